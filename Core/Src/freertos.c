@@ -28,7 +28,14 @@
 #include "log.h"
 #include "ble_data.h"
 #include "modbus.h"
+#include "modbus_rtu.h"
+#include "tuning.h"
 #include "flash.h"
+#include "flash_fs.h"
+#include "fw_update.h"
+#include "record_codec.h"
+#include "flash_column.h"
+#include "flash_io.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include "delay.h"
@@ -61,12 +68,28 @@
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
-/* BLE接收缓冲区 */
-  uint8_t bt_rx_buffer[256];
 /* 全局任务句柄 */
 osThreadId_t g_PressureTaskHandle;  // 压力任务全局句柄
 osThreadId_t g_LCDTaskHandle;       // LCD任务全局句柄
 osThreadId_t g_DHT11TaskHandle;  // dht11任务全局句柄
+/* Flash I/O服务任务，优先级高于所有提交请求的任务 */
+osThreadId_t FlashIO_TaskHandle;
+const osThreadAttr_t FlashIO_Task_attributes = {
+  .name = "FlashIO_Task",
+  .stack_size = 768 * 4,
+  .priority = (osPriority_t) osPriorityBelowNormal,
+};
+/* USART3 Modbus RTU从机，与Usart2_Task同优先级，共用寄存器表 */
+osThreadId_t Usart3_TaskHandle;
+const osThreadAttr_t Usart3_Task_attributes = {
+  .name = "Usart3_Task",
+  .stack_size = 512 * 4,
+  .priority = (osPriority_t) osPriorityLow1,
+};
+osMessageQueueId_t Usart3QueueHandle;
+const osMessageQueueAttr_t Usart3Queue_attributes = {
+  .name = "Usart3Queue"
+};
 /* USER CODE END Variables */
 /* Definitions for Log_Task */
 osThreadId_t Log_TaskHandle;
@@ -142,6 +165,11 @@ const osMutexAttr_t uart1_mutex_attributes = {
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN FunctionPrototypes */
+#if FLASH_COLUMN_STORE_ENABLE
+static FlashResult_t FlashTask_ColumnAppend(void *context);
+#endif
+static void Usart3Task(void *argument);
+static void FlashTask_LogStackUsage(void);
 
 /* USER CODE END FunctionPrototypes */
 
@@ -186,9 +214,10 @@ void MX_FREERTOS_Init(void) {
   logQueueHandle = osMessageQueueNew (10, 64, &logQueue_attributes);
 
   /* creation of BLEQueue */
-  BLEQueueHandle = osMessageQueueNew (5, 262, &BLEQueue_attributes);
+  BLEQueueHandle = osMessageQueueNew (5, 268, &BLEQueue_attributes);
 
   /* USER CODE BEGIN RTOS_QUEUES */
+  Usart3QueueHandle = osMessageQueueNew(3, sizeof(BLEMessage_t), &Usart3Queue_attributes);
   /* add queues, ... */
   /* USER CODE END RTOS_QUEUES */
 
@@ -221,6 +250,7 @@ void MX_FREERTOS_Init(void) {
   g_PressureTaskHandle = Pressure_TaskHandle;  // 压力任务全局句柄
   g_LCDTaskHandle = LCD_TaskHandle;       // LCD任务全局句柄
   g_DHT11TaskHandle = DHT11_TaskHandle;  // DHT11任务全局句柄
+  FlashIO_TaskHandle = osThreadNew(FlashIo_Task, NULL, &FlashIO_Task_attributes);
   /* add threads, ... */
   /* USER CODE END RTOS_THREADS */
 
@@ -313,7 +343,7 @@ void PressureTask(void *argument)
   for(;;)
   {
       /* 等待任务通知或超时 */
-      uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, 5000);  /* 等待5秒或任务通知 */
+      uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, g_tuning.pressure_period_ms);  /* 等待采样周期或任务通知 */
       
       if (flags & 0x01) {
           /* 收到任务通知，立即读取压力 */
@@ -356,44 +386,51 @@ void Usart2Task(void *argument)
   /* USER CODE BEGIN Usart2Task */
   BLEMessage_t ble_msg;
   osStatus_t status;
-  uint8_t modbus_response[256];
   uint16_t response_length;
+  uint8_t first_response = 1;
+  
+  /* 初始化Modbus系统：等待Flash I/O服务任务加载热启动状态，恢复复位前的最近值 */
+  Modbus_Init();
   
-  /* 等待系统初始化完成 */
-  osDelay(200);
+  /* 寄存器表初始化后启动USART3从机 */
+  Usart3_TaskHandle = osThreadNew(Usart3Task, NULL, &Usart3_Task_attributes);
   
-  /* 初始化BLE系统 */
+  /* 初始化BLE系统，开始接收 */
   BLE_Init();
   
-  /* 初始化Modbus系统 */
-  Modbus_Init();
+  /* 初始化固件暂存 */
+  FwUpdate_Init();
   
   Log_Info("Usart2 Task started, waiting for data from UART2");
   /* Infinite loop */
   for(;;)
   {
-    /* 从消息队列获取BLE消息 */
-    status = osMessageQueueGet(BLEQueueHandle, &ble_msg, NULL, osWaitForever);
-    if (status == osOK)
+    /* 从消息队列获取BLE消息，固件暂存会话中定时检查超时 */
+    status = osMessageQueueGet(BLEQueueHandle, &ble_msg, NULL, FwUpdate_IsActive() ? 1000 : osWaitForever);
+    if (status == osErrorTimeout)
+    {
+      FwUpdate_Poll();
+    }
+    else if (status == osOK)
     {
-      /* 先检测是否为Modbus命令 */
-      if (Modbus_IsModbusCommand(ble_msg.data, ble_msg.length))
+      /* 固件暂存会话中的数据全部交给固件暂存模块 */
+      if (FwUpdate_IsActive() || FwUpdate_IsStartFrame(ble_msg.data, ble_msg.length))
+      {
+        FwUpdate_Feed(ble_msg.data, ble_msg.length);
+      }
+      /* 完整且CRC正确的RTU帧，发给其他从机的忽略 */
+      else if (ble_msg.flags & MODBUS_RTU_FRAME_OK)
       {
-        /* 是Modbus命令，处理Modbus请求 */
-        Modbus_ProcessRequest(ble_msg.data, ble_msg.length, modbus_response, &response_length);
+        /* DMA发送应答，不使用串口1；应答旁路在DEBUG级别经日志任务输出 */
+        response_length = ModbusRtu_Serve(&g_modbus_rtu_usart2, &ble_msg);
         
         if (response_length > 0)
         {
-          /* 获取UART1互斥锁 */
-          osMutexAcquire(uart1_mutexHandle, osWaitForever);
-          
-          /* 发送Modbus响应 */
-          HAL_UART_Transmit(&huart1, modbus_response, response_length, 100);
-          HAL_UART_Transmit(&huart2, modbus_response, response_length, 100);
-          /* 释放UART1互斥锁 */
-          osMutexRelease(uart1_mutexHandle);
-          
-          Log_Info("Modbus response sent: %d bytes", response_length);
+          /* 复位到第一个应答的时间 */
+          if (first_response) {
+            first_response = 0;
+            Log_Info("Modbus: first response at %lu ms", osKernelGetTickCount());
+          }
         }
       }
       else
@@ -453,7 +490,7 @@ void LCDTask(void *argument)
   for(;;)
   {
     /* 等待任务通知或超时 */
-    uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, 1000);  /* 等待1秒超时 */
+    uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, g_tuning.lcd_period_ms);  /* 等待刷新周期超时 */
     
     display_counter++;
     
@@ -640,7 +677,7 @@ void DHT11Task(void *argument)
   {
     counter ++;
     /* 等待任务通知或超时 */
-    uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, 5000);  /* 等待5秒或任务通知 */
+    uint32_t flags = osThreadFlagsWait(0x01, osFlagsWaitAny, g_tuning.dht11_period_ms);  /* 等待采样周期或任务通知 */
     
     Log_Debug("counter : %d",counter);
     read_count++;
@@ -685,8 +722,10 @@ void FLASHTask(void *argument)
   
   Log_Info("Flash Task: Starting...");
   
-  /* 初始化Flash存储系统 */
-  Flash_TaskInit();
+  /* Flash初始化、文件区挂载和列存储初始化由Flash I/O服务任务完成 */
+  while (!FlashIo_IsReady()) {
+    osDelay(100);
+  }
   
   /* 等待系统稳定 */
   osDelay(2000);
@@ -697,80 +736,41 @@ void FLASHTask(void *argument)
   /* Infinite loop */
   for(;;)
   {
-    /* 看门狗机制 - 记录任务开始时间 */
-    uint32_t task_start_time = osKernelGetTickCount();
-    
-    /* 处理Flash任务 */
-    Flash_TaskProcess();
-    
-    /* 检查任务执行时间，如果超过5秒则认为任务卡住 */
-    uint32_t task_duration = osKernelGetTickCount() - task_start_time;
-    if (task_duration > 5000) {
-      Log_Error("Flash Task: Task execution took %lu ms - possible hang detected!", task_duration);
-    }
-    
-    /* 每5秒存储一次传感器数据 */
+    /* 每个存储周期存储一次传感器数据 */
     static uint32_t last_store_time = 0;
     uint32_t current_time = osKernelGetTickCount();
     
-    if (current_time - last_store_time >= 5000) {
+    if (current_time - last_store_time >= g_tuning.store_period_s * 1000UL) {
       /* 获取全局传感器数据 */
       GlobalSensorData_t* sensor_data = SensorData_GetGlobalData();
       
-      /* 准备传感器数据用于存储 */
-      uint8_t sensor_data_bytes[sizeof(GlobalSensorData_t)];
-      memcpy(sensor_data_bytes, sensor_data, sizeof(GlobalSensorData_t));
+      /* 按记录格式编码传感器数据 */
+      uint8_t record[RECORD_ENCODED_SIZE];
+      uint32_t record_length = RecordCodec_EncodeSensorData(sensor_data, record);
       
       /* 存储传感器数据 */
       uint32_t record_id;
-      FlashResult_t result = Flash_StoreData(sensor_data_bytes, sizeof(GlobalSensorData_t), &record_id);
+      FlashResult_t result = FlashIo_StoreData(record, record_length, &record_id);
       
       if (result == FLASH_OK) {
         Log_Info("Flash Task: Stored sensor data with ID %lu", record_id);
         
         /* 立即读取验证数据一致性 */
         ReadResult_t read_result;
-        result = Flash_ReadData(record_id, &read_result);
+        GlobalSensorData_t read_data;
+        result = FlashIo_ReadData(FLASH_IO_DURABLE, record_id, &read_result);
         
         if (result == FLASH_OK && read_result.valid) {
-          /* 比较存储和读取的数据 */
-          if (read_result.data_length == sizeof(GlobalSensorData_t)) {
-            GlobalSensorData_t* read_data = (GlobalSensorData_t*)read_result.data;
-            
-            /* 验证关键数据字段 */
-            int data_match = 1;
-            if (sensor_data->pressure_value != read_data->pressure_value) {
-              Log_Error("Flash Task: Pressure value mismatch! Stored: %.6f, Read: %.6f", 
-                       sensor_data->pressure_value, read_data->pressure_value);
-              data_match = 0;
-            }
-            if (sensor_data->temperature != read_data->temperature) {
-              Log_Error("Flash Task: Temperature value mismatch! Stored: %.2f, Read: %.2f", 
-                       sensor_data->temperature, read_data->temperature);
-              data_match = 0;
-            }
-            if (sensor_data->humidity != read_data->humidity) {
-              Log_Error("Flash Task: Humidity value mismatch! Stored: %.2f, Read: %.2f", 
-                       sensor_data->humidity, read_data->humidity);
-              data_match = 0;
-            }
-            if (sensor_data->system_status != read_data->system_status) {
-              Log_Error("Flash Task: System status mismatch! Stored: 0x%04X, Read: 0x%04X", 
-                       sensor_data->system_status, read_data->system_status);
-              data_match = 0;
-            }
-            
-            if (data_match) {
-              Log_Info("Flash Task: Data verification PASSED - All sensor data matches");
-              Log_Info("Flash Task: P:%.6f T:%.2f H:%.2f S:0x%04X", 
-                      sensor_data->pressure_value, sensor_data->temperature, 
-                      sensor_data->humidity, sensor_data->system_status);
-            } else {
-              Log_Error("Flash Task: Data verification FAILED - Data mismatch detected");
-            }
+          /* 比较存储和读取的记录 */
+          if (read_result.data_length == record_length &&
+              memcmp(read_result.data, record, record_length) == 0 &&
+              RecordCodec_DecodeSensorData(read_result.data, read_result.data_length, &read_data)) {
+            Log_Info("Flash Task: Data verification PASSED - All sensor data matches");
+            Log_Info("Flash Task: P:%.6f T:%.2f H:%.2f S:0x%04X", 
+                    read_data.pressure_value, read_data.temperature, 
+                    read_data.humidity, read_data.system_status);
           } else {
-            Log_Error("Flash Task: Data length mismatch! Expected: %lu, Read: %lu", 
-                     sizeof(GlobalSensorData_t), read_result.data_length);
+            Log_Error("Flash Task: Data verification FAILED - Data mismatch detected");
           }
         } else {
           Log_Error("Flash Task: Failed to read stored data for verification");
@@ -779,16 +779,90 @@ void FLASHTask(void *argument)
         Log_Error("Flash Task: Failed to store sensor data, error %d", result);
       }
       
+#if FLASH_COLUMN_STORE_ENABLE
+      /* 同时按列保存，供单字段查询 */
+      if (FlashIo_Call(FLASH_IO_DURABLE, FlashTask_ColumnAppend, record) != FLASH_OK) {
+        Log_Error("Flash Task: Column store append failed");
+      }
+#endif
+      
       last_store_time = current_time;
+      FlashTask_LogStackUsage();
     }
     
-    osDelay(1);
+    osDelay(100);
   }
   /* USER CODE END FLASHTask */
 }
 
 /* Private application code --------------------------------------------------*/
 /* USER CODE BEGIN Application */
+/**
+ * @brief USART3 Modbus RTU从机任务
+ * @note 只处理Modbus帧，不转发字符串，没有应答旁路，不与Usart2_Task共用锁
+ */
+static void Usart3Task(void *argument)
+{
+  BLEMessage_t msg;
+
+  ModbusRtu_Start(&g_modbus_rtu_usart3);
+  Log_Info("Usart3 Task started, Modbus RTU on UART3");
+
+  for(;;)
+  {
+    if (osMessageQueueGet(Usart3QueueHandle, &msg, NULL, osWaitForever) != osOK)
+    {
+      continue;
+    }
+
+    /* 完整且CRC正确的RTU帧，其他的已计入帧定界统计 */
+    if (msg.flags & MODBUS_RTU_FRAME_OK)
+    {
+      ModbusRtu_Serve(&g_modbus_rtu_usart3, &msg);
+    }
+  }
+}
+
+#if FLASH_COLUMN_STORE_ENABLE
+/**
+ * @brief 追加一条编码记录到列存储（在Flash I/O服务任务中执行）
+ * @param context 编码记录，长度RECORD_ENCODED_SIZE
+ */
+static FlashResult_t FlashTask_ColumnAppend(void *context)
+{
+  return FlashColumn_Append((const uint8_t*)context, RECORD_ENCODED_SIZE);
+}
+#endif
+
+/**
+ * @brief 记录FlashIO/Usart3任务栈余量和堆最低余量
+ * @note 只在余量创新低时输出，长期运行后日志里最后一条即板上实测的最坏值
+ */
+static void FlashTask_LogStackUsage(void)
+{
+  static UBaseType_t s_flash_io_free = (UBaseType_t)-1;
+  static UBaseType_t s_usart3_free = (UBaseType_t)-1;
+  UBaseType_t flash_io_free;
+  UBaseType_t usart3_free;
+
+  if (FlashIO_TaskHandle == NULL || Usart3_TaskHandle == NULL) {
+    return;
+  }
+
+  /* 高水位线以StackType_t(4字节)为单位 */
+  flash_io_free = uxTaskGetStackHighWaterMark((TaskHandle_t)FlashIO_TaskHandle);
+  usart3_free = uxTaskGetStackHighWaterMark((TaskHandle_t)Usart3_TaskHandle);
+
+  if (flash_io_free < s_flash_io_free || usart3_free < s_usart3_free) {
+    s_flash_io_free = flash_io_free;
+    s_usart3_free = usart3_free;
+    /* 日志缓冲区只有56字节，栈大小见任务属性（3 KB / 2 KB） */
+    Log_Info("Stack free: FlashIO %lu Usart3 %lu heap %lu B",
+             (unsigned long)(flash_io_free * sizeof(StackType_t)),
+             (unsigned long)(usart3_free * sizeof(StackType_t)),
+             (unsigned long)xPortGetMinimumEverFreeHeapSize());
+  }
+}
 
 /* USER CODE END Application */
 
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    host_port.h
+  * @brief   主机构建强制包含的头文件（-include）
+  *          先包含HAL头文件，再把Cortex-M3专有的内核寄存器和指令替换为主机实现
+  ******************************************************************************
+  */
+#ifndef __HOST_PORT_H__
+#define __HOST_PORT_H__
+
+#include "stm32f1xx_hal.h"
+
+/* DWT周期计数器：DWT_Init/DWT_GetTick由host_os.c按主机时钟实现 */
+#undef DWT
+extern DWT_Type host_dwt;
+#define DWT (&host_dwt)
+
+/* 与ARM指令语义一致：CLZ(0) = 32 */
+static inline uint32_t Host_Clz(uint32_t value)
+{
+    return (value != 0) ? (uint32_t)__builtin_clz(value) : 32;
+}
+
+static inline uint32_t Host_Rev16(uint32_t value)
+{
+    return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+
+#undef __CLZ
+#define __CLZ(value)            Host_Clz(value)
+#define __REV16(value)          Host_Rev16(value)
+#define __DMB()                 __sync_synchronize()
+
+/* 主机上没有中断，PRIMASK临界区为空操作 */
+#define __get_PRIMASK()         0u
+#define __set_PRIMASK(mask)     ((void)(mask))
+#define __disable_irq()         ((void)0)
+
+/* 没有CRC单元：CRC32全部由软件计算 */
+#define CRC32_HW_MIN_LENGTH     UINT32_MAX
+
+#endif /* __HOST_PORT_H__ */
@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    host_board.c
+  * @brief   主机构建的板级外设桩（UART、定时器、DMA）和Flash启动流程
+  *          外设句柄指向内存中的寄存器结构，modbus_rtu.c的寄存器宏可以直接执行；
+  *          发送立即完成：中断、DMA方式直接调用Modbus端口的发送完成回调
+  *          （与usart.c的HAL_UART_TxCpltCallback相同）
+  ******************************************************************************
+  */
+#include "host_board.h"
+#include "flash_io.h"
+#include "flash_fs.h"
+#include "flash_column.h"
+#include "record_codec.h"
+#include "tuning.h"
+#include "warm_state.h"
+#include "modbus_rtu.h"
+#include "usart.h"
+#include "tim.h"
+
+#include <string.h>
+
+uint32_t SystemCoreClock = 72000000;
+
+UART_HandleTypeDef huart1;
+UART_HandleTypeDef huart2;
+UART_HandleTypeDef huart3;
+TIM_HandleTypeDef htim4;
+TIM_HandleTypeDef htim5;
+
+osMessageQueueId_t BLEQueueHandle;
+osMessageQueueId_t Usart3QueueHandle;
+osThreadId_t g_PressureTaskHandle;
+osThreadId_t g_DHT11TaskHandle;
+
+/* 外设寄存器（内存中） */
+static USART_TypeDef host_usart[3];
+static TIM_TypeDef host_tim[2];
+
+/**
+ * @brief 初始化外设句柄
+ * @note 与CubeMX生成的配置一致：115200 8N1，不使用DMA接收
+ */
+void HostBoard_Init(void)
+{
+    UART_HandleTypeDef *uarts[3] = { &huart1, &huart2, &huart3 };
+
+    for (uint32_t i = 0; i < 3; i++) {
+        uarts[i]->Instance = &host_usart[i];
+        uarts[i]->Init.BaudRate = 115200;
+        uarts[i]->Init.WordLength = UART_WORDLENGTH_8B;
+        uarts[i]->Init.StopBits = UART_STOPBITS_1;
+        uarts[i]->Init.Parity = UART_PARITY_NONE;
+        uarts[i]->gState = HAL_UART_STATE_READY;
+    }
+    htim4.Instance = &host_tim[0];
+    htim5.Instance = &host_tim[1];
+}
+
+/**
+ * @brief 按FlashIO任务的顺序初始化Flash，并在当前线程启动服务
+ * @note 之后当前线程就是服务任务：FlashIo_*请求直接执行
+ */
+FlashResult_t HostBoard_FlashInit(void)
+{
+    Flash_SetProbeHook(WarmState_Load);
+    FlashResult_t result = Flash_Init();
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    FlashFs_Mount();
+    Tuning_Load();
+#if FLASH_COLUMN_STORE_ENABLE
+    FlashColumn_Init();
+#endif
+    FlashIo_Init();
+    return FLASH_OK;
+}
+
+#if FLASH_COLUMN_STORE_ENABLE
+/**
+ * @brief 向列存储追加samples个确定的传感器样本并刷新
+ */
+FlashResult_t HostBoard_FillColumns(uint32_t samples)
+{
+    GlobalSensorData_t data;
+    uint8_t record[RECORD_ENCODED_SIZE];
+
+    for (uint32_t i = 0; i < samples; i++) {
+        memset(&data, 0, sizeof(data));
+        data.system_timestamp = 0x12345678u + i * 5000u;
+        data.pressure_value = 0.1 + (i % 1000) * 0.000123;
+        data.temperature = -5.0f + (i % 50) * 0.7f;
+        data.humidity = 40.0f + (i % 30);
+        data.system_status = i & 0xFFFF;
+        data.error_count = i % 7;
+        data.pressure_valid = i & 1;
+        data.temperature_valid = 1;
+        data.humidity_valid = (i >> 1) & 1;
+
+        RecordCodec_EncodeSensorData(&data, record);
+        FlashResult_t result = FlashColumn_Append(record, RECORD_ENCODED_SIZE);
+        if (result != FLASH_OK) {
+            return result;
+        }
+    }
+    return FlashColumn_Flush();
+}
+#endif
+
+/* HAL UART/DMA -----------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    (void)Timeout;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    (void)pData;
+    (void)Size;
+    ModbusRtu_TxCpltCallback(huart);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    (void)pData;
+    (void)Size;
+    ModbusRtu_TxCpltCallback(huart);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength)
+{
+    (void)hdma;
+    (void)SrcAddress;
+    (void)DstAddress;
+    (void)DataLength;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return HAL_OK;
+}
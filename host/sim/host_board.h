@@ -0,0 +1,18 @@
+/**
+  ******************************************************************************
+  * @file    host_board.h
+  * @brief   主机构建的板级外设桩（UART、定时器、DMA）和Flash启动流程
+  ******************************************************************************
+  */
+#ifndef __HOST_BOARD_H__
+#define __HOST_BOARD_H__
+
+#include "flash.h"
+
+void HostBoard_Init(void);
+FlashResult_t HostBoard_FlashInit(void);
+#if FLASH_COLUMN_STORE_ENABLE
+FlashResult_t HostBoard_FillColumns(uint32_t samples);
+#endif
+
+#endif /* __HOST_BOARD_H__ */
@@ -0,0 +1,450 @@
+/**
+  ******************************************************************************
+  * @file    host_os.c
+  * @brief   主机构建的CMSIS-RTOS2子集、时钟和日志输出
+  *          只实现应用代码用到的函数：任务标志、调度器锁、延时、tick、日志队列
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "bsp_dwt.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 虚拟时钟下osWaitForever最多等待的模拟时间，超过即判定为死锁 */
+#define HOST_WAIT_FOREVER_LIMIT_NS  (600ull * 1000000000ull)
+
+/* 虚拟时钟下等待任务标志时每次推进的时间 */
+#define HOST_WAIT_STEP_NS           (100ull * 1000ull)
+
+/* 任务控制块：任务标志和唤醒条件 */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t flags;
+    osThreadFunc_t func;
+    void *argument;
+} HostThread_t;
+
+/* 日志队列句柄（freertos.c中定义），主机上直接输出 */
+osMessageQueueId_t logQueueHandle = (osMessageQueueId_t)&logQueueHandle;
+
+static HostClock_t g_host_clock = HOST_CLOCK_VIRTUAL;
+static uint64_t g_virtual_ns = 0;
+static uint64_t g_real_base_ns = 0;
+static HostIdleHook_t g_idle_hook = NULL;
+static bool g_in_idle_hook = false;
+
+static pthread_mutex_t g_kernel_lock;
+static uint32_t g_kernel_lock_depth = 0;
+static pthread_mutex_t g_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread HostThread_t *g_self = NULL;
+
+static bool g_log_quiet = false;
+static uint32_t g_pass_count = 0;
+static uint32_t g_fail_count = 0;
+static LogMessage_t g_log_last;                 /* 上一条日志，用于合并重复消息 */
+static uint32_t g_log_repeats = 0;
+
+DWT_Type host_dwt;
+
+/**
+ * @brief 单调时钟（纳秒）
+ */
+static uint64_t HostOs_MonotonicNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 初始化任务控制块
+ */
+static HostThread_t* HostOs_NewThread(void)
+{
+    HostThread_t *thread = calloc(1, sizeof(HostThread_t));
+
+    if (thread == NULL) {
+        abort();
+    }
+    pthread_mutex_init(&thread->mutex, NULL);
+    pthread_cond_init(&thread->cond, NULL);
+    return thread;
+}
+
+/**
+ * @brief 当前任务的控制块，主线程首次调用时创建
+ */
+static HostThread_t* HostOs_Self(void)
+{
+    if (g_self == NULL) {
+        g_self = HostOs_NewThread();
+    }
+    return g_self;
+}
+
+/**
+ * @brief 初始化主机运行环境
+ * @param clock 时钟类型，虚拟时钟从0开始
+ */
+void HostOs_Init(HostClock_t clock)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&g_kernel_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    g_host_clock = clock;
+    g_virtual_ns = 0;
+    g_real_base_ns = HostOs_MonotonicNs();
+    g_idle_hook = NULL;
+    HostOs_Self();
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+}
+
+HostClock_t HostOs_GetClock(void)
+{
+    return g_host_clock;
+}
+
+/**
+ * @brief 当前时刻（纳秒）
+ */
+uint64_t HostOs_GetNs(void)
+{
+    if (g_host_clock == HOST_CLOCK_VIRTUAL) {
+        return g_virtual_ns;
+    }
+    return HostOs_MonotonicNs() - g_real_base_ns;
+}
+
+uint64_t HostOs_GetUs(void)
+{
+    return HostOs_GetNs() / 1000;
+}
+
+/**
+ * @brief 模拟耗时
+ * @param ns 耗时（纳秒）
+ * @note 虚拟时钟直接推进并调用空闲回调；实时时钟忙等（模拟SPI传输占用CPU）
+ */
+void HostOs_AdvanceNs(uint64_t ns)
+{
+    if (g_host_clock == HOST_CLOCK_REAL) {
+        uint64_t until = HostOs_MonotonicNs() + ns;
+        while (HostOs_MonotonicNs() < until) {
+        }
+        return;
+    }
+
+    g_virtual_ns += ns;
+
+    /* 回调中提交请求也会经过这里，不能重入 */
+    if (g_idle_hook != NULL && !g_in_idle_hook) {
+        g_in_idle_hook = true;
+        g_idle_hook();
+        g_in_idle_hook = false;
+    }
+}
+
+/**
+ * @brief 设置虚拟时钟推进时的回调
+ */
+void HostOs_SetIdleHook(HostIdleHook_t hook)
+{
+    g_idle_hook = hook;
+}
+
+void HostOs_SetLogQuiet(bool quiet)
+{
+    g_log_quiet = quiet;
+}
+
+uint32_t HostOs_GetPassCount(void)
+{
+    return g_pass_count;
+}
+
+uint32_t HostOs_GetFailCount(void)
+{
+    return g_fail_count;
+}
+
+/* CMSIS-RTOS2 ---------------------------------------------------------------*/
+
+uint32_t osKernelGetTickCount(void)
+{
+    return (uint32_t)(HostOs_GetNs() / 1000000ull);
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return 1000;
+}
+
+int32_t osKernelLock(void)
+{
+    pthread_mutex_lock(&g_kernel_lock);
+    return (g_kernel_lock_depth++ > 0) ? 1 : 0;
+}
+
+int32_t osKernelUnlock(void)
+{
+    g_kernel_lock_depth--;
+    pthread_mutex_unlock(&g_kernel_lock);
+    return 1;
+}
+
+int32_t osKernelRestoreLock(int32_t lock)
+{
+    g_kernel_lock_depth--;
+    pthread_mutex_unlock(&g_kernel_lock);
+    return lock;
+}
+
+/**
+ * @brief pthread入口
+ */
+static void* HostOs_ThreadEntry(void *argument)
+{
+    HostThread_t *thread = (HostThread_t*)argument;
+
+    g_self = thread;
+    thread->func(thread->argument);
+    return NULL;
+}
+
+/**
+ * @brief 创建任务
+ * @note 只支持实时时钟；优先级、栈大小等属性忽略
+ */
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+    HostThread_t *thread;
+    pthread_t handle;
+
+    (void)attr;
+
+    if (g_host_clock != HOST_CLOCK_REAL) {
+        fprintf(stderr, "host: osThreadNew needs the real-time clock\n");
+        abort();
+    }
+
+    thread = HostOs_NewThread();
+    thread->func = func;
+    thread->argument = argument;
+    if (pthread_create(&handle, NULL, HostOs_ThreadEntry, thread) != 0) {
+        abort();
+    }
+    pthread_detach(handle);
+    return (osThreadId_t)thread;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return (osThreadId_t)HostOs_Self();
+}
+
+uint32_t osThreadGetStackSpace(osThreadId_t thread_id)
+{
+    (void)thread_id;
+    return 1024;
+}
+
+osStatus_t osThreadYield(void)
+{
+    sched_yield();
+    return osOK;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+    HostThread_t *thread = (HostThread_t*)thread_id;
+    uint32_t result;
+
+    if (thread == NULL) {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&thread->mutex);
+    thread->flags |= flags;
+    result = thread->flags;
+    pthread_cond_broadcast(&thread->cond);
+    pthread_mutex_unlock(&thread->mutex);
+    return result;
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+    HostThread_t *thread = HostOs_Self();
+
+    pthread_mutex_lock(&thread->mutex);
+    uint32_t result = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&thread->mutex);
+    return result;
+}
+
+/**
+ * @brief 标志是否满足等待条件，满足时按选项清除
+ */
+static bool HostOs_TakeFlags(HostThread_t *thread, uint32_t flags, uint32_t options, uint32_t *result)
+{
+    uint32_t match = thread->flags & flags;
+    bool satisfied = (options & osFlagsWaitAll) ? (match == flags) : (match != 0);
+
+    if (satisfied) {
+        *result = thread->flags;
+        if (!(options & osFlagsNoClear)) {
+            thread->flags &= ~flags;
+        }
+    }
+    return satisfied;
+}
+
+/**
+ * @brief 等待任务标志
+ * @note 虚拟时钟下按HOST_WAIT_STEP_NS推进时间，空闲回调可在等待期间设置标志
+ */
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    HostThread_t *thread = HostOs_Self();
+    uint32_t result = osFlagsErrorTimeout;
+
+    if (g_host_clock == HOST_CLOCK_VIRTUAL) {
+        uint64_t limit = (timeout == osWaitForever) ? HOST_WAIT_FOREVER_LIMIT_NS :
+                         (uint64_t)timeout * 1000000ull;
+        uint64_t waited = 0;
+
+        for (;;) {
+            if (HostOs_TakeFlags(thread, flags, options, &result)) {
+                return result;
+            }
+            if (waited >= limit) {
+                break;
+            }
+            HostOs_AdvanceNs(HOST_WAIT_STEP_NS);
+            waited += HOST_WAIT_STEP_NS;
+        }
+
+        if (timeout == osWaitForever) {
+            fprintf(stderr, "host: osThreadFlagsWait(0x%X) never satisfied\n", (unsigned)flags);
+            abort();
+        }
+        return (timeout == 0) ? (uint32_t)osFlagsErrorResource : result;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (timeout != osWaitForever) {
+        uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)timeout * 1000000ull;
+        deadline.tv_sec += (time_t)(ns / 1000000000ull);
+        deadline.tv_nsec = (long)(ns % 1000000000ull);
+    }
+
+    pthread_mutex_lock(&thread->mutex);
+    for (;;) {
+        if (HostOs_TakeFlags(thread, flags, options, &result)) {
+            break;
+        }
+        if (timeout == 0) {
+            result = osFlagsErrorResource;
+            break;
+        }
+        if (timeout == osWaitForever) {
+            pthread_cond_wait(&thread->cond, &thread->mutex);
+        } else if (pthread_cond_timedwait(&thread->cond, &thread->mutex, &deadline) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread->mutex);
+    return result;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    if (g_host_clock == HOST_CLOCK_VIRTUAL) {
+        HostOs_AdvanceNs((uint64_t)ticks * 1000000ull);
+    } else {
+        struct timespec ts = { (time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return osOK;
+}
+
+/**
+ * @brief 消息队列发送
+ * @note 只有日志队列有接收方：按LogTask的格式立即输出，其他队列的消息丢弃；
+ *       连续相同的消息（基准测试循环中的异常应答日志）只输出一次和重复次数
+ */
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout)
+{
+    static const char *levels[LOG_LEVEL_MAX] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
+    const LogMessage_t *message = (const LogMessage_t*)msg_ptr;
+
+    (void)msg_prio;
+    (void)timeout;
+
+    if (mq_id != logQueueHandle) {
+        return osOK;
+    }
+
+    pthread_mutex_lock(&g_log_lock);
+    if (strstr(message->message, "FAIL") != NULL) {
+        g_fail_count++;
+    } else if (strstr(message->message, "PASS") != NULL) {
+        g_pass_count++;
+    }
+    if (message->level == g_log_last.level && strcmp(message->message, g_log_last.message) == 0) {
+        g_log_repeats++;
+    } else {
+        if (g_log_repeats > 0 && !g_log_quiet) {
+            printf("[%5lu] %s: (repeated %lu times)\n", (unsigned long)g_log_last.timestamp,
+                   (g_log_last.level < LOG_LEVEL_MAX) ? levels[g_log_last.level] : "UNKN",
+                   (unsigned long)g_log_repeats);
+        }
+        g_log_repeats = 0;
+        if (!g_log_quiet) {
+            printf("[%5lu] %s: %s\n", (unsigned long)message->timestamp,
+                   (message->level < LOG_LEVEL_MAX) ? levels[message->level] : "UNKN",
+                   message->message);
+        }
+    }
+    g_log_last = *message;
+    pthread_mutex_unlock(&g_log_lock);
+    return osOK;
+}
+
+/* HAL和DWT -------------------------------------------------------------------*/
+
+uint32_t HAL_GetTick(void)
+{
+    return osKernelGetTickCount();
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    osDelay(Delay);
+}
+
+void DWT_Init(void)
+{
+    host_dwt.CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief 周期计数按SystemCoreClock由主机时钟换算
+ */
+uint32_t DWT_GetTick(void)
+{
+    return (uint32_t)(HostOs_GetNs() * (SystemCoreClock / 1000000u) / 1000ull);
+}
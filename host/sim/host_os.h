@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    host_os.h
+  * @brief   主机构建的CMSIS-RTOS2子集、时钟和日志输出
+  *          虚拟时钟：单线程，时间只随SPI传输、芯片忙等和osDelay推进，结果可复现；
+  *          实时时钟：osThreadNew在pthread上创建任务，用于多任务压力测试
+  ******************************************************************************
+  */
+#ifndef __HOST_OS_H__
+#define __HOST_OS_H__
+
+#include "cmsis_os.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 时钟类型 */
+typedef enum {
+    HOST_CLOCK_VIRTUAL = 0,     /* 虚拟时钟，只能单线程使用 */
+    HOST_CLOCK_REAL             /* 单调实时时钟 */
+} HostClock_t;
+
+/* 虚拟时钟推进时的回调，用于在模拟时刻注入请求 */
+typedef void (*HostIdleHook_t)(void);
+
+void HostOs_Init(HostClock_t clock);
+HostClock_t HostOs_GetClock(void);
+uint64_t HostOs_GetNs(void);
+uint64_t HostOs_GetUs(void);
+void HostOs_AdvanceNs(uint64_t ns);
+void HostOs_SetIdleHook(HostIdleHook_t hook);
+
+/* 日志输出（按LogTask的格式写到stdout），并统计含PASS、FAIL的消息数 */
+void HostOs_SetLogQuiet(bool quiet);
+uint32_t HostOs_GetPassCount(void);
+uint32_t HostOs_GetFailCount(void);
+
+#endif /* __HOST_OS_H__ */
@@ -0,0 +1,519 @@
+/**
+  ******************************************************************************
+  * @file    w25q_sim.c
+  * @brief   W25Qxx SPI Flash芯片模型（主机构建）
+  *          按字节解析片选期间的命令；编程/擦除在片选释放时生效，
+  *          打开timing时芯片在典型时间内保持忙，支持75h/7Ah擦除暂停和恢复
+  ******************************************************************************
+  */
+#include "w25q_sim.h"
+#include "host_os.h"
+#include "main.h"
+#include "spi.h"
+
+#include <string.h>
+
+/* 命令 */
+#define SIM_CMD_WRITE_ENABLE    0x06
+#define SIM_CMD_WRITE_DISABLE   0x04
+#define SIM_CMD_READ_STATUS1    0x05
+#define SIM_CMD_READ_STATUS2    0x35
+#define SIM_CMD_READ            0x03
+#define SIM_CMD_FAST_READ       0x0B
+#define SIM_CMD_READ_4B         0x13
+#define SIM_CMD_FAST_READ_4B    0x0C
+#define SIM_CMD_PROGRAM         0x02
+#define SIM_CMD_PROGRAM_4B      0x12
+#define SIM_CMD_SECTOR_ERASE    0x20
+#define SIM_CMD_SECTOR_ERASE_4B 0x21
+#define SIM_CMD_BLOCK32_ERASE   0x52
+#define SIM_CMD_BLOCK_ERASE     0xD8
+#define SIM_CMD_BLOCK_ERASE_4B  0xDC
+#define SIM_CMD_CHIP_ERASE      0xC7
+#define SIM_CMD_CHIP_ERASE_ALT  0x60
+#define SIM_CMD_JEDEC_ID        0x9F
+#define SIM_CMD_DEVICE_ID       0x90
+#define SIM_CMD_RELEASE_PD      0xAB
+#define SIM_CMD_READ_SFDP       0x5A
+#define SIM_CMD_ENTER_4B        0xB7
+#define SIM_CMD_EXIT_4B         0xE9
+#define SIM_CMD_RESET           0x99
+#define SIM_CMD_SUSPEND         0x75
+#define SIM_CMD_RESUME          0x7A
+
+#define SIM_STATUS_BUSY         0x01
+#define SIM_STATUS_WEL          0x02
+#define SIM_STATUS2_SUS         0x80
+
+#define SIM_PAGE_SIZE           256u
+
+SPI_HandleTypeDef hspi1;
+
+static uint8_t g_sim_memory[W25Q_SIM_MAX_SIZE];
+static W25QSimConfig_t g_sim_config;
+static W25QSimStats_t g_sim_stats;
+static int32_t g_sim_program_limit = -1;
+
+/* 片选期间的命令解析状态 */
+static bool g_selected = false;
+static uint8_t g_cmd = 0;
+static uint32_t g_header = 0;           /* 已接收的命令+地址+空字节数 */
+static uint32_t g_address = 0;
+static uint32_t g_data_count = 0;       /* 命令头之后的数据字节数 */
+static bool g_wel = false;
+static bool g_four_byte = false;
+
+/* 忙和擦除暂停状态（纳秒，HostOs时钟） */
+static uint64_t g_busy_until = 0;
+static bool g_erasing = false;
+static bool g_suspended = false;
+static uint64_t g_erase_remaining = 0;
+static uint64_t g_resume_at = 0;
+static uint64_t g_dma_until = 0;
+static bool g_dma_busy = false;
+
+/**
+ * @brief 命令的地址字节数，0表示无地址
+ */
+static uint32_t W25QSim_AddressBytes(uint8_t cmd)
+{
+    switch (cmd) {
+    case SIM_CMD_READ_4B:
+    case SIM_CMD_FAST_READ_4B:
+    case SIM_CMD_PROGRAM_4B:
+    case SIM_CMD_SECTOR_ERASE_4B:
+    case SIM_CMD_BLOCK_ERASE_4B:
+        return 4;
+    case SIM_CMD_READ_SFDP:
+    case SIM_CMD_DEVICE_ID:
+    case SIM_CMD_RELEASE_PD:
+        return 3;
+    case SIM_CMD_READ:
+    case SIM_CMD_FAST_READ:
+    case SIM_CMD_PROGRAM:
+    case SIM_CMD_SECTOR_ERASE:
+    case SIM_CMD_BLOCK32_ERASE:
+    case SIM_CMD_BLOCK_ERASE:
+        return g_four_byte ? 4 : 3;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 命令头长度（命令+地址+空字节）
+ */
+static uint32_t W25QSim_HeaderBytes(uint8_t cmd)
+{
+    uint32_t dummy = (cmd == SIM_CMD_FAST_READ || cmd == SIM_CMD_FAST_READ_4B ||
+                      cmd == SIM_CMD_READ_SFDP) ? 1 : 0;
+
+    return 1 + W25QSim_AddressBytes(cmd) + dummy;
+}
+
+static bool W25QSim_IsErase(uint8_t cmd)
+{
+    return cmd == SIM_CMD_SECTOR_ERASE || cmd == SIM_CMD_SECTOR_ERASE_4B ||
+           cmd == SIM_CMD_BLOCK32_ERASE || cmd == SIM_CMD_BLOCK_ERASE ||
+           cmd == SIM_CMD_BLOCK_ERASE_4B || cmd == SIM_CMD_CHIP_ERASE ||
+           cmd == SIM_CMD_CHIP_ERASE_ALT;
+}
+
+static bool W25QSim_IsProgram(uint8_t cmd)
+{
+    return cmd == SIM_CMD_PROGRAM || cmd == SIM_CMD_PROGRAM_4B;
+}
+
+static bool W25QSim_Busy(void)
+{
+    return g_sim_config.timing && HostOs_GetNs() < g_busy_until;
+}
+
+/**
+ * @brief 芯片开始一次内部操作
+ */
+static void W25QSim_StartBusy(uint32_t us, bool erase)
+{
+    if (!g_sim_config.timing) {
+        return;
+    }
+    g_busy_until = HostOs_GetNs() + (uint64_t)us * 1000ull;
+    g_erasing = erase;
+    if (erase) {
+        g_resume_at = HostOs_GetNs();
+    }
+}
+
+/**
+ * @brief 总线耗时
+ */
+static void W25QSim_BusTime(uint64_t ns)
+{
+    if (g_sim_config.spi_hz == 0) {
+        return;
+    }
+    if (g_dma_busy) {
+        g_sim_stats.violations++;
+    }
+    HostOs_AdvanceNs(ns);
+}
+
+static uint64_t W25QSim_ByteNs(uint32_t bytes)
+{
+    return (g_sim_config.spi_hz == 0) ? 0 :
+           (uint64_t)bytes * 8ull * 1000000000ull / g_sim_config.spi_hz;
+}
+
+/**
+ * @brief 收到命令字节：检查忙/暂停状态下是否允许，处理无数据的命令
+ */
+static void W25QSim_Command(uint8_t cmd)
+{
+    if (g_sim_config.timing) {
+        uint64_t now = HostOs_GetNs();
+        bool busy = now < g_busy_until;
+
+        if (busy && cmd != SIM_CMD_READ_STATUS1 && cmd != SIM_CMD_READ_STATUS2 &&
+            !(cmd == SIM_CMD_SUSPEND && g_erasing)) {
+            g_sim_stats.violations++;
+        }
+        if (g_suspended && (W25QSim_IsProgram(cmd) || W25QSim_IsErase(cmd))) {
+            g_sim_stats.violations++;
+        }
+
+        if (cmd == SIM_CMD_SUSPEND && busy && g_erasing && !g_suspended) {
+            uint32_t gap_us = (uint32_t)((now - g_resume_at) / 1000ull);
+
+            g_erase_remaining = g_busy_until - now;
+            g_busy_until = now + W25Q_SIM_SUSPEND_US * 1000ull;
+            g_suspended = true;
+            g_sim_stats.suspends++;
+            if (g_sim_stats.suspends == 1 || gap_us < g_sim_stats.min_resume_us) {
+                g_sim_stats.min_resume_us = gap_us;
+            }
+        } else if (cmd == SIM_CMD_RESUME && g_suspended) {
+            g_busy_until = now + g_erase_remaining;
+            g_suspended = false;
+            g_resume_at = now;
+        }
+    }
+
+    if (cmd == SIM_CMD_WRITE_ENABLE) {
+        g_wel = true;
+    } else if (cmd == SIM_CMD_WRITE_DISABLE) {
+        g_wel = false;
+    }
+}
+
+/**
+ * @brief 片选期间传输一个字节
+ * @param in 主机发出的字节
+ * @return uint8_t 芯片返回的字节
+ */
+static uint8_t W25QSim_Transfer(uint8_t in)
+{
+    g_sim_stats.spi_bytes++;
+
+    if (!g_selected) {
+        return 0xFF;
+    }
+
+    if (g_header == 0) {
+        g_cmd = in;
+        g_header = 1;
+        g_address = 0;
+        g_data_count = 0;
+        W25QSim_Command(in);
+        return 0xFF;
+    }
+
+    uint32_t address_bytes = W25QSim_AddressBytes(g_cmd);
+    if (g_header <= address_bytes) {
+        g_address = (g_address << 8) | in;
+        g_header++;
+        return 0xFF;
+    }
+    if (g_header < W25QSim_HeaderBytes(g_cmd)) {
+        g_header++;
+        return 0xFF;
+    }
+
+    uint32_t index = g_data_count++;
+    switch (g_cmd) {
+    case SIM_CMD_READ_STATUS1:
+        return (W25QSim_Busy() ? SIM_STATUS_BUSY : 0) | (g_wel ? SIM_STATUS_WEL : 0);
+    case SIM_CMD_READ_STATUS2:
+        return g_suspended ? SIM_STATUS2_SUS : 0;
+    case SIM_CMD_JEDEC_ID:
+        return (uint8_t)(g_sim_config.jedec_id >> (8 * (2 - index % 3)));
+    case SIM_CMD_DEVICE_ID:
+        return (index & 1) ? (uint8_t)(g_sim_config.jedec_id - 1) : (uint8_t)(g_sim_config.jedec_id >> 16);
+    case SIM_CMD_RELEASE_PD:
+        return (uint8_t)(g_sim_config.jedec_id - 1);
+    case SIM_CMD_READ_SFDP:
+        return (g_sim_config.sfdp != NULL && g_address + index < g_sim_config.sfdp_length) ?
+               g_sim_config.sfdp[g_address + index] : 0xFF;
+    case SIM_CMD_READ:
+    case SIM_CMD_FAST_READ:
+    case SIM_CMD_READ_4B:
+    case SIM_CMD_FAST_READ_4B:
+        return g_sim_memory[(g_address + index) % g_sim_config.size];
+    case SIM_CMD_PROGRAM:
+    case SIM_CMD_PROGRAM_4B:
+        /* 编程只能把1变为0；超出页尾回绕到页首 */
+        if (g_wel && g_sim_program_limit != 0) {
+            uint32_t page = g_address & ~(SIM_PAGE_SIZE - 1);
+            uint32_t offset = (g_address + index) & (SIM_PAGE_SIZE - 1);
+            g_sim_memory[(page + offset) % g_sim_config.size] &= in;
+        }
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+/**
+ * @brief 片选释放：编程、擦除和模式切换命令在此生效
+ */
+static void W25QSim_Deselect(void)
+{
+    bool complete = (g_header >= W25QSim_HeaderBytes(g_cmd));
+
+    if (g_header == 0) {
+        return;
+    }
+
+    if (W25QSim_IsProgram(g_cmd) && complete && g_wel) {
+        g_wel = false;
+        g_sim_stats.page_programs++;
+        if (g_sim_program_limit > 0) {
+            g_sim_program_limit--;
+        }
+        uint32_t us = g_sim_config.page_program_us;
+        W25QSim_StartBusy((us != 0) ? us : W25Q_SIM_PAGE_PROGRAM_US, false);
+    } else if (W25QSim_IsErase(g_cmd) && complete && g_wel) {
+        uint32_t size;
+        uint32_t us;
+
+        switch (g_cmd) {
+        case SIM_CMD_SECTOR_ERASE:
+        case SIM_CMD_SECTOR_ERASE_4B:
+            size = 4096;
+            us = W25Q_SIM_SECTOR_ERASE_US;
+            g_sim_stats.sector_erases++;
+            break;
+        case SIM_CMD_BLOCK32_ERASE:
+            size = 32768;
+            us = W25Q_SIM_BLOCK32_ERASE_US;
+            g_sim_stats.block_erases++;
+            break;
+        case SIM_CMD_BLOCK_ERASE:
+        case SIM_CMD_BLOCK_ERASE_4B:
+            size = 65536;
+            us = W25Q_SIM_BLOCK_ERASE_US;
+            g_sim_stats.block_erases++;
+            break;
+        default:
+            size = g_sim_config.size;
+            us = W25Q_SIM_BLOCK_ERASE_US * (g_sim_config.size / 65536);
+            break;
+        }
+        memset(g_sim_memory + ((g_address % g_sim_config.size) & ~(size - 1)), 0xFF, size);
+        g_wel = false;
+        W25QSim_StartBusy(us, true);
+    } else if (g_cmd == SIM_CMD_ENTER_4B) {
+        g_four_byte = true;
+    } else if (g_cmd == SIM_CMD_EXIT_4B || g_cmd == SIM_CMD_RESET) {
+        g_four_byte = false;
+    }
+
+    g_header = 0;
+}
+
+/**
+ * @brief 默认配置：W25Q64，不模拟时间
+ */
+void W25QSim_DefaultConfig(W25QSimConfig_t *config)
+{
+    memset(config, 0, sizeof(W25QSimConfig_t));
+    config->size = 8u * 1024u * 1024u;
+    config->jedec_id = 0xEF4017;
+}
+
+/**
+ * @brief 初始化芯片模型，存储内容全部为擦除状态
+ * @param config 配置，NULL使用默认配置
+ */
+void W25QSim_Init(const W25QSimConfig_t *config)
+{
+    if (config != NULL) {
+        g_sim_config = *config;
+    } else {
+        W25QSim_DefaultConfig(&g_sim_config);
+    }
+    if (g_sim_config.size == 0 || g_sim_config.size > W25Q_SIM_MAX_SIZE) {
+        g_sim_config.size = W25Q_SIM_MAX_SIZE;
+    }
+
+    memset(g_sim_memory, 0xFF, sizeof(g_sim_memory));
+    W25QSim_ResetStats();
+    g_sim_program_limit = -1;
+    W25QSim_PowerCycle();
+}
+
+/**
+ * @brief 掉电重启：存储内容保留，进行中的操作、写使能和4字节地址模式清除
+ */
+void W25QSim_PowerCycle(void)
+{
+    g_selected = false;
+    g_header = 0;
+    g_wel = false;
+    g_four_byte = false;
+    g_busy_until = 0;
+    g_erasing = false;
+    g_suspended = false;
+    g_dma_busy = false;
+}
+
+uint8_t* W25QSim_Memory(void)
+{
+    return g_sim_memory;
+}
+
+const W25QSimConfig_t* W25QSim_GetConfig(void)
+{
+    return &g_sim_config;
+}
+
+const W25QSimStats_t* W25QSim_GetStats(void)
+{
+    return &g_sim_stats;
+}
+
+void W25QSim_ResetStats(void)
+{
+    memset(&g_sim_stats, 0, sizeof(g_sim_stats));
+}
+
+/**
+ * @brief 模拟掉电：再编程pages页后，之后的页编程不再改变存储内容
+ * @param pages 允许的页数，-1表示不限制
+ */
+void W25QSim_SetProgramLimit(int32_t pages)
+{
+    g_sim_program_limit = pages;
+}
+
+/* HAL ------------------------------------------------------------------------*/
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (GPIOx != FLASH_CS_GPIO_Port || GPIO_Pin != FLASH_CS_Pin) {
+        return;
+    }
+
+    W25QSim_BusTime(W25Q_SIM_GPIO_NS);
+    if (PinState == GPIO_PIN_RESET) {
+        if (!g_selected) {
+            g_selected = true;
+            g_header = 0;
+            g_sim_stats.transactions++;
+        }
+    } else if (g_selected) {
+        W25QSim_Deselect();
+        g_selected = false;
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+
+    W25QSim_BusTime(W25Q_SIM_CALL_NS + W25QSim_ByteNs(Size));
+    for (uint16_t i = 0; i < Size; i++) {
+        W25QSim_Transfer(pData[i]);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+
+    W25QSim_BusTime(W25Q_SIM_CALL_NS + W25QSim_ByteNs(Size));
+    for (uint16_t i = 0; i < Size; i++) {
+        pData[i] = W25QSim_Transfer(0xFF);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData,
+                                          uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+
+    W25QSim_BusTime(W25Q_SIM_CALL_NS + W25QSim_ByteNs(Size));
+    for (uint16_t i = 0; i < Size; i++) {
+        pRxData[i] = W25QSim_Transfer(pTxData[i]);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief DMA接收：数据立即到位，传输在后台按总线速度进行直到HAL_SPI_GetState
+ */
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    (void)hspi;
+
+    W25QSim_BusTime(W25Q_SIM_DMA_SETUP_NS);
+    for (uint16_t i = 0; i < Size; i++) {
+        pData[i] = W25QSim_Transfer(0xFF);
+    }
+    if (g_sim_config.spi_hz != 0) {
+        g_dma_until = HostOs_GetNs() + W25QSim_ByteNs(Size);
+        g_dma_busy = true;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief 查询SPI状态：DMA未完成时等到完成
+ */
+HAL_SPI_StateTypeDef HAL_SPI_GetState(const SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+
+    if (g_dma_busy) {
+        uint64_t now = HostOs_GetNs();
+
+        g_dma_busy = false;
+        if (now < g_dma_until) {
+            HostOs_AdvanceNs(g_dma_until - now);
+        }
+    }
+    return HAL_SPI_STATE_READY;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    g_dma_busy = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DeInit(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    return HAL_OK;
+}
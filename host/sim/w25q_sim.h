@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file    w25q_sim.h
+  * @brief   W25Qxx SPI Flash芯片模型（主机构建）
+  *          实现hspi1的HAL SPI函数和片选引脚，flash.c不做修改即可运行在模型上；
+  *          可选按数据手册典型值模拟芯片忙时间、擦除暂停和SPI总线耗时
+  ******************************************************************************
+  */
+#ifndef __W25Q_SIM_H__
+#define __W25Q_SIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define W25Q_SIM_MAX_SIZE       (32u * 1024u * 1024u)  /* 最大容量（W25Q256） */
+
+/* 芯片时间（W25Q64JV数据手册典型值） */
+#define W25Q_SIM_PAGE_PROGRAM_US    700
+#define W25Q_SIM_SECTOR_ERASE_US    45000
+#define W25Q_SIM_BLOCK32_ERASE_US   120000
+#define W25Q_SIM_BLOCK_ERASE_US     150000
+#define W25Q_SIM_SUSPEND_US         20      /* tSUS */
+
+/* 总线开销（72MHz主频下HAL阻塞传输的估计值） */
+#define W25Q_SIM_CALL_NS            1000    /* 每次HAL SPI调用 */
+#define W25Q_SIM_GPIO_NS            300     /* 每次片选翻转 */
+#define W25Q_SIM_DMA_SETUP_NS       2000    /* 启动一次DMA接收 */
+
+/* 模型配置 */
+typedef struct {
+    uint32_t size;              /* 容量（字节） */
+    uint32_t jedec_id;          /* 0x9F返回的3字节ID */
+    const uint8_t *sfdp;        /* SFDP表，NULL表示不支持0x5A */
+    uint32_t sfdp_length;
+    bool timing;                /* 模拟编程/擦除忙时间和擦除暂停 */
+    uint32_t spi_hz;            /* SPI时钟，0表示传输不耗时 */
+    uint32_t page_program_us;   /* 页编程忙时间，0为典型值W25Q_SIM_PAGE_PROGRAM_US */
+} W25QSimConfig_t;
+
+/* 模型统计 */
+typedef struct {
+    uint32_t spi_bytes;         /* SPI传输字节数 */
+    uint32_t transactions;      /* 片选次数 */
+    uint32_t page_programs;     /* 页编程次数 */
+    uint32_t sector_erases;     /* 4KB扇区擦除次数 */
+    uint32_t block_erases;      /* 32KB/64KB块擦除次数 */
+    uint32_t suspends;          /* 芯片接受的擦除暂停次数 */
+    uint32_t violations;        /* 芯片忙或暂停时收到不允许的命令、DMA进行中发起传输 */
+    uint32_t min_resume_us;     /* 恢复擦除到下一次暂停的最短间隔 */
+} W25QSimStats_t;
+
+void W25QSim_Init(const W25QSimConfig_t *config);
+void W25QSim_DefaultConfig(W25QSimConfig_t *config);
+void W25QSim_PowerCycle(void);
+uint8_t* W25QSim_Memory(void);
+const W25QSimConfig_t* W25QSim_GetConfig(void);
+const W25QSimStats_t* W25QSim_GetStats(void);
+void W25QSim_ResetStats(void);
+void W25QSim_SetProgramLimit(int32_t pages);
+
+#endif /* __W25Q_SIM_H__ */
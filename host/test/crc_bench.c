@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    crc_bench.c
+  * @brief   CRC基准测试（主机）
+  *          与板上Crc_BenchmarkTest相同的1KB数据，对比逐字节查表与slice-by-4的
+  *          每周期字节数；周期为x86的TSC计数（其他主机为纳秒）。CPU处理时间依赖主机，
+  *          只用于比较两种实现，不是板上的数值。硬件CRC32单元只在板上测试
+  ******************************************************************************
+  */
+#include "crc.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_BUFFER_SIZE       1024                    /* 与crc_test.c相同 */
+#define BENCH_ROUNDS            20000                   /* 每次计时的计算次数 */
+#define BENCH_TRIALS            5                       /* 取最快的一次 */
+
+/* 旧实现的逐字节表 */
+#define CRC16_BYTE_TABLE_BYTES  (256 * sizeof(uint16_t))
+
+typedef struct {
+    const char *name;
+    uint32_t (*run)(const uint8_t *data, uint32_t length);
+    uint32_t table_bytes;
+} CrcBench_t;
+
+static uint8_t bench_buffer[BENCH_BUFFER_SIZE];
+static volatile uint32_t bench_sink;
+
+static const uint8_t check_input[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+static uint32_t Bench_CcittByte(const uint8_t *data, uint32_t length)
+{
+    return Crc16Ccitt_UpdateBytewise(CRC16_CCITT_INIT, data, length);
+}
+
+static uint32_t Bench_CcittSlice4(const uint8_t *data, uint32_t length)
+{
+    return Crc16Ccitt_Update(CRC16_CCITT_INIT, data, length);
+}
+
+static uint32_t Bench_ModbusByte(const uint8_t *data, uint32_t length)
+{
+    return Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, data, length);
+}
+
+static uint32_t Bench_ModbusSlice4(const uint8_t *data, uint32_t length)
+{
+    return Crc16Modbus_Update(CRC16_MODBUS_INIT, data, length);
+}
+
+static uint32_t Bench_Crc32Software(const uint8_t *data, uint32_t length)
+{
+    return Crc32_UpdateSoftware(CRC32_INIT, data, length);
+}
+
+static const CrcBench_t bench_list[] = {
+    {"CCITT byte",  Bench_CcittByte,     CRC16_BYTE_TABLE_BYTES},
+    {"CCITT s4",    Bench_CcittSlice4,   CRC16_SLICE4_TABLE_BYTES},
+    {"Modbus byte", Bench_ModbusByte,    CRC16_BYTE_TABLE_BYTES},
+    {"Modbus s4",   Bench_ModbusSlice4,  CRC16_SLICE4_TABLE_BYTES},
+    {"CRC32 sw",    Bench_Crc32Software, CRC32_TABLE_BYTES},
+};
+
+#define BENCH_COUNT             (sizeof(bench_list) / sizeof(bench_list[0]))
+
+/**
+ * @brief 当前周期计数：x86为TSC，其他主机为单调时钟纳秒
+ */
+static uint64_t Bench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();          /* x86intrin.h与CMSIS的宏冲突，直接用内建函数 */
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief 标准校验值与分段计算（与crc_test.c的检查相同，不含硬件单元）
+ */
+static bool Bench_Check(void)
+{
+    bool passed = true;
+
+    passed &= Crc16Ccitt_Update(CRC16_CCITT_INIT, check_input, 9) == 0x29B1 &&
+              Crc16Ccitt_UpdateBytewise(CRC16_CCITT_INIT, check_input, 9) == 0x29B1;
+    passed &= Crc16Modbus_Update(CRC16_MODBUS_INIT, check_input, 9) == 0x4B37 &&
+              Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, check_input, 9) == 0x4B37;
+    passed &= Crc32_UpdateSoftware(CRC32_INIT, check_input, 9) == 0x0376E6E7;
+
+    uint16_t crc16 = Crc16Modbus_Update(CRC16_MODBUS_INIT, bench_buffer, 333);
+    crc16 = Crc16Modbus_Update(crc16, bench_buffer + 333, BENCH_BUFFER_SIZE - 333);
+    passed &= crc16 == Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, bench_buffer, BENCH_BUFFER_SIZE);
+    crc16 = Crc16Ccitt_Update(CRC16_CCITT_INIT, bench_buffer, 333);
+    crc16 = Crc16Ccitt_Update(crc16, bench_buffer + 333, BENCH_BUFFER_SIZE - 333);
+    passed &= crc16 == Crc16Ccitt_UpdateBytewise(CRC16_CCITT_INIT, bench_buffer, BENCH_BUFFER_SIZE);
+    return passed;
+}
+
+int main(void)
+{
+    for (uint32_t i = 0; i < BENCH_BUFFER_SIZE; i++) {
+        bench_buffer[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    bool passed = Bench_Check();
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "B/cycle";
+#else
+    const char *unit = "B/ns";
+#endif
+    printf("crc: %u B x %u, fastest of %u, %s\n", BENCH_BUFFER_SIZE, BENCH_ROUNDS, BENCH_TRIALS, unit);
+
+    for (uint32_t b = 0; b < BENCH_COUNT; b++) {
+        uint64_t best = UINT64_MAX;
+
+        for (uint32_t t = 0; t < BENCH_TRIALS; t++) {
+            uint64_t start = Bench_Cycles();
+            for (uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+                bench_sink = bench_list[b].run(bench_buffer, BENCH_BUFFER_SIZE);
+            }
+            uint64_t cycles = Bench_Cycles() - start;
+            if (cycles < best) {
+                best = cycles;
+            }
+        }
+
+        double bytes = (double)BENCH_BUFFER_SIZE * BENCH_ROUNDS;
+        printf("  %-12s %5.2f %s  %5.2f cyc/B  table %4u B\n", bench_list[b].name, bytes / best, unit,
+               best / bytes, (unsigned)bench_list[b].table_bytes);
+    }
+
+    printf("crc_bench: %s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
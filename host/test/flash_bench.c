@@ -0,0 +1,1419 @@
+/**
+  ******************************************************************************
+  * @file    flash_bench.c
+  * @brief   Flash基准测试（主机，虚拟时钟）
+  *          芯片模型按W25Q64JV典型时间保持忙，SPI 9MHz、每次HAL调用1us、DMA启动2us；
+  *          时间只随总线传输、芯片忙等和osDelay推进，结果可复现。CPU处理时间
+  *          （CRC、memcpy、解码）不计入
+  *
+  *          fs        文件层：64KB文件顺序写、读，200个文件时的挂载时间
+  *          program   页编程：64KB逐页编程的吞吐量，典型与较慢的编程时间
+  *          cache     页缓存：20条40字节记录存储后读回的命中数和节省的SPI字节，与无缓存对照
+  *          stage     写合并：100条48字节记录，每条写后读回
+  *          column    列存储：10万样本追加，单字段查询与整行查询
+  *          geometry  SFDP识别：8/16/32MB芯片写满后的挂载时间与全量扫描时间
+  *          io        Flash I/O服务：持续写入负载下交互读取的排队时间
+  *          fw        固件暂存：64KB镜像经115200波特率、30ms往返的回环线路传给FwUpdate_*
+  *          scan      顺序预读：整个数据区的扫描速度
+  *          tags      记录标签：写满数据区后按标签查询读取的扇区数
+  *
+  *          参数为要运行的基准名，不带参数时全部运行；每个场景在单独的子进程中
+  *          从空芯片开始
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+#include "flash.h"
+#include "flash_io.h"
+#include "flash_column.h"
+#include "flash_fs.h"
+#include "fw_update.h"
+#include "modbus.h"
+#include "crc.h"
+#include "record_codec.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BENCH_SPI_HZ            9000000                 /* APB2 72MHz、8分频 */
+#define BENCH_JEDEC_W25Q64      0xEF4017
+#define BENCH_JEDEC_W25Q128     0xEF4018
+#define BENCH_JEDEC_W25Q256     0xEF4019
+#define BENCH_JEDEC_GD25Q64     0xC84017                /* 非Winbond：无SFDP时不暂停擦除 */
+#define BENCH_MB                (1024u * 1024u)
+
+typedef struct {
+    const char *name;
+    const char *description;
+    bool (*run)(void);          /* 各场景都通过时返回true */
+} Bench_t;
+
+static ReadResult_t bench_result;
+static uint32_t bench_rng = 12345;
+
+/**
+ * @brief 基准内的伪随机数（LCG），各场景独立可复现
+ */
+static uint32_t Bench_Random(void)
+{
+    bench_rng = bench_rng * 1103515245u + 12345u;
+    return bench_rng >> 8;
+}
+
+/**
+ * @brief 在子进程中运行一个场景
+ * @return 子进程正常退出且返回0
+ */
+static bool Bench_Fork(void (*scenario)(uint32_t), uint32_t argument)
+{
+    int status = 1;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        scenario(argument);
+        fflush(stdout);
+        _exit(0);
+    }
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * @brief 子进程中的失败：输出原因后返回非0
+ */
+static void Bench_Fail(const char *what)
+{
+    printf("  FAIL: %s\n", what);
+    fflush(stdout);
+    _exit(1);
+}
+
+/**
+ * @brief 初始化虚拟时钟、芯片模型并挂载Flash
+ * @param config 芯片配置，NULL为W25Q64（无SFDP）
+ */
+static void Bench_Start(const W25QSimConfig_t *config)
+{
+    W25QSimConfig_t chip;
+
+    if (config != NULL) {
+        chip = *config;
+    } else {
+        W25QSim_DefaultConfig(&chip);
+    }
+    chip.timing = true;
+    chip.spi_hz = BENCH_SPI_HZ;
+
+    HostOs_Init(HOST_CLOCK_VIRTUAL);
+    HostBoard_Init();
+    W25QSim_Init(&chip);
+    Log_SetLevel(LOG_LEVEL_ERROR);
+    bench_rng = 12345;
+
+    if (Flash_Init() != FLASH_OK) {
+        Bench_Fail("Flash_Init");
+    }
+}
+
+/**
+ * @brief 正常关机后重新挂载，返回挂载时间（毫秒）
+ */
+static double Bench_Remount(void)
+{
+    Flash_DeInit();
+    W25QSim_PowerCycle();
+
+    uint64_t start = HostOs_GetUs();
+    if (Flash_Init() != FLASH_OK) {
+        Bench_Fail("remount");
+    }
+    return (HostOs_GetUs() - start) / 1000.0;
+}
+
+/**
+ * @brief 当前记录数
+ */
+static uint32_t Bench_RecordCount(void)
+{
+    uint32_t used_space;
+    uint32_t free_space;
+    uint32_t count = 0;
+
+    Flash_GetStorageInfo(&used_space, &free_space, &count);
+    return count;
+}
+
+static double Bench_Ms(uint64_t start_us)
+{
+    return (HostOs_GetUs() - start_us) / 1000.0;
+}
+
+/**
+ * @brief 记录ID对应的内容
+ */
+static void Bench_Pattern(uint32_t id, uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(id * 7 + i);
+    }
+}
+
+/* 文件层 ------------------------------------------------------------------------*/
+
+#define FS_FILE_SIZE            (64 * 1024)
+#define FS_FILE_COUNT           200
+
+/**
+ * @brief 64KB文件按页顺序写入、读回校验，再建立200个小文件后重新挂载
+ */
+static void Bench_FsRun(uint32_t argument)
+{
+    FlashFsFile_t *file;
+    uint8_t page[W25Q64_PAGE_SIZE];
+    char name[FLASH_FS_NAME_LEN];
+    uint32_t read_length;
+    uint32_t files;
+    uint32_t free_sectors;
+
+    (void)argument;
+    Bench_Start(NULL);
+    if (FlashFs_Mount() != FLASH_OK) {
+        Bench_Fail("FlashFs_Mount");
+    }
+
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+    if (FlashFs_Open(&file, "bench.bin", FLASH_FS_O_WRONLY | FLASH_FS_O_CREAT | FLASH_FS_O_TRUNC) != FLASH_OK) {
+        Bench_Fail("open for write");
+    }
+    for (uint32_t offset = 0; offset < FS_FILE_SIZE; offset += sizeof(page)) {
+        Bench_Pattern(offset / sizeof(page), page, sizeof(page));
+        if (FlashFs_Write(file, page, sizeof(page)) != FLASH_OK) {
+            Bench_Fail("write");
+        }
+    }
+    if (FlashFs_Close(file) != FLASH_OK) {
+        Bench_Fail("commit");
+    }
+    double write_ms = Bench_Ms(start);
+    W25QSimStats_t write_stats = *W25QSim_GetStats();
+
+    W25QSim_ResetStats();
+    start = HostOs_GetUs();
+    if (FlashFs_Open(&file, "bench.bin", FLASH_FS_O_RDONLY) != FLASH_OK) {
+        Bench_Fail("open for read");
+    }
+    for (uint32_t offset = 0; offset < FS_FILE_SIZE; offset += read_length) {
+        uint8_t expected[W25Q64_PAGE_SIZE];
+
+        if (FlashFs_Read(file, page, sizeof(page), &read_length) != FLASH_OK || read_length != sizeof(page)) {
+            Bench_Fail("read");
+        }
+        Bench_Pattern(offset / sizeof(page), expected, sizeof(expected));
+        if (memcmp(page, expected, sizeof(page)) != 0) {
+            Bench_Fail("read back");
+        }
+    }
+    FlashFs_Close(file);
+    double read_ms = Bench_Ms(start);
+
+    printf("  seq write %u KB: %7.1f KB/s  %u programs  %u erases\n", FS_FILE_SIZE / 1024,
+           FS_FILE_SIZE / 1024 / write_ms * 1000.0, (unsigned)write_stats.page_programs,
+           (unsigned)(write_stats.sector_erases + write_stats.block_erases));
+    printf("  seq read  %u KB: %7.1f KB/s  %u SPI B\n", FS_FILE_SIZE / 1024,
+           FS_FILE_SIZE / 1024 / read_ms * 1000.0, (unsigned)W25QSim_GetStats()->spi_bytes);
+
+    /* 挂载时间：200个小文件，另有上面的64KB文件 */
+    for (uint32_t i = 0; i < FS_FILE_COUNT; i++) {
+        snprintf(name, sizeof(name), "bench%03u", (unsigned)i);
+        if (FlashFs_Open(&file, name, FLASH_FS_O_WRONLY | FLASH_FS_O_CREAT | FLASH_FS_O_TRUNC) != FLASH_OK ||
+            FlashFs_Write(file, (const uint8_t*)name, sizeof(name)) != FLASH_OK || FlashFs_Close(file) != FLASH_OK) {
+            Bench_Fail("create");
+        }
+    }
+
+    Bench_Remount();
+    W25QSim_ResetStats();
+    start = HostOs_GetUs();
+    if (FlashFs_Mount() != FLASH_OK) {
+        Bench_Fail("remount FS");
+    }
+    double mount_ms = Bench_Ms(start);
+    FlashFs_GetInfo(&files, &free_sectors);
+    printf("  mount %u files: %.1f ms  %u SPI B\n", (unsigned)files, mount_ms, (unsigned)W25QSim_GetStats()->spi_bytes);
+
+    if (files != FS_FILE_COUNT + 1) {
+        Bench_Fail("file count after mount");
+    }
+    if (FlashFs_Open(&file, "bench199", FLASH_FS_O_RDONLY) != FLASH_OK ||
+        FlashFs_Read(file, (uint8_t*)page, sizeof(name), &read_length) != FLASH_OK ||
+        read_length != sizeof(name) || strcmp((const char*)page, "bench199") != 0) {
+        Bench_Fail("read after mount");
+    }
+    FlashFs_Close(file);
+}
+
+static bool Bench_Fs(void)
+{
+    return Bench_Fork(Bench_FsRun, 0);
+}
+
+/* 页编程 ------------------------------------------------------------------------*/
+
+#define PROGRAM_ADDRESS         0x200000                /* 空芯片上数据区中未写过的64KB */
+#define PROGRAM_PAGES           256
+
+typedef struct {
+    const char *name;
+    uint32_t page_program_us;   /* 芯片的页编程忙时间 */
+} BenchProgramCase_t;
+
+static const BenchProgramCase_t bench_program_cases[] = {
+    {"tPP 0.7 ms",  700},
+    {"tPP 2.5 ms",  2500},                              /* 超过忙等上限，转为睡眠轮询 */
+};
+
+/**
+ * @brief 连续编程64KB（Flash_Write按页），读回校验
+ * @note SPI字节数中除命令和数据外都是等待就绪时读取的状态寄存器，即忙等的长短
+ */
+static void Bench_ProgramRun(uint32_t index)
+{
+    const BenchProgramCase_t *c = &bench_program_cases[index];
+    W25QSimConfig_t chip;
+    uint8_t page[W25Q64_PAGE_SIZE];
+    uint8_t expected[W25Q64_PAGE_SIZE];
+
+    W25QSim_DefaultConfig(&chip);
+    chip.page_program_us = c->page_program_us;
+    Bench_Start(&chip);
+
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+    for (uint32_t i = 0; i < PROGRAM_PAGES; i++) {
+        Bench_Pattern(i, page, sizeof(page));
+        if (Flash_Write(PROGRAM_ADDRESS + i * sizeof(page), page, sizeof(page)) != FLASH_OK) {
+            Bench_Fail("Flash_Write");
+        }
+    }
+    double program_ms = Bench_Ms(start);
+    const W25QSimStats_t *stats = W25QSim_GetStats();
+
+    printf("  %-12s %6.1f KB/s  %5.2f ms/page  %5u SPI B/page\n", c->name,
+           PROGRAM_PAGES * sizeof(page) / 1024 / program_ms * 1000.0, program_ms / PROGRAM_PAGES,
+           (unsigned)(stats->spi_bytes / PROGRAM_PAGES));
+
+    if (stats->page_programs != PROGRAM_PAGES) {
+        Bench_Fail("page program count");
+    }
+    for (uint32_t i = 0; i < PROGRAM_PAGES; i++) {
+        Bench_Pattern(i, expected, sizeof(expected));
+        if (Flash_ReadNoCache(PROGRAM_ADDRESS + i * sizeof(page), page, sizeof(page)) != FLASH_OK ||
+            memcmp(page, expected, sizeof(page)) != 0) {
+            Bench_Fail("read back");
+        }
+    }
+}
+
+static bool Bench_Program(void)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < sizeof(bench_program_cases) / sizeof(bench_program_cases[0]); i++) {
+        ok &= Bench_Fork(Bench_ProgramRun, i);
+    }
+    return ok;
+}
+
+/* 页缓存 ------------------------------------------------------------------------*/
+
+#define CACHE_ITERATIONS        20
+#define CACHE_RECORD_LENGTH     40
+
+/**
+ * @brief 按FLASH任务的方式存储40字节记录并按ID读回（同Flash_PageCacheReplayTest）
+ * @param cold 非0时每次读取前清空页缓存，作为无缓存的对照
+ * @note 芯片模型的SPI字节数和片选次数只统计读取
+ */
+static void Bench_CacheRun(uint32_t cold)
+{
+    uint8_t record[CACHE_RECORD_LENGTH];
+    uint32_t record_id;
+    uint32_t read_bytes = 0;
+    uint32_t read_transactions = 0;
+
+    Bench_Start(NULL);
+    FlashPageCacheStats_t before = *Flash_GetPageCacheStats();
+
+    for (uint32_t i = 0; i < CACHE_ITERATIONS; i++) {
+        for (uint32_t j = 0; j < sizeof(record); j++) {
+            record[j] = (uint8_t)(i + j);
+        }
+        if (Flash_StoreData(record, sizeof(record), &record_id) != FLASH_OK) {
+            Bench_Fail("store");
+        }
+        if (cold) {
+            Flash_InvalidatePageCache();
+        }
+
+        W25QSimStats_t chip = *W25QSim_GetStats();
+        if (Flash_ReadData(record_id, &bench_result) != FLASH_OK || !bench_result.valid ||
+            bench_result.data_length != sizeof(record) || memcmp(bench_result.data, record, sizeof(record)) != 0) {
+            Bench_Fail("read back");
+        }
+        read_bytes += W25QSim_GetStats()->spi_bytes - chip.spi_bytes;
+        read_transactions += W25QSim_GetStats()->transactions - chip.transactions;
+    }
+
+    const FlashPageCacheStats_t *after = Flash_GetPageCacheStats();
+    uint32_t hits = after->hits - before.hits;
+    uint32_t misses = after->misses - before.misses;
+    int32_t saved = (int32_t)((after->uncached_spi_bytes - before.uncached_spi_bytes) -
+                              (after->spi_bytes - before.spi_bytes));
+
+    printf("  %-7s %3u hits %3u misses  %5d SPI B saved | chip reads %5u SPI B, %3u CS\n",
+           cold ? "cold" : "cached", (unsigned)hits, (unsigned)misses, (int)saved,
+           (unsigned)read_bytes, (unsigned)read_transactions);
+}
+
+static bool Bench_Cache(void)
+{
+    return Bench_Fork(Bench_CacheRun, 0) & Bench_Fork(Bench_CacheRun, 1);
+}
+
+/* 写合并 ------------------------------------------------------------------------*/
+
+#define STAGE_RECORDS           100
+#define STAGE_LENGTH            48
+
+/**
+ * @brief 存储100条记录并逐条读回
+ * @param commit_every 每多少条提交一次，0为只在最后提交
+ */
+static void Bench_StageRun(uint32_t commit_every)
+{
+    uint8_t record[STAGE_LENGTH];
+    uint32_t id;
+    uint32_t bad = 0;
+
+    Bench_Start(NULL);
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+
+    for (uint32_t i = 1; i <= STAGE_RECORDS; i++) {
+        Bench_Pattern(i, record, STAGE_LENGTH);
+        if (Flash_StoreData(record, STAGE_LENGTH, &id) != FLASH_OK || id != i) {
+            Bench_Fail("store");
+        }
+        if (commit_every != 0 && i % commit_every == 0) {
+            Flash_Flush();
+        }
+        if (Flash_ReadData(id, &bench_result) != FLASH_OK || memcmp(bench_result.data, record, STAGE_LENGTH) != 0) {
+            bad++;
+        }
+    }
+    if (Flash_Flush() != FLASH_OK) {
+        Bench_Fail("flush");
+    }
+
+    double ms = Bench_Ms(start);
+    W25QSimStats_t stats = *W25QSim_GetStats();
+
+    /* 重新挂载后全部记录可读 */
+    Bench_Remount();
+    for (uint32_t i = 1; i <= STAGE_RECORDS; i++) {
+        Bench_Pattern(i, record, STAGE_LENGTH);
+        if (Flash_ReadData(i, &bench_result) != FLASH_OK || memcmp(bench_result.data, record, STAGE_LENGTH) != 0) {
+            bad++;
+        }
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), commit_every ? "commit every %u" : "one final flush", (unsigned)commit_every);
+    printf("  %-18s %5.2f programs/rec  %6.2f ms/rec  %7.1f KB/s  %u erases  SPI %u B\n",
+           name, (double)stats.page_programs / STAGE_RECORDS, ms / STAGE_RECORDS,
+           STAGE_RECORDS * STAGE_LENGTH / ms * 1000.0 / 1024.0,
+           (unsigned)(stats.sector_erases + stats.block_erases), (unsigned)stats.spi_bytes);
+    if (bad != 0) {
+        Bench_Fail("read back");
+    }
+}
+
+static bool Bench_Stage(void)
+{
+    bool ok = Bench_Fork(Bench_StageRun, 0);
+
+    ok &= Bench_Fork(Bench_StageRun, 12);
+    return ok;
+}
+
+/* 列存储 ------------------------------------------------------------------------*/
+
+#define COLUMN_SAMPLES          100000
+
+typedef struct {
+    uint32_t count;
+    double sum;
+} BenchSum_t;
+
+static void Bench_FieldVisitor(uint32_t sample, const double *values, void *context)
+{
+    BenchSum_t *sum = (BenchSum_t*)context;
+
+    (void)sample;
+    sum->count++;
+    sum->sum += values[0];
+}
+
+static void Bench_RowVisitor(uint32_t sample, const double *values, void *context)
+{
+    BenchSum_t *sum = (BenchSum_t*)context;
+
+    (void)sample;
+    sum->count++;
+    sum->sum += values[RECORD_FIELD_pressure];
+}
+
+static void Bench_ColumnRun(uint32_t samples)
+{
+    const FlashColumnStats_t *column = FlashColumn_GetStats();
+    BenchSum_t field = {0};
+    BenchSum_t rows = {0};
+    uint32_t first;
+    uint32_t count;
+
+    Bench_Start(NULL);
+    if (FlashColumn_Init() != FLASH_OK) {
+        Bench_Fail("FlashColumn_Init");
+    }
+
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+    if (HostBoard_FillColumns(samples) != FLASH_OK) {
+        Bench_Fail("append");
+    }
+    double append_ms = Bench_Ms(start);
+    W25QSimStats_t stats = *W25QSim_GetStats();
+
+    FlashColumn_GetRange(&first, &count);
+    printf("  append %u samples: %.2f programs/sample, %u erases (1 per %u samples), %.1f ms\n",
+           (unsigned)samples, (double)stats.page_programs / samples, (unsigned)stats.sector_erases,
+           (unsigned)(stats.sector_erases ? samples / stats.sector_erases : 0), append_ms);
+
+    uint32_t bytes = column->bytes_read;
+    W25QSim_ResetStats();
+    start = HostOs_GetUs();
+    FlashColumn_ScanField(RECORD_FIELD_pressure, first, count, Bench_FieldVisitor, &field);
+    printf("  pressure via ScanField: %u samples, %u KB read, %u SPI B, %.1f ms\n",
+           (unsigned)field.count, (unsigned)((column->bytes_read - bytes) / 1024),
+           (unsigned)W25QSim_GetStats()->spi_bytes, Bench_Ms(start));
+
+    bytes = column->bytes_read;
+    W25QSim_ResetStats();
+    start = HostOs_GetUs();
+    FlashColumn_ScanRows(first, count, Bench_RowVisitor, &rows);
+    printf("  all fields via ScanRows: %u samples, %u KB read, %u SPI B, %.1f ms\n",
+           (unsigned)rows.count, (unsigned)((column->bytes_read - bytes) / 1024),
+           (unsigned)W25QSim_GetStats()->spi_bytes, Bench_Ms(start));
+
+    if (field.count != count || rows.count != count || field.sum != rows.sum) {
+        Bench_Fail("scans differ");
+    }
+}
+
+static bool Bench_Column(void)
+{
+    return Bench_Fork(Bench_ColumnRun, COLUMN_SAMPLES);
+}
+
+/* SFDP识别 ----------------------------------------------------------------------*/
+
+#define GEOMETRY_LENGTH         1000
+#define GEOMETRY_SFDP_SIZE      256
+
+typedef struct {
+    const char *name;
+    uint32_t size_mb;
+    uint32_t jedec_id;
+    bool four_byte_table;       /* SFDP含4字节地址命令表（4BAIT） */
+} BenchChip_t;
+
+static const BenchChip_t bench_chips[] = {
+    {"W25Q64 (SFDP)",           8,  BENCH_JEDEC_W25Q64,  false},
+    {"W25Q128 (SFDP)",          16, BENCH_JEDEC_W25Q128, false},
+    {"W25Q256 (SFDP+4BAIT)",    32, BENCH_JEDEC_W25Q256, true},
+    {"W25Q256 (SFDP, B7 mode)", 32, BENCH_JEDEC_W25Q256, false},
+};
+
+static uint8_t bench_sfdp[GEOMETRY_SFDP_SIZE];
+
+static void Bench_Put32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/**
+ * @brief 生成与W25Q-JV相近的SFDP表（JESD216B基本参数表16个DWORD）
+ * @note 擦除时间：4KB 3x16ms、32KB 8x16ms、64KB 10x16ms，最大值倍数6；页编程11x64us，
+ *       倍数4；擦除暂停75h/7Ah。four_byte_table为true时增加4字节地址命令表
+ */
+static void Bench_BuildSfdp(uint32_t size_mb, bool four_byte_table)
+{
+    static const uint8_t basic_header[8] = {0x00, 0x06, 0x01, 16, 0x80, 0x00, 0x00, 0xFF};
+    static const uint8_t four_byte_header[8] = {0x84, 0x00, 0x01, 2, 0xC0, 0x00, 0x00, 0xFF};
+    uint32_t chip_erase_s = (size_mb * 5 / 2 < 4) ? 4 : size_mb * 5 / 2;
+    uint32_t dword[16];
+
+    memset(bench_sfdp, 0xFF, sizeof(bench_sfdp));
+    memcpy(bench_sfdp, "SFDP", 4);
+    bench_sfdp[4] = 0x06;
+    bench_sfdp[5] = 0x01;
+    bench_sfdp[6] = four_byte_table ? 1 : 0;
+    memcpy(&bench_sfdp[8], basic_header, sizeof(basic_header));
+    if (four_byte_table) {
+        memcpy(&bench_sfdp[16], four_byte_header, sizeof(four_byte_header));
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        dword[i] = 0xFFFFFFFF;
+    }
+    dword[0] = (size_mb > 16) ? 0xFFFB20E5 : 0xFFF920E5;    /* 3或4字节地址 */
+    dword[1] = size_mb * 8 * BENCH_MB - 1;                  /* 容量（位） */
+    dword[2] = 0x6B08EB44;
+    dword[3] = 0x3B42BB08;
+    dword[4] = 0xFFFFFFFE;
+    dword[5] = 0xFF00FFFF;
+    dword[6] = 0xEB40FFFF;
+    dword[7] = 0x520F200C;                                  /* 4KB 20h、32KB 52h */
+    dword[8] = 0x0000D810;                                  /* 64KB D8h */
+    dword[9] = 2 | ((1 << 5 | 2) << 4) | ((1 << 5 | 7) << 11) | ((1 << 5 | 9) << 18);
+    dword[10] = 1 | (8 << 4) | (10 << 8) | (1 << 13) | ((chip_erase_s / 4 - 1) << 24) | (2u << 29);
+    dword[11] = 0x00300000;                                 /* 支持暂停，恢复后256us可再暂停 */
+    dword[12] = 0x757A757A;                                 /* 暂停75h、恢复7Ah */
+    for (uint32_t i = 0; i < 16; i++) {
+        Bench_Put32(&bench_sfdp[0x80 + i * 4], dword[i]);
+    }
+
+    if (four_byte_table) {
+        Bench_Put32(&bench_sfdp[0xC0], (1 << 0) | (1 << 6) | (1 << 9) | (1 << 10) | (1 << 11));
+        Bench_Put32(&bench_sfdp[0xC4], 0xFFDC5C21);
+    }
+}
+
+/**
+ * @brief 写满数据区（16MB芯片写到扩展数据区200条）后统计挂载和全量扫描时间
+ */
+static void Bench_GeometryRun(uint32_t index)
+{
+    const BenchChip_t *chip = &bench_chips[index];
+    W25QSimConfig_t config;
+    uint8_t record[GEOMETRY_LENGTH];
+    uint32_t stored = 0;
+    uint32_t id;
+    uint32_t count;
+    uint32_t write_address;
+
+    Bench_BuildSfdp(chip->size_mb, chip->four_byte_table);
+    W25QSim_DefaultConfig(&config);
+    config.size = chip->size_mb * BENCH_MB;
+    config.jedec_id = chip->jedec_id;
+    config.sfdp = bench_sfdp;
+    config.sfdp_length = sizeof(bench_sfdp);
+    Bench_Start(&config);
+
+    const FlashGeometry_t *geometry = Flash_GetGeometry();
+    uint32_t limit = W25Q64_DATA_AREA_SIZE / (GEOMETRY_LENGTH + sizeof(DataHeader_t));
+    if (chip->size_mb == 16) {
+        limit += 200;
+    } else if (chip->size_mb > 16) {
+        limit = UINT32_MAX;
+    }
+
+    for (uint32_t i = 1; i <= limit; i++) {
+        Bench_Pattern(i, record, GEOMETRY_LENGTH);
+        FlashResult_t result = Flash_StoreData(record, GEOMETRY_LENGTH, &id);
+        if (result == FLASH_ERROR_FULL) {
+            break;
+        }
+        if (result != FLASH_OK) {
+            Bench_Fail("store");
+        }
+        stored = i;
+    }
+    Flash_Flush();
+    Flash_GetNextWriteAddress(&write_address);
+
+    printf("  %-24s %5u KB, %u-byte addr%s, cmds %02X/%02X/%02X/%02X, %u records to 0x%08X\n",
+           chip->name, (unsigned)(geometry->total_size / 1024), geometry->address_bytes,
+           geometry->enter_4byte_mode ? " (B7)" : "", geometry->read_cmd, geometry->program_cmd,
+           geometry->sector_erase_cmd, geometry->block_erase_cmd, (unsigned)stored, (unsigned)write_address);
+
+    double mount_ms = Bench_Remount();
+    count = Bench_RecordCount();
+
+    uint32_t bad = 0;
+    for (uint32_t i = (stored > 200) ? stored - 199 : 1; i <= stored; i++) {
+        Bench_Pattern(i, record, GEOMETRY_LENGTH);
+        if (Flash_ReadData(i, &bench_result) != FLASH_OK ||
+            memcmp(bench_result.data, record, GEOMETRY_LENGTH) != 0) {
+            bad++;
+        }
+    }
+
+    uint64_t start = HostOs_GetUs();
+    Flash_ScanDataArea();
+    double scan_ms = Bench_Ms(start);
+
+    printf("  %-24s mount %.1f ms (%u records), full rescan %.1f ms\n", "", mount_ms, (unsigned)count, scan_ms);
+    if (count != stored || bad != 0) {
+        Bench_Fail("records lost");
+    }
+}
+
+static bool Bench_Geometry(void)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < sizeof(bench_chips) / sizeof(bench_chips[0]); i++) {
+        ok &= Bench_Fork(Bench_GeometryRun, i);
+    }
+    return ok;
+}
+
+/* Flash I/O服务 -----------------------------------------------------------------*/
+
+#define IO_DURATION_US          30000000                /* 每个场景30秒 */
+#define IO_READ_POOL            32                      /* 同时等待的交互读取 */
+#define IO_MAX_WAITS            20000
+#define IO_RECORD_LENGTH        18
+#define IO_ERASE_PERIOD_US      500000                  /* 64KB块擦除周期 */
+#define IO_COMPACT_PERIOD_US    2000000                 /* 16扇区重写周期 */
+#define IO_PROCESS_PERIOD_US    (FLASH_IO_PROCESS_MS * 1000)
+
+typedef struct {
+    const char *name;
+    bool fifo;                  /* 全部请求同一优先级 */
+    uint32_t jedec_id;
+} BenchIoCase_t;
+
+static const BenchIoCase_t bench_io_cases[] = {
+    {"single FIFO",         true,  BENCH_JEDEC_W25Q64},
+    {"priority",            false, BENCH_JEDEC_GD25Q64},
+    {"priority + suspend",  false, BENCH_JEDEC_W25Q64},
+};
+
+static FlashIoRequest_t io_reads[IO_READ_POOL];
+static ReadResult_t io_results[IO_READ_POOL];
+static bool io_busy[IO_READ_POOL];
+static uint32_t io_waits[IO_MAX_WAITS];
+static uint32_t io_wait_count;
+static uint32_t io_dropped;
+static uint32_t io_bad;
+static uint64_t io_next_arrival;
+static uint32_t io_max_id;
+static FlashIoClass_t io_read_class;
+
+/**
+ * @brief 收集完成的交互读取
+ */
+static void BenchIo_Reap(void)
+{
+    for (uint32_t i = 0; i < IO_READ_POOL; i++) {
+        if (io_busy[i] && io_reads[i].done) {
+            io_busy[i] = false;
+            if (io_wait_count < IO_MAX_WAITS) {
+                io_waits[io_wait_count++] = io_reads[i].wait_us;
+            }
+            if (io_reads[i].result != FLASH_OK || !io_results[i].valid) {
+                io_bad++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 虚拟时钟推进时提交到期的交互读取（间隔10~30ms，读最近150条中的一条）
+ * @note 提交时间记为到达时刻，排队时间不受时钟推进粒度影响
+ */
+static void BenchIo_Arrive(void)
+{
+    uint64_t now = HostOs_GetUs();
+
+    BenchIo_Reap();
+    while (io_next_arrival <= now) {
+        uint32_t i;
+
+        for (i = 0; i < IO_READ_POOL && io_busy[i]; i++) {
+        }
+        if (i == IO_READ_POOL) {
+            io_dropped++;
+        } else {
+            memset(&io_reads[i], 0, sizeof(FlashIoRequest_t));
+            io_reads[i].op = FLASH_IO_OP_READ_DATA;
+            io_reads[i].io_class = io_read_class;
+            io_reads[i].address = io_max_id - Bench_Random() % 150;
+            io_reads[i].output = &io_results[i];
+            FlashIo_Submit(&io_reads[i]);
+            io_reads[i].submit_cycles = (uint32_t)(io_next_arrival * (SystemCoreClock / 1000000));
+            io_busy[i] = true;
+        }
+        io_next_arrival += 10000 + Bench_Random() % 20000;
+    }
+}
+
+/**
+ * @brief 后台整理：重写文件区的16个扇区（每个扇区擦除+16次页编程）
+ */
+static FlashResult_t BenchIo_Compact(void *context)
+{
+    static uint8_t page[W25Q64_PAGE_SIZE];
+    uint32_t base = W25Q64_FS_AREA_START + (*(uint32_t*)context % 8) * 16 * W25Q64_SECTOR_SIZE;
+
+    for (uint32_t s = 0; s < 16; s++) {
+        FlashResult_t result = Flash_EraseSector(base + s * W25Q64_SECTOR_SIZE);
+        if (result != FLASH_OK) {
+            return result;
+        }
+        for (uint32_t p = 0; p < 16; p++) {
+            memset(page, s + p, sizeof(page));
+            result = Flash_Write(base + s * W25Q64_SECTOR_SIZE + p * W25Q64_PAGE_SIZE, page, sizeof(page));
+            if (result != FLASH_OK) {
+                return result;
+            }
+        }
+    }
+    return FLASH_OK;
+}
+
+static int Bench_Compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * @brief 持续负载30秒：连续存储记录、连续写固件页、每0.5秒擦除64KB块、每2秒重写16个扇区，
+ *       同时每10~30ms到达一个交互读取
+ * @note FIFO场景中读取、擦除和整理都按DURABLE提交，与存储同一队列
+ */
+static void Bench_IoRun(uint32_t index)
+{
+    const BenchIoCase_t *test = &bench_io_cases[index];
+    static FlashIoRequest_t store, firmware, erase, compact;
+    static uint8_t record[IO_RECORD_LENGTH];
+    static uint8_t page[W25Q64_PAGE_SIZE];
+    static uint32_t store_id;
+    static uint32_t compact_count;
+    W25QSimConfig_t config;
+    uint32_t firmware_address = W25Q64_FW_AREA_START;
+    uint32_t stores = 0;
+    uint32_t pages = 0;
+    uint32_t erases = 0;
+    FlashIoClass_t background = test->fifo ? FLASH_IO_DURABLE : FLASH_IO_BACKGROUND;
+
+    W25QSim_DefaultConfig(&config);
+    config.jedec_id = test->jedec_id;
+    Bench_Start(&config);
+
+    for (uint32_t i = 0; i < 300; i++) {
+        Bench_Pattern(i, record, IO_RECORD_LENGTH);
+        Flash_StoreData(record, IO_RECORD_LENGTH, &io_max_id);
+    }
+    Flash_Flush();
+
+    /* 当前线程就是服务任务：请求排队，由下面的循环执行 */
+    FlashIo_Init();
+    FlashIo_ResetStats();
+    io_read_class = test->fifo ? FLASH_IO_DURABLE : FLASH_IO_INTERACTIVE;
+    store.done = firmware.done = erase.done = compact.done = true;
+
+    uint64_t start = HostOs_GetUs();
+    uint64_t next_erase = start;
+    uint64_t next_compact = start + 1000000;
+    uint64_t next_process = start;
+    io_next_arrival = start + 5000;
+    HostOs_SetIdleHook(BenchIo_Arrive);
+
+    while (HostOs_GetUs() - start < IO_DURATION_US) {
+        uint64_t now = HostOs_GetUs();
+
+        BenchIo_Arrive();
+        if (store.done) {
+            if (store.result == FLASH_OK && store_id > io_max_id) {
+                io_max_id = store_id;
+            }
+            memset(&store, 0, sizeof(store));
+            for (uint32_t j = 0; j < IO_RECORD_LENGTH; j++) {
+                record[j] = Bench_Random();
+            }
+            store.op = FLASH_IO_OP_STORE_DATA;
+            store.io_class = FLASH_IO_DURABLE;
+            store.buffer = record;
+            store.length = IO_RECORD_LENGTH;
+            store.output = &store_id;
+            FlashIo_Submit(&store);
+            stores++;
+        }
+        if (firmware.done) {
+            memset(&firmware, 0, sizeof(firmware));
+            memset(page, Bench_Random(), sizeof(page));
+            firmware.op = FLASH_IO_OP_WRITE;
+            firmware.io_class = FLASH_IO_DURABLE;
+            firmware.address = firmware_address;
+            firmware.buffer = page;
+            firmware.length = sizeof(page);
+            firmware_address += sizeof(page);
+            if (firmware_address >= W25Q64_FW_AREA_START + W25Q64_FW_AREA_SIZE) {
+                firmware_address = W25Q64_FW_AREA_START;
+            }
+            FlashIo_Submit(&firmware);
+            pages++;
+        }
+        if (erase.done && now >= next_erase) {
+            uint32_t offset = (firmware_address - W25Q64_FW_AREA_START + 2 * W25Q64_BLOCK_SIZE) % W25Q64_FW_AREA_SIZE;
+
+            memset(&erase, 0, sizeof(erase));
+            erase.op = FLASH_IO_OP_ERASE_BLOCK;
+            erase.io_class = background;
+            erase.address = W25Q64_FW_AREA_START + (offset & ~(W25Q64_BLOCK_SIZE - 1));
+            FlashIo_Submit(&erase);
+            erases++;
+            next_erase = now + IO_ERASE_PERIOD_US;
+        }
+        if (compact.done && now >= next_compact) {
+            memset(&compact, 0, sizeof(compact));
+            compact.op = FLASH_IO_OP_CALL;
+            compact.io_class = background;
+            compact.handler = BenchIo_Compact;
+            compact.output = &compact_count;
+            compact_count++;
+            FlashIo_Submit(&compact);
+            next_compact = now + IO_COMPACT_PERIOD_US;
+        }
+
+        FlashIo_ServiceOnce();
+        if (HostOs_GetUs() >= next_process) {
+            Flash_TaskProcess();
+            next_process = HostOs_GetUs() + IO_PROCESS_PERIOD_US;
+        }
+    }
+
+    HostOs_SetIdleHook(NULL);
+    while (FlashIo_ServiceOnce()) {
+    }
+    BenchIo_Reap();
+
+    double secs = (HostOs_GetUs() - start) / 1e6;
+    qsort(io_waits, io_wait_count, sizeof(uint32_t), Bench_Compare);
+    printf("  %-19s reads %4u  wait p50 %6.1f  p99 %6.1f  max %6.1f ms  dropped %3u | %3.0f stores/s  %3u erases  %4u suspends\n",
+           test->name, (unsigned)io_wait_count, io_waits[io_wait_count / 2] / 1000.0,
+           io_waits[io_wait_count * 99 / 100] / 1000.0, io_waits[io_wait_count - 1] / 1000.0,
+           (unsigned)io_dropped, stores / secs, (unsigned)erases, (unsigned)Flash_GetSuspendStats()->suspends);
+    (void)pages;
+    if (io_bad != 0) {
+        Bench_Fail("reads failed");
+    }
+}
+
+static bool Bench_Io(void)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < sizeof(bench_io_cases) / sizeof(bench_io_cases[0]); i++) {
+        ok &= Bench_Fork(Bench_IoRun, i);
+    }
+    return ok;
+}
+
+/* 固件暂存 ----------------------------------------------------------------------*/
+
+#define FW_BENCH_IMAGE_SIZE     (64 * 1024)
+#define FW_BENCH_CHUNK          200
+#define FW_BENCH_ONE_WAY_US     15000                   /* 蓝牙透传往返约30ms */
+#define FW_BENCH_RTO_US         300000                  /* 上位机无进展时从确认位置重传 */
+#define FW_BENCH_LIMIT_US       120000000
+#define FW_BENCH_QUEUE          64
+
+typedef struct {
+    const char *name;
+    uint8_t window;
+    uint32_t corrupt_every;     /* 每隔多少个数据帧损坏一帧，0为不损坏 */
+} BenchFwCase_t;
+
+static const BenchFwCase_t bench_fw_cases[] = {
+    {"stop-and-wait",       1, 0},
+    {"window 8",            8, 0},
+    {"window 8, 2% bad",    8, 50},
+};
+
+/* 线路上的一帧：到达对端的时刻和内容 */
+typedef struct {
+    uint64_t arrive_us;
+    uint16_t length;
+    uint8_t data[FW_FRAME_HEADER_SIZE + FW_FRAME_MAX_PAYLOAD + 2];
+} BenchFwFrame_t;
+
+typedef struct {
+    BenchFwFrame_t frames[FW_BENCH_QUEUE];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t line_free_us;      /* 发送方向线路空闲的时刻 */
+} BenchFwLine_t;
+
+static BenchFwLine_t fw_to_device;
+static BenchFwLine_t fw_to_host;
+static uint8_t fw_image[FW_BENCH_IMAGE_SIZE];
+
+/**
+ * @brief 把一帧放上线路：按115200波特率依次发送，再经过单程延迟到达
+ */
+static void BenchFw_Put(BenchFwLine_t *line, const uint8_t *data, uint16_t length, uint64_t now_us)
+{
+    if (line->tail - line->head >= FW_BENCH_QUEUE) {
+        Bench_Fail("loopback queue full");
+    }
+
+    BenchFwFrame_t *frame = &line->frames[line->tail++ % FW_BENCH_QUEUE];
+    uint64_t start_us = (line->line_free_us > now_us) ? line->line_free_us : now_us;
+
+    line->line_free_us = start_us + (uint64_t)length * 1000000u / FW_LINE_BYTES_PER_SEC;
+    frame->arrive_us = line->line_free_us + FW_BENCH_ONE_WAY_US;
+    frame->length = length;
+    memcpy(frame->data, data, length);
+}
+
+static uint64_t BenchFw_Next(const BenchFwLine_t *line)
+{
+    return (line->head != line->tail) ? line->frames[line->head % FW_BENCH_QUEUE].arrive_us : UINT64_MAX;
+}
+
+/**
+ * @brief 设备的USART2发送：ACK/RESULT帧经回环线路送到上位机
+ */
+HAL_StatusTypeDef UART2_SendData(uint8_t *data, uint16_t length)
+{
+    BenchFw_Put(&fw_to_host, data, length, HostOs_GetUs());
+    return HAL_OK;
+}
+
+/**
+ * @brief 上位机发送一帧
+ */
+static void BenchFw_Send(uint8_t type, const uint8_t *payload, uint16_t length, uint64_t now_us)
+{
+    static uint16_t seq = 0;
+    uint8_t frame[FW_FRAME_HEADER_SIZE + FW_FRAME_MAX_PAYLOAD + 2];
+
+    frame[0] = FW_FRAME_SYNC;
+    frame[1] = type;
+    frame[2] = seq & 0xFF;
+    frame[3] = (seq >> 8) & 0xFF;
+    frame[4] = length & 0xFF;
+    frame[5] = (length >> 8) & 0xFF;
+    memcpy(&frame[FW_FRAME_HEADER_SIZE], payload, length);
+    uint16_t crc = Modbus_CalculateCRC16(frame, FW_FRAME_HEADER_SIZE + length);
+    frame[FW_FRAME_HEADER_SIZE + length] = crc & 0xFF;
+    frame[FW_FRAME_HEADER_SIZE + length + 1] = (crc >> 8) & 0xFF;
+    seq++;
+
+    BenchFw_Put(&fw_to_device, frame, FW_FRAME_HEADER_SIZE + length + 2, now_us);
+}
+
+static uint32_t BenchFw_GetU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void BenchFw_PutU32(uint8_t *p, uint32_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+/**
+ * @brief 上位机与FwUpdate_*经回环线路传送64KB镜像（go-back-N）
+ * @note 事件按时间顺序处理：上位机发送、帧到达设备（设备处理推进虚拟时钟）、确认到达上位机、
+ *       重传超时。上位机收到重复确认或超时无进展时从确认位置重传
+ */
+static void Bench_FwRun(uint32_t index)
+{
+    const BenchFwCase_t *c = &bench_fw_cases[index];
+    uint32_t window_bytes = c->window * FW_BENCH_CHUNK;
+    uint8_t payload[FW_FRAME_MAX_PAYLOAD];
+    uint32_t base = 0;                  /* 已确认的偏移 */
+    uint32_t next = 0;                  /* 下一个发送的偏移 */
+    uint32_t data_frames = 0;
+    uint32_t resent = 0;
+    uint32_t timeouts = 0;
+    bool started = false;
+    bool end_sent = false;
+    bool done = false;
+    uint8_t status = 0xFF;
+    uint32_t device_rate = 0;
+    uint64_t data_start_us = 0;
+    uint64_t data_end_us = 0;
+
+    Bench_Start(NULL);
+    FlashIo_Init();
+    FwUpdate_Init();
+    memset(&fw_to_device, 0, sizeof(fw_to_device));
+    memset(&fw_to_host, 0, sizeof(fw_to_host));
+
+    for (uint32_t i = 0; i < sizeof(fw_image); i++) {
+        fw_image[i] = (uint8_t)Bench_Random();
+    }
+    uint32_t image_crc = Crc32_Update(CRC32_INIT, fw_image, sizeof(fw_image));
+
+    uint64_t now = HostOs_GetUs();
+    uint64_t start = now;
+    uint64_t progress_us = now;
+
+    BenchFw_PutU32(&payload[0], sizeof(fw_image));
+    BenchFw_PutU32(&payload[4], image_crc);
+    payload[8] = FW_BENCH_CHUNK & 0xFF;
+    payload[9] = (FW_BENCH_CHUNK >> 8) & 0xFF;
+    payload[10] = c->window;
+    BenchFw_Send(FW_FRAME_START, payload, 11, now);
+
+    while (!done) {
+        bool can_send = started && !end_sent &&
+                        ((next < sizeof(fw_image)) ? (next - base < window_bytes) : (base == sizeof(fw_image)));
+        uint64_t t_send = can_send ? ((fw_to_device.line_free_us > now) ? fw_to_device.line_free_us : now) : UINT64_MAX;
+        uint64_t t_device = BenchFw_Next(&fw_to_device);
+        uint64_t t_host = BenchFw_Next(&fw_to_host);
+        uint64_t t_rto = (started && !end_sent && next > base) ? progress_us + FW_BENCH_RTO_US : UINT64_MAX;
+        uint64_t t = t_send;
+
+        t = (t_device < t) ? t_device : t;
+        t = (t_host < t) ? t_host : t;
+        t = (t_rto < t) ? t_rto : t;
+        if (t == UINT64_MAX || t - start > FW_BENCH_LIMIT_US) {
+            Bench_Fail("transfer stalled");
+        }
+        now = t;
+
+        if (t == t_device) {
+            /* 设备按到达顺序处理，忙于编程时后到的帧在接收队列中等待 */
+            const BenchFwFrame_t *frame = &fw_to_device.frames[fw_to_device.head % FW_BENCH_QUEUE];
+            if (t > HostOs_GetUs()) {
+                HostOs_AdvanceNs((t - HostOs_GetUs()) * 1000u);
+            }
+            FwUpdate_Feed(frame->data, frame->length);
+            fw_to_device.head++;
+        } else if (t == t_host) {
+            const BenchFwFrame_t *frame = &fw_to_host.frames[fw_to_host.head % FW_BENCH_QUEUE];
+            const uint8_t *p = &frame->data[FW_FRAME_HEADER_SIZE];
+
+            if (frame->data[1] == FW_FRAME_ACK) {
+                uint32_t offset = BenchFw_GetU32(p);
+                if (!started) {
+                    started = true;
+                    data_start_us = t;
+                } else if (offset > base) {
+                    base = offset;
+                    if (next < base) {
+                        next = base;
+                    }
+                } else if (offset == base && next > base) {
+                    resent += (next - base + FW_BENCH_CHUNK - 1) / FW_BENCH_CHUNK;
+                    next = base;
+                }
+                progress_us = t;
+            } else if (frame->data[1] == FW_FRAME_RESULT) {
+                status = p[0];
+                device_rate = BenchFw_GetU32(&p[9]);
+                done = true;
+            }
+            fw_to_host.head++;
+        } else if (t == t_send) {
+            if (next < sizeof(fw_image)) {
+                uint32_t length = sizeof(fw_image) - next;
+                if (length > FW_BENCH_CHUNK) {
+                    length = FW_BENCH_CHUNK;
+                }
+                BenchFw_PutU32(payload, next);
+                memcpy(&payload[4], &fw_image[next], length);
+                BenchFw_Send(FW_FRAME_DATA, payload, length + 4, t);
+                next += length;
+
+                /* 损坏线路上的副本：设备按CRC错误处理 */
+                data_frames++;
+                if (c->corrupt_every != 0 && data_frames % c->corrupt_every == 0) {
+                    fw_to_device.frames[(fw_to_device.tail - 1) % FW_BENCH_QUEUE].data[FW_FRAME_HEADER_SIZE + 8] ^= 0x5A;
+                }
+            } else {
+                data_end_us = t;
+                BenchFw_Send(FW_FRAME_END, payload, 0, t);
+                end_sent = true;
+            }
+        } else {
+            resent += (next - base + FW_BENCH_CHUNK - 1) / FW_BENCH_CHUNK;
+            next = base;
+            progress_us = t;
+            timeouts++;
+        }
+    }
+
+    double data_secs = (data_end_us - data_start_us) / 1e6;
+    double rate = sizeof(fw_image) / data_secs;
+    printf("  %-18s %7.1f KB/s (%3.0f%% of line)  device %5.1f KB/s with erase  %3u resent  %u timeouts\n",
+           c->name, rate / 1000.0, rate * 100.0 / FW_LINE_BYTES_PER_SEC, device_rate / 1000.0,
+           (unsigned)resent, (unsigned)timeouts);
+
+    FwImageHeader_t header;
+    if (status != FW_STATUS_OK) {
+        Bench_Fail("session result");
+    }
+    if (FwUpdate_GetStagedImage(&header) != FLASH_OK || header.image_crc32 != image_crc ||
+        memcmp(W25QSim_Memory() + FW_IMAGE_ADDR, fw_image, sizeof(fw_image)) != 0) {
+        Bench_Fail("staged image");
+    }
+}
+
+static bool Bench_Fw(void)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < sizeof(bench_fw_cases) / sizeof(bench_fw_cases[0]); i++) {
+        ok &= Bench_Fork(Bench_FwRun, i);
+    }
+    return ok;
+}
+
+/* 顺序预读 ----------------------------------------------------------------------*/
+
+/**
+ * @brief 用连续的记录填满数据区后重新扫描
+ * @param length 记录长度
+ */
+static void Bench_ScanRun(uint32_t length)
+{
+    uint8_t *memory = W25QSim_Memory();
+    uint8_t payload[W25Q64_PAGE_SIZE];
+    uint32_t address = W25Q64_DATA_AREA_START;
+    uint32_t id = 1;
+    uint32_t count;
+
+    Bench_Start(NULL);
+
+    while (address + sizeof(DataHeader_t) + length <= W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE) {
+        DataHeader_t header;
+
+        Bench_Pattern(id, payload, length);
+        header.magic = W25Q64_DATA_HEADER_MAGIC;
+        header.record_id = id;
+        header.data_length = length;
+        header.crc16 = Flash_CalculateCRC16(payload, length);
+        memcpy(&memory[address], &header, sizeof(header));
+        memcpy(&memory[address + sizeof(header)], payload, length);
+        address += sizeof(header) + length;
+        id++;
+    }
+
+    Flash_InvalidatePageCache();
+    FlashPageCacheStats_t before = *Flash_GetPageCacheStats();
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+    Flash_ScanDataArea();
+    double secs = (HostOs_GetUs() - start) / 1e6;
+
+    const FlashPageCacheStats_t *after = Flash_GetPageCacheStats();
+    const W25QSimStats_t *stats = W25QSim_GetStats();
+    uint32_t bytes = address - W25Q64_DATA_AREA_START;
+
+    count = Bench_RecordCount();
+    printf("  %3u-byte records: %6u records, %.2f MB/s | %7u CS, %8u SPI B, %4u read-ahead bursts\n",
+           (unsigned)length, (unsigned)count, bytes / secs / BENCH_MB, (unsigned)stats->transactions,
+           (unsigned)stats->spi_bytes, (unsigned)(after->readahead_bursts - before.readahead_bursts));
+    if (count != id - 1 || stats->violations != 0) {
+        Bench_Fail("scan");
+    }
+}
+
+static bool Bench_Scan(void)
+{
+    static const uint32_t lengths[] = {18, 64, 256};
+    bool ok = true;
+
+    for (uint32_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        ok &= Bench_Fork(Bench_ScanRun, lengths[i]);
+    }
+    return ok;
+}
+
+/* 记录标签 ----------------------------------------------------------------------*/
+
+#define TAG_MAX_ID              200000
+#define TAG_COUNT               4
+
+typedef struct {
+    uint32_t hits;
+    uint32_t id_sum;
+    uint32_t sectors_read;
+    uint32_t spi_bytes;
+    double ms;
+} BenchTagQuery_t;
+
+static const struct {
+    uint16_t tag;
+    const char *name;
+} bench_tags[TAG_COUNT] = {
+    {2, "sparse"},
+    {3, "1 in 200"},
+    {9, "absent"},
+    {1, "dense"},
+};
+
+static uint16_t tag_truth[TAG_MAX_ID];
+
+/**
+ * @brief 按标签查询全部记录
+ */
+static BenchTagQuery_t Bench_TagQuery(uint16_t tag)
+{
+    BenchTagQuery_t query = {0};
+    FlashTagCursor_t cursor;
+    FlashResult_t result;
+
+    Flash_InvalidatePageCache();
+    W25QSim_ResetStats();
+    uint64_t start = HostOs_GetUs();
+
+    Flash_TagCursorInit(&cursor);
+    while ((result = Flash_ReadNextTagged(tag, &cursor, &bench_result)) != FLASH_ERROR_NOT_FOUND) {
+        if (result != FLASH_OK || bench_result.tag != tag || tag_truth[bench_result.record_id] != tag) {
+            Bench_Fail("tag query");
+        }
+        query.hits++;
+        query.id_sum += bench_result.record_id;
+    }
+
+    query.ms = Bench_Ms(start);
+    query.sectors_read = cursor.sectors_read;
+    query.spi_bytes = W25QSim_GetStats()->spi_bytes;
+    return query;
+}
+
+/**
+ * @brief 写满数据区（标签：每5000条1条标签2，约1/200标签3，其余标签1），
+ *       比较按摘要查询与删除摘要后逐个扇区查询
+ */
+static void Bench_TagsRun(uint32_t argument)
+{
+    BenchTagQuery_t summary[TAG_COUNT];
+    BenchTagQuery_t plain[TAG_COUNT];
+    uint8_t data[64];
+    uint32_t id = 0;
+    uint32_t write_address;
+
+    (void)argument;
+    Bench_Start(NULL);
+
+    for (;;) {
+        uint32_t length = 20 + Bench_Random() % 24;
+        uint16_t tag = ((id + 1) % 5000 == 1234) ? 2 : (Bench_Random() % 200 == 0) ? 3 : 1;
+
+        for (uint32_t j = 0; j < length; j++) {
+            data[j] = Bench_Random();
+        }
+        FlashResult_t result = Flash_StoreTaggedData(tag, data, length, &id);
+        if (result == FLASH_ERROR_FULL) {
+            break;
+        }
+        if (result != FLASH_OK || id >= TAG_MAX_ID) {
+            Bench_Fail("store");
+        }
+        tag_truth[id] = tag;
+    }
+    Flash_Flush();
+    uint32_t summaries = Flash_GetStageStats()->tag_summaries;     /* 重新挂载后统计清零 */
+    double mount_ms = Bench_Remount();
+    Flash_GetNextWriteAddress(&write_address);
+
+    uint32_t sectors = (write_address - W25Q64_DATA_AREA_START + W25Q64_SECTOR_SIZE - 1) / W25Q64_SECTOR_SIZE;
+    printf("  %u records in %u sectors, %u summaries, mount %.1f ms\n", (unsigned)id, (unsigned)sectors,
+           (unsigned)summaries, mount_ms);
+
+    for (uint32_t t = 0; t < TAG_COUNT; t++) {
+        summary[t] = Bench_TagQuery(bench_tags[t].tag);
+    }
+
+    /* 删除摘要区后重新挂载：查询逐个扇区读取数据头 */
+    Flash_DeInit();
+    memset(W25QSim_Memory() + W25Q64_TAG_AREA_START, 0xFF, W25Q64_TAG_AREA_SIZE);
+    W25QSim_PowerCycle();
+    if (Flash_Init() != FLASH_OK) {
+        Bench_Fail("remount");
+    }
+    for (uint32_t t = 0; t < TAG_COUNT; t++) {
+        plain[t] = Bench_TagQuery(bench_tags[t].tag);
+    }
+
+    for (uint32_t t = 0; t < TAG_COUNT; t++) {
+        printf("  tag %u %-9s %5u hits | summary %4u sectors %7.1f ms | plain %4u sectors %7.1f ms\n",
+               bench_tags[t].tag, bench_tags[t].name, (unsigned)summary[t].hits,
+               (unsigned)summary[t].sectors_read, summary[t].ms, (unsigned)plain[t].sectors_read, plain[t].ms);
+        if (summary[t].hits != plain[t].hits || summary[t].id_sum != plain[t].id_sum) {
+            Bench_Fail("summary and plain queries differ");
+        }
+    }
+}
+
+static bool Bench_Tags(void)
+{
+    return Bench_Fork(Bench_TagsRun, 0);
+}
+
+/* ------------------------------------------------------------------------------*/
+
+static const Bench_t bench_list[] = {
+    {"fs",       "file layer, 64 KB sequential I/O and 200-file mount", Bench_Fs},
+    {"program",  "page program throughput, 64 KB via Flash_Write",     Bench_Program},
+    {"cache",    "page cache, 20 x 40 B records stored and read back", Bench_Cache},
+    {"stage",    "write coalescing, 100 x 48 B records read back",      Bench_Stage},
+    {"column",   "column store, single-field vs full-row scan",         Bench_Column},
+    {"geometry", "SFDP parts filled, mount vs full rescan",             Bench_Geometry},
+    {"io",       "interactive read wait under 30 s write load",         Bench_Io},
+    {"fw",       "firmware staging over a 115200 baud loopback",       Bench_Fw},
+    {"scan",     "full data area scan with read-ahead",                 Bench_Scan},
+    {"tags",     "tag queries with and without sector summaries",       Bench_Tags},
+};
+
+#define BENCH_COUNT             (sizeof(bench_list) / sizeof(bench_list[0]))
+
+int main(int argc, char **argv)
+{
+    uint32_t failures = 0;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+        bool selected = (argc < 2);
+
+        for (int a = 1; a < argc; a++) {
+            selected |= (strcmp(argv[a], bench_list[i].name) == 0);
+        }
+        if (!selected) {
+            continue;
+        }
+
+        printf("%s: %s\n", bench_list[i].name, bench_list[i].description);
+        if (!bench_list[i].run()) {
+            failures++;
+        }
+    }
+
+    printf("flash_bench: %s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    flash_check.c
+  * @brief   Flash一致性测试（主机）
+  *          运行板上的Flash测试函数（flash_test.c）中不依赖实际时间的部分；
+  *          任何一项不是PASS时返回非0
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+#include "flash.h"
+#include "log.h"
+
+#include <stdio.h>
+
+/* 运行的测试：输出至少一行PASS且没有FAIL为通过 */
+void Flash_RecordCodecTest(void);
+
+static void (* const check_tests[])(void) = {
+    Flash_RecordCodecTest,
+};
+
+#define CHECK_TEST_COUNT        (sizeof(check_tests) / sizeof(check_tests[0]))
+
+int main(void)
+{
+    HostOs_Init(HOST_CLOCK_VIRTUAL);
+    HostBoard_Init();
+    W25QSim_Init(NULL);
+    Log_SetLevel(LOG_LEVEL_INFO);
+
+    if (Flash_Init() != FLASH_OK) {
+        fprintf(stderr, "flash_check: flash init failed\n");
+        return 1;
+    }
+
+    uint32_t passed = 0;
+    for (uint32_t i = 0; i < CHECK_TEST_COUNT; i++) {
+        uint32_t pass_count = HostOs_GetPassCount();
+        uint32_t fail_count = HostOs_GetFailCount();
+
+        check_tests[i]();
+        if (HostOs_GetFailCount() == fail_count && HostOs_GetPassCount() > pass_count) {
+            passed++;
+        }
+    }
+
+    printf("flash_check: %u of %u tests passed\n", (unsigned)passed, (unsigned)CHECK_TEST_COUNT);
+    return (passed == CHECK_TEST_COUNT) ? 0 : 1;
+}
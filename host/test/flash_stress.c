@@ -0,0 +1,294 @@
+/**
+  ******************************************************************************
+  * @file    flash_stress.c
+  * @brief   记录存储多任务压力测试（主机，实时时钟）
+  *          FlashIO任务、4个读取任务、追加任务、后台块擦除任务和快照检查任务在
+  *          pthread上并发运行，芯片模型按典型时间保持忙并支持擦除暂停。
+  *          读取任务在[first_id, head_id]中随机选取ID读取并校验内容，统计延迟
+  *
+  *          每个阶段在单独的子进程中从空芯片开始：
+  *            readers only         只有读取
+  *            load, no suspend     读取+追加+擦除，芯片ID不是Winbond，不暂停擦除
+  *            load, erase suspend  读取+追加+擦除，擦除期间暂停执行读取
+  *          每阶段时间由环境变量SECS设置（默认8秒）；内容错误、芯片协议违例或
+  *          快照不一致时返回非0
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+#include "flash.h"
+#include "flash_io.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define STRESS_LENGTH           32                      /* 记录长度 */
+#define STRESS_READERS          4
+#define STRESS_MAX_SAMPLES      400000                  /* 保存的读取延迟数 */
+#define STRESS_APPEND_GAP_US    500                     /* 追加间隔 */
+#define STRESS_ERASE_GAP_US     20000                   /* 块擦除间隔 */
+#define STRESS_ERASE_BLOCKS     8                       /* 在固件暂存区轮流擦除的块数 */
+#define STRESS_DEFAULT_SECS     8
+#define STRESS_SPI_HZ           9000000                 /* APB2 72MHz、8分频 */
+#define STRESS_JEDEC_WINBOND    0xEF4017                /* W25Q64，默认暂停命令75h/7Ah */
+#define STRESS_JEDEC_OTHER      0xC84017                /* GD25Q64，无SFDP时不暂停擦除 */
+
+typedef struct {
+    const char *name;
+    bool load;                  /* 运行追加和擦除任务 */
+    uint32_t jedec_id;
+} StressPhase_t;
+
+static const StressPhase_t stress_phases[] = {
+    {"readers only",        false, STRESS_JEDEC_WINBOND},
+    {"load, no suspend",    true,  STRESS_JEDEC_OTHER},
+    {"load, erase suspend", true,  STRESS_JEDEC_WINBOND},
+};
+
+#define STRESS_PHASE_COUNT      (sizeof(stress_phases) / sizeof(stress_phases[0]))
+
+static volatile bool stress_running;
+static uint32_t stress_latency[STRESS_MAX_SAMPLES];
+static volatile uint32_t stress_samples;
+static volatile uint32_t stress_bad;
+static volatile uint32_t stress_evicted;
+static volatile uint32_t stress_appends;
+static volatile uint32_t stress_erases;
+static volatile uint32_t stress_snapshot_checks;
+static volatile uint32_t stress_snapshot_bad;
+
+/**
+ * @brief 记录ID对应的内容
+ */
+static void Stress_Pattern(uint32_t id, uint8_t *data)
+{
+    memcpy(data, &id, sizeof(id));
+    for (uint32_t i = sizeof(id); i < STRESS_LENGTH; i++) {
+        data[i] = (uint8_t)(id * 31 + i);
+    }
+}
+
+/**
+ * @brief 读取任务
+ */
+static void Stress_ReaderTask(void *argument)
+{
+    unsigned int seed = (unsigned int)(uintptr_t)argument;
+    ReadResult_t *result = malloc(sizeof(ReadResult_t));
+    uint8_t expected[STRESS_LENGTH];
+
+    while (stress_running) {
+        FlashSnapshot_t snapshot;
+
+        Flash_GetSnapshot(&snapshot);
+        uint32_t id = snapshot.first_id + rand_r(&seed) % (snapshot.head_id - snapshot.first_id + 1);
+        uint64_t start = HostOs_GetUs();
+        FlashResult_t status = FlashIo_ReadData(FLASH_IO_INTERACTIVE, id, result);
+        uint32_t latency = (uint32_t)(HostOs_GetUs() - start);
+
+        uint32_t index = __sync_fetch_and_add(&stress_samples, 1);
+        if (index < STRESS_MAX_SAMPLES) {
+            stress_latency[index] = latency;
+        }
+
+        if (status == FLASH_OK) {
+            Stress_Pattern(id, expected);
+            if (result->data_length != STRESS_LENGTH || memcmp(result->data, expected, STRESS_LENGTH) != 0) {
+                __sync_fetch_and_add(&stress_bad, 1);
+            }
+        } else if (status == FLASH_ERROR_NOT_FOUND) {
+            /* 读取前ID已移出RAM索引：重新取快照后ID必须小于first_id */
+            Flash_GetSnapshot(&snapshot);
+            __sync_fetch_and_add((id < snapshot.first_id) ? &stress_evicted : &stress_bad, 1);
+        } else {
+            __sync_fetch_and_add(&stress_bad, 1);
+        }
+    }
+    free(result);
+}
+
+/**
+ * @brief 追加任务：新记录的ID必须是快照head_id+1
+ */
+static void Stress_AppendTask(void *argument)
+{
+    uint8_t data[STRESS_LENGTH];
+
+    (void)argument;
+    while (stress_running) {
+        FlashSnapshot_t snapshot;
+        uint32_t id = 0;
+
+        Flash_GetSnapshot(&snapshot);
+        Stress_Pattern(snapshot.head_id + 1, data);
+        if (FlashIo_StoreData(data, STRESS_LENGTH, &id) != FLASH_OK || id != snapshot.head_id + 1) {
+            __sync_fetch_and_add(&stress_bad, 1);
+        } else {
+            __sync_fetch_and_add(&stress_appends, 1);
+        }
+        usleep(STRESS_APPEND_GAP_US);
+    }
+}
+
+/**
+ * @brief 后台擦除任务：在固件暂存区轮流擦除64KB块
+ */
+static void Stress_EraseTask(void *argument)
+{
+    uint32_t block = 0;
+
+    (void)argument;
+    while (stress_running) {
+        uint32_t address = W25Q64_FW_AREA_START + (block++ % STRESS_ERASE_BLOCKS) * W25Q64_BLOCK_SIZE;
+
+        if (FlashIo_EraseBlock(address) != FLASH_OK) {
+            __sync_fetch_and_add(&stress_bad, 1);
+        } else {
+            __sync_fetch_and_add(&stress_erases, 1);
+        }
+        usleep(STRESS_ERASE_GAP_US);
+    }
+}
+
+/**
+ * @brief 快照检查任务：快照单调推进，各字段来自同一次提交
+ */
+static void Stress_SnapshotTask(void *argument)
+{
+    FlashSnapshot_t previous;
+
+    (void)argument;
+    Flash_GetSnapshot(&previous);
+    uint32_t base = previous.record_count - previous.head_id;
+
+    while (stress_running) {
+        FlashSnapshot_t snapshot;
+
+        Flash_GetSnapshot(&snapshot);
+        if (snapshot.head_id < previous.head_id || snapshot.write_address < previous.write_address ||
+            snapshot.first_id < previous.first_id || snapshot.first_id > snapshot.head_id ||
+            snapshot.head_id - snapshot.first_id >= W25Q64_MAX_CACHE_ENTRIES ||
+            snapshot.record_count - snapshot.head_id != base) {
+            stress_snapshot_bad++;
+        }
+        previous = snapshot;
+        stress_snapshot_checks++;
+        osThreadYield();        /* 最低优先级：单核主机上不占用其他任务的时间 */
+    }
+}
+
+static int Stress_Compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * @brief 运行一个阶段（子进程），返回0为没有错误
+ */
+static int Stress_RunPhase(const StressPhase_t *phase, uint32_t secs)
+{
+    W25QSimConfig_t config;
+    uint8_t data[STRESS_LENGTH];
+    uint32_t id;
+
+    HostOs_Init(HOST_CLOCK_REAL);
+    HostBoard_Init();
+    W25QSim_DefaultConfig(&config);
+    config.jedec_id = phase->jedec_id;
+    config.timing = true;
+    config.spi_hz = STRESS_SPI_HZ;
+    W25QSim_Init(&config);
+    Log_SetLevel(LOG_LEVEL_WARN);
+
+    osThreadNew(FlashIo_Task, NULL, NULL);
+    while (!FlashIo_IsReady()) {
+        usleep(1000);
+    }
+
+    /* 先写满RAM索引，读取任务有可选的ID */
+    for (uint32_t i = 0; i < W25Q64_MAX_CACHE_ENTRIES; i++) {
+        FlashSnapshot_t snapshot;
+
+        Flash_GetSnapshot(&snapshot);
+        Stress_Pattern(snapshot.head_id + 1, data);
+        if (FlashIo_StoreData(data, STRESS_LENGTH, &id) != FLASH_OK) {
+            fprintf(stderr, "flash_stress: prefill failed\n");
+            return 1;
+        }
+    }
+    W25QSim_ResetStats();
+
+    stress_running = true;
+    for (uintptr_t i = 0; i < STRESS_READERS; i++) {
+        osThreadNew(Stress_ReaderTask, (void*)(i + 1), NULL);
+    }
+    if (phase->load) {
+        osThreadNew(Stress_AppendTask, NULL, NULL);
+        osThreadNew(Stress_EraseTask, NULL, NULL);
+    }
+    osThreadNew(Stress_SnapshotTask, NULL, NULL);
+
+    sleep(secs);
+    stress_running = false;
+    usleep(300000);
+
+    uint32_t count = (stress_samples < STRESS_MAX_SAMPLES) ? stress_samples : STRESS_MAX_SAMPLES;
+    if (count == 0) {
+        fprintf(stderr, "flash_stress: no reads\n");
+        return 1;
+    }
+    qsort(stress_latency, count, sizeof(uint32_t), Stress_Compare);
+
+    const W25QSimStats_t *stats = W25QSim_GetStats();
+    printf("%-20s %6.1fk reads/s  p50 %5.2f  p99 %5.2f  max %6.1f ms | %4.0f appends/s  %3u erases  %5u suspends\n",
+           phase->name, count / (secs * 1000.0), stress_latency[count / 2] / 1000.0,
+           stress_latency[count * 99 / 100] / 1000.0, stress_latency[count - 1] / 1000.0,
+           stress_appends / (double)secs, (unsigned)stress_erases, (unsigned)Flash_GetSuspendStats()->suspends);
+    printf("%-20s bad %u, evicted %u, chip violations %u, snapshots %u checked %u inconsistent\n",
+           "", (unsigned)stress_bad, (unsigned)stress_evicted, (unsigned)stats->violations,
+           (unsigned)stress_snapshot_checks, (unsigned)stress_snapshot_bad);
+    if (stats->suspends > 0) {
+        printf("%-20s min resume to suspend %u us\n", "", (unsigned)stats->min_resume_us);
+    }
+    fflush(stdout);
+
+    return (stress_bad == 0 && stats->violations == 0 && stress_snapshot_bad == 0) ? 0 : 1;
+}
+
+int main(void)
+{
+    uint32_t secs = getenv("SECS") ? strtoul(getenv("SECS"), NULL, 0) : STRESS_DEFAULT_SECS;
+    int failures = 0;
+
+    if (secs == 0) {
+        secs = 1;
+    }
+    printf("flash_stress: %u s per phase, %u readers, append every %u us, 64KB erase every %u ms\n",
+           (unsigned)secs, STRESS_READERS, STRESS_APPEND_GAP_US, STRESS_ERASE_GAP_US / 1000);
+    fflush(stdout);
+
+    /* FlashIO任务不会退出：每个阶段在子进程中运行，结束时直接退出进程 */
+    for (uint32_t i = 0; i < STRESS_PHASE_COUNT; i++) {
+        pid_t pid = fork();
+        int status = 1;
+
+        if (pid == 0) {
+            _exit(Stress_RunPhase(&stress_phases[i], secs));
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("%-20s FAIL\n", stress_phases[i].name);
+            failures++;
+        }
+    }
+
+    printf("flash_stress: %s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    modbus_bench.c
+  * @brief   Modbus基准测试（主机）
+  *          与板上相同的基准函数（modbus_test.c）：各功能码的周期数、请求速率（req/s）、
+  *          端口应答时间等。周期数为主机时间按SystemCoreClock（72 MHz）换算，
+  *          只用于比较改动前后，不是板上的数值；任何一项不是PASS时返回非0
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+#include "modbus.h"
+#include "log.h"
+
+#include <stdio.h>
+
+/* 文件记录基准需要列存储中至少121个样本 */
+#define BENCH_SAMPLES           1000
+
+/* 运行的基准：输出至少一行PASS且没有FAIL为通过 */
+void Modbus_FunctionCodeBenchmark(void);
+void Modbus_RequestRateBenchmark(void);
+void Modbus_ServeBenchmark(void);
+void Modbus_ReadResponseBenchmark(void);
+void Modbus_FrameParseBenchmark(void);
+void Modbus_DualPortBenchmark(void);
+
+static void (* const bench_list[])(void) = {
+    Modbus_FunctionCodeBenchmark,
+    Modbus_RequestRateBenchmark,
+    Modbus_ServeBenchmark,
+    Modbus_ReadResponseBenchmark,
+    Modbus_FrameParseBenchmark,
+    Modbus_DualPortBenchmark,
+};
+
+#define BENCH_COUNT        (sizeof(bench_list) / sizeof(bench_list[0]))
+
+int main(void)
+{
+    HostOs_Init(HOST_CLOCK_REAL);
+    HostBoard_Init();
+    W25QSim_Init(NULL);
+    Log_SetLevel(LOG_LEVEL_INFO);
+
+    if (HostBoard_FlashInit() != FLASH_OK || HostBoard_FillColumns(BENCH_SAMPLES) != FLASH_OK) {
+        fprintf(stderr, "modbus_bench: flash setup failed\n");
+        return 1;
+    }
+    Modbus_Init();
+
+    uint32_t passed = 0;
+    for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+        uint32_t pass_count = HostOs_GetPassCount();
+        uint32_t fail_count = HostOs_GetFailCount();
+
+        bench_list[i]();
+        if (HostOs_GetFailCount() == fail_count && HostOs_GetPassCount() > pass_count) {
+            passed++;
+        }
+    }
+
+    printf("modbus_bench: %u of %u benchmarks passed\n", (unsigned)passed, (unsigned)BENCH_COUNT);
+    return (passed == BENCH_COUNT) ? 0 : 1;
+}
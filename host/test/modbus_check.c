@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    modbus_check.c
+  * @brief   Modbus一致性测试（主机）
+  *          与板上相同的测试函数（modbus_test.c），在芯片模型上按FlashIO任务的流程
+  *          初始化后依次运行；任何一项不是PASS时返回非0
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+#include "modbus.h"
+#include "log.h"
+
+#include <stdio.h>
+
+/* 文件记录测试需要列存储中至少121个样本 */
+#define CHECK_SAMPLES           1000
+
+/* 运行的测试：输出至少一行PASS且没有FAIL为通过 */
+void Modbus_RtuFramerTest(void);
+void Modbus_RegisterMapTest(void);
+void Modbus_RegisterWriteTest(void);
+void Modbus_FileRecordTest(void);
+void Modbus_ConformanceTest(void);
+void Modbus_FuzzTest(void);
+
+static void (* const check_tests[])(void) = {
+    Modbus_RtuFramerTest,
+    Modbus_RegisterMapTest,
+    Modbus_RegisterWriteTest,
+    Modbus_FileRecordTest,
+    Modbus_ConformanceTest,
+    Modbus_FuzzTest,
+};
+
+#define CHECK_TEST_COUNT        (sizeof(check_tests) / sizeof(check_tests[0]))
+
+int main(void)
+{
+    HostOs_Init(HOST_CLOCK_REAL);
+    HostBoard_Init();
+    W25QSim_Init(NULL);
+    Log_SetLevel(LOG_LEVEL_INFO);
+
+    if (HostBoard_FlashInit() != FLASH_OK || HostBoard_FillColumns(CHECK_SAMPLES) != FLASH_OK) {
+        fprintf(stderr, "modbus_check: flash setup failed\n");
+        return 1;
+    }
+    Modbus_Init();
+
+    uint32_t passed = 0;
+    for (uint32_t i = 0; i < CHECK_TEST_COUNT; i++) {
+        uint32_t pass_count = HostOs_GetPassCount();
+        uint32_t fail_count = HostOs_GetFailCount();
+
+        check_tests[i]();
+        if (HostOs_GetFailCount() == fail_count && HostOs_GetPassCount() > pass_count) {
+            passed++;
+        }
+    }
+
+    printf("modbus_check: %u of %u tests passed\n", (unsigned)passed, (unsigned)CHECK_TEST_COUNT);
+    return (passed == CHECK_TEST_COUNT) ? 0 : 1;
+}
@@ -0,0 +1,378 @@
+/**
+  ******************************************************************************
+  * @file    modbus_fuzz.c
+  * @brief   Modbus模糊测试入口（libFuzzer/AFL）
+  *          输入的第一个字节选择模式：
+  *            bit0=0 请求模式：其余字节作为一个请求交给Modbus_ProcessRequest，
+  *                   bit1=1时改写地址为1并加CRC，使请求到达功能码处理
+  *            bit0=1 字节流模式：bit1~2选择波特率，其余字节为最多8段
+  *                   [控制][长度][数据...]，按控制字节的静默时间、帧内间隔和噪声
+  *                   回放给RTU帧定界，正确的帧再交给Modbus_ProcessFrame
+  *          检查与板上模糊测试（Modbus_FuzzTest）相同：应答符合标准、不越过发送
+  *          缓冲区、不读取帧以外的字节、帧定界不丢字节、不丢正确帧；失败时abort()
+  *
+  *          控制字节：bit0~1段前静默（0：无，1：小于t1.5，2：t1.5~t3.5，3：超过t3.5）
+  *                    bit2噪声，bit3帧内间隔，bit4~5帧内间隔的静默，bit6~7间隔位置
+  *
+  *          HOST_FUZZ_STANDALONE（gcc）：没有libFuzzer时的main，参数为文件或目录时
+  *          逐个运行（与AFL的@@兼容），否则用板上测试的变异器生成-runs=N个输入；
+  *          -seeds=DIR把种子写为输入文件，作为libFuzzer/AFL的初始语料
+  ******************************************************************************
+  */
+#include "host_os.h"
+#include "host_board.h"
+#include "w25q_sim.h"
+
+/* 使用板上测试的静态辅助函数：应答检查、保护字节、帧定界回放和变异器 */
+#include "../../mycodec/modbus_test.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FUZZ_SAMPLES            1000                   /* 列存储样本数，文件记录请求读到数据 */
+#define FUZZ_MODE_STREAM        0x01
+#define FUZZ_MODE_FIX_CRC       0x02
+#define FUZZ_MAX_SEGMENTS       8
+
+#define FUZZ_CTRL_NOISE         0x04
+#define FUZZ_CTRL_SPLIT         0x08
+
+static const uint32_t fuzz_baud_rates[4] = {9600, 19200, 115200, 921600};
+
+static Tuning_t fuzz_saved_tuning;
+static LogLevel_t fuzz_saved_level;
+
+/**
+ * @brief 控制字节中的静默类别换算为时间
+ */
+static uint32_t Fuzz_Gap(uint8_t gap_class)
+{
+    switch (gap_class & 0x03) {
+    case 0:
+        return 0;
+    case 1:
+        return test_timing.t15_us / 2;
+    case 2:
+        return (test_timing.t15_us + test_timing.t35_us) / 2;
+    default:
+        return test_timing.t35_us + test_timing.t35_us / 2;
+    }
+}
+
+/**
+ * @brief 请求模式
+ */
+static void Fuzz_Request(uint8_t mode, const uint8_t *data, size_t size)
+{
+    uint16_t length;
+    uint16_t response_length;
+
+    if (mode & FUZZ_MODE_FIX_CRC) {
+        length = (size < MODBUS_RTU_MAX_FRAME - 2) ? size : MODBUS_RTU_MAX_FRAME - 2;
+        memcpy(test_fuzz_frame, data, length);
+        if (length > 0) {
+            test_fuzz_frame[0] = 0x01;
+        }
+        uint16_t crc = Modbus_CalculateCRC16(test_fuzz_frame, length);
+        test_fuzz_frame[length++] = crc & 0xFF;
+        test_fuzz_frame[length++] = crc >> 8;
+    } else {
+        length = (size < MODBUS_RTU_MAX_FRAME) ? size : MODBUS_RTU_MAX_FRAME;
+        memcpy(test_fuzz_frame, data, length);
+    }
+
+    if (!ModbusTest_WritesSave(test_fuzz_frame, length)) {
+        ModbusTest_FuzzOne(length, &response_length);
+    }
+}
+
+/**
+ * @brief 字节流模式
+ * @note 与ModbusTest_FuzzStream相同的检查：输出字节数等于回放字节数；前后静默都不小于
+ *       t3.5、没有帧内间隔和噪声的正确帧必须作为正确的帧输出
+ */
+static void Fuzz_Stream(uint8_t mode, const uint8_t *data, size_t size)
+{
+    ModbusTestSegment_t segments[FUZZ_MAX_SEGMENTS];
+    bool crc_ok[FUZZ_MAX_SEGMENTS];
+    uint16_t count = 0;
+    uint32_t played = 0;
+    uint32_t expected = 0;
+
+    ModbusTest_Reset(fuzz_baud_rates[(mode >> 1) & 0x03]);
+    ModbusRtu_FramerInit(&test_framer, test_ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusTest_FuzzSink, NULL);
+
+    while (size >= 2 && count < FUZZ_MAX_SEGMENTS) {
+        uint8_t control = data[0];
+        uint16_t length = (data[1] < size - 2) ? data[1] : size - 2;
+        ModbusTestSegment_t *segment = &segments[count];
+
+        data += 2;
+        size -= 2;
+        if (length == 0) {
+            continue;
+        }
+
+        segment->data = data;
+        segment->length = length;
+        segment->gap_us = Fuzz_Gap(control);
+        segment->split_at = ((control & FUZZ_CTRL_SPLIT) && length > 1) ?
+                            1 + (length - 1) * (control >> 6) / 4 : 0;
+        segment->split_gap_us = Fuzz_Gap(control >> 4);
+        segment->noise = (control & FUZZ_CTRL_NOISE) != 0;
+        crc_ok[count] = length >= MODBUS_RTU_MIN_FRAME && Modbus_CalculateCRC16((uint8_t*)data, length) == 0;
+
+        played += length;
+        data += length;
+        size -= length;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t next_gap = (i + 1 < count) ? segments[i + 1].gap_us : test_timing.t35_us;
+
+        if (crc_ok[i] && segments[i].split_at == 0 && !segments[i].noise &&
+            segments[i].gap_us >= test_timing.t35_us && next_gap >= test_timing.t35_us) {
+            expected++;
+        }
+    }
+
+    uint32_t bytes = test_fuzz_bytes;
+    uint32_t ok_frames = test_fuzz_ok_frames;
+    ModbusTest_Replay(segments, count);
+
+    if (test_fuzz_bytes - bytes != played) {
+        ModbusTest_FuzzReport("framer bytes", segments[0].data, segments[0].length);
+    }
+    if (test_fuzz_ok_frames - ok_frames < expected) {
+        ModbusTest_FuzzReport("framer lost", segments[0].data, segments[0].length);
+    }
+}
+
+/**
+ * @brief 运行一个输入，返回失败数
+ * @note 请求可能改写运行参数和日志级别（不保存），运行后写回，使各输入互不影响
+ */
+static uint32_t Fuzz_Run(const uint8_t *data, size_t size)
+{
+    test_fuzz_failures = 0;
+    if (size == 0) {
+        return 0;
+    }
+
+    if (data[0] & FUZZ_MODE_STREAM) {
+        Fuzz_Stream(data[0], data + 1, size - 1);
+    } else {
+        Fuzz_Request(data[0], data + 1, size - 1);
+    }
+
+    if ((memcmp(&fuzz_saved_tuning, &g_tuning, sizeof(Tuning_t)) != 0 || Log_GetLevel() != fuzz_saved_level) &&
+        !ModbusTest_RestoreTuning(&fuzz_saved_tuning, fuzz_saved_level)) {
+        Log_Error("Fuzz: tuning not restored");
+        test_fuzz_failures++;
+    }
+    return test_fuzz_failures;
+}
+
+/**
+ * @brief 与modbus_check相同的启动流程，之后不输出日志
+ */
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+
+    HostOs_Init(HOST_CLOCK_REAL);
+    HostBoard_Init();
+    W25QSim_Init(NULL);
+    Log_SetLevel(LOG_LEVEL_INFO);
+    if (HostBoard_FlashInit() != FLASH_OK || HostBoard_FillColumns(FUZZ_SAMPLES) != FLASH_OK) {
+        fprintf(stderr, "modbus_fuzz: flash setup failed\n");
+        exit(1);
+    }
+    Modbus_Init();
+
+    fuzz_saved_tuning = g_tuning;
+    fuzz_saved_level = Log_GetLevel();
+    ModbusTest_GuardIntact();
+    HostOs_SetLogQuiet(true);
+    return 0;
+}
+
+/**
+ * @brief 失败时打开日志重新运行一次输出失败原因，然后abort()保存输入
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (Fuzz_Run(data, size) != 0) {
+        HostOs_SetLogQuiet(false);
+        Fuzz_Run(data, size);
+        abort();
+    }
+    return 0;
+}
+
+#ifdef HOST_FUZZ_STANDALONE
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define FUZZ_DEFAULT_RUNS       20000
+#define FUZZ_MAX_INPUT          (1 + FUZZ_MAX_SEGMENTS * (2 + MODBUS_RTU_MAX_FRAME))
+
+static uint8_t fuzz_input[FUZZ_MAX_INPUT];
+
+/**
+ * @brief 从语料生成一个输入：变异后的请求，或由语料帧组成的字节流
+ */
+static size_t Fuzz_Generate(uint8_t *input)
+{
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+    size_t size = 1;
+
+    input[0] = ModbusTest_Random();
+    uint16_t segments = (input[0] & FUZZ_MODE_STREAM) ? 1 + ModbusTest_Random() % FUZZ_MAX_SEGMENTS : 1;
+
+    for (uint16_t i = 0; i < segments; i++) {
+        uint16_t k = ModbusTest_Random() % test_fuzz_count;
+        uint16_t length = test_fuzz_length[k];
+
+        memcpy(frame, test_fuzz_corpus[k], length);
+        if (!(input[0] & FUZZ_MODE_STREAM) || ModbusTest_Random() % 4 == 0) {
+            length = ModbusTest_Mutate(frame, length);
+        }
+        if (input[0] & FUZZ_MODE_STREAM) {
+            if (length > 0xFF) {
+                length = 0xFF;
+            }
+            /* 多数段前后静默超过t3.5，使正确帧的检查生效 */
+            input[size++] = (ModbusTest_Random() % 4 == 0) ? ModbusTest_Random() : 0x03;
+            input[size++] = length;
+        } else if (input[0] & FUZZ_MODE_FIX_CRC) {
+            length = (length >= 2) ? length - 2 : 0;
+        }
+        memcpy(&input[size], frame, length);
+        size += length;
+    }
+    return size;
+}
+
+/**
+ * @brief 把种子请求写为输入文件
+ */
+static int Fuzz_WriteSeeds(const char *directory)
+{
+    char path[512];
+
+    for (uint16_t i = 0; i < test_fuzz_seeds; i++) {
+        uint8_t mode = 0;
+
+        snprintf(path, sizeof(path), "%s/seed_%02u", directory, i);
+        FILE *file = fopen(path, "wb");
+        if (file == NULL) {
+            perror(path);
+            return 1;
+        }
+        fwrite(&mode, 1, 1, file);
+        fwrite(test_fuzz_corpus[i], 1, test_fuzz_length[i], file);
+        fclose(file);
+    }
+    printf("modbus_fuzz: %u seeds written to %s\n", test_fuzz_seeds, directory);
+    return 0;
+}
+
+/**
+ * @brief 运行一个输入文件
+ */
+static void Fuzz_RunFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    size_t size = fread(fuzz_input, 1, sizeof(fuzz_input), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(fuzz_input, size);
+}
+
+/**
+ * @brief 运行文件或目录中的全部文件，返回运行的输入数
+ */
+static uint32_t Fuzz_RunPath(const char *path)
+{
+    struct stat info;
+    uint32_t runs = 0;
+
+    if (stat(path, &info) != 0) {
+        perror(path);
+        exit(1);
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        Fuzz_RunFile(path);
+        return 1;
+    }
+
+    DIR *directory = opendir(path);
+    struct dirent *entry;
+    char file_path[512];
+
+    while (directory != NULL && (entry = readdir(directory)) != NULL) {
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name);
+        if (stat(file_path, &info) == 0 && S_ISREG(info.st_mode)) {
+            Fuzz_RunFile(file_path);
+            runs++;
+        }
+    }
+    if (directory != NULL) {
+        closedir(directory);
+    }
+    return runs;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t runs = FUZZ_DEFAULT_RUNS;
+    uint32_t seed = MODBUS_TEST_FUZZ_SEED;
+    const char *seeds_directory = NULL;
+    uint32_t inputs = 0;
+    bool paths = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = strtoul(argv[i] + 6, NULL, 0);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            seed = strtoul(argv[i] + 6, NULL, 0);
+        } else if (strncmp(argv[i], "-seeds=", 7) == 0) {
+            seeds_directory = argv[i] + 7;
+        } else if (argv[i][0] != '-') {
+            paths = true;
+        }
+    }
+
+    LLVMFuzzerInitialize(&argc, &argv);
+    test_fuzz_state = (seed != 0) ? seed : MODBUS_TEST_FUZZ_SEED;
+    ModbusTest_FuzzSeed();
+    if (seeds_directory != NULL) {
+        return Fuzz_WriteSeeds(seeds_directory);
+    }
+
+    if (paths) {
+        for (int i = 1; i < argc; i++) {
+            if (argv[i][0] != '-') {
+                inputs += Fuzz_RunPath(argv[i]);
+            }
+        }
+    } else {
+        for (inputs = 0; inputs < runs; inputs++) {
+            size_t size = Fuzz_Generate(fuzz_input);
+            LLVMFuzzerTestOneInput(fuzz_input, size);
+        }
+    }
+
+    printf("modbus_fuzz: %u inputs, %u ok frames, no failures\n", (unsigned)inputs, (unsigned)test_fuzz_ok_frames);
+    return 0;
+}
+#endif /* HOST_FUZZ_STANDALONE */
@@ -26,6 +26,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "cmsis_os.h"
+#include "modbus_rtu.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -47,7 +48,6 @@
 /* USER CODE BEGIN PV */
 
 /* 外部变量声明 */
-extern uint8_t bt_rx_buffer[256];
 extern osMessageQueueId_t BLEQueueHandle;
 
 /* BLE全局变量定义 */
@@ -87,14 +87,8 @@ void BLE_Init(void)
     
     Log_Info("BLE system initialized");
     
-    /* 启动UART2 DMA接收 - 使用ReceiveToIdle模式 */
-    if (HAL_UARTEx_ReceiveToIdle_DMA(&huart2, bt_rx_buffer, sizeof(bt_rx_buffer)) != HAL_OK) {
-        Log_Error("UART2 DMA receive start failed");
-    } else {
-        Log_Debug("UART2 DMA receive started successfully");
-        /* 禁止半传输中断 */
-        __HAL_DMA_DISABLE_IT(huart2.hdmarx, DMA_IT_HT);
-    }
+    /* 启动UART2循环DMA接收，按RTU帧间隔定界 */
+    ModbusRtu_Start(&g_modbus_rtu_usart2);
 }
 
 /**
@@ -113,7 +107,9 @@ void BLE_UART_RxCpltCallback(UART_HandleTypeDef *huart)
         /* 创建BLE消息并复制实际接收的数据 */
         BLEMessage_t ble_msg;
         ble_msg.length = ble_rx_count;
+        ble_msg.flags = 0;
         ble_msg.timestamp = HAL_GetTick();
+        ble_msg.cycles = 0;
         
         /* 复制接收到的数据 */
         memcpy(ble_msg.data, ble_rx_buffer, ble_rx_count);
@@ -147,30 +143,7 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
         Log_Debug("UART1 Rx Event: %d bytes", Size);
         // 这里可以添加USART1的处理逻辑
     }
-    else if (huart->Instance == USART2) // 蓝牙串口
-    {
-        Log_Debug("BLE UART Rx Event: %d bytes", Size);
-        
-        // 创建BLE消息并复制实际接收的数据
-        BLEMessage_t ble_msg;
-        ble_msg.length = Size;
-        ble_msg.timestamp = HAL_GetTick();
-        
-        // 只复制实际接收到的数据
-        memcpy(ble_msg.data, bt_rx_buffer, Size);
-        
-        // 将消息放入队列
-        osStatus_t status = osMessageQueuePut(BLEQueueHandle, &ble_msg, 0, 0);
-        if (status != osOK) {
-            Log_Error("BLE queue full, data lost");
-        } else {
-            Log_Debug("BLE data queued: %d bytes", Size);
-        }
-        
-        // 重新启动DMA接收
-        HAL_UARTEx_ReceiveToIdle_DMA(&huart2, bt_rx_buffer, sizeof(bt_rx_buffer));
-        __HAL_DMA_DISABLE_IT(huart->hdmarx, DMA_IT_HT); // 禁止半传输中断
-    }
+    /* USART2由modbus_rtu.c按RTU帧间隔定界，不使用ReceiveToIdle */
 }
 
 /**
@@ -219,7 +192,9 @@ void UART2_ProcessReceivedData(void)
         /* 创建BLE消息 */
         BLEMessage_t ble_msg;
         ble_msg.length = ble_rx_count;
+        ble_msg.flags = 0;
         ble_msg.timestamp = HAL_GetTick();
+        ble_msg.cycles = 0;
         
         /* 复制接收到的数据 */
         memcpy(ble_msg.data, ble_rx_buffer, ble_rx_count);
@@ -332,8 +307,12 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
         Log_Error("UART2 error occurred");
         ble_rx_state = BLE_RX_ERROR;
         
-        /* 重新启动接收 */
-        UART2_StartReceive();
+        /* 重新启动RTU接收 */
+        ModbusRtu_Start(&g_modbus_rtu_usart2);
+    } else if (huart->Instance == USART3) {
+        /* HAL处理溢出错误时会关闭RXNE中断，重新启动RTU接收 */
+        Log_Error("UART3 error occurred");
+        ModbusRtu_Start(&g_modbus_rtu_usart3);
     }
 }
 
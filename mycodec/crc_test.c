@@ -0,0 +1,194 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    crc_test.c
+  * @brief   This file provides test code for the CRC engine.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crc.h"
+#include "bsp_dwt.h"
+#include "log.h"
+
+/* USER CODE BEGIN Includes */
+
+/* USER CODE END Includes */
+
+/* Private typedef -----------------------------------------------------------*/
+/* USER CODE BEGIN PTD */
+
+/* USER CODE END PTD */
+
+/* Private define ------------------------------------------------------------*/
+/* USER CODE BEGIN PD */
+
+#define CRC_TEST_BUFFER_SIZE     1024                   /* 每次计算的数据量，与一次DMA块相当 */
+#define CRC_TEST_ROUNDS          16                     /* 重复次数 */
+
+/* 旧实现占用的查表空间，用于对比 */
+#define CRC16_BYTE_TABLE_BYTES   (256 * sizeof(uint16_t))
+#define CRC32_NIBBLE_TABLE_BYTES (16 * sizeof(uint32_t))
+
+/* USER CODE END PD */
+
+/* Private macro -------------------------------------------------------------*/
+/* USER CODE BEGIN PM */
+
+/* USER CODE END PM */
+
+/* Private variables ---------------------------------------------------------*/
+/* USER CODE BEGIN PV */
+
+static uint8_t test_buffer[CRC_TEST_BUFFER_SIZE];
+
+/* 标准校验值，输入为"123456789" */
+static const uint8_t check_input[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+/* USER CODE BEGIN PFP */
+
+/* USER CODE END PFP */
+
+/* Private user code ---------------------------------------------------------*/
+/* USER CODE BEGIN 0 */
+
+/**
+ * @brief 硬件CRC单元计算（被占用时返回0）
+ */
+static uint32_t CrcTest_Hardware(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    return Crc32_UpdateHardware(&crc, data, length) ? crc : 0;
+}
+
+/**
+ * @brief 输出一种实现的每字节周期数（保留两位小数）
+ */
+static void CrcTest_Report(const char *name, uint32_t cycles, uint32_t table_bytes)
+{
+    uint32_t centi = cycles * 100 / (CRC_TEST_BUFFER_SIZE * CRC_TEST_ROUNDS);
+
+    Log_Info("%-12s %lu.%02lu cyc/B, table %lu B", name, centi / 100, centi % 100, table_bytes);
+}
+
+/* USER CODE END 0 */
+
+/* Exported functions --------------------------------------------------------*/
+/* USER CODE BEGIN EF */
+
+/**
+ * @brief CRC各实现的正确性与性能对比
+ * @note 先用标准校验值和分段计算验证结果，再对1KB数据统计每字节周期数，
+ *       同时列出各实现的查表空间
+ */
+void Crc_BenchmarkTest(void)
+{
+    uint32_t start;
+    uint32_t cycles;
+    uint16_t crc16;
+    uint32_t crc32;
+    bool passed = true;
+
+    Log_Info("=== CRC Benchmark Test ===");
+
+    DWT_Init();
+
+    for (uint32_t i = 0; i < CRC_TEST_BUFFER_SIZE; i++) {
+        test_buffer[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    /* 标准校验值 */
+    if (Crc16Ccitt_Update(CRC16_CCITT_INIT, check_input, 9) != 0x29B1 ||
+        Crc16Ccitt_UpdateBytewise(CRC16_CCITT_INIT, check_input, 9) != 0x29B1) {
+        Log_Error("CCITT check value mismatch");
+        passed = false;
+    }
+    if (Crc16Modbus_Update(CRC16_MODBUS_INIT, check_input, 9) != 0x4B37 ||
+        Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, check_input, 9) != 0x4B37) {
+        Log_Error("Modbus check value mismatch");
+        passed = false;
+    }
+    if (Crc32_UpdateSoftware(CRC32_INIT, check_input, 9) != 0x0376E6E7 ||
+        CrcTest_Hardware(CRC32_INIT, check_input, 9) != 0x0376E6E7) {
+        Log_Error("CRC32 check value mismatch");
+        passed = false;
+    }
+
+    /* 分段计算与一次计算结果一致（分段点不对齐4字节） */
+    crc32 = Crc32_Update(CRC32_INIT, test_buffer, 333);
+    crc32 = Crc32_Update(crc32, test_buffer + 333, CRC_TEST_BUFFER_SIZE - 333);
+    if (crc32 != Crc32_UpdateSoftware(CRC32_INIT, test_buffer, CRC_TEST_BUFFER_SIZE)) {
+        Log_Error("CRC32 chunked result mismatch");
+        passed = false;
+    }
+    crc16 = Crc16Modbus_Update(CRC16_MODBUS_INIT, test_buffer, 333);
+    crc16 = Crc16Modbus_Update(crc16, test_buffer + 333, CRC_TEST_BUFFER_SIZE - 333);
+    if (crc16 != Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, test_buffer, CRC_TEST_BUFFER_SIZE)) {
+        Log_Error("Modbus chunked result mismatch");
+        passed = false;
+    }
+
+    /* 每字节周期数 */
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc16 = Crc16Ccitt_UpdateBytewise(CRC16_CCITT_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("CCITT byte", cycles, CRC16_BYTE_TABLE_BYTES);
+
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc16 = Crc16Ccitt_Update(CRC16_CCITT_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("CCITT s4", cycles, CRC16_SLICE4_TABLE_BYTES);
+
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc16 = Crc16Modbus_UpdateBytewise(CRC16_MODBUS_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("Modbus byte", cycles, CRC16_BYTE_TABLE_BYTES);
+
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc16 = Crc16Modbus_Update(CRC16_MODBUS_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("Modbus s4", cycles, CRC16_SLICE4_TABLE_BYTES);
+
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc32 = Crc32_UpdateSoftware(CRC32_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("CRC32 sw", cycles, CRC32_TABLE_BYTES);
+
+    start = DWT_GetTick();
+    for (uint32_t r = 0; r < CRC_TEST_ROUNDS; r++) {
+        crc32 = CrcTest_Hardware(CRC32_INIT, test_buffer, CRC_TEST_BUFFER_SIZE);
+    }
+    cycles = DWT_GetTick() - start;
+    CrcTest_Report("CRC32 hw", cycles, 0);
+
+    Log_Info("Old nibble CRC32 table: %lu B", (uint32_t)CRC32_NIBBLE_TABLE_BYTES);
+    Log_Info("Last results: 0x%04X 0x%08lX", crc16, crc32);
+    Log_Info("Correctness: %s", passed ? "PASS" : "FAIL");
+
+    Log_Info("=== CRC Benchmark Test Completed ===");
+}
+
+/* USER CODE END EF */
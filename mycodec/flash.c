@@ -2,8 +2,10 @@
 #include "spi.h"
 #include "gpio.h"
 #include "log.h"
+#include "bsp_dwt.h"
+#include "crc.h"
 #include <string.h>
-#include <stdlib.h>
+#include <stddef.h>
 
 /* 私有变量 */
 static bool g_flash_initialized = false;
@@ -16,6 +18,65 @@ static CacheEntry_t g_cache_entries[W25Q64_MAX_CACHE_ENTRIES];
 static uint32_t g_cache_count = 0;
 static uint32_t g_cache_start_id = 0;  /* 缓存中最小记录ID */
 
+/* 已提交状态快照（顺序锁：发布期间序号为奇数，读取方前后序号一致且为偶数才有效） */
+static FlashSnapshot_t g_snapshot;
+static volatile uint32_t g_snapshot_seq = 0;
+
+/* 磨损统计：统计块区内按页对齐顺序追加，写入位置进入未擦除的扇区时才擦除 */
+#define FLASH_STATS_RECORD_SIZE      ((sizeof(FlashStats_t) + W25Q64_PAGE_SIZE - 1) / W25Q64_PAGE_SIZE * W25Q64_PAGE_SIZE)
+
+static FlashStats_t g_flash_stats;
+static uint32_t g_stats_saved_tick = 0;         /* 上次保存（含失败）的时刻 */
+static uint32_t g_stats_next = 0;               /* 下一份统计块在统计块区内的偏移 */
+static uint32_t g_stats_erased_end = 0;         /* 统计块区已擦除区域的结束偏移 */
+
+/* 页缓存（直写，LRU） */
+typedef struct {
+    uint32_t page_address;      /* 页地址，FLASH_PAGE_CACHE_INVALID表示空 */
+    uint32_t last_use;          /* 最近访问时刻，用于LRU替换 */
+    uint8_t data[W25Q64_PAGE_SIZE];
+} FlashPageCacheEntry_t;
+
+#define FLASH_PAGE_CACHE_INVALID     0xFFFFFFFF
+
+static FlashPageCacheEntry_t g_page_cache[FLASH_PAGE_CACHE_ENTRIES];
+static uint32_t g_page_cache_clock = 0;
+static FlashPageCacheStats_t g_page_cache_stats;
+static uint32_t g_page_cache_blank_sector = FLASH_PAGE_CACHE_INVALID;  /* 最近擦除的扇区 */
+static uint16_t g_page_cache_blank_pages = 0;                           /* 该扇区中仍为空白的页 */
+
+/* 顺序预读（双缓冲）：当前缓冲从g_ra_base开始，另一个缓冲存放（或正在DMA读取）下一段 */
+static uint8_t g_ra_buffer[2][FLASH_READAHEAD_SIZE];
+static uint32_t g_ra_base = FLASH_PAGE_CACHE_INVALID;      /* 当前缓冲起始地址，INVALID为未预读 */
+static uint8_t g_ra_current = 0;                            /* 当前缓冲下标 */
+static bool g_ra_next_valid = false;                        /* 下一段已读入（或正在读取） */
+static volatile bool g_ra_pending = false;                  /* 下一段DMA读取中，片选保持有效 */
+static uint32_t g_ra_expect = FLASH_PAGE_CACHE_INVALID;    /* 上次读取的结束地址 */
+static uint8_t g_ra_sequential = 0;                         /* 连续顺序读取次数 */
+static bool g_ra_rescan = false;                            /* 正在扫描数据区，写入位置尚未确定 */
+
+/* 写合并页缓冲：记录紧密排列，数据头和数据先进入缓冲，页写满或到期后一次编程 */
+static uint8_t g_stage_page[W25Q64_PAGE_SIZE];
+static uint32_t g_stage_address = 0;            /* 缓冲对应的页地址 */
+static uint16_t g_stage_fill = 0;               /* 页内已暂存到的偏移 */
+static uint16_t g_stage_programmed = 0;         /* 页内已编程到的偏移 */
+static uint32_t g_data_erased_end = W25Q64_DATA_AREA_START;  /* 数据区已擦除区域的结束地址 */
+static bool g_index_dirty = false;              /* 有记录尚未写入索引表 */
+static uint32_t g_index_dirty_tick = 0;         /* 第一条未写入索引表的记录的时刻 */
+static volatile uint32_t g_stage_flush_ms = FLASH_STAGE_FLUSH_MS;  /* 记录暂存的最长时间 */
+static FlashStageStats_t g_stage_stats;
+
+/* 扇区标签摘要：写入位置所在扇区的摘要在RAM中累积，写入位置离开扇区、
+ * 扇区内最后一条记录编程完成后写入摘要区 */
+#define FLASH_TAG_SECTOR_NONE        0xFFFFFFFF
+#define FLASH_TAG_SUMMARY_COUNT      (W25Q64_TAG_AREA_SIZE / sizeof(FlashTagSummary_t))
+
+static FlashTagSummary_t g_tag_open;                            /* 当前扇区的摘要 */
+static uint32_t g_tag_open_sector = FLASH_TAG_SECTOR_NONE;      /* 当前扇区号 */
+static bool g_tag_open_valid = false;                           /* 从扇区第一条记录开始累积，摘要完整 */
+static FlashTagSummary_t g_tag_sealed;                          /* 已写完、等待写入摘要区的扇区摘要 */
+static uint32_t g_tag_sealed_sector = FLASH_TAG_SECTOR_NONE;
+
 /* SPI Flash命令定义 */
 #define W25Q64_CMD_WRITE_ENABLE      0x06
 #define W25Q64_CMD_WRITE_DISABLE     0x04
@@ -35,17 +96,110 @@ static uint32_t g_cache_start_id = 0;  /* 缓存中最小记录ID */
 #define W25Q64_CMD_READ_UNIQUE_ID    0x4B
 #define W25Q64_CMD_READ_ID           0x90
 #define W25Q64_CMD_RELEASE_POWER_DOWN 0xAB
+#define W25Q64_CMD_READ_SFDP         0x5A
+#define W25Q64_CMD_ENTER_4BYTE_MODE  0xB7
+#define W25Q64_CMD_READ_4BYTE        0x13
+#define W25Q64_CMD_PAGE_PROGRAM_4BYTE 0x12
+#define W25Q64_CMD_ERASE_SUSPEND     0x75
+#define W25Q64_CMD_ERASE_RESUME      0x7A
+
+/* SFDP（JESD216） */
+#define SFDP_SIGNATURE              0x50444653            /* "SFDP" */
+#define SFDP_ID_BASIC               0xFF00                /* JEDEC基本参数表 */
+#define SFDP_ID_4BYTE               0xFF84                /* 4字节地址命令表 */
+#define SFDP_MAX_HEADERS            8                     /* 最多解析的参数表头数 */
+#define SFDP_BASIC_DWORDS           16                    /* 基本参数表读取的DWORD数 */
+#define SFDP_4BYTE_READ             (1UL << 0)            /* 4字节地址命令表：支持0x13读取 */
+#define SFDP_4BYTE_PAGE_PROGRAM     (1UL << 6)            /* 4字节地址命令表：支持0x12页编程 */
+#define SFDP_4BYTE_ERASE_TYPE(t)    (1UL << (9 + (t)))    /* 4字节地址命令表：支持第t类擦除 */
+#define SFDP_SUSPEND_UNSUPPORTED    (1UL << 31)           /* 基本参数表DWORD12：不支持暂停/恢复 */
+#define SFDP_MANUFACTURER_WINBOND   0xEF                  /* 无SFDP暂停命令时按厂商默认0x75/0x7A */
 
 /* 状态寄存器位定义 */
 #define W25Q64_STATUS_BUSY          0x01
 #define W25Q64_STATUS_WEL           0x02
 
+/* 操作时序参数 */
+typedef struct {
+    uint32_t typical_us;        /* 典型耗时 */
+    uint32_t max_ms;            /* 最大耗时，超过即判定超时 */
+    uint32_t spin_us;           /* 忙等轮询时长，超过后转为睡眠轮询 */
+    uint32_t poll_ms;           /* 睡眠轮询间隔 */
+} FlashOpTiming_t;
+
+/* 忙等上限为典型时间的1.5倍：正常的页编程在此之内完成，超出的少数情况转为睡眠轮询，
+ * 不再忙等到最大耗时（3ms）占住CPU */
+#define FLASH_SPIN_US(typical_us)   ((typical_us) * 3 / 2)
+
+/* 默认为W25Q64FV数据手册：tPP 0.7/3ms，tSE 45/400ms，tBE(64KB) 150/2000ms，tCE 20/100s，
+ * 初始化时按SFDP中的典型时间更新 */
+static FlashOpTiming_t g_flash_op_timing[FLASH_OP_COUNT] = {
+    /* typical_us   max_ms   spin_us  poll_ms */
+    {          0,     1000,        0,      1 },    /* FLASH_OP_NONE */
+    {        700,        3,     1050,      1 },    /* FLASH_OP_PAGE_PROGRAM */
+    {      45000,      400,        0,      1 },    /* FLASH_OP_SECTOR_ERASE */
+    {     150000,     2000,        0,      5 },    /* FLASH_OP_BLOCK_ERASE */
+    {   20000000,   100000,        0,    100 },    /* FLASH_OP_CHIP_ERASE */
+};
+
+/* 芯片参数，SFDP读取前为W25Q64的参数 */
+static FlashGeometry_t g_flash_geometry = {
+    .jedec_id = 0xEF4017,
+    .total_size = W25Q64_TOTAL_SIZE,
+    .page_size = W25Q64_PAGE_SIZE,
+    .address_bytes = 3,
+    .read_cmd = W25Q64_CMD_CONTINUOUS_READ,
+    .program_cmd = W25Q64_CMD_PAGE_PROGRAM,
+    .sector_erase_cmd = W25Q64_CMD_SECTOR_ERASE,
+    .block_erase_cmd = W25Q64_CMD_BLOCK_ERASE,
+    .page_program_us = 700,
+    .sector_erase_us = 45000,
+    .block_erase_us = 150000,
+    .chip_erase_ms = 20000,
+    .suspend_cmd = W25Q64_CMD_ERASE_SUSPEND,
+    .resume_cmd = W25Q64_CMD_ERASE_RESUME,
+};
+
+/* 芯片操作完成回调 */
+static FlashOpHook_t g_flash_op_hook = NULL;
+
+/* 芯片识别完成回调 */
+static FlashOpHook_t g_flash_probe_hook = NULL;
+
+/* 擦除暂停：等待回调、正在擦除的范围、上次恢复时刻 */
+static FlashWaitHook_t g_flash_wait_hook = NULL;
+static uint32_t g_erase_address = 0;
+static uint32_t g_erase_size = 0;
+static uint32_t g_erase_resume_tick = 0;
+static FlashSuspendStats_t g_suspend_stats;
+
 /* 私有函数声明 */
-static FlashResult_t Flash_WaitForReady(void);
+static FlashResult_t Flash_WaitForReady(FlashOp_t op);
+static void Flash_PublishSnapshot(void);
+static void Flash_ReadAheadSettle(void);
+static void Flash_ReadAheadDrop(void);
+static void Flash_ReadAheadInvalidateRange(uint32_t address, uint32_t size);
+static bool Flash_ReadAheadServe(uint32_t address, uint8_t *buffer, uint32_t length);
+static bool Flash_ReadAheadStart(uint32_t address);
+static FlashResult_t Flash_SpinWaitReady(uint32_t spin_us, uint8_t *status);
 static FlashResult_t Flash_WriteEnable(void);
 static FlashResult_t Flash_ReadJEDECID(uint32_t *id);
+static FlashResult_t Flash_ReadSFDP(uint32_t address, uint8_t *buffer, uint32_t length);
+static FlashResult_t Flash_DetectGeometry(uint32_t jedec_id);
+static FlashResult_t Flash_Enter4ByteMode(void);
+static uint32_t Flash_PutCommand(uint8_t *cmd, uint8_t opcode, uint32_t address);
+static uint32_t Flash_DataSegmentEnd(uint32_t address);
+static uint32_t Flash_DataAreaSize(void);
+static bool Flash_InDataArea(uint32_t address, uint32_t length);
+static bool Flash_FindNextRecord(uint32_t *address, DataHeader_t *header, uint32_t next_id);
 static FlashResult_t Flash_WritePage(uint32_t address, const uint8_t *data, uint32_t length);
 static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, uint32_t length);
+static FlashResult_t Flash_ReadSPI(uint32_t address, uint8_t *buffer, uint32_t length);
+static FlashPageCacheEntry_t* Flash_PageCacheLookup(uint32_t page_address);
+static FlashPageCacheEntry_t* Flash_PageCacheVictim(void);
+static FlashPageCacheEntry_t* Flash_PageCacheBlank(uint32_t page_address);
+static void Flash_PageCacheUpdate(uint32_t address, const uint8_t *data, uint32_t length);
+static void Flash_PageCacheInvalidateRange(uint32_t address, uint32_t size);
 static FlashResult_t Flash_EraseInternal(uint32_t address, uint32_t size);
 static void Flash_AddToCache(uint32_t record_id, uint32_t address, uint32_t length);
 static FlashResult_t Flash_ForceReset(void);
@@ -54,42 +208,69 @@ static bool Flash_FindInCache(uint32_t record_id, uint32_t *address, uint32_t *l
 static FlashResult_t Flash_ScanDataAreaInternal(void);
 static FlashResult_t Flash_ResetSPI(void);
 static FlashResult_t Flash_RecoverFromError(void);
+static void Flash_StatsHistogram(uint32_t *hist, uint32_t start_cycles);
+static void Flash_StatsCountErase(uint32_t address, uint32_t size);
+static FlashResult_t Flash_StageWrite(const uint8_t *data, uint32_t length);
+static FlashResult_t Flash_StageProgram(void);
+static FlashResult_t Flash_StageCommit(void);
+static void Flash_StageOverlay(uint32_t address, uint8_t *buffer, uint32_t length);
+static bool Flash_ProbeRecord(uint32_t address, DataHeader_t *header);
+static bool Flash_FindRecordAt(uint32_t *address, DataHeader_t *header);
+static bool Flash_IsBlank(uint32_t address, uint32_t length);
+static void Flash_RecoverWritePointer(void);
+static uint32_t Flash_TagSector(uint32_t address);
+static void Flash_TagAddRecord(uint32_t address, uint16_t tag);
+static bool Flash_TagSealedProgrammed(void);
+static void Flash_TagWriteSealed(void);
+static void Flash_TagRebuild(void);
 
-/* CRC16计算表 */
-static const uint16_t crc16_table[256] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
-    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
-    0xB56A, 0xA54B, 0x9528, 0x8509, 0xF5EE, 0xE5CF, 0xD5AC, 0xC58D,
-    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
-    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
-    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
-    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
-    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
-    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
-    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
-    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
-    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
-    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
-    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
-    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
-};
+/**
+ * @brief 按耗时累计延迟直方图
+ * @param hist 直方图
+ * @param start_cycles 操作开始时的DWT计数
+ * @note 桶边界 128/512/2048/8192/32768/131072/524288us，每桶x4，用CLZ求桶号
+ */
+static void Flash_StatsHistogram(uint32_t *hist, uint32_t start_cycles)
+{
+    uint32_t us = (DWT_GetTick() - start_cycles) / (SystemCoreClock / 1000000);
+    uint32_t bits = 32 - __CLZ(us);
+    uint32_t bucket = (bits > 7) ? (bits - 6) / 2 : 0;
+    
+    if (bucket >= FLASH_STATS_HIST_BUCKETS) {
+        bucket = FLASH_STATS_HIST_BUCKETS - 1;
+    }
+    hist[bucket]++;
+}
+
+/**
+ * @brief 累计擦除次数
+ * @param address 擦除起始地址
+ * @param size 擦除大小
+ */
+static void Flash_StatsCountErase(uint32_t address, uint32_t size)
+{
+    uint32_t sector = address / W25Q64_SECTOR_SIZE;
+    uint32_t count = size / W25Q64_SECTOR_SIZE;
+    uint32_t shift = g_flash_geometry.wear_shift;
+    
+    g_flash_stats.erase_ops++;
+    g_flash_stats.sector_erases += count;
+    
+    /* 大容量芯片每个计数单元含2^shift个扇区，一次擦除在同一单元内只计1次 */
+    uint32_t first_unit = sector >> shift;
+    uint32_t last_unit = (sector + count - 1) >> shift;
+    
+    for (uint32_t unit = first_unit; unit <= last_unit && unit < W25Q64_SECTOR_COUNT; unit++) {
+        uint16_t *erases = &g_flash_stats.sector_erase_count[unit];
+        if (*erases < 0xFFFF) {
+            (*erases)++;
+        }
+        if (*erases > g_flash_stats.max_sector_erases) {
+            g_flash_stats.max_sector_erases = *erases;
+            g_flash_stats.max_sector_index = unit << shift;
+        }
+    }
+}
 
 /**
  * @brief 强制重置Flash
@@ -130,11 +311,16 @@ static FlashResult_t Flash_ForceReset(void)
     /* 验证复位是否成功 */
     uint32_t jedec_id;
     FlashResult_t result = Flash_ReadJEDECID(&jedec_id);
-    if (result != FLASH_OK || jedec_id != 0xEF4017) {
+    if (result != FLASH_OK || jedec_id != g_flash_geometry.jedec_id) {
         Log_Error("Flash: Force reset verification failed, JEDEC ID: 0x%08X", jedec_id);
         return FLASH_ERROR_READ;
     }
     
+    /* 复位后回到3字节地址模式 */
+    if (g_flash_geometry.enter_4byte_mode && Flash_Enter4ByteMode() != FLASH_OK) {
+        return FLASH_ERROR_READ;
+    }
+    
     Log_Info("Flash: Force reset completed successfully");
     return FLASH_OK;
 }
@@ -153,6 +339,8 @@ static FlashResult_t Flash_ReadStatus(uint8_t *status)
     uint8_t cmd = W25Q64_CMD_READ_STATUS_REG;
     uint8_t status_value;
     
+    Flash_ReadAheadSettle();
+    
     /* 发送读取状态寄存器命令 */
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
     if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 50) != HAL_OK) {
@@ -185,13 +373,18 @@ FlashResult_t Flash_Init(void)
         return FLASH_OK;
     }
     
-    Log_Info("Flash: Initializing W25Q64...");
+    Log_Info("Flash: Initializing SPI flash...");
+    
+    /* 统计延迟需要DWT周期计数器 */
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        DWT_Init();
+    }
     
     /* 初始化SPI */
     //MX_SPI1_Init();  // SPI已在main函数中初始化
     
     /* 等待Flash就绪 */
-    if (Flash_WaitForReady() != FLASH_OK) {
+    if (Flash_WaitForReady(FLASH_OP_NONE) != FLASH_OK) {
         Log_Error("Flash: Failed to wait for ready");
         return FLASH_ERROR_INIT;
     }
@@ -203,17 +396,40 @@ FlashResult_t Flash_Init(void)
         return FLASH_ERROR_INIT;
     }
     
-    if (jedec_id != 0xEF4017) {
-        Log_Error("Flash: Invalid JEDEC ID, expected 0xEF4017, got 0x%08X", jedec_id);
+    /* 从SFDP读取容量、擦除类型和典型时间 */
+    if (Flash_DetectGeometry(jedec_id) != FLASH_OK) {
+        Log_Error("Flash: Unsupported chip, JEDEC ID 0x%08X", jedec_id);
         return FLASH_ERROR_INIT;
     }
     
+    if (g_flash_geometry.enter_4byte_mode && Flash_Enter4ByteMode() != FLASH_OK) {
+        Log_Error("Flash: Failed to enter 4-byte mode");
+        return FLASH_ERROR_INIT;
+    }
+    
+    /* 清空页缓存 */
+    Flash_InvalidatePageCache();
+    memset(&g_page_cache_stats, 0, sizeof(g_page_cache_stats));
+    
     /* 初始化变量 */
     g_next_record_id = 1;
     g_next_write_address = W25Q64_DATA_AREA_START;
     g_total_records = 0;
     g_cache_count = 0;
     g_cache_start_id = 0;
+    g_stage_address = 0;
+    g_stage_fill = 0;
+    g_stage_programmed = 0;
+    g_index_dirty = false;
+    memset(&g_stage_stats, 0, sizeof(g_stage_stats));
+    
+    /* 加载磨损统计块 */
+    Flash_LoadStats();
+    
+    /* 索引表加载和数据区扫描可能耗时数秒，系统区的内容先交给回调读取 */
+    if (g_flash_probe_hook != NULL) {
+        g_flash_probe_hook();
+    }
     
     /* 加载索引表 */
     FlashResult_t result = Flash_LoadIndexTable();
@@ -226,6 +442,12 @@ FlashResult_t Flash_Init(void)
         }
     }
     
+    /* 补齐索引表之后写入的记录，确定写入位置 */
+    Flash_RecoverWritePointer();
+    
+    /* 重建写入位置所在扇区的标签摘要 */
+    Flash_TagRebuild();
+    
     /* 验证存储连续性 */
     if (g_total_records > 0) {
         Log_Info("Flash: Verifying storage continuity...");
@@ -236,6 +458,7 @@ FlashResult_t Flash_Init(void)
     }
     
     g_flash_initialized = true;
+    Flash_PublishSnapshot();
     Log_Info("Flash: Initialization completed - Records: %lu, Next ID: %lu, Next address: 0x%08X", 
              g_total_records, g_next_record_id, g_next_write_address);
     
@@ -252,8 +475,10 @@ FlashResult_t Flash_DeInit(void)
         return FLASH_OK;
     }
     
-    /* 保存索引表 */
+    /* 编程暂存数据，保存索引表和统计块 */
+    Flash_StageProgram();
     Flash_SaveIndexTable();
+    Flash_SaveStats();
     
     g_flash_initialized = false;
     Log_Info("Flash: Deinitialized");
@@ -262,73 +487,183 @@ FlashResult_t Flash_DeInit(void)
 }
 
 /**
- * @brief 等待Flash就绪
+ * @brief 在一次片选内连续读取状态寄存器，忙等到Flash就绪
+ * @param spin_us 最长忙等时间（微秒）
+ * @param status 输出最后读到的状态寄存器值
  * @return FlashResult_t 操作结果
+ * @note W25Q64在片选保持有效期间会连续输出状态寄存器，无需重复发送命令
  */
-static FlashResult_t Flash_WaitForReady(void)
+static FlashResult_t Flash_SpinWaitReady(uint32_t spin_us, uint8_t *status)
 {
-    uint8_t status;
-    uint32_t timeout = 1000;  /* 1秒超时，减少等待时间 */
-    uint32_t retry_count = 0;
+    uint8_t cmd = W25Q64_CMD_READ_STATUS_REG;
+    
+    /* 忙等计时依赖DWT周期计数器 */
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        DWT_Init();
+    }
+    
+    uint32_t spin_cycles = spin_us * (SystemCoreClock / 1000000);
+    uint32_t start_cycles = DWT_GetTick();
+    
+    Flash_ReadAheadSettle();
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 50) != HAL_OK) {
+        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+        return FLASH_ERROR_READ;
+    }
     
     do {
-        /* 读取状态寄存器 */
-        uint8_t cmd = W25Q64_CMD_READ_STATUS_REG;
-        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
-        
-        if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 50) != HAL_OK) {
+        if (HAL_SPI_Receive(&hspi1, status, 1, 50) != HAL_OK) {
             HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-            Log_Error("Flash: Failed to send status register command (retry %lu)", retry_count);
-            osDelay(10);
-            retry_count++;
-            if (retry_count > 10) {
-                Log_Error("Flash: Too many SPI transmit failures");
-                return FLASH_ERROR_READ;
-            }
+            return FLASH_ERROR_READ;
+        }
+    } while ((*status & W25Q64_STATUS_BUSY) && (DWT_GetTick() - start_cycles) < spin_cycles);
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+    
+    return FLASH_OK;
+}
+
+/**
+ * @brief 暂停正在进行的擦除，执行芯片操作回调中的读取后恢复
+ * @return uint32_t 暂停的tick数
+ * @note 暂停命令发出后最多tSUS（W25Q64为20us）芯片空闲。擦除恰好已完成时
+ *       芯片忽略暂停和恢复命令。暂停期间读取正在擦除的范围得到的是中间状态，
+ *       恢复后使该范围的页缓存失效
+ */
+static uint32_t Flash_SuspendErase(void)
+{
+    uint32_t start_tick = osKernelGetTickCount();
+    uint8_t status = 0;
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    HAL_StatusTypeDef hal = HAL_SPI_Transmit(&hspi1, &g_flash_geometry.suspend_cmd, 1, 10);
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+    
+    if (hal != HAL_OK || Flash_SpinWaitReady(100, &status) != FLASH_OK ||
+        (status & W25Q64_STATUS_BUSY)) {
+        /* 未能暂停，继续等待擦除完成 */
+        g_erase_resume_tick = start_tick;
+        return 0;
+    }
+    
+    if (g_flash_op_hook != NULL) {
+        g_flash_op_hook();
+    }
+    Flash_ReadAheadDrop();
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &g_flash_geometry.resume_cmd, 1, 10);
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+    
+    Flash_PageCacheInvalidateRange(g_erase_address, g_erase_size);
+    
+    g_erase_resume_tick = osKernelGetTickCount();
+    uint32_t suspended = g_erase_resume_tick - start_tick;
+    g_suspend_stats.suspends++;
+    g_suspend_stats.suspended_ms += suspended;
+    if (suspended > g_suspend_stats.max_suspend_ms) {
+        g_suspend_stats.max_suspend_ms = suspended;
+    }
+    return suspended;
+}
+
+/**
+ * @brief 等待芯片操作期间睡眠
+ * @param op 正在执行的操作类型
+ * @param ms 睡眠时间
+ * @param start_tick 等待开始时刻，擦除暂停的时间从超时计时中扣除
+ * @note 擦除期间由等待回调代替osDelay，回调返回true时暂停擦除执行读取。
+ *       恢复后至少擦除FLASH_SUSPEND_MIN_RUN_MS（且不短于芯片要求的间隔）才再次暂停
+ */
+static void Flash_WaitSleep(FlashOp_t op, uint32_t ms, uint32_t *start_tick)
+{
+    if (g_flash_wait_hook == NULL || g_flash_geometry.suspend_cmd == 0 ||
+        (op != FLASH_OP_SECTOR_ERASE && op != FLASH_OP_BLOCK_ERASE)) {
+        osDelay(ms);
+        return;
+    }
+    
+    /* 间隔按tick计，多等1个tick补偿计时起点落在tick中间 */
+    uint32_t run_ms = (g_flash_geometry.suspend_interval_us + 999) / 1000;
+    if (run_ms < FLASH_SUSPEND_MIN_RUN_MS) {
+        run_ms = FLASH_SUSPEND_MIN_RUN_MS;
+    }
+    run_ms++;
+    
+    uint32_t until = osKernelGetTickCount() + ms;
+    for (;;) {
+        int32_t remaining = (int32_t)(until - osKernelGetTickCount());
+        if (remaining <= 0) {
+            return;
+        }
+        
+        if (!g_flash_wait_hook((uint32_t)remaining)) {
             continue;
         }
         
-        if (HAL_SPI_Receive(&hspi1, &status, 1, 50) != HAL_OK) {
-            HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-            Log_Error("Flash: Failed to receive status register (retry %lu)", retry_count);
-            osDelay(10);
+        uint32_t running = osKernelGetTickCount() - g_erase_resume_tick;
+        if (running < run_ms) {
+            osDelay(run_ms - running);
+            continue;
+        }
+        
+        uint32_t suspended = Flash_SuspendErase();
+        *start_tick += suspended;
+        until += suspended;
+    }
+}
+
+/**
+ * @brief 等待Flash就绪
+ * @param op 正在执行的操作类型，决定轮询策略和超时
+ * @return FlashResult_t 操作结果
+ * @note 页编程等短操作忙等轮询，擦除等长操作先睡眠约一半典型时间再按间隔睡眠轮询
+ */
+static FlashResult_t Flash_WaitForReady(FlashOp_t op)
+{
+    const FlashOpTiming_t *timing = &g_flash_op_timing[op];
+    uint32_t start_tick = osKernelGetTickCount();
+    uint32_t retry_count = 0;
+    uint8_t status = 0;
+    
+    /* 短操作：忙等，避免osDelay(1)带来的1~2个tick延迟 */
+    if (timing->spin_us > 0) {
+        if (Flash_SpinWaitReady(timing->spin_us, &status) == FLASH_OK &&
+            !(status & W25Q64_STATUS_BUSY)) {
+            return FLASH_OK;
+        }
+    }
+    
+    /* 长操作：典型时间内芯片必然忙，直接让出CPU */
+    if (timing->typical_us >= 2000) {
+        Flash_WaitSleep(op, timing->typical_us / 2000, &start_tick);
+    }
+    
+    for (;;) {
+        if (Flash_ReadStatus(&status) != FLASH_OK) {
             retry_count++;
             if (retry_count > 10) {
-                Log_Error("Flash: Too many SPI receive failures");
+                Log_Error("Flash: Too many status read failures");
                 return FLASH_ERROR_READ;
             }
+            osDelay(10);
             continue;
         }
         
-        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-        
-        /* 每100次检查打印一次状态 */
-//        if (timeout % 100 == 0) {
-//            Log_Debug("Flash: Wait for ready - status: 0x%02X, timeout: %lu", status, timeout);
-//        }
-        
-        /* 检查Flash状态异常 - 如果状态为0x03且等待时间过长，强制重置 */
-        if (status == 0x03 && (1000 - timeout) > 200) {
-            Log_Warn("Flash: Detected stuck programming state (0x03), forcing reset...");
-            FlashResult_t reset_result = Flash_ForceReset();
-            if (reset_result == FLASH_OK) {
-                Log_Info("Flash: Reset successful, continuing...");
-                return FLASH_OK;
-            } else {
-                Log_Error("Flash: Reset failed, continuing with timeout...");
-            }
-        }
-        
         if (!(status & W25Q64_STATUS_BUSY)) {
-//            Log_Debug("Flash: Ready after %lu attempts", 1000 - timeout);
             return FLASH_OK;
         }
         
-        osDelay(1);
-        timeout--;
-    } while (timeout > 0);
+        /* 超过数据手册最大耗时仍忙，判定为卡死 */
+        if (osKernelGetTickCount() - start_tick > timing->max_ms) {
+            break;
+        }
+        
+        Flash_WaitSleep(op, timing->poll_ms, &start_tick);
+    }
     
-    Log_Error("Flash: Wait for ready timeout after %lu attempts", 1000 - timeout);
+    Log_Error("Flash: Wait for ready timeout, op %d, status 0x%02X", op, status);
     
     /* 强制重置Flash状态 */
     Log_Warn("Flash: Forcing Flash reset due to timeout...");
@@ -349,6 +684,7 @@ static FlashResult_t Flash_WriteEnable(void)
 {
     uint8_t cmd = W25Q64_CMD_WRITE_ENABLE;
     
+    Flash_ReadAheadSettle();
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
     if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 100) != HAL_OK) {
         HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
@@ -389,115 +725,790 @@ static FlashResult_t Flash_ReadJEDECID(uint32_t *id)
 }
 
 /**
- * @brief 写入页面数据
- * @param address 地址
- * @param data 数据指针
- * @param length 数据长度
+ * @brief 读取SFDP参数表
+ * @param address SFDP地址
+ * @param buffer 缓冲区
+ * @param length 长度
  * @return FlashResult_t 操作结果
+ * @note 命令0x5A后固定为3字节地址和1个空字节，与地址模式无关
  */
-static FlashResult_t Flash_WritePage(uint32_t address, const uint8_t *data, uint32_t length)
+static FlashResult_t Flash_ReadSFDP(uint32_t address, uint8_t *buffer, uint32_t length)
 {
-    if (length > W25Q64_PAGE_SIZE) {
-        Log_Error("Flash: Write page length %lu exceeds page size %lu", length, W25Q64_PAGE_SIZE);
-        return FLASH_ERROR_INVALID_PARAM;
-    }
+    uint8_t cmd[5];
+    cmd[0] = W25Q64_CMD_READ_SFDP;
+    cmd[1] = (address >> 16) & 0xFF;
+    cmd[2] = (address >> 8) & 0xFF;
+    cmd[3] = address & 0xFF;
+    cmd[4] = 0;
     
-    /* 检查Flash是否被保护 */
-    uint8_t status_reg;
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
-    uint8_t cmd = W25Q64_CMD_READ_STATUS_REG;
-    if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 100) != HAL_OK) {
-        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-        Log_Error("Flash: Failed to read status register");
-        return FLASH_ERROR_READ;
-    }
-    if (HAL_SPI_Receive(&hspi1, &status_reg, 1, 50) != HAL_OK) {
+    if (HAL_SPI_Transmit(&hspi1, cmd, sizeof(cmd), 50) != HAL_OK ||
+        HAL_SPI_Receive(&hspi1, buffer, length, 50) != HAL_OK) {
         HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-        Log_Error("Flash: Failed to receive status register");
+        Log_Error("Flash: Failed to read SFDP");
         return FLASH_ERROR_READ;
     }
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
     
-    /* 写使能 */
-    if (Flash_WriteEnable() != FLASH_OK) {
-        Log_Error("Flash: Write enable failed");
-        return FLASH_ERROR_WRITE;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 换算SFDP中的擦除典型时间
+ * @param field 7位时间字段：[4:0]计数-1，[6:5]单位（1ms/16ms/128ms/1s）
+ * @return uint32_t 微秒
+ */
+static uint32_t Flash_SfdpEraseTimeUs(uint32_t field)
+{
+    static const uint32_t unit_ms[4] = {1, 16, 128, 1000};
+    
+    return ((field & 0x1F) + 1) * unit_ms[(field >> 5) & 0x03] * 1000;
+}
+
+/**
+ * @brief 按典型时间和最大时间倍数设置一种操作的等待参数
+ */
+static void Flash_SetOpTiming(FlashOp_t op, uint32_t typical_us, uint32_t max_multiplier)
+{
+    FlashOpTiming_t *timing = &g_flash_op_timing[op];
+    
+    timing->typical_us = typical_us;
+    timing->max_ms = (uint32_t)(((uint64_t)typical_us * max_multiplier + 999) / 1000);
+    if (timing->spin_us > 0) {
+        timing->spin_us = FLASH_SPIN_US(typical_us);
+    }
+}
+
+/**
+ * @brief 从SFDP读取芯片参数
+ * @param jedec_id JEDEC ID
+ * @return FlashResult_t 操作结果
+ * @note 解析JEDEC基本参数表：容量（DWORD2）、擦除类型（DWORD8~9）、典型时间（DWORD10~11）；
+ *       容量超过16MB时使用4字节地址：4字节地址命令表声明了0x13/0x12和对应擦除命令时
+ *       使用专用命令，否则进入4字节地址模式。不支持SFDP的芯片按JEDEC ID容量字节推算，
+ *       擦除命令和时间沿用W25Q64
+ */
+static FlashResult_t Flash_DetectGeometry(uint32_t jedec_id)
+{
+    FlashGeometry_t *geometry = &g_flash_geometry;
+    uint8_t headers[8 + SFDP_MAX_HEADERS * 8];
+    uint32_t basic[SFDP_BASIC_DWORDS];
+    uint32_t basic_dwords = 0;
+    uint32_t fourbyte[2] = {0};
+    bool has_fourbyte = false;
+    uint32_t sector_type = 0;
+    uint32_t block_type = 0;
+    
+    geometry->jedec_id = jedec_id;
+    geometry->sfdp_revision = 0;
+    geometry->page_size = W25Q64_PAGE_SIZE;
+    geometry->address_bytes = 3;
+    geometry->enter_4byte_mode = false;
+    geometry->read_cmd = W25Q64_CMD_CONTINUOUS_READ;
+    geometry->program_cmd = W25Q64_CMD_PAGE_PROGRAM;
+    geometry->sector_erase_cmd = W25Q64_CMD_SECTOR_ERASE;
+    geometry->block_erase_cmd = W25Q64_CMD_BLOCK_ERASE;
+    geometry->suspend_interval_us = 0;
+    if ((jedec_id >> 16) == SFDP_MANUFACTURER_WINBOND) {
+        geometry->suspend_cmd = W25Q64_CMD_ERASE_SUSPEND;
+        geometry->resume_cmd = W25Q64_CMD_ERASE_RESUME;
+    } else {
+        geometry->suspend_cmd = 0;
+        geometry->resume_cmd = 0;
     }
     
-    /* 等待就绪 */
-    if (Flash_WaitForReady() != FLASH_OK) {
-        Log_Error("Flash: Wait for ready failed before write");
-        return FLASH_ERROR_WRITE;
+    /* 参数表头 */
+    if (Flash_ReadSFDP(0, headers, 8) == FLASH_OK &&
+        (headers[0] | headers[1] << 8 | headers[2] << 16 | (uint32_t)headers[3] << 24) == SFDP_SIGNATURE) {
+        uint32_t count = headers[6] + 1;
+        if (count > SFDP_MAX_HEADERS) {
+            count = SFDP_MAX_HEADERS;
+        }
+        
+        if (Flash_ReadSFDP(8, headers + 8, count * 8) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+        
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t *header = headers + 8 + i * 8;
+            uint16_t id = header[0] | header[7] << 8;
+            uint32_t dwords = header[3];
+            uint32_t pointer = header[4] | header[5] << 8 | header[6] << 16;
+            uint8_t revision = (header[2] << 4) | (header[1] & 0x0F);
+            
+            if (id == SFDP_ID_BASIC && revision >= geometry->sfdp_revision) {
+                basic_dwords = dwords > SFDP_BASIC_DWORDS ? SFDP_BASIC_DWORDS : dwords;
+                memset(basic, 0, sizeof(basic));
+                if (Flash_ReadSFDP(pointer, (uint8_t*)basic, basic_dwords * 4) != FLASH_OK) {
+                    return FLASH_ERROR_READ;
+                }
+                geometry->sfdp_revision = revision;
+            } else if (id == SFDP_ID_4BYTE && dwords >= 2) {
+                if (Flash_ReadSFDP(pointer, (uint8_t*)fourbyte, sizeof(fourbyte)) != FLASH_OK) {
+                    return FLASH_ERROR_READ;
+                }
+                has_fourbyte = true;
+            }
+        }
     }
     
-    /* 发送页编程命令 */
-    uint8_t cmd_array[4];
-    cmd_array[0] = W25Q64_CMD_PAGE_PROGRAM;
-    cmd_array[1] = (address >> 16) & 0xFF;
-    cmd_array[2] = (address >> 8) & 0xFF;
-    cmd_array[3] = address & 0xFF;
+    if (basic_dwords >= 9) {
+        /* DWORD2：容量（位），最高位为1时为2^N位 */
+        uint32_t density = basic[1];
+        if (density & 0x80000000) {
+            uint32_t n = density & 0x7FFFFFFF;
+            geometry->total_size = (n >= 3 && n < 35) ? 1UL << (n - 3) : 0;
+        } else {
+            geometry->total_size = (density + 1) / 8;
+        }
+        
+        /* DWORD8~9：四种擦除类型，每种为大小（2^N字节）和命令 */
+        bool has_sector = false;
+        bool has_block = false;
+        for (uint32_t t = 0; t < 4; t++) {
+            uint32_t type = basic[7 + t / 2] >> ((t % 2) * 16);
+            uint8_t size_shift = type & 0xFF;
+            uint8_t opcode = (type >> 8) & 0xFF;
+            
+            if (size_shift == 12 && !has_sector) {
+                geometry->sector_erase_cmd = opcode;
+                sector_type = t;
+                has_sector = true;
+            } else if (size_shift == 16 && !has_block) {
+                geometry->block_erase_cmd = opcode;
+                block_type = t;
+                has_block = true;
+            }
+        }
+        if (!has_sector || !has_block) {
+            Log_Error("Flash: SFDP lacks 4KB/64KB erase");
+            return FLASH_ERROR_INIT;
+        }
+        
+        /* DWORD10~11：典型时间和最大时间倍数（JESD216A起） */
+        if (basic_dwords >= 11) {
+            uint32_t erase_multiplier = 2 * ((basic[9] & 0x0F) + 1);
+            uint32_t program_multiplier = 2 * ((basic[10] & 0x0F) + 1);
+            static const uint32_t chip_unit_ms[4] = {16, 256, 4000, 64000};
+            
+            geometry->sector_erase_us = Flash_SfdpEraseTimeUs(basic[9] >> (4 + 7 * sector_type));
+            geometry->block_erase_us = Flash_SfdpEraseTimeUs(basic[9] >> (4 + 7 * block_type));
+            geometry->page_size = 1 << ((basic[10] >> 4) & 0x0F);
+            geometry->page_program_us = (((basic[10] >> 8) & 0x1F) + 1) * ((basic[10] & (1UL << 13)) ? 64 : 8);
+            geometry->chip_erase_ms = (((basic[10] >> 24) & 0x1F) + 1) * chip_unit_ms[(basic[10] >> 29) & 0x03];
+            
+            Flash_SetOpTiming(FLASH_OP_PAGE_PROGRAM, geometry->page_program_us, program_multiplier);
+            Flash_SetOpTiming(FLASH_OP_SECTOR_ERASE, geometry->sector_erase_us, erase_multiplier);
+            Flash_SetOpTiming(FLASH_OP_BLOCK_ERASE, geometry->block_erase_us, erase_multiplier);
+            Flash_SetOpTiming(FLASH_OP_CHIP_ERASE, geometry->chip_erase_ms * 1000, erase_multiplier);
+        }
+        
+        /* DWORD12~13：擦除暂停/恢复命令和恢复到再次暂停的间隔（JESD216A起） */
+        if (basic_dwords >= 13) {
+            if (basic[11] & SFDP_SUSPEND_UNSUPPORTED) {
+                geometry->suspend_cmd = 0;
+                geometry->resume_cmd = 0;
+            } else {
+                geometry->suspend_cmd = (basic[12] >> 24) & 0xFF;
+                geometry->resume_cmd = (basic[12] >> 16) & 0xFF;
+                geometry->suspend_interval_us = (((basic[11] >> 20) & 0x0F) + 1) * 64;
+            }
+        }
+    } else {
+        /* 无SFDP：JEDEC ID最低字节为容量的log2 */
+        uint32_t capacity = jedec_id & 0xFF;
+        geometry->total_size = (capacity >= 20 && capacity < 32) ? 1UL << capacity : 0;
+        Log_Warn("Flash: No SFDP, size from JEDEC ID");
+    }
     
-    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    if (geometry->total_size < W25Q64_TOTAL_SIZE || geometry->total_size > FLASH_MAX_TOTAL_SIZE ||
+        geometry->page_size < W25Q64_PAGE_SIZE) {
+        Log_Error("Flash: Unsupported size %lu B", geometry->total_size);
+        return FLASH_ERROR_INIT;
+    }
     
-    /* 发送命令和地址 */
-    if (HAL_SPI_Transmit(&hspi1, cmd_array, 4, 100) != HAL_OK) {
-        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-        Log_Error("Flash: Failed to send page program command");
+    /* 4字节地址 */
+    if (geometry->total_size > FLASH_3BYTE_ADDRESS_LIMIT) {
+        uint32_t required = SFDP_4BYTE_READ | SFDP_4BYTE_PAGE_PROGRAM |
+                            SFDP_4BYTE_ERASE_TYPE(sector_type) | SFDP_4BYTE_ERASE_TYPE(block_type);
+        
+        geometry->address_bytes = 4;
+        if (has_fourbyte && (fourbyte[0] & required) == required) {
+            geometry->read_cmd = W25Q64_CMD_READ_4BYTE;
+            geometry->program_cmd = W25Q64_CMD_PAGE_PROGRAM_4BYTE;
+            geometry->sector_erase_cmd = (fourbyte[1] >> (8 * sector_type)) & 0xFF;
+            geometry->block_erase_cmd = (fourbyte[1] >> (8 * block_type)) & 0xFF;
+        } else {
+            geometry->enter_4byte_mode = true;
+        }
+    }
+    
+    /* 擦除计数单元数固定，容量越大每单元扇区越多 */
+    geometry->wear_shift = 0;
+    while (((uint32_t)W25Q64_SECTOR_COUNT << geometry->wear_shift) * W25Q64_SECTOR_SIZE < geometry->total_size) {
+        geometry->wear_shift++;
+    }
+    
+    Log_Info("Flash: %lu KB, %u-byte address, SFDP %u.%u", geometry->total_size / 1024,
+             geometry->address_bytes, geometry->sfdp_revision >> 4, geometry->sfdp_revision & 0x0F);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 进入4字节地址模式
+ * @return FlashResult_t 操作结果
+ * @note 部分芯片要求先写使能，统一先发送写使能
+ */
+static FlashResult_t Flash_Enter4ByteMode(void)
+{
+    uint8_t cmd = W25Q64_CMD_ENTER_4BYTE_MODE;
+    
+    if (Flash_WriteEnable() != FLASH_OK) {
         return FLASH_ERROR_WRITE;
     }
     
-    /* 发送数据 */
-    if (HAL_SPI_Transmit(&hspi1, (uint8_t*)data, length, 1000) != HAL_OK) {
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    if (HAL_SPI_Transmit(&hspi1, &cmd, 1, 50) != HAL_OK) {
         HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
-        Log_Error("Flash: Failed to send page program data");
+        Log_Error("Flash: Failed to send 4-byte mode command");
         return FLASH_ERROR_WRITE;
     }
-    
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
     
-    /* 等待写入完成 */
-    FlashResult_t result = Flash_WaitForReady();
-    if (result != FLASH_OK) {
-        Log_Error("Flash: Wait for ready failed after write");
-        return result;
-    }
     return FLASH_OK;
 }
 
 /**
- * @brief 内部读取数据
+ * @brief 填写命令和地址
+ * @param cmd 输出缓冲，至少5字节
+ * @param opcode 命令
  * @param address 地址
- * @param buffer 缓冲区
- * @param length 长度
- * @return FlashResult_t 操作结果
+ * @return uint32_t 命令和地址的字节数
  */
-static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, uint32_t length)
+static uint32_t Flash_PutCommand(uint8_t *cmd, uint8_t opcode, uint32_t address)
 {
-    uint8_t cmd[4];
-    uint8_t dummy[4] = {0};  // 用于接收命令响应
-    cmd[0] = W25Q64_CMD_CONTINUOUS_READ;
-    cmd[1] = (address >> 16) & 0xFF;
-    cmd[2] = (address >> 8) & 0xFF;
-    cmd[3] = address & 0xFF;
+    uint32_t length = 0;
     
-    Log_Debug("Flash: Reading %lu bytes from address 0x%08lX", length, address);
+    cmd[length++] = opcode;
+    if (g_flash_geometry.address_bytes == 4) {
+        cmd[length++] = (address >> 24) & 0xFF;
+    }
+    cmd[length++] = (address >> 16) & 0xFF;
+    cmd[length++] = (address >> 8) & 0xFF;
+    cmd[length++] = address & 0xFF;
     
-    /* 检查Flash状态，如果异常则重置 */
-    uint8_t status;
-    if (Flash_ReadStatus(&status) == FLASH_OK) {
-        if (status == 0x03) {
-            Log_Warn("Flash: Detected programming state before read, forcing reset...");
-            if (Flash_ForceReset() != FLASH_OK) {
-                Log_Error("Flash: Force reset failed before read");
-                return FLASH_ERROR_READ;
+    return length;
+}
+
+/**
+ * @brief 获取芯片参数
+ * @return const FlashGeometry_t* 芯片参数指针
+ */
+const FlashGeometry_t* Flash_GetGeometry(void)
+{
+    return &g_flash_geometry;
+}
+
+/**
+ * @brief 写入页面数据
+ * @param address 地址
+ * @param data 数据指针
+ * @param length 数据长度
+ * @return FlashResult_t 操作结果
+ */
+static FlashResult_t Flash_WritePage(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    if (length > W25Q64_PAGE_SIZE) {
+        Log_Error("Flash: Write page length %lu exceeds page size %lu", length, W25Q64_PAGE_SIZE);
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    uint32_t start_cycles = DWT_GetTick();
+    
+    Flash_ReadAheadInvalidateRange(address, length);
+    
+    /* 写使能 */
+    if (Flash_WriteEnable() != FLASH_OK) {
+        Log_Error("Flash: Write enable failed");
+        return FLASH_ERROR_WRITE;
+    }
+    
+    /* 等待就绪 */
+    if (Flash_WaitForReady(FLASH_OP_NONE) != FLASH_OK) {
+        Log_Error("Flash: Wait for ready failed before write");
+        return FLASH_ERROR_WRITE;
+    }
+    
+    /* 发送页编程命令 */
+    uint8_t cmd_array[5];
+    uint32_t cmd_length = Flash_PutCommand(cmd_array, g_flash_geometry.program_cmd, address);
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    
+    /* 发送命令和地址 */
+    if (HAL_SPI_Transmit(&hspi1, cmd_array, cmd_length, 100) != HAL_OK) {
+        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+        Log_Error("Flash: Failed to send page program command");
+        return FLASH_ERROR_WRITE;
+    }
+    
+    /* 发送数据 */
+    if (HAL_SPI_Transmit(&hspi1, (uint8_t*)data, length, 1000) != HAL_OK) {
+        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+        Log_Error("Flash: Failed to send page program data");
+        return FLASH_ERROR_WRITE;
+    }
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+    
+    /* 等待写入完成 */
+    FlashResult_t result = Flash_WaitForReady(FLASH_OP_PAGE_PROGRAM);
+    if (result != FLASH_OK) {
+        Log_Error("Flash: Wait for ready failed after write");
+        return result;
+    }
+    
+    Flash_PageCacheUpdate(address, data, length);
+    
+    g_flash_stats.program_ops++;
+    g_flash_stats.bytes_programmed += length;
+    Flash_StatsHistogram(g_flash_stats.hist_program, start_cycles);
+    
+    if (g_flash_op_hook != NULL) {
+        g_flash_op_hook();
+    }
+    return FLASH_OK;
+}
+
+/**
+ * @brief 内部读取数据（经过页缓存）
+ * @param address 地址
+ * @param buffer 缓冲区
+ * @param length 长度
+ * @return FlashResult_t 操作结果
+ * @note 不超过FLASH_PAGE_CACHE_MAX_READ的读取按页查缓存，未命中时整页读入；
+ *       更长的读取（扫描、统计块等）直接访问芯片，不冲刷缓存；
+ *       结果包含写合并缓冲中尚未编程的数据
+ */
+static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    g_page_cache_stats.requested_bytes += length;
+    g_page_cache_stats.uncached_spi_bytes += length + FLASH_SPI_READ_OVERHEAD;
+    
+    /* 顺序读取（扫描、历史查询）：连续FLASH_READAHEAD_TRIGGER次紧接上次结束地址时
+     * 改为突发预读，之后的读取从预读缓冲复制 */
+    if (address == g_ra_expect) {
+        if (g_ra_sequential < FLASH_READAHEAD_TRIGGER) {
+            g_ra_sequential++;
+        }
+    } else {
+        g_ra_sequential = 0;
+    }
+    g_ra_expect = address + length;
+    
+    if (Flash_ReadAheadServe(address, buffer, length) ||
+        (g_ra_sequential >= FLASH_READAHEAD_TRIGGER - 1 && length <= FLASH_READAHEAD_SIZE &&
+         Flash_ReadAheadStart(address) && Flash_ReadAheadServe(address, buffer, length))) {
+        Flash_StageOverlay(address, buffer, length);
+        return FLASH_OK;
+    }
+    
+    if (length > FLASH_PAGE_CACHE_MAX_READ) {
+        g_page_cache_stats.bypasses++;
+        g_page_cache_stats.spi_bytes += length + FLASH_SPI_READ_OVERHEAD;
+        FlashResult_t result = Flash_ReadSPI(address, buffer, length);
+        if (result == FLASH_OK) {
+            Flash_StageOverlay(address, buffer, length);
+        }
+        return result;
+    }
+    
+    uint32_t start_address = address;
+    uint8_t *start_buffer = buffer;
+    uint32_t total_length = length;
+    
+    while (length > 0) {
+        uint32_t page_address = address & ~(uint32_t)(W25Q64_PAGE_SIZE - 1);
+        uint32_t offset = address - page_address;
+        uint32_t chunk = W25Q64_PAGE_SIZE - offset;
+        if (chunk > length) {
+            chunk = length;
+        }
+        
+        FlashPageCacheEntry_t *entry = Flash_PageCacheLookup(page_address);
+        
+        if (entry == NULL) {
+            entry = Flash_PageCacheBlank(page_address);
+        }
+        
+        if (entry != NULL) {
+            g_page_cache_stats.hits++;
+        } else {
+            g_page_cache_stats.misses++;
+            g_page_cache_stats.spi_bytes += W25Q64_PAGE_SIZE + FLASH_SPI_READ_OVERHEAD;
+            
+            entry = Flash_PageCacheVictim();
+            FlashResult_t result = Flash_ReadSPI(page_address, entry->data, W25Q64_PAGE_SIZE);
+            if (result != FLASH_OK) {
+                return result;
             }
+            entry->page_address = page_address;
+        }
+        
+        entry->last_use = ++g_page_cache_clock;
+        memcpy(buffer, &entry->data[offset], chunk);
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    /* 尚未编程的暂存数据在芯片上仍为0xFF，用缓冲内容覆盖 */
+    Flash_StageOverlay(start_address, start_buffer, total_length);
+    
+    return FLASH_OK;
+}
+
+/**
+ * @brief 在页缓存中查找页
+ * @return FlashPageCacheEntry_t* 未命中返回NULL
+ */
+static FlashPageCacheEntry_t* Flash_PageCacheLookup(uint32_t page_address)
+{
+    for (uint32_t i = 0; i < FLASH_PAGE_CACHE_ENTRIES; i++) {
+        if (g_page_cache[i].page_address == page_address) {
+            return &g_page_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 选出空闲或最久未用的缓存条目并置为无效
+ */
+static FlashPageCacheEntry_t* Flash_PageCacheVictim(void)
+{
+    FlashPageCacheEntry_t *victim = &g_page_cache[0];
+    
+    for (uint32_t i = 0; i < FLASH_PAGE_CACHE_ENTRIES; i++) {
+        if (g_page_cache[i].page_address == FLASH_PAGE_CACHE_INVALID) {
+            victim = &g_page_cache[i];
+            break;
+        }
+        if (g_page_cache[i].last_use < victim->last_use) {
+            victim = &g_page_cache[i];
+        }
+    }
+    
+    victim->page_address = FLASH_PAGE_CACHE_INVALID;
+    return victim;
+}
+
+/**
+ * @brief 最近擦除扇区中仍为空白的页直接分配为全0xFF的缓存页，不读芯片
+ * @return FlashPageCacheEntry_t* 不是已知空白页时返回NULL
+ * @note 写合并缓冲中的记录在编程前被读回时，所在页在芯片上仍为空白
+ */
+static FlashPageCacheEntry_t* Flash_PageCacheBlank(uint32_t page_address)
+{
+    uint16_t page_bit = 1 << ((page_address % W25Q64_SECTOR_SIZE) / W25Q64_PAGE_SIZE);
+    
+    if ((page_address & ~(uint32_t)(W25Q64_SECTOR_SIZE - 1)) != g_page_cache_blank_sector ||
+        !(g_page_cache_blank_pages & page_bit)) {
+        return NULL;
+    }
+    
+    FlashPageCacheEntry_t *entry = Flash_PageCacheVictim();
+    memset(entry->data, 0xFF, W25Q64_PAGE_SIZE);
+    entry->page_address = page_address;
+    entry->last_use = ++g_page_cache_clock;
+    return entry;
+}
+
+/**
+ * @brief 直写更新页缓存
+ * @param address 编程地址
+ * @param data 编程数据
+ * @param length 编程长度（不跨页）
+ * @note NOR编程只能把1变为0，缓存内容按位与更新，与芯片内容保持一致；
+ *       写入最近擦除扇区中的空白页时已知整页内容，直接分配缓存（写分配），
+ *       刚写入的记录被读回时无需访问芯片
+ */
+static void Flash_PageCacheUpdate(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    uint32_t page_address = address & ~(uint32_t)(W25Q64_PAGE_SIZE - 1);
+    uint32_t offset = address - page_address;
+    FlashPageCacheEntry_t *entry = Flash_PageCacheLookup(page_address);
+    
+    if (entry == NULL) {
+        entry = Flash_PageCacheBlank(page_address);
+    }
+    
+    /* 编程后不再是空白页，缓存条目被换出后须从芯片读取 */
+    if ((page_address & ~(uint32_t)(W25Q64_SECTOR_SIZE - 1)) == g_page_cache_blank_sector) {
+        g_page_cache_blank_pages &= ~(1 << ((page_address % W25Q64_SECTOR_SIZE) / W25Q64_PAGE_SIZE));
+    }
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    for (uint32_t j = 0; j < length && offset + j < W25Q64_PAGE_SIZE; j++) {
+        entry->data[offset + j] &= data[j];
+    }
+}
+
+/**
+ * @brief 使擦除范围内的缓存页失效
+ */
+static void Flash_PageCacheInvalidateRange(uint32_t address, uint32_t size)
+{
+    g_page_cache_blank_sector = FLASH_PAGE_CACHE_INVALID;
+    
+    for (uint32_t i = 0; i < FLASH_PAGE_CACHE_ENTRIES; i++) {
+        if (g_page_cache[i].page_address != FLASH_PAGE_CACHE_INVALID &&
+            g_page_cache[i].page_address >= address &&
+            g_page_cache[i].page_address < address + size) {
+            g_page_cache[i].page_address = FLASH_PAGE_CACHE_INVALID;
+        }
+    }
+}
+
+/**
+ * @brief 使全部缓存页失效
+ */
+void Flash_InvalidatePageCache(void)
+{
+    Flash_ReadAheadDrop();
+    g_page_cache_blank_sector = FLASH_PAGE_CACHE_INVALID;
+    g_page_cache_blank_pages = 0;
+    for (uint32_t i = 0; i < FLASH_PAGE_CACHE_ENTRIES; i++) {
+        g_page_cache[i].page_address = FLASH_PAGE_CACHE_INVALID;
+    }
+}
+
+/**
+ * @brief 获取页缓存统计
+ */
+const FlashPageCacheStats_t* Flash_GetPageCacheStats(void)
+{
+    return &g_page_cache_stats;
+}
+
+/**
+ * @brief 是否预读从address开始的一段
+ * @note 超出芯片容量或跨过数据区写入位置时不预读：写入位置之后尚未写入，
+ *       而紧跟写入位置的读取（存储后读最新记录）会被下一次编程打断
+ */
+static bool Flash_ReadAheadAllowed(uint32_t address)
+{
+    uint32_t end = address + FLASH_READAHEAD_SIZE;
+    bool in_data = (address >= W25Q64_DATA_AREA_START &&
+                    address < W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE) ||
+                   address >= FLASH_EXT_DATA_AREA_START;
+    
+    if (end > g_flash_geometry.total_size) {
+        return false;
+    }
+    
+    /* 初始化或重新扫描时写入位置尚未确定 */
+    return !g_flash_initialized || g_ra_rescan || !in_data || end <= g_next_write_address ||
+           Flash_DataSegmentEnd(address) != Flash_DataSegmentEnd(g_next_write_address);
+}
+
+/**
+ * @brief 开始读取下一段到另一个缓冲
+ * @note DMA方式发送命令后立即返回，片选保持有效直到Flash_ReadAheadSettle；
+ *       超出芯片容量时不预读
+ */
+static void Flash_ReadAheadFetch(void)
+{
+    uint32_t address = g_ra_base + FLASH_READAHEAD_SIZE;
+    uint8_t *buffer = g_ra_buffer[g_ra_current ^ 1];
+    
+    g_ra_next_valid = false;
+    if (!Flash_ReadAheadAllowed(address)) {
+        return;
+    }
+    
+    g_page_cache_stats.readahead_bursts++;
+    g_page_cache_stats.spi_bytes += FLASH_READAHEAD_SIZE + FLASH_SPI_READ_OVERHEAD;
+    
+#if FLASH_READAHEAD_DMA
+    uint8_t cmd[5];
+    uint8_t dummy[5];
+    uint32_t cmd_length = Flash_PutCommand(cmd, g_flash_geometry.read_cmd, address);
+    
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
+    if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, cmd_length, 50) != HAL_OK ||
+        HAL_SPI_Receive_DMA(&hspi1, buffer, FLASH_READAHEAD_SIZE) != HAL_OK) {
+        HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+        return;
+    }
+    g_ra_pending = true;
+    g_ra_next_valid = true;
+#else
+    g_ra_next_valid = (Flash_ReadSPI(address, buffer, FLASH_READAHEAD_SIZE) == FLASH_OK);
+#endif
+}
+
+/**
+ * @brief 等待进行中的预读DMA完成并释放片选
+ * @note 任何其他SPI访问之前调用；预读数据保留
+ */
+static void Flash_ReadAheadSettle(void)
+{
+    if (!g_ra_pending) {
+        return;
+    }
+    
+    uint32_t start_tick = osKernelGetTickCount();
+    while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY) {
+        if (osKernelGetTickCount() - start_tick > 50) {
+            HAL_SPI_Abort(&hspi1);
+            g_ra_next_valid = false;
+            Log_Error("Flash: Read-ahead DMA timeout");
+            break;
+        }
+    }
+    HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+    g_ra_pending = false;
+    
+    if (g_ra_next_valid) {
+        g_flash_stats.bytes_read += FLASH_READAHEAD_SIZE;
+    }
+}
+
+/**
+ * @brief 停止预读并丢弃缓冲
+ * @note 编程、擦除前调用，缓冲内容不再可信
+ */
+static void Flash_ReadAheadDrop(void)
+{
+    Flash_ReadAheadSettle();
+    g_ra_base = FLASH_PAGE_CACHE_INVALID;
+    g_ra_next_valid = false;
+    g_ra_sequential = 0;
+}
+
+/**
+ * @brief 编程、擦除范围与预读缓冲重叠时丢弃预读
+ */
+static void Flash_ReadAheadInvalidateRange(uint32_t address, uint32_t size)
+{
+    if (g_ra_base != FLASH_PAGE_CACHE_INVALID && address < g_ra_base + 2 * FLASH_READAHEAD_SIZE &&
+        address + size > g_ra_base) {
+        Flash_ReadAheadDrop();
+    }
+}
+
+/**
+ * @brief 切换到下一段缓冲，并开始读取再下一段
+ * @return bool 下一段可用
+ */
+static bool Flash_ReadAheadAdvance(void)
+{
+    Flash_ReadAheadSettle();
+    if (!g_ra_next_valid) {
+        Flash_ReadAheadDrop();
+        return false;
+    }
+    
+    g_ra_current ^= 1;
+    g_ra_base += FLASH_READAHEAD_SIZE;
+    Flash_ReadAheadFetch();
+    return true;
+}
+
+/**
+ * @brief 从预读缓冲提供数据
+ * @return bool true: 已全部从缓冲复制
+ * @note 读取进入下一段时切换缓冲，调用者处理当前段期间DMA读取再下一段
+ */
+static bool Flash_ReadAheadServe(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    if (g_ra_base == FLASH_PAGE_CACHE_INVALID || length > FLASH_READAHEAD_SIZE ||
+        address < g_ra_base || address >= g_ra_base + 2 * FLASH_READAHEAD_SIZE) {
+        return false;
+    }
+    
+    if (address >= g_ra_base + FLASH_READAHEAD_SIZE && !Flash_ReadAheadAdvance()) {
+        return false;
+    }
+    
+    uint32_t offset = address - g_ra_base;
+    uint32_t chunk = FLASH_READAHEAD_SIZE - offset;
+    if (chunk > length) {
+        chunk = length;
+    }
+    memcpy(buffer, &g_ra_buffer[g_ra_current][offset], chunk);
+    
+    if (chunk < length) {
+        if (!Flash_ReadAheadAdvance()) {
+            return false;
+        }
+        memcpy(buffer + chunk, g_ra_buffer[g_ra_current], length - chunk);
+    }
+    
+    g_page_cache_stats.readahead_bytes += length;
+    return true;
+}
+
+/**
+ * @brief 从address开始预读
+ * @return bool 当前段已读入
+ */
+static bool Flash_ReadAheadStart(uint32_t address)
+{
+    Flash_ReadAheadDrop();
+    
+    if (!Flash_ReadAheadAllowed(address)) {
+        return false;
+    }
+    
+    g_page_cache_stats.readahead_bursts++;
+    g_page_cache_stats.spi_bytes += FLASH_READAHEAD_SIZE + FLASH_SPI_READ_OVERHEAD;
+    if (Flash_ReadSPI(address, g_ra_buffer[g_ra_current], FLASH_READAHEAD_SIZE) != FLASH_OK) {
+        return false;
+    }
+    
+    g_ra_base = address;
+    Flash_ReadAheadFetch();
+    return true;
+}
+
+/**
+ * @brief 直接从芯片读取数据（不经过页缓存）
+ * @param address 地址
+ * @param buffer 缓冲区
+ * @param length 长度
+ * @return FlashResult_t 操作结果
+ */
+static FlashResult_t Flash_ReadSPI(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint8_t cmd[5];
+    uint8_t dummy[5] = {0};  // 用于接收命令响应
+    uint32_t cmd_length = Flash_PutCommand(cmd, g_flash_geometry.read_cmd, address);
+    
+    Log_Debug("Flash: Reading %lu bytes from address 0x%08lX", length, address);
+    
+    uint32_t start_cycles = DWT_GetTick();
+    
+    Flash_ReadAheadSettle();
+    
+    /* 读取在操作边界和擦除暂停期间执行，芯片正常时不忙；仍忙则等待完成，不复位芯片 */
+    uint8_t status;
+    if (Flash_ReadStatus(&status) == FLASH_OK && (status & W25Q64_STATUS_BUSY)) {
+        if (Flash_WaitForReady(FLASH_OP_NONE) != FLASH_OK) {
+            Log_Error("Flash: Chip busy before read at 0x%08lX", address);
+            return FLASH_ERROR_READ;
         }
     }
     
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
     
     /* 发送命令和地址，同时接收响应 */
-    if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, 4, 50) != HAL_OK) {
+    if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, cmd_length, 50) != HAL_OK) {
         HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
         Log_Error("Flash: Failed to send read command to address 0x%08lX", address);
         
@@ -506,7 +1517,7 @@ static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, u
             Log_Info("Flash: Retrying read after recovery...");
             /* 重试一次 */
             HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
-            if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, 4, 50) != HAL_OK) {
+            if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, cmd_length, 50) != HAL_OK) {
                 HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
                 Log_Error("Flash: Retry failed after recovery");
                 return FLASH_ERROR_READ;
@@ -527,7 +1538,7 @@ static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, u
             Log_Info("Flash: Retrying read after recovery...");
             /* 重新发送命令并接收数据 */
             HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
-            if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, 4, 50) != HAL_OK) {
+            if (HAL_SPI_TransmitReceive(&hspi1, cmd, dummy, cmd_length, 50) != HAL_OK) {
                 HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
                 Log_Error("Flash: Retry command failed after recovery");
                 return FLASH_ERROR_READ;
@@ -544,6 +1555,9 @@ static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, u
     
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
     
+    g_flash_stats.bytes_read += length;
+    Flash_StatsHistogram(g_flash_stats.hist_read, start_cycles);
+    
     Log_Debug("Flash: Successfully read %lu bytes from address 0x%08lX", length, address);
     return FLASH_OK;
 }
@@ -556,19 +1570,26 @@ static FlashResult_t Flash_ReadDataInternal(uint32_t address, uint8_t *buffer, u
  */
 static FlashResult_t Flash_EraseInternal(uint32_t address, uint32_t size)
 {
-    uint8_t cmd[4];
+    uint8_t cmd[5];
     uint8_t erase_cmd;
+    FlashOp_t erase_op;
+    uint32_t erase_size;
     
     if (size >= W25Q64_BLOCK_SIZE) {
-        erase_cmd = W25Q64_CMD_BLOCK_ERASE;
+        erase_cmd = g_flash_geometry.block_erase_cmd;
+        erase_op = FLASH_OP_BLOCK_ERASE;
+        erase_size = W25Q64_BLOCK_SIZE;
     } else {
-        erase_cmd = W25Q64_CMD_SECTOR_ERASE;
+        erase_cmd = g_flash_geometry.sector_erase_cmd;
+        erase_op = FLASH_OP_SECTOR_ERASE;
+        erase_size = W25Q64_SECTOR_SIZE;
     }
     
-    cmd[0] = erase_cmd;
-    cmd[1] = (address >> 16) & 0xFF;
-    cmd[2] = (address >> 8) & 0xFF;
-    cmd[3] = address & 0xFF;
+    uint32_t cmd_length = Flash_PutCommand(cmd, erase_cmd, address);
+    
+    uint32_t start_cycles = DWT_GetTick();
+    
+    Flash_ReadAheadInvalidateRange(address & ~(erase_size - 1), erase_size);
     
     /* 写使能 */
     if (Flash_WriteEnable() != FLASH_OK) {
@@ -577,14 +1598,20 @@ static FlashResult_t Flash_EraseInternal(uint32_t address, uint32_t size)
     }
     
     /* 等待就绪 */
-    if (Flash_WaitForReady() != FLASH_OK) {
+    if (Flash_WaitForReady(FLASH_OP_NONE) != FLASH_OK) {
         Log_Error("Flash: Wait for ready failed before erase");
         return FLASH_ERROR_ERASE;
     }
     
+    /* 擦除命令发出后芯片内容即不可信，先使缓存失效 */
+    g_erase_address = address & ~(erase_size - 1);
+    g_erase_size = erase_size;
+    g_erase_resume_tick = osKernelGetTickCount();
+    Flash_PageCacheInvalidateRange(g_erase_address, erase_size);
+    
     /* 发送擦除命令 */
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET);
-    if (HAL_SPI_Transmit(&hspi1, cmd, 4, 100) != HAL_OK) {
+    if (HAL_SPI_Transmit(&hspi1, cmd, cmd_length, 100) != HAL_OK) {
         HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
         Log_Error("Flash: Failed to send erase command");
         return FLASH_ERROR_ERASE;
@@ -592,14 +1619,161 @@ static FlashResult_t Flash_EraseInternal(uint32_t address, uint32_t size)
     HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
     
     /* 等待擦除完成 */
-    FlashResult_t result = Flash_WaitForReady();
+    FlashResult_t result = Flash_WaitForReady(erase_op);
     if (result != FLASH_OK) {
         Log_Error("Flash: Wait for ready failed after erase");
         return result;
     }
+    
+    /* 记录空白扇区供写分配使用，块擦除只跟踪第一个扇区，顺序写入总是从这里开始 */
+    g_page_cache_blank_sector = address & ~(erase_size - 1);
+    g_page_cache_blank_pages = 0xFFFF;
+    
+    Flash_StatsCountErase(address, erase_size);
+    Flash_StatsHistogram(g_flash_stats.hist_erase, start_cycles);
+    
+    if (g_flash_op_hook != NULL) {
+        g_flash_op_hook();
+    }
+    return FLASH_OK;
+}
+
+/**
+ * @brief 设置芯片操作完成回调
+ * @param hook 回调，NULL为取消
+ * @note 每次页编程、扇区/块擦除成功完成后调用，此时芯片空闲、缓存与芯片内容一致。
+ *       回调中可以读取，不能写入或擦除
+ */
+void Flash_SetOpHook(FlashOpHook_t hook)
+{
+    g_flash_op_hook = hook;
+}
+
+/**
+ * @brief 设置擦除等待回调
+ * @param hook 回调，NULL为擦除期间不暂停
+ * @note 芯片支持擦除暂停时，扇区/块擦除等待期间调用回调代替osDelay；回调返回true后
+ *       暂停擦除，调用芯片操作完成回调（只能读取，正在擦除的范围内容无效），再恢复擦除
+ */
+void Flash_SetWaitHook(FlashWaitHook_t hook)
+{
+    g_flash_wait_hook = hook;
+}
+
+/**
+ * @brief 设置芯片识别完成回调
+ * @param hook 回调，NULL为取消
+ * @note Flash_Init读取芯片参数和统计块之后、加载索引表或扫描数据区之前调用，
+ *       用于尽早读取系统区（热启动状态）；回调中只能用Flash_Read读取
+ */
+void Flash_SetProbeHook(FlashOpHook_t hook)
+{
+    g_flash_probe_hook = hook;
+}
+
+/**
+ * @brief 获取擦除暂停统计
+ * @return const FlashSuspendStats_t* 统计指针
+ */
+const FlashSuspendStats_t* Flash_GetSuspendStats(void)
+{
+    return &g_suspend_stats;
+}
+
+/**
+ * @brief 读取Flash任意地址数据
+ * @param address 起始地址
+ * @param buffer 缓冲区
+ * @param length 长度
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t Flash_Read(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    if (buffer == NULL || length == 0 || address + length > g_flash_geometry.total_size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    return Flash_ReadDataInternal(address, buffer, length);
+}
+
+/**
+ * @brief 读取Flash任意地址数据，不经过页缓存
+ * @param address 起始地址
+ * @param buffer 缓冲区
+ * @param length 长度
+ * @return FlashResult_t 操作结果
+ * @note 用于写后校验等必须读取芯片实际内容的场合
+ */
+FlashResult_t Flash_ReadNoCache(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    if (buffer == NULL || length == 0 || address + length > g_flash_geometry.total_size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    return Flash_ReadSPI(address, buffer, length);
+}
+
+/**
+ * @brief 写入Flash任意地址数据（自动按页拆分，目标区域需已擦除）
+ * @param address 起始地址
+ * @param buffer 数据指针
+ * @param length 长度
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t Flash_Write(uint32_t address, const uint8_t *buffer, uint32_t length)
+{
+    if (buffer == NULL || length == 0 || address + length > g_flash_geometry.total_size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    while (length > 0) {
+        /* 单次页编程不能跨越页边界 */
+        uint32_t chunk = W25Q64_PAGE_SIZE - (address % W25Q64_PAGE_SIZE);
+        if (chunk > length) {
+            chunk = length;
+        }
+        
+        FlashResult_t result = Flash_WritePage(address, buffer, chunk);
+        if (result != FLASH_OK) {
+            return result;
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    
     return FLASH_OK;
 }
 
+/**
+ * @brief 擦除地址所在的4KB扇区
+ * @param address 扇区内任意地址
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t Flash_EraseSector(uint32_t address)
+{
+    if (address >= g_flash_geometry.total_size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    return Flash_EraseInternal(address - (address % W25Q64_SECTOR_SIZE), W25Q64_SECTOR_SIZE);
+}
+
+/**
+ * @brief 擦除地址所在的64KB块
+ * @param address 块内任意地址
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t Flash_EraseBlock(uint32_t address)
+{
+    if (address >= g_flash_geometry.total_size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    return Flash_EraseInternal(address - (address % W25Q64_BLOCK_SIZE), W25Q64_BLOCK_SIZE);
+}
+
 /**
  * @brief 计算CRC16
  * @param data 数据指针
@@ -608,190 +1782,982 @@ static FlashResult_t Flash_EraseInternal(uint32_t address, uint32_t size)
  */
 uint16_t Flash_CalculateCRC16(const uint8_t *data, uint32_t length)
 {
-    uint16_t crc = 0xFFFF;
-    
-    for (uint32_t i = 0; i < length; i++) {
-        crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ data[i]) & 0xFF];
-    }
-    
-    return crc;
+    return Crc16Ccitt_Update(CRC16_CCITT_INIT, data, length);
+}
+
+/**
+ * @brief 添加条目到缓存
+ * @param record_id 记录ID
+ * @param address Flash地址
+ * @param length 数据长度
+ */
+static void Flash_AddToCache(uint32_t record_id, uint32_t address, uint32_t length)
+{
+    /* 如果缓存已满，移除最旧的条目 */
+    if (g_cache_count >= W25Q64_MAX_CACHE_ENTRIES) {
+        /* 移动所有条目向前一位 */
+        for (uint32_t i = 0; i < W25Q64_MAX_CACHE_ENTRIES - 1; i++) {
+            g_cache_entries[i] = g_cache_entries[i + 1];
+        }
+        g_cache_count = W25Q64_MAX_CACHE_ENTRIES - 1;
+        g_cache_start_id = g_cache_entries[0].record_id;
+    }
+    
+    /* 添加新条目 */
+    g_cache_entries[g_cache_count].record_id = record_id;
+    g_cache_entries[g_cache_count].flash_address = address;
+    g_cache_entries[g_cache_count].data_length = length;
+    g_cache_count++;
+    
+    if (g_cache_count == 1) {
+        g_cache_start_id = record_id;
+    }
+}
+
+/**
+ * @brief 在缓存中查找记录
+ * @param record_id 记录ID
+ * @param address 输出Flash地址
+ * @param length 输出数据长度
+ * @return bool 是否找到
+ */
+static bool Flash_FindInCache(uint32_t record_id, uint32_t *address, uint32_t *length)
+{
+    for (uint32_t i = 0; i < g_cache_count; i++) {
+        if (g_cache_entries[i].record_id == record_id) {
+            *address = g_cache_entries[i].flash_address;
+            *length = g_cache_entries[i].data_length;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 地址所在数据区段的结束地址
+ * @note 第一段为W25Q64_DATA_AREA_START起的基本数据区，第二段为扩展数据区
+ */
+static uint32_t Flash_DataSegmentEnd(uint32_t address)
+{
+    if (address >= FLASH_EXT_DATA_AREA_START) {
+        return g_flash_geometry.total_size;
+    }
+    return W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE;
+}
+
+/**
+ * @brief [address, address + length)是否位于同一段数据区内
+ * @note 长度为0时地址可以等于段结束地址（数据区已写满时的写入位置）；
+ *       数据区曾占用到8MB布局的固件暂存区之前，旧版本的索引条目可能指向
+ *       现在的列存储区、文件区或固件暂存区
+ */
+static bool Flash_InDataArea(uint32_t address, uint32_t length)
+{
+    if (address < W25Q64_DATA_AREA_START) {
+        return false;
+    }
+    
+    if (address >= FLASH_EXT_DATA_AREA_START) {
+        if (g_flash_geometry.total_size <= FLASH_EXT_DATA_AREA_START) {
+            return false;
+        }
+    } else if (address > W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE) {
+        return false;
+    }
+    
+    return length <= Flash_DataSegmentEnd(address) - address;
+}
+
+/**
+ * @brief 数据区总大小（含扩展数据区）
+ */
+static uint32_t Flash_DataAreaSize(void)
+{
+    return W25Q64_DATA_AREA_SIZE + (g_flash_geometry.total_size - FLASH_EXT_DATA_AREA_START);
+}
+
+/**
+ * @brief 存储数据到Flash
+ * @param data 数据指针
+ * @param length 数据长度
+ * @param record_id 输出记录ID
+ * @return FlashResult_t 操作结果
+ * @note 返回时记录可能仍在写合并缓冲中，需要立即持久化时调用Flash_Flush
+ */
+FlashResult_t Flash_StoreData(const uint8_t *data, uint32_t length, uint32_t *record_id)
+{
+    return Flash_StoreTaggedData(FLASH_RECORD_TAG_NONE, data, length, record_id);
+}
+
+/**
+ * @brief 存储带标签的数据到Flash
+ * @param tag 记录标签（记录类型、通道等），按标签查询时只读取可能含有该标签的扇区
+ * @param data 数据指针
+ * @param length 数据长度
+ * @param record_id 输出记录ID
+ * @return FlashResult_t 操作结果
+ * @note 返回时记录可能仍在写合并缓冲中，需要立即持久化时调用Flash_Flush
+ */
+FlashResult_t Flash_StoreTaggedData(uint16_t tag, const uint8_t *data, uint32_t length, uint32_t *record_id)
+{
+    if (!g_flash_initialized) {
+        return FLASH_ERROR_INIT;
+    }
+    
+    if (data == NULL || length == 0 || length > FLASH_RECORD_MAX_LENGTH || record_id == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    /* 检查数据区空间，第一段写满后转到扩展数据区 */
+    uint32_t record_size = W25Q64_DATA_HEADER_SIZE + length;
+    if (g_next_write_address + record_size > Flash_DataSegmentEnd(g_next_write_address)) {
+        if (g_next_write_address >= FLASH_EXT_DATA_AREA_START ||
+            g_flash_geometry.total_size - FLASH_EXT_DATA_AREA_START < record_size) {
+            Log_Error("Flash: Data area full");
+            return FLASH_ERROR_FULL;
+        }
+        
+        /* 先编程第一段最后一页中已暂存的部分 */
+        FlashResult_t result = Flash_StageProgram();
+        if (result != FLASH_OK) {
+            return result;
+        }
+        g_next_write_address = FLASH_EXT_DATA_AREA_START;
+        Log_Info("Flash: Continuing in extended data area");
+    }
+    
+    /* 准备数据头 */
+    DataHeader_t header;
+    header.magic = W25Q64_DATA_HEADER_MAGIC;
+    header.record_id = g_next_record_id;
+    header.data_length = length | ((uint32_t)tag << FLASH_RECORD_TAG_SHIFT);
+    header.crc16 = Flash_CalculateCRC16(data, length);
+    
+    /* 数据头和数据紧接着进入页缓冲，页写满时编程，其余部分由Flash_Flush或到期提交 */
+    uint32_t header_address = g_next_write_address;
+    Flash_TagAddRecord(header_address, tag);
+    FlashResult_t result = Flash_StageWrite((const uint8_t*)&header, sizeof(DataHeader_t));
+    if (result == FLASH_OK) {
+        result = Flash_StageWrite(data, length);
+    }
+    if (result != FLASH_OK) {
+        Log_Error("Flash: Failed to stage record");
+        return result;
+    }
+    
+    g_flash_stats.user_bytes += length;
+    g_stage_stats.records++;
+    
+    /* 更新缓存 */
+    Flash_AddToCache(g_next_record_id, header_address, length);
+    
+    /* 更新全局变量 */
+    *record_id = g_next_record_id;
+    g_next_record_id++;
+    g_total_records++;
+    Flash_PublishSnapshot();
+    
+    /* 索引表在提交时保存 */
+    if (!g_index_dirty) {
+        g_index_dirty = true;
+        g_index_dirty_tick = osKernelGetTickCount();
+    }
+    
+    Log_Info("Flash: Stored ID:%lu, %lu bytes @0x%08X", 
+             *record_id, length, header_address);
+    
+    return FLASH_OK;
+}
+
+/**
+ * @brief 把数据顺序追加到写合并缓冲
+ * @param data 数据
+ * @param length 数据长度
+ * @return FlashResult_t 操作结果
+ * @note 从g_next_write_address开始追加，页写满时立即编程；
+ *       写入位置进入未擦除的扇区时先擦除该扇区
+ */
+static FlashResult_t Flash_StageWrite(const uint8_t *data, uint32_t length)
+{
+    while (length > 0) {
+        uint32_t offset = g_next_write_address % W25Q64_PAGE_SIZE;
+        uint32_t page_address = g_next_write_address - offset;
+        
+        if (page_address != g_stage_address || g_stage_fill != offset) {
+            /* 开始新的一页，上一页已在写满时编程 */
+            if (page_address >= g_data_erased_end) {
+                uint32_t sector_address = page_address - (page_address % W25Q64_SECTOR_SIZE);
+                if (Flash_EraseInternal(sector_address, W25Q64_SECTOR_SIZE) != FLASH_OK) {
+                    Log_Error("Flash: Failed to erase sector before write");
+                    return FLASH_ERROR_ERASE;
+                }
+                g_data_erased_end = sector_address + W25Q64_SECTOR_SIZE;
+                g_stage_stats.sector_erases++;
+            }
+            
+            g_stage_address = page_address;
+            g_stage_fill = offset;
+            g_stage_programmed = offset;
+        }
+        
+        uint32_t chunk = W25Q64_PAGE_SIZE - offset;
+        if (chunk > length) {
+            chunk = length;
+        }
+        
+        memcpy(&g_stage_page[offset], data, chunk);
+        g_stage_fill = offset + chunk;
+        g_next_write_address += chunk;
+        data += chunk;
+        length -= chunk;
+        
+        if (g_stage_fill == W25Q64_PAGE_SIZE) {
+            g_stage_stats.full_flushes++;
+            FlashResult_t result = Flash_StageProgram();
+            if (result != FLASH_OK) {
+                return result;
+            }
+        }
+    }
+    
+    return FLASH_OK;
+}
+
+/**
+ * @brief 编程写合并缓冲中尚未写入芯片的部分并回读校验
+ * @return FlashResult_t 操作结果
+ * @note 失败时保留缓冲内容，下次提交重试（重复编程相同数据不改变芯片内容）
+ */
+static FlashResult_t Flash_StageProgram(void)
+{
+    if (g_stage_programmed == g_stage_fill) {
+        return FLASH_OK;
+    }
+    
+    uint32_t address = g_stage_address + g_stage_programmed;
+    uint32_t length = g_stage_fill - g_stage_programmed;
+    const uint8_t *expected = &g_stage_page[g_stage_programmed];
+    
+    if (Flash_WritePage(address, expected, length) != FLASH_OK) {
+        Log_Error("Flash: Failed to program staged page");
+        return FLASH_ERROR_WRITE;
+    }
+    g_stage_stats.page_programs++;
+    
+    /* 回读校验，绕过页缓存 */
+    uint8_t verify[64];
+    g_flash_stats.verify_reads++;
+    for (uint32_t done = 0; done < length; done += sizeof(verify)) {
+        uint32_t chunk = length - done;
+        if (chunk > sizeof(verify)) {
+            chunk = sizeof(verify);
+        }
+        
+        if (Flash_ReadSPI(address + done, verify, chunk) != FLASH_OK) {
+            Log_Error("Flash: Failed to read back staged page");
+            return FLASH_ERROR_READ;
+        }
+        
+        if (memcmp(verify, expected + done, chunk) != 0) {
+            Log_Error("Flash: Verify failed @0x%08lX", address + done);
+            return FLASH_ERROR_CRC;
+        }
+    }
+    
+    g_stage_programmed = g_stage_fill;
+    
+    /* 上一个扇区的最后一条记录编程完成后写入其标签摘要 */
+    if (Flash_TagSealedProgrammed()) {
+        Flash_TagWriteSealed();
+    }
+    return FLASH_OK;
+}
+
+/**
+ * @brief 提交：编程暂存数据，再保存索引表
+ * @return FlashResult_t 操作结果
+ */
+static FlashResult_t Flash_StageCommit(void)
+{
+    FlashResult_t result = Flash_StageProgram();
+    if (result != FLASH_OK) {
+        return result;
+    }
+    
+    if (g_index_dirty) {
+        result = Flash_SaveIndexTable();
+    }
+    
+    return result;
+}
+
+/**
+ * @brief 用写合并缓冲中尚未编程的数据覆盖读取结果
+ */
+static void Flash_StageOverlay(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    if (g_stage_programmed == g_stage_fill) {
+        return;
+    }
+    
+    uint32_t start = g_stage_address + g_stage_programmed;
+    uint32_t end = g_stage_address + g_stage_fill;
+    
+    if (start < address) {
+        start = address;
+    }
+    if (end > address + length) {
+        end = address + length;
+    }
+    
+    if (start < end) {
+        memcpy(buffer + (start - address), &g_stage_page[start - g_stage_address], end - start);
+    }
+}
+
+/**
+ * @brief 把暂存的记录和索引表写入芯片
+ * @return FlashResult_t 操作结果
+ * @note 返回FLASH_OK后，此前Flash_StoreData存储的记录掉电不丢失
+ */
+FlashResult_t Flash_Flush(void)
+{
+    if (!g_flash_initialized) {
+        return FLASH_ERROR_INIT;
+    }
+    
+    if (g_stage_programmed == g_stage_fill && !g_index_dirty) {
+        return FLASH_OK;
+    }
+    
+    g_stage_stats.forced_flushes++;
+    return Flash_StageCommit();
+}
+
+/**
+ * @brief 获取写合并统计
+ * @return const FlashStageStats_t* 统计指针
+ */
+const FlashStageStats_t* Flash_GetStageStats(void)
+{
+    return &g_stage_stats;
+}
+
+/**
+ * @brief 设置记录暂存的最长时间
+ * @param flush_ms 到期后由Flash_TaskProcess编程并保存索引，0为每个处理周期提交
+ * @note 任意任务可调用，下一次Flash_TaskProcess生效
+ */
+void Flash_SetStageFlushTime(uint32_t flush_ms)
+{
+    g_stage_flush_ms = flush_ms;
+}
+
+/**
+ * @brief 发布已提交状态快照
+ * @note 只由追加记录的任务调用。调度锁保证其他任务不会看到发布中途的状态，
+ *       序号供中断或多核读取方检测并重试
+ */
+static void Flash_PublishSnapshot(void)
+{
+    int32_t lock = osKernelLock();
+    
+    g_snapshot_seq++;
+    __DMB();
+    g_snapshot.first_id = (g_cache_count > 0) ? g_cache_start_id : 0;
+    g_snapshot.head_id = g_next_record_id - 1;
+    g_snapshot.record_count = g_total_records;
+    g_snapshot.write_address = g_next_write_address;
+    __DMB();
+    g_snapshot_seq++;
+    
+    osKernelRestoreLock(lock);
+}
+
+/**
+ * @brief 读取记录存储快照
+ * @param snapshot 输出快照
+ * @note 可在任意任务中调用，不加锁、不等待Flash操作。head_id及之前的记录都已可读；
+ *       读取前first_id之后的记录可能已被新记录挤出RAM索引，此时读取返回
+ *       FLASH_ERROR_NOT_FOUND，重新取快照即可
+ */
+void Flash_GetSnapshot(FlashSnapshot_t *snapshot)
+{
+    uint32_t seq;
+    
+    do {
+        seq = g_snapshot_seq;
+        __DMB();
+        *snapshot = g_snapshot;
+        __DMB();
+    } while ((seq & 1) || seq != g_snapshot_seq);
+}
+
+/**
+ * @brief 检查地址处是否为完整的数据记录
+ * @param address 数据头地址
+ * @param header 输出数据头
+ * @return true: 数据头有效且数据CRC正确
+ */
+static bool Flash_ProbeRecord(uint32_t address, DataHeader_t *header)
+{
+    uint32_t data_end = Flash_DataSegmentEnd(address);
+    
+    if (address + sizeof(DataHeader_t) > data_end) {
+        return false;
+    }
+    
+    if (Flash_ReadDataInternal(address, (uint8_t*)header, sizeof(DataHeader_t)) != FLASH_OK) {
+        return false;
+    }
+    
+    uint32_t data_length = FLASH_RECORD_LENGTH(header->data_length);
+    if (header->magic != W25Q64_DATA_HEADER_MAGIC || data_length == 0 ||
+        data_length > FLASH_RECORD_MAX_LENGTH ||
+        address + sizeof(DataHeader_t) + data_length > data_end) {
+        return false;
+    }
+    
+    /* 分段计算数据CRC，避免大缓冲 */
+    uint8_t chunk[64];
+    uint16_t crc = CRC16_CCITT_INIT;
+    uint32_t data_address = address + sizeof(DataHeader_t);
+    
+    for (uint32_t done = 0; done < data_length; done += sizeof(chunk)) {
+        uint32_t length = data_length - done;
+        if (length > sizeof(chunk)) {
+            length = sizeof(chunk);
+        }
+        
+        if (Flash_ReadDataInternal(data_address + done, chunk, length) != FLASH_OK) {
+            return false;
+        }
+        crc = Crc16Ccitt_Update(crc, chunk, length);
+    }
+    
+    return crc == header->crc16;
+}
+
+/**
+ * @brief 在地址处查找下一条记录
+ * @param address 输入候选地址，找到时输出记录地址
+ * @param header 输出数据头
+ * @return true: 找到记录
+ * @note 记录紧密排列；旧版本按页对齐存放，紧接位置不是记录时再尝试下一页页首
+ */
+static bool Flash_FindRecordAt(uint32_t *address, DataHeader_t *header)
+{
+    if (Flash_ProbeRecord(*address, header)) {
+        return true;
+    }
+    
+    uint32_t offset = *address % W25Q64_PAGE_SIZE;
+    if (offset == 0) {
+        return false;
+    }
+    
+    uint32_t aligned = *address + W25Q64_PAGE_SIZE - offset;
+    if (!Flash_ProbeRecord(aligned, header)) {
+        return false;
+    }
+    
+    *address = aligned;
+    return true;
+}
+
+/**
+ * @brief 查找下一条记录，第一段数据区中没有时检查扩展数据区开头
+ * @param address 输入候选地址，找到时输出记录地址
+ * @param header 输出数据头
+ * @param next_id 紧接的记录ID
+ * @return true: 找到记录
+ * @note 第一段写满后记录从扩展数据区开头继续，只接受编号紧接的记录
+ */
+static bool Flash_FindNextRecord(uint32_t *address, DataHeader_t *header, uint32_t next_id)
+{
+    if (Flash_FindRecordAt(address, header)) {
+        return true;
+    }
+    
+    if (*address >= FLASH_EXT_DATA_AREA_START || g_flash_geometry.total_size <= FLASH_EXT_DATA_AREA_START) {
+        return false;
+    }
+    
+    if (!Flash_ProbeRecord(FLASH_EXT_DATA_AREA_START, header) || header->record_id != next_id) {
+        return false;
+    }
+    
+    *address = FLASH_EXT_DATA_AREA_START;
+    return true;
+}
+
+/**
+ * @brief 检查区域是否全部为0xFF
+ */
+static bool Flash_IsBlank(uint32_t address, uint32_t length)
+{
+    uint8_t chunk[64];
+    
+    while (length > 0) {
+        uint32_t n = length > sizeof(chunk) ? sizeof(chunk) : length;
+        
+        if (Flash_ReadSPI(address, chunk, n) != FLASH_OK) {
+            return false;
+        }
+        
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+        
+        address += n;
+        length -= n;
+    }
+    
+    return true;
+}
+
+/**
+ * @brief 上电后补齐索引表之后写入的记录，确定写入位置
+ * @note 索引表只在提交时保存，之后写满编程的页不在索引表中，从索引末尾继续探测；
+ *       写入位置之后若不是空白（编程中途掉电），跳到下一个扇区，由下次写入擦除
+ */
+static void Flash_RecoverWritePointer(void)
+{
+    DataHeader_t header;
+    uint32_t recovered = 0;
+    
+    /* 写入位置必须在数据区内，否则按数据区内的记录重新确定 */
+    if (!Flash_InDataArea(g_next_write_address, 0)) {
+        Log_Warn("Flash: Write address 0x%08lX outside data area, rescanning", g_next_write_address);
+        Flash_ScanDataArea();
+    }
+    
+    uint32_t address = g_next_write_address;
+    
+    for (;;) {
+        while (Flash_FindNextRecord(&address, &header, g_next_record_id)) {
+            Flash_AddToCache(header.record_id, address, FLASH_RECORD_LENGTH(header.data_length));
+            g_total_records++;
+            recovered++;
+            
+            if (header.record_id >= g_next_record_id) {
+                g_next_record_id = header.record_id + 1;
+            }
+            
+            address += sizeof(DataHeader_t) + FLASH_RECORD_LENGTH(header.data_length);
+        }
+        
+        g_next_write_address = address;
+        
+        /* 写入位置所在扇区的剩余部分必须为空白 */
+        uint32_t offset = address % W25Q64_SECTOR_SIZE;
+        uint32_t sector_end = address - offset + W25Q64_SECTOR_SIZE;
+        
+        if (offset == 0) {
+            g_data_erased_end = address;
+        } else if (Flash_IsBlank(address, sector_end - address)) {
+            g_data_erased_end = sector_end;
+        } else {
+            Log_Warn("Flash: Torn write, skip to 0x%08lX", sector_end);
+            g_next_write_address = sector_end;
+            g_data_erased_end = sector_end;
+            
+            /* 上次启动跳过后写入的记录尚未进入索引表时，从下一个扇区开头继续 */
+            if (sector_end < Flash_DataSegmentEnd(sector_end) &&
+                Flash_ProbeRecord(sector_end, &header) && header.record_id == g_next_record_id) {
+                address = sector_end;
+                continue;
+            }
+        }
+        break;
+    }
+    
+    if (recovered > 0) {
+        Log_Info("Flash: Recovered %lu unindexed records", recovered);
+        g_index_dirty = true;
+        g_index_dirty_tick = osKernelGetTickCount();
+    }
+}
+
+/**
+ * @brief 地址所在数据扇区的编号
+ * @note 第一段数据区从0编号，扩展数据区接在其后
+ */
+static uint32_t Flash_TagSector(uint32_t address)
+{
+    if (address >= FLASH_EXT_DATA_AREA_START) {
+        return (W25Q64_DATA_AREA_SIZE + (address - FLASH_EXT_DATA_AREA_START)) / W25Q64_SECTOR_SIZE;
+    }
+    return (address - W25Q64_DATA_AREA_START) / W25Q64_SECTOR_SIZE;
+}
+
+/**
+ * @brief 标签在Bloom过滤器中的位
+ * @param tag 标签
+ * @param bits 输出FLASH_TAG_BLOOM_HASHES个位号（0~63）
+ */
+static void Flash_TagBloomBits(uint16_t tag, uint8_t *bits)
+{
+    uint32_t hash = ((uint32_t)tag + 0x9E37) * 0x85EBCA6B;
+    hash ^= hash >> 13;
+    
+    for (uint32_t i = 0; i < FLASH_TAG_BLOOM_HASHES; i++) {
+        bits[i] = (uint8_t)((hash >> (i * 6)) & 0x3F);
+    }
+}
+
+/**
+ * @brief 扇区中是否可能有该标签的记录
+ * @return false: 一定没有
+ */
+static bool Flash_TagMayContain(const FlashTagSummary_t *summary, uint16_t tag)
+{
+    uint8_t bits[FLASH_TAG_BLOOM_HASHES];
+    
+    Flash_TagBloomBits(tag, bits);
+    for (uint32_t i = 0; i < FLASH_TAG_BLOOM_HASHES; i++) {
+        if (!(summary->bloom[bits[i] >> 5] & (1UL << (bits[i] & 0x1F)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 计算摘要CRC
+ */
+static uint16_t Flash_TagSummaryCrc(const FlashTagSummary_t *summary)
+{
+    return Crc16Ccitt_Update(CRC16_CCITT_INIT, (const uint8_t*)summary, offsetof(FlashTagSummary_t, crc16));
+}
+
+/**
+ * @brief 摘要区中扇区摘要的地址
+ */
+static uint32_t Flash_TagSummaryAddress(uint32_t sector)
+{
+    return W25Q64_TAG_AREA_START + sector * sizeof(FlashTagSummary_t);
+}
+
+/**
+ * @brief 读取已写完扇区的摘要
+ * @return true: 摘要有效；未写入（写完前掉电、旧版本写入的扇区）或超出摘要区时为false
+ */
+static bool Flash_TagLoadSummary(uint32_t sector, FlashTagSummary_t *summary)
+{
+    if (sector == g_tag_sealed_sector) {
+        *summary = g_tag_sealed;
+        return true;
+    }
+    
+    if (sector >= FLASH_TAG_SUMMARY_COUNT) {
+        return false;
+    }
+    
+    if (Flash_ReadDataInternal(Flash_TagSummaryAddress(sector), (uint8_t*)summary, sizeof(FlashTagSummary_t)) != FLASH_OK) {
+        return false;
+    }
+    
+    return summary->next_address != 0xFFFFFFFF && summary->crc16 == Flash_TagSummaryCrc(summary);
+}
+
+/**
+ * @brief 把记录加入写入位置所在扇区的摘要
+ * @param address 数据头地址
+ * @param tag 标签
+ * @note 数据头进入新的扇区时上一个扇区写完，其摘要等最后一条记录编程完成后写入
+ */
+static void Flash_TagAddRecord(uint32_t address, uint16_t tag)
+{
+    uint32_t sector = Flash_TagSector(address);
+    
+    if (sector != g_tag_open_sector) {
+        if (g_tag_open_valid) {
+            g_tag_open.next_address = address;
+            g_tag_sealed = g_tag_open;
+            g_tag_sealed_sector = g_tag_open_sector;
+        }
+        
+        memset(&g_tag_open, 0, sizeof(g_tag_open));
+        g_tag_open_sector = sector;
+        g_tag_open_valid = true;
+    }
+    
+    uint8_t bits[FLASH_TAG_BLOOM_HASHES];
+    Flash_TagBloomBits(tag, bits);
+    for (uint32_t i = 0; i < FLASH_TAG_BLOOM_HASHES; i++) {
+        g_tag_open.bloom[bits[i] >> 5] |= 1UL << (bits[i] & 0x1F);
+    }
+    g_tag_open.records++;
+    
+    if (Flash_TagSealedProgrammed()) {
+        Flash_TagWriteSealed();
+    }
+}
+
+/**
+ * @brief 等待写入的扇区摘要所描述的记录是否都已编程
+ * @note 记录按顺序编程，写合并缓冲之前的页都已写入芯片
+ */
+static bool Flash_TagSealedProgrammed(void)
+{
+    return g_tag_sealed_sector != FLASH_TAG_SECTOR_NONE &&
+           g_tag_sealed.next_address <= g_stage_address + g_stage_programmed;
+}
+
+/**
+ * @brief 把已写完扇区的摘要写入摘要区
+ * @note 写入失败时放弃，该扇区在查询时照常读取
+ */
+static void Flash_TagWriteSealed(void)
+{
+    uint32_t sector = g_tag_sealed_sector;
+    
+    g_tag_sealed_sector = FLASH_TAG_SECTOR_NONE;
+    if (sector >= FLASH_TAG_SUMMARY_COUNT) {
+        return;
+    }
+    
+    g_tag_sealed.crc16 = Flash_TagSummaryCrc(&g_tag_sealed);
+    if (Flash_WritePage(Flash_TagSummaryAddress(sector), (const uint8_t*)&g_tag_sealed, sizeof(FlashTagSummary_t)) != FLASH_OK) {
+        Log_Warn("Flash: Tag summary write failed, sector %lu", sector);
+        return;
+    }
+    g_stage_stats.tag_summaries++;
+}
+
+/**
+ * @brief 地址是否已到达记录末尾（写入位置）
+ */
+static bool Flash_TagAtEnd(uint32_t address)
+{
+    return address >= g_next_write_address &&
+           Flash_DataSegmentEnd(address) == Flash_DataSegmentEnd(g_next_write_address);
 }
 
 /**
- * @brief 添加条目到缓存
- * @param record_id 记录ID
- * @param address Flash地址
- * @param length 数据长度
+ * @brief 读取地址处的数据头
+ * @param address 输入候选地址，找到时输出记录地址
+ * @param header 输出数据头
+ * @param next_id 紧接的记录ID，0为不检查
+ * @return true: 找到记录
+ * @note 扇区内的记录只检查数据头，数据CRC在读取匹配的记录时校验；
+ *       不是紧接的记录时（旧版本页对齐、转到扩展数据区）按恢复流程查找
  */
-static void Flash_AddToCache(uint32_t record_id, uint32_t address, uint32_t length)
+static bool Flash_TagReadHeader(uint32_t *address, DataHeader_t *header, uint32_t next_id)
 {
-    /* 如果缓存已满，移除最旧的条目 */
-    if (g_cache_count >= W25Q64_MAX_CACHE_ENTRIES) {
-        /* 移动所有条目向前一位 */
-        for (uint32_t i = 0; i < W25Q64_MAX_CACHE_ENTRIES - 1; i++) {
-            g_cache_entries[i] = g_cache_entries[i + 1];
+    uint32_t data_end = Flash_DataSegmentEnd(*address);
+    
+    if (*address + sizeof(DataHeader_t) <= data_end &&
+        Flash_ReadDataInternal(*address, (uint8_t*)header, sizeof(DataHeader_t)) == FLASH_OK) {
+        uint32_t length = FLASH_RECORD_LENGTH(header->data_length);
+        
+        if (header->magic == W25Q64_DATA_HEADER_MAGIC && length != 0 && length <= FLASH_RECORD_MAX_LENGTH &&
+            *address + sizeof(DataHeader_t) + length <= data_end &&
+            (next_id == 0 || header->record_id == next_id)) {
+            /* 跨扇区的记录校验数据：写入中掉电时其后的记录从下一个扇区开头继续，
+             * 按损坏记录的长度会落在新记录中间 */
+            if ((*address % W25Q64_SECTOR_SIZE) + sizeof(DataHeader_t) + length <= W25Q64_SECTOR_SIZE) {
+                return true;
+            }
+            return Flash_ProbeRecord(*address, header);
         }
-        g_cache_count = W25Q64_MAX_CACHE_ENTRIES - 1;
-        g_cache_start_id = g_cache_entries[0].record_id;
     }
     
-    /* 添加新条目 */
-    g_cache_entries[g_cache_count].record_id = record_id;
-    g_cache_entries[g_cache_count].flash_address = address;
-    g_cache_entries[g_cache_count].data_length = length;
-    g_cache_count++;
-    
-    if (g_cache_count == 1) {
-        g_cache_start_id = record_id;
-    }
+    return Flash_FindNextRecord(address, header, next_id);
 }
 
 /**
- * @brief 在缓存中查找记录
- * @param record_id 记录ID
- * @param address 输出Flash地址
- * @param length 输出数据长度
- * @return bool 是否找到
+ * @brief 从地址处查找写入位置之前的下一条记录
+ * @param address 输入候选地址，找到时输出记录地址
+ * @param header 输出数据头
+ * @param next_id 紧接的记录ID，0为不检查
+ * @return true: 找到记录
+ * @note 写入中掉电后写入位置跳到下一个扇区（见Flash_RecoverWritePointer），
+ *       找不到记录时从下一个扇区开头继续
  */
-static bool Flash_FindInCache(uint32_t record_id, uint32_t *address, uint32_t *length)
+static bool Flash_TagNextRecord(uint32_t *address, DataHeader_t *header, uint32_t next_id)
 {
-    for (uint32_t i = 0; i < g_cache_count; i++) {
-        if (g_cache_entries[i].record_id == record_id) {
-            *address = g_cache_entries[i].flash_address;
-            *length = g_cache_entries[i].data_length;
+    while (!Flash_TagAtEnd(*address)) {
+        if (Flash_TagReadHeader(address, header, next_id)) {
             return true;
         }
+        
+        uint32_t sector_end = *address - (*address % W25Q64_SECTOR_SIZE) + W25Q64_SECTOR_SIZE;
+        if (sector_end >= Flash_DataSegmentEnd(*address)) {
+            if (*address >= FLASH_EXT_DATA_AREA_START || g_next_write_address < FLASH_EXT_DATA_AREA_START) {
+                return false;
+            }
+            sector_end = FLASH_EXT_DATA_AREA_START;
+        }
+        
+        *address = sector_end;
+        next_id = 0;
     }
+    
     return false;
 }
 
 /**
- * @brief 存储数据到Flash
- * @param data 数据指针
- * @param length 数据长度
- * @param record_id 输出记录ID
- * @return FlashResult_t 操作结果
+ * @brief 上电后重建写入位置所在扇区的标签摘要
+ * @note 从前面最近一个已保存摘要记下的下一条记录地址开始，读取数据头到写入位置，
+ *       途中经过的已写完扇区补写摘要。附近没有摘要（旧版本写入的数据）时当前扇区
+ *       的摘要不完整，查询时照常读取，从下一个扇区开始累积
  */
-FlashResult_t Flash_StoreData(const uint8_t *data, uint32_t length, uint32_t *record_id)
+static void Flash_TagRebuild(void)
 {
-    if (!g_flash_initialized) {
-        return FLASH_ERROR_INIT;
+    FlashTagSummary_t summary;
+    DataHeader_t header;
+    uint32_t write_sector = Flash_TagSector(g_next_write_address);
+    
+    g_tag_open_sector = FLASH_TAG_SECTOR_NONE;
+    g_tag_open_valid = false;
+    g_tag_sealed_sector = FLASH_TAG_SECTOR_NONE;
+    
+    /* 写入位置所在扇区尚未写完，已有摘要说明摘要区是数据区重新开始之前留下的 */
+    if (write_sector < FLASH_TAG_SUMMARY_COUNT &&
+        !Flash_IsBlank(Flash_TagSummaryAddress(write_sector), sizeof(FlashTagSummary_t))) {
+        Log_Warn("Flash: Stale tag summaries, erasing");
+        for (uint32_t offset = 0; offset < W25Q64_TAG_AREA_SIZE; offset += W25Q64_BLOCK_SIZE) {
+            if (Flash_EraseInternal(W25Q64_TAG_AREA_START + offset, W25Q64_BLOCK_SIZE) != FLASH_OK) {
+                Log_Error("Flash: Failed to erase tag summaries");
+                return;
+            }
+        }
     }
     
-    if (data == NULL || length == 0 || record_id == NULL) {
-        return FLASH_ERROR_INVALID_PARAM;
-    }
+    /* 查找前面最近的摘要，靠近数据区开头时从第一条记录开始 */
+    uint32_t first = (write_sector > FLASH_TAG_REBUILD_SECTORS) ? write_sector - FLASH_TAG_REBUILD_SECTORS : 0;
+    uint32_t address = W25Q64_DATA_AREA_START;
+    bool found = (first == 0);
     
-    /* 检查数据区空间 */
-    if (g_next_write_address + W25Q64_DATA_HEADER_SIZE + length > W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE) {
-        Log_Error("Flash: Data area full");
-        return FLASH_ERROR_FULL;
+    for (uint32_t sector = write_sector; sector > first; sector--) {
+        if (Flash_TagLoadSummary(sector - 1, &summary)) {
+            address = summary.next_address;
+            found = true;
+            break;
+        }
     }
     
-    /* 准备数据头 */
-    DataHeader_t header;
-    header.magic = W25Q64_DATA_HEADER_MAGIC;
-    header.record_id = g_next_record_id;
-    header.data_length = length;
-    header.crc16 = Flash_CalculateCRC16(data, length);
-    
-    /* 计算需要擦除的扇区 */
-    uint32_t total_size = sizeof(DataHeader_t) + length;
-    uint32_t sector_size = W25Q64_SECTOR_SIZE;
-    uint32_t sector_address = (g_next_write_address / sector_size) * sector_size;
-    
-    /* 擦除扇区 */
-    if (Flash_EraseInternal(sector_address, sector_size) != FLASH_OK) {
-        Log_Error("Flash: Failed to erase sector before write");
-        return FLASH_ERROR_ERASE;
+    if (!found) {
+        /* 写入位置在扇区开头时，下一条记录就是扇区的第一条 */
+        if (g_next_write_address % W25Q64_SECTOR_SIZE != 0) {
+            g_tag_open_sector = write_sector;
+        }
+        Log_Info("Flash: No tag summary near 0x%08lX", g_next_write_address);
+        return;
     }
     
-    /* 写入数据头 */
-    uint32_t header_address = g_next_write_address;
-    if (Flash_WritePage(header_address, (uint8_t*)&header, sizeof(DataHeader_t)) != FLASH_OK) {
-        Log_Error("Flash: Failed to write data header");
-        return FLASH_ERROR_WRITE;
-    }
+    uint32_t next_id = 0;
+    uint32_t records = 0;
     
-    /* 立即验证数据头写入 */
-    DataHeader_t verify_header;
-    if (Flash_ReadDataInternal(header_address, (uint8_t*)&verify_header, sizeof(DataHeader_t)) != FLASH_OK) {
-        Log_Error("Flash: Failed to read back header for verification");
-        return FLASH_ERROR_READ;
+    while (Flash_TagNextRecord(&address, &header, next_id)) {
+        Flash_TagAddRecord(address, FLASH_RECORD_TAG(header.data_length));
+        
+        /* 经过的扇区已在芯片中 */
+        if (g_tag_sealed_sector != FLASH_TAG_SECTOR_NONE) {
+            Flash_TagWriteSealed();
+        }
+        
+        next_id = header.record_id + 1;
+        address += sizeof(DataHeader_t) + FLASH_RECORD_LENGTH(header.data_length);
+        records++;
     }
     
-    Log_Debug("Flash: Header verify - magic: 0x%04X->0x%04X, ID: %lu->%lu", 
-              header.magic, verify_header.magic, header.record_id, verify_header.record_id);
-    
-    if (verify_header.magic != header.magic || verify_header.record_id != header.record_id) {
-        Log_Error("Flash: Header verification failed - data corruption detected");
-        return FLASH_ERROR_CRC;
+    Log_Debug("Flash: Tag summary rebuilt from %lu records", records);
+}
+
+/**
+ * @brief 初始化按标签查询的游标，从最旧的记录开始
+ */
+void Flash_TagCursorInit(FlashTagCursor_t *cursor)
+{
+    memset(cursor, 0, sizeof(FlashTagCursor_t));
+    cursor->address = W25Q64_DATA_AREA_START;
+    cursor->sector = FLASH_TAG_SECTOR_NONE;
+}
+
+/**
+ * @brief 读取下一条带指定标签的记录
+ * @param tag 标签
+ * @param cursor 游标，由Flash_TagCursorInit初始化，返回后指向下一条记录
+ * @param result 读取结果
+ * @return FlashResult_t FLASH_OK: 找到记录；FLASH_ERROR_NOT_FOUND: 已到最新记录；
+ *         FLASH_ERROR_CRC: 该记录损坏（写入中掉电），可继续调用
+ * @note 进入每个扇区时先查摘要，摘要表明没有该标签时跳到摘要记下的下一条记录；
+ *       没有摘要的扇区（旧版本写入、写完前掉电）逐条读取数据头。
+ *       与其他Flash操作一样在Flash I/O服务任务中调用（FlashIo_Call）
+ */
+FlashResult_t Flash_ReadNextTagged(uint16_t tag, FlashTagCursor_t *cursor, ReadResult_t *result)
+{
+    if (!g_flash_initialized) {
+        return FLASH_ERROR_INIT;
     }
     
-    /* 写入数据 */
-    uint32_t data_address = header_address + sizeof(DataHeader_t);
-    if (Flash_WritePage(data_address, data, length) != FLASH_OK) {
-        Log_Error("Flash: Failed to write data");
-        return FLASH_ERROR_WRITE;
+    if (cursor == NULL || result == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
     }
     
-    /* 立即验证数据写入 */
-    uint8_t *verify_data = (uint8_t*)malloc(length);
-    if (verify_data == NULL) {
-        Log_Error("Flash: Failed to allocate memory for verification");
-        return FLASH_ERROR_MEMORY;
-    }
+    result->valid = false;
+    result->data_length = 0;
     
-    if (Flash_ReadDataInternal(data_address, verify_data, length) != FLASH_OK) {
-        Log_Error("Flash: Failed to read back data for verification");
-        free(verify_data);
-        return FLASH_ERROR_READ;
-    }
+    DataHeader_t header;
+    FlashTagSummary_t summary;
     
-    /* 比较数据 */
-    bool data_match = true;
-    for (uint32_t i = 0; i < length; i++) {
-        if (verify_data[i] != data[i]) {
-            Log_Error("Flash: Data verification failed at byte %lu - written: 0x%02X, read: 0x%02X", 
-                     i, data[i], verify_data[i]);
-            data_match = false;
+    while (!Flash_TagAtEnd(cursor->address)) {
+        uint32_t sector = Flash_TagSector(cursor->address);
+        
+        if (sector != cursor->sector) {
+            cursor->sector = sector;
+            
+            if (sector == g_tag_open_sector) {
+                /* 写入位置所在扇区，其后没有记录 */
+                if (g_tag_open_valid && !Flash_TagMayContain(&g_tag_open, tag)) {
+                    cursor->address = g_next_write_address;
+                    cursor->sectors_skipped++;
+                    break;
+                }
+            } else if (Flash_TagLoadSummary(sector, &summary) && !Flash_TagMayContain(&summary, tag)) {
+                cursor->address = summary.next_address;
+                cursor->next_id = 0;
+                cursor->sectors_skipped++;
+                continue;
+            }
+            cursor->sectors_read++;
+        }
+        
+        if (!Flash_TagNextRecord(&cursor->address, &header, cursor->next_id)) {
             break;
         }
+        
+        uint32_t address = cursor->address;
+        uint32_t data_length = FLASH_RECORD_LENGTH(header.data_length);
+        cursor->address += sizeof(DataHeader_t) + data_length;
+        cursor->next_id = header.record_id + 1;
+        
+        if (FLASH_RECORD_TAG(header.data_length) != tag) {
+            continue;
+        }
+        
+        result->record_id = header.record_id;
+        if (Flash_ReadDataInternal(address + sizeof(DataHeader_t), result->data, data_length) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+        
+        if (Flash_CalculateCRC16(result->data, data_length) != header.crc16) {
+            Log_Error("Flash: CRC mismatch in record %lu", header.record_id);
+            return FLASH_ERROR_CRC;
+        }
+        
+        result->data_length = data_length;
+        result->tag = tag;
+        result->valid = true;
+        return FLASH_OK;
     }
     
-    free(verify_data);
-    
-    if (!data_match) {
-        Log_Error("Flash: Data verification failed - data corruption detected");
-        return FLASH_ERROR_CRC;
-    }
-    
-    Log_Debug("Flash: Write verification successful - %lu bytes verified", length);
-    
-    /* 更新缓存 */
-    Flash_AddToCache(g_next_record_id, header_address, length);
-    
-    /* 更新全局变量 */
-    *record_id = g_next_record_id;
-    g_next_record_id++;
-    g_total_records++;
-    g_next_write_address = data_address + length;
-    
-    /* 对齐到页边界 */
-    if (g_next_write_address % W25Q64_PAGE_SIZE != 0) {
-        g_next_write_address = ((g_next_write_address / W25Q64_PAGE_SIZE) + 1) * W25Q64_PAGE_SIZE;
-    }
-    
-    Log_Info("Flash: Stored ID:%lu, %lu bytes @0x%08X", 
-             *record_id, length, header_address);
-    
-    /* 保存索引表到Flash */
-    if (Flash_SaveIndexTable() != FLASH_OK) {
-        Log_Error("Flash: Failed to save index table");
-        return FLASH_ERROR_WRITE;
-    }
-    
-    return FLASH_OK;
+    return FLASH_ERROR_NOT_FOUND;
 }
 
 /**
@@ -861,29 +2827,31 @@ FlashResult_t Flash_ReadData(uint32_t record_id, ReadResult_t *result)
     }
     
     /* 检查数据长度 */
-    if (header.data_length > sizeof(result->data)) {
+    uint32_t data_length = FLASH_RECORD_LENGTH(header.data_length);
+    if (data_length > sizeof(result->data)) {
         Log_Error("Flash: Data too large for buffer");
         return FLASH_ERROR_INVALID_PARAM;
     }
     
     /* 读取数据 */
     uint32_t data_address = address + sizeof(DataHeader_t);
-    if (Flash_ReadDataInternal(data_address, result->data, header.data_length) != FLASH_OK) {
+    if (Flash_ReadDataInternal(data_address, result->data, data_length) != FLASH_OK) {
         Log_Error("Flash: Failed to read data");
         return FLASH_ERROR_READ;
     }
     
     /* 验证CRC */
-    uint16_t calculated_crc = Flash_CalculateCRC16(result->data, header.data_length);
+    uint16_t calculated_crc = Flash_CalculateCRC16(result->data, data_length);
     if (calculated_crc != header.crc16) {
         Log_Error("Flash: CRC mismatch, expected 0x%04X, got 0x%04X", header.crc16, calculated_crc);
         return FLASH_ERROR_CRC;
     }
     
     result->valid = true;
-    result->data_length = header.data_length;
+    result->data_length = data_length;
+    result->tag = FLASH_RECORD_TAG(header.data_length);
     
-    Log_Info("Flash: Read record %lu, length %lu", record_id, header.data_length);
+    Log_Info("Flash: Read record %lu, length %lu", record_id, data_length);
     
     return FLASH_OK;
 }
@@ -942,6 +2910,7 @@ FlashResult_t Flash_LoadIndexTable(void)
     uint32_t index_address = W25Q64_INDEX_AREA_START;
     uint32_t max_entries = W25Q64_INDEX_AREA_SIZE / W25Q64_INDEX_ENTRY_SIZE;
     uint32_t loaded_count = 0;
+    uint32_t rejected_count = 0;
     
     for (uint32_t i = 0; i < max_entries && loaded_count < W25Q64_MAX_CACHE_ENTRIES; i++) {
         IndexEntry_t entry;
@@ -955,6 +2924,14 @@ FlashResult_t Flash_LoadIndexTable(void)
             break;
         }
         
+        /* 旧布局的数据区更大，超出现在数据区的条目指向其他区域，不加载 */
+        index_address += sizeof(IndexEntry_t);
+        if (entry.data_length == 0 || entry.data_length > FLASH_RECORD_MAX_LENGTH ||
+            !Flash_InDataArea(entry.flash_address, sizeof(DataHeader_t) + entry.data_length)) {
+            rejected_count++;
+            continue;
+        }
+        
         /* 添加到缓存 */
         Flash_AddToCache(entry.record_id, entry.flash_address, entry.data_length);
         loaded_count++;
@@ -963,16 +2940,19 @@ FlashResult_t Flash_LoadIndexTable(void)
         if (entry.record_id >= g_next_record_id) {
             g_next_record_id = entry.record_id + 1;
         }
-        
-        index_address += sizeof(IndexEntry_t);
+    }
+    
+    if (rejected_count > 0) {
+        Log_Warn("Flash: Ignored %lu index entries outside data area", rejected_count);
     }
     
     g_total_records = loaded_count;
     
     /* 验证索引表的完整性 */
     if (loaded_count > 0) {
-        /* 检查记录ID的连续性，如果有缺失则进行修复 */
-        uint32_t expected_id = 1;
+        /* 检查记录ID的连续性，如果有缺失则进行修复；
+         * 索引表只保存最新的W25Q64_MAX_CACHE_ENTRIES条，从第一条的ID开始检查 */
+        uint32_t expected_id = g_cache_entries[0].record_id;
         bool has_gaps = false;
         
         for (uint32_t i = 0; i < g_cache_count; i++) {
@@ -985,6 +2965,11 @@ FlashResult_t Flash_LoadIndexTable(void)
             expected_id++;
         }
         
+        /* 更早的记录仍在数据区中，记录ID从1开始连续 */
+        if (!has_gaps) {
+            g_total_records = g_next_record_id - 1;
+        }
+        
         if (has_gaps) {
             Log_Warn("Flash: Index table has gaps, will scan data area for complete recovery");
             /* 如果发现缺失，重新扫描数据区以确保完整性 */
@@ -1011,14 +2996,9 @@ FlashResult_t Flash_LoadIndexTable(void)
         }
         
         if (last_address > 0) {
-            /* 计算下一个写入地址 */
+            /* 计算下一个写入地址（记录紧密排列） */
             g_next_write_address = last_address + sizeof(DataHeader_t) + last_length;
             
-            /* 对齐到页边界 */
-            if (g_next_write_address % W25Q64_PAGE_SIZE != 0) {
-                g_next_write_address = ((g_next_write_address / W25Q64_PAGE_SIZE) + 1) * W25Q64_PAGE_SIZE;
-            }
-            
             Log_Debug("Flash: Found last record ID: %lu at address 0x%08X, next write address: 0x%08X", 
                      max_record_id, last_address, g_next_write_address);
         }
@@ -1038,32 +3018,39 @@ FlashResult_t Flash_SaveIndexTable(void)
 {
     Log_Info("Flash: Saving index table...");
     
+    g_flash_stats.index_rewrites++;
+    
     /* 擦除索引区 */
     if (Flash_EraseInternal(W25Q64_INDEX_AREA_START, W25Q64_INDEX_AREA_SIZE) != FLASH_OK) {
         Log_Error("Flash: Failed to erase index area");
         return FLASH_ERROR_ERASE;
     }
     
-    /* 写入索引表 */
+    /* 写入索引表，条目凑满一页缓冲后一次写入（条目为18字节，由Flash_Write按页边界拆分） */
     uint32_t index_address = W25Q64_INDEX_AREA_START;
+    IndexEntry_t page[W25Q64_PAGE_SIZE / sizeof(IndexEntry_t)];
+    uint32_t page_count = 0;
     
     for (uint32_t i = 0; i < g_cache_count; i++) {
-        IndexEntry_t entry;
-        entry.magic = W25Q64_INDEX_ENTRY_MAGIC;
-        entry.record_id = g_cache_entries[i].record_id;
-        entry.flash_address = g_cache_entries[i].flash_address;
-        entry.data_length = g_cache_entries[i].data_length;
-        entry.crc16 = 0;  /* 索引条目不需要CRC */
-        entry.reserved = 0;
+        IndexEntry_t *entry = &page[page_count++];
+        entry->magic = W25Q64_INDEX_ENTRY_MAGIC;
+        entry->record_id = g_cache_entries[i].record_id;
+        entry->flash_address = g_cache_entries[i].flash_address;
+        entry->data_length = g_cache_entries[i].data_length;
+        entry->crc16 = 0;  /* 索引条目不需要CRC */
+        entry->reserved = 0;
         
-        if (Flash_WritePage(index_address, (uint8_t*)&entry, sizeof(IndexEntry_t)) != FLASH_OK) {
-            Log_Error("Flash: Failed to write index entry %lu", i);
-            return FLASH_ERROR_WRITE;
+        if (page_count == sizeof(page) / sizeof(page[0]) || i == g_cache_count - 1) {
+            if (Flash_Write(index_address, (uint8_t*)page, page_count * sizeof(IndexEntry_t)) != FLASH_OK) {
+                Log_Error("Flash: Failed to write index entry %lu", i);
+                return FLASH_ERROR_WRITE;
+            }
+            index_address += page_count * sizeof(IndexEntry_t);
+            page_count = 0;
         }
-        
-        index_address += sizeof(IndexEntry_t);
     }
     
+    g_index_dirty = false;
     Log_Info("Flash: Saved %lu index entries", g_cache_count);
     
     return FLASH_OK;
@@ -1083,31 +3070,17 @@ FlashResult_t Flash_ScanDataArea(void)
     g_total_records = 0;
     
     uint32_t address = W25Q64_DATA_AREA_START;
-    uint32_t max_address = W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE;
     uint32_t record_count = 0;
+    uint32_t last_id = 0;
     
-    while (address < max_address) {
-        DataHeader_t header;
-        
-        /* 读取数据头 */
-        if (Flash_ReadDataInternal(address, (uint8_t*)&header, sizeof(DataHeader_t)) != FLASH_OK) {
-            break;
-        }
-        
-        /* 检查是否为有效数据头 */
-        if (header.magic != W25Q64_DATA_HEADER_MAGIC) {
-            break;
-        }
-        
-        /* 验证数据长度合理性 */
-        if (header.data_length > 1024 || header.data_length == 0) {
-            Log_Warn("Flash: Invalid data length %lu at address 0x%08X", header.data_length, address);
-            break;
-        }
-        
+    DataHeader_t header;
+    
+    g_ra_rescan = true;
+    while (Flash_FindNextRecord(&address, &header, last_id + 1)) {
         /* 添加到缓存 */
-        Flash_AddToCache(header.record_id, address, header.data_length);
+        Flash_AddToCache(header.record_id, address, FLASH_RECORD_LENGTH(header.data_length));
         record_count++;
+        last_id = header.record_id;
         
         /* 更新全局变量 */
         if (header.record_id >= g_next_record_id) {
@@ -1115,16 +3088,14 @@ FlashResult_t Flash_ScanDataArea(void)
         }
         
         /* 计算下一个记录地址 */
-        address += sizeof(DataHeader_t) + header.data_length;
-        
-        /* 对齐到页边界 */
-        if (address % W25Q64_PAGE_SIZE != 0) {
-            address = ((address / W25Q64_PAGE_SIZE) + 1) * W25Q64_PAGE_SIZE;
-        }
+        address += sizeof(DataHeader_t) + FLASH_RECORD_LENGTH(header.data_length);
     }
     
+    g_ra_rescan = false;
+    
     g_total_records = record_count;
     g_next_write_address = address;
+    Flash_PublishSnapshot();
     
     Log_Info("Flash: Scanned %lu records, next write address: 0x%08X", record_count, address);
     
@@ -1140,6 +3111,23 @@ static FlashResult_t Flash_ScanDataAreaInternal(void)
     return Flash_ScanDataArea();
 }
 
+/**
+ * @brief 获取下一个写入地址
+ * @param address 输出下一个写入地址
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t Flash_GetNextWriteAddress(uint32_t *address)
+{
+    if (address == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+    
+    FlashSnapshot_t snapshot;
+    Flash_GetSnapshot(&snapshot);
+    *address = snapshot.write_address;
+    return FLASH_OK;
+}
+
 /**
  * @brief 获取存储信息
  * @param used_space 已使用空间
@@ -1157,13 +3145,233 @@ FlashResult_t Flash_GetStorageInfo(uint32_t *used_space, uint32_t *free_space, u
         return FLASH_ERROR_INVALID_PARAM;
     }
     
-    *record_count = g_total_records;
-    *used_space = g_next_write_address - W25Q64_DATA_AREA_START;
-    *free_space = W25Q64_DATA_AREA_SIZE - *used_space;
+    /* 可在任意任务中调用，按快照计算 */
+    FlashSnapshot_t snapshot;
+    Flash_GetSnapshot(&snapshot);
+    
+    *record_count = snapshot.record_count;
+    if (snapshot.write_address >= FLASH_EXT_DATA_AREA_START) {
+        *used_space = W25Q64_DATA_AREA_SIZE + (snapshot.write_address - FLASH_EXT_DATA_AREA_START);
+    } else {
+        *used_space = snapshot.write_address - W25Q64_DATA_AREA_START;
+    }
+    *free_space = Flash_DataAreaSize() - *used_space;
+    
+    return FLASH_OK;
+}
+
+/**
+ * @brief 获取磨损统计块
+ * @return const FlashStats_t* 统计块指针
+ */
+const FlashStats_t* Flash_GetStats(void)
+{
+    return &g_flash_stats;
+}
+
+/**
+ * @brief 分段读取并校验一份统计块
+ * @param address 统计块地址
+ * @return true: CRC正确
+ * @note 读取会更新统计块中的读取计数，不能直接读入统计块校验；
+ *       分段计算CRC，避免再占用一份统计块大小的RAM
+ */
+static bool Flash_CheckStats(uint32_t address)
+{
+    uint8_t chunk[64];
+    uint16_t crc = CRC16_CCITT_INIT;
+    uint16_t stored;
+    
+    for (uint32_t done = 0; done < offsetof(FlashStats_t, crc16); done += sizeof(chunk)) {
+        uint32_t length = offsetof(FlashStats_t, crc16) - done;
+        if (length > sizeof(chunk)) {
+            length = sizeof(chunk);
+        }
+        if (Flash_ReadDataInternal(address + done, chunk, length) != FLASH_OK) {
+            return false;
+        }
+        crc = Crc16Ccitt_Update(crc, chunk, length);
+    }
+    
+    if (Flash_ReadDataInternal(address + offsetof(FlashStats_t, crc16), (uint8_t*)&stored, sizeof(stored)) != FLASH_OK) {
+        return false;
+    }
+    return stored == crc;
+}
+
+/**
+ * @brief 从统计块区加载磨损统计
+ * @return FlashResult_t 操作结果
+ * @note 统计块只从扇区开头（上电后第一次保存、回到区首）或紧接上一份开始写入，
+ *       一份大于一个扇区，每个扇区最多有一份的开头：从每个扇区开头起按统计块
+ *       大小向后查找标志位，只读取约30个数据头，不逐页读取整个统计块区。
+ *       按序号从大到小校验CRC，取第一份有效的统计块；写入中掉电的一份
+ *       CRC错误，回退到上一份。旧版本A/B两份也从扇区开头写入，可以直接加载
+ */
+FlashResult_t Flash_LoadStats(void)
+{
+    uint32_t limit = 0xFFFFFFFF;
+    uint32_t newest = 0;
+    bool found = false;
+    
+    g_stats_saved_tick = osKernelGetTickCount();
+    
+    while (!found) {
+        uint32_t header[2];
+        uint32_t best_offset = 0;
+        uint32_t best_sequence = 0;
+        bool have_best = false;
+        
+        for (uint32_t sector = 0; sector < W25Q64_STATS_AREA_SIZE; sector += W25Q64_SECTOR_SIZE) {
+            for (uint32_t offset = sector; offset + sizeof(FlashStats_t) <= W25Q64_STATS_AREA_SIZE;
+                 offset += FLASH_STATS_RECORD_SIZE) {
+                if (Flash_ReadDataInternal(W25Q64_STATS_AREA_START + offset, (uint8_t*)header, sizeof(header)) != FLASH_OK ||
+                    header[0] != FLASH_STATS_MAGIC) {
+                    break;
+                }
+                if (header[1] < limit && (!have_best || header[1] > best_sequence)) {
+                    best_offset = offset;
+                    best_sequence = header[1];
+                    have_best = true;
+                }
+            }
+        }
+        
+        if (!have_best) {
+            break;
+        }
+        if (best_sequence > newest) {
+            newest = best_sequence;
+        }
+        
+        if (Flash_CheckStats(W25Q64_STATS_AREA_START + best_offset) &&
+            Flash_ReadDataInternal(W25Q64_STATS_AREA_START + best_offset,
+                                   (uint8_t*)&g_flash_stats, sizeof(g_flash_stats)) == FLASH_OK) {
+            /* 最新一份之后可能有写入中掉电的残留，从下一个扇区开始追加 */
+            g_stats_erased_end = (best_offset + FLASH_STATS_RECORD_SIZE + W25Q64_SECTOR_SIZE - 1) /
+                                 W25Q64_SECTOR_SIZE * W25Q64_SECTOR_SIZE;
+            g_stats_next = g_stats_erased_end;
+            /* 跳过损坏的一份用过的序号，新写入的序号唯一 */
+            g_flash_stats.sequence = newest;
+            found = true;
+        } else {
+            limit = best_sequence;
+        }
+    }
+    
+    if (!found) {
+        memset(&g_flash_stats, 0, sizeof(g_flash_stats));
+        g_flash_stats.magic = FLASH_STATS_MAGIC;
+        g_flash_stats.sequence = newest;
+        g_stats_next = 0;
+        g_stats_erased_end = 0;
+        Log_Info("Flash: No stats block, starting fresh");
+        return FLASH_ERROR_NOT_FOUND;
+    }
+    
+    Log_Info("Flash: Stats loaded, seq %lu", g_flash_stats.sequence);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 保存磨损统计到统计块区
+ * @return FlashResult_t 操作结果
+ * @note 追加到上一份之后，只擦除写入位置新进入的扇区（平均每份约1个扇区，
+ *       分布在整个统计块区），上一份在写入过程中掉电时仍然有效。
+ *       失败时同样更新保存时刻，等下一个周期重试，不反复擦除
+ */
+FlashResult_t Flash_SaveStats(void)
+{
+    if (!g_flash_initialized) {
+        return FLASH_ERROR_INIT;
+    }
+    
+    g_stats_saved_tick = osKernelGetTickCount();
+    
+    /* 区尾放不下一份时回到区首，最新一份位于区尾，不会被擦除 */
+    if (g_stats_next + FLASH_STATS_RECORD_SIZE > W25Q64_STATS_AREA_SIZE) {
+        g_stats_next = 0;
+        g_stats_erased_end = 0;
+    }
+    
+    /* 先擦除再计CRC，使保存本身的擦写也计入统计 */
+    while (g_stats_erased_end < g_stats_next + FLASH_STATS_RECORD_SIZE) {
+        if (Flash_EraseInternal(W25Q64_STATS_AREA_START + g_stats_erased_end, W25Q64_SECTOR_SIZE) != FLASH_OK) {
+            Log_Error("Flash: Failed to erase stats sector");
+            return FLASH_ERROR_ERASE;
+        }
+        g_stats_erased_end += W25Q64_SECTOR_SIZE;
+    }
+    
+    uint32_t address = W25Q64_STATS_AREA_START + g_stats_next;
+    
+    /* 写入失败的位置不再使用 */
+    g_stats_next += FLASH_STATS_RECORD_SIZE;
+    
+    g_flash_stats.magic = FLASH_STATS_MAGIC;
+    g_flash_stats.sequence++;
+    g_flash_stats.crc16 = Flash_CalculateCRC16((uint8_t*)&g_flash_stats, offsetof(FlashStats_t, crc16));
     
+    if (Flash_Write(address, (const uint8_t*)&g_flash_stats, sizeof(g_flash_stats)) != FLASH_OK) {
+        Log_Error("Flash: Failed to write stats block");
+        return FLASH_ERROR_WRITE;
+    }
+    
+    Log_Debug("Flash: Stats saved, seq %lu", g_flash_stats.sequence);
     return FLASH_OK;
 }
 
+/**
+ * @brief 读取统计寄存器窗口中的一个寄存器
+ * @param offset 窗口内偏移（0 ~ FLASH_STATS_REG_COUNT-1）
+ * @return uint16_t 寄存器值，32位计数按高字在前拆成两个寄存器
+ * @note ModbusRegs_Read在调度器锁定时调用，不能阻塞
+ *       0-9:擦除扇区/编程次数/编程字节/读取字节/用户字节  10:写放大x100
+ *       11:每用户字节擦除字节数  12-15:校验读/索引重写  16-17:最大擦除次数及扇区号
+ *       18-25/26-33/34-41:编程/擦除/读取延迟直方图
+ */
+uint16_t Flash_GetStatsRegister(uint16_t offset)
+{
+    const FlashStats_t *stats = &g_flash_stats;
+    uint32_t value;
+    
+    if (offset >= FLASH_STATS_REG_COUNT) {
+        return 0;
+    }
+    
+    if (offset >= 18) {
+        uint32_t bucket = (offset - 18) % FLASH_STATS_HIST_BUCKETS;
+        const uint32_t *hist = (offset < 26) ? stats->hist_program :
+                               (offset < 34) ? stats->hist_erase : stats->hist_read;
+        value = hist[bucket];
+        return (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+    }
+    
+    switch (offset) {
+        case 0:  case 1:  value = stats->sector_erases;    break;
+        case 2:  case 3:  value = stats->program_ops;      break;
+        case 4:  case 5:  value = stats->bytes_programmed; break;
+        case 6:  case 7:  value = stats->bytes_read;       break;
+        case 8:  case 9:  value = stats->user_bytes;       break;
+        case 12: case 13: value = stats->verify_reads;     break;
+        case 14: case 15: value = stats->index_rewrites;   break;
+        case 10:
+            value = (stats->user_bytes > 0) ?
+                    (uint32_t)((uint64_t)stats->bytes_programmed * 100 / stats->user_bytes) : 0;
+            return (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+        case 11:
+            value = (stats->user_bytes > 0) ?
+                    (uint32_t)((uint64_t)stats->sector_erases * W25Q64_SECTOR_SIZE / stats->user_bytes) : 0;
+            return (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+        case 16: return stats->max_sector_erases;
+        case 17: return stats->max_sector_index;
+        default: return 0;
+    }
+    
+    /* 偶数偏移为高16位，奇数偏移为低16位 */
+    return (offset & 1) ? (uint16_t)(value & 0xFFFF) : (uint16_t)(value >> 16);
+}
+
 /**
  * @brief 打印状态信息
  */
@@ -1179,12 +3387,30 @@ void Flash_PrintStatus(void)
     
     Log_Info("=== Flash Status ===");
     Log_Info("Initialized: Yes");
+    Log_Info("Chip: 0x%06lX, %lu KB, %u-byte address", g_flash_geometry.jedec_id,
+             g_flash_geometry.total_size / 1024, g_flash_geometry.address_bytes);
     Log_Info("Total records: %lu", record_count);
     Log_Info("Next record ID: %lu", g_next_record_id);
     Log_Info("Next write address: 0x%08X", g_next_write_address);
     Log_Info("Used space: %lu bytes", used_space);
     Log_Info("Free space: %lu bytes", free_space);
     Log_Info("Cache entries: %lu", g_cache_count);
+    Log_Info("Sector erases: %lu (%lu ops)", g_flash_stats.sector_erases, g_flash_stats.erase_ops);
+    Log_Info("Max wear: %u @ sector %u", g_flash_stats.max_sector_erases, g_flash_stats.max_sector_index);
+    Log_Info("Programmed: %lu B in %lu pages", g_flash_stats.bytes_programmed, g_flash_stats.program_ops);
+    Log_Info("Read: %lu B, user: %lu B", g_flash_stats.bytes_read, g_flash_stats.user_bytes);
+    Log_Info("Write amp: %u.%02u", Flash_GetStatsRegister(10) / 100, Flash_GetStatsRegister(10) % 100);
+    Log_Info("Verify reads: %lu, index rewrites: %lu", g_flash_stats.verify_reads, g_flash_stats.index_rewrites);
+    uint32_t accesses = g_page_cache_stats.hits + g_page_cache_stats.misses;
+    Log_Info("Page cache: %lu/%lu hits (%lu%%)", g_page_cache_stats.hits, accesses,
+             accesses ? g_page_cache_stats.hits * 100 / accesses : 0);
+    Log_Info("SPI bytes: %lu, uncached %lu", g_page_cache_stats.spi_bytes, g_page_cache_stats.uncached_spi_bytes);
+    Log_Info("Read-ahead: %lu bursts, %lu B served", g_page_cache_stats.readahead_bursts,
+             g_page_cache_stats.readahead_bytes);
+    uint32_t programs_x100 = g_stage_stats.records ? g_stage_stats.page_programs * 100 / g_stage_stats.records : 0;
+    Log_Info("Staged: %lu rec, %lu.%02lu programs/rec", g_stage_stats.records,
+             programs_x100 / 100, programs_x100 % 100);
+    Log_Info("Tag summaries: %lu", g_stage_stats.tag_summaries);
     Log_Info("==================");
 }
 
@@ -1221,27 +3447,38 @@ void Flash_TaskInit(void)
 
 /**
  * @brief Flash任务处理
+ * @note 由Flash I/O服务任务周期调用，不阻塞
  */
 void Flash_TaskProcess(void)
 {
-    static uint32_t task_counter = 0;
     static uint32_t last_status_time = 0;
     
-    task_counter++;
-    
     /* 每10秒打印一次状态 */
-    if (task_counter % 10000 == 0) {
-        uint32_t current_time = osKernelGetTickCount();
-        if (current_time - last_status_time >= 10000) {
-            Flash_PrintStatus();
-            last_status_time = current_time;
+    uint32_t current_time = osKernelGetTickCount();
+    if (current_time - last_status_time >= 10000) {
+        Flash_PrintStatus();
+        last_status_time = current_time;
+    }
+    
+    /* 空闲时结束预读，释放片选 */
+    Flash_ReadAheadSettle();
+    
+    /* 暂存记录到期后提交，失败时等下一个周期重试 */
+    if (g_index_dirty && osKernelGetTickCount() - g_index_dirty_tick >= g_stage_flush_ms) {
+        g_stage_stats.deadline_flushes++;
+        if (Flash_StageCommit() != FLASH_OK) {
+            Log_Error("Flash: Deadline flush failed");
+            g_index_dirty_tick = osKernelGetTickCount();
         }
     }
     
+    /* 定期保存磨损统计 */
+    if (osKernelGetTickCount() - g_stats_saved_tick >= FLASH_STATS_SAVE_INTERVAL_MS) {
+        Flash_SaveStats();
+    }
+    
     /* 这里可以添加其他Flash任务处理逻辑 */
     /* 例如：定期保存索引表、清理过期数据等 */
-    
-    osDelay(1);
 }
 
 /**
@@ -1268,7 +3505,7 @@ static FlashResult_t Flash_ResetSPI(void)
     osDelay(10);
     
     /* 等待Flash就绪 */
-    if (Flash_WaitForReady() != FLASH_OK) {
+    if (Flash_WaitForReady(FLASH_OP_NONE) != FLASH_OK) {
         Log_Error("Flash: Flash not ready after reset");
         return FLASH_ERROR_READ;
     }
@@ -1300,7 +3537,7 @@ static FlashResult_t Flash_RecoverFromError(void)
         return result;
     }
     
-    if (jedec_id != 0xEF4017) {
+    if (jedec_id != g_flash_geometry.jedec_id) {
         Log_Error("Flash: Invalid JEDEC ID during recovery, got 0x%08X", jedec_id);
         return FLASH_ERROR_INIT;
     }
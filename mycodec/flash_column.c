@@ -0,0 +1,702 @@
+#include "flash_column.h"
+#include "log.h"
+#include <string.h>
+#include <stddef.h>
+
+#if FLASH_COLUMN_STORE_ENABLE
+
+#define FLASH_COLUMN_FLAGS_FIELD     0xFF                  /* flags列的字段下标 */
+
+/* 当前记录格式的列布局 */
+static FlashColumnDesc_t g_columns[FLASH_COLUMN_MAX_COLUMNS];
+static uint8_t g_column_record_offset[FLASH_COLUMN_MAX_COLUMNS];  /* 列在编码记录中的偏移 */
+static uint8_t g_column_count = 0;
+static uint8_t g_field_column[RECORD_FIELD_COUNT];                /* 字段所在列 */
+static uint8_t g_field_bit[RECORD_FIELD_COUNT];                   /* 标志字段在flags中的位 */
+
+/* 运行状态 */
+static bool g_column_ready = false;
+static uint32_t g_first_sample = 0;         /* 最旧的可用样本序号 */
+static uint32_t g_next_sample = 0;          /* 下一个样本序号 */
+static uint8_t g_pending[FLASH_COLUMN_CHUNK_SAMPLES][RECORD_ENCODED_SIZE];  /* 尚未写入的样本 */
+static uint32_t g_pending_count = 0;
+static FlashColumnStats_t g_column_stats;
+
+/**
+ * @brief 块序号对应的扇区地址
+ */
+static uint32_t FlashColumn_BlockAddress(uint32_t sequence)
+{
+    return W25Q64_COLUMN_AREA_START + (sequence % FLASH_COLUMN_SECTOR_COUNT) * W25Q64_SECTOR_SIZE;
+}
+
+/**
+ * @brief 查询读取，计入统计
+ */
+static FlashResult_t FlashColumn_Read(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    g_column_stats.read_ops++;
+    g_column_stats.bytes_read += length;
+    return Flash_ReadNoCache(address, buffer, length);
+}
+
+/**
+ * @brief 按记录格式的字段表生成列布局
+ * @return true: 成功, false: 列数超过FLASH_COLUMN_MAX_COLUMNS
+ */
+static bool FlashColumn_BuildLayout(void)
+{
+    uint32_t offset = FLASH_COLUMN_DIR_SIZE;
+    uint32_t record_offset = 1;
+    uint32_t bit = 0;
+
+    g_column_count = 0;
+
+    for (uint32_t i = 0; i < RECORD_FIELD_COUNT; i++) {
+        const RecordFieldDesc_t *field = RecordCodec_GetField(i);
+
+        if (field->kind == RECORD_FIELD_FLAG) {
+            g_field_bit[i] = bit++;
+            continue;
+        }
+
+        if (g_column_count >= FLASH_COLUMN_MAX_COLUMNS - 1) {
+            return false;
+        }
+
+        FlashColumnDesc_t *column = &g_columns[g_column_count];
+        column->offset = offset;
+        column->width = field->width;
+        column->field = i;
+        g_column_record_offset[g_column_count] = record_offset;
+        g_field_column[i] = g_column_count;
+        g_field_bit[i] = 0;
+
+        offset += field->width * FLASH_COLUMN_BLOCK_SAMPLES;
+        record_offset += field->width;
+        g_column_count++;
+    }
+
+    /* flags列放在最后，最后写入 */
+    FlashColumnDesc_t *flags = &g_columns[g_column_count];
+    flags->offset = offset;
+    flags->width = 1;
+    flags->field = FLASH_COLUMN_FLAGS_FIELD;
+    g_column_record_offset[g_column_count] = record_offset;
+
+    for (uint32_t i = 0; i < RECORD_FIELD_COUNT; i++) {
+        if (RecordCodec_GetField(i)->kind == RECORD_FIELD_FLAG) {
+            g_field_column[i] = g_column_count;
+        }
+    }
+    g_column_count++;
+
+    return true;
+}
+
+/**
+ * @brief 读取并校验块目录
+ * @param sequence 块序号
+ * @param block 输出块目录
+ * @return true: 块有效且列布局与当前格式一致
+ */
+static bool FlashColumn_ReadBlock(uint32_t sequence, FlashColumnBlock_t *block)
+{
+    if (FlashColumn_Read(FlashColumn_BlockAddress(sequence), (uint8_t*)block, sizeof(FlashColumnBlock_t)) != FLASH_OK) {
+        return false;
+    }
+
+    return block->magic == FLASH_COLUMN_MAGIC &&
+           block->sequence == sequence &&
+           block->crc16 == Flash_CalculateCRC16((const uint8_t*)block, offsetof(FlashColumnBlock_t, crc16)) &&
+           block->schema_version == RECORD_SCHEMA_VERSION &&
+           block->samples == FLASH_COLUMN_BLOCK_SAMPLES &&
+           block->column_count == g_column_count &&
+           memcmp(block->columns, g_columns, g_column_count * sizeof(FlashColumnDesc_t)) == 0;
+}
+
+/**
+ * @brief 块中已写入芯片的样本序号上限
+ */
+static uint32_t FlashColumn_BlockEnd(uint32_t sequence, const FlashColumnBlock_t *block)
+{
+    uint32_t end = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+    uint32_t flushed = g_next_sample - g_pending_count;
+
+    if (block->sealed_samples != FLASH_COLUMN_NOT_SEALED) {
+        end = sequence * FLASH_COLUMN_BLOCK_SAMPLES + block->sealed_samples;
+    }
+    return end < flushed ? end : flushed;
+}
+
+/**
+ * @brief 开始新块：擦除扇区并写入块目录
+ */
+static FlashResult_t FlashColumn_OpenBlock(uint32_t sequence)
+{
+    uint32_t address = FlashColumn_BlockAddress(sequence);
+    FlashColumnBlock_t block;
+
+    if (Flash_EraseSector(address) != FLASH_OK) {
+        Log_Error("FlashColumn: Erase failed @0x%08lX", address);
+        return FLASH_ERROR_ERASE;
+    }
+
+    memset(&block, 0xFF, sizeof(block));
+    block.magic = FLASH_COLUMN_MAGIC;
+    block.sequence = sequence;
+    block.samples = FLASH_COLUMN_BLOCK_SAMPLES;
+    block.schema_version = RECORD_SCHEMA_VERSION;
+    block.column_count = g_column_count;
+    memcpy(block.columns, g_columns, g_column_count * sizeof(FlashColumnDesc_t));
+    block.crc16 = Flash_CalculateCRC16((const uint8_t*)&block, offsetof(FlashColumnBlock_t, crc16));
+
+    if (Flash_Write(address, (const uint8_t*)&block, sizeof(block)) != FLASH_OK) {
+        Log_Error("FlashColumn: Directory write failed");
+        return FLASH_ERROR_WRITE;
+    }
+
+    /* 覆盖了最旧的块 */
+    if (sequence >= FLASH_COLUMN_SECTOR_COUNT) {
+        uint32_t oldest = (sequence - FLASH_COLUMN_SECTOR_COUNT + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        if (g_first_sample < oldest) {
+            g_first_sample = oldest;
+        }
+    }
+
+    g_column_stats.blocks++;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 检查块中某列从index起的count个值是否未写入
+ */
+static bool FlashColumn_IsBlank(uint32_t address, const FlashColumnDesc_t *column, uint32_t index, uint32_t count)
+{
+    uint8_t buffer[64];
+    uint32_t offset = column->offset + index * column->width;
+    uint32_t length = count * column->width;
+
+    while (length > 0) {
+        uint32_t chunk = length > sizeof(buffer) ? sizeof(buffer) : length;
+
+        if (Flash_ReadNoCache(address + offset, buffer, chunk) != FLASH_OK) {
+            return false;
+        }
+        for (uint32_t i = 0; i < chunk; i++) {
+            if (buffer[i] != 0xFF) {
+                return false;
+            }
+        }
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+/**
+ * @brief 上电后恢复最新块的写入位置
+ * @note flags列中最高位为0的字节数即已写入的样本数；其后若有列不是空白
+ *       （按列写入中途掉电），封存该块，从下一块继续
+ */
+static FlashResult_t FlashColumn_RecoverBlock(uint32_t sequence, const FlashColumnBlock_t *block)
+{
+    uint32_t address = FlashColumn_BlockAddress(sequence);
+    const FlashColumnDesc_t *flags = &g_columns[g_column_count - 1];
+    uint8_t buffer[64];
+    uint32_t count = 0;
+
+    if (block->sealed_samples != FLASH_COLUMN_NOT_SEALED) {
+        g_next_sample = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        return FLASH_OK;
+    }
+
+    /* 统计已写入的样本 */
+    while (count < FLASH_COLUMN_BLOCK_SAMPLES) {
+        uint32_t chunk = FLASH_COLUMN_BLOCK_SAMPLES - count;
+        if (chunk > sizeof(buffer)) {
+            chunk = sizeof(buffer);
+        }
+        if (Flash_ReadNoCache(address + flags->offset + count, buffer, chunk) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+
+        uint32_t i = 0;
+        while (i < chunk && !(buffer[i] & FLASH_COLUMN_PRESENT_MASK)) {
+            i++;
+        }
+        count += i;
+        if (i < chunk) {
+            break;
+        }
+    }
+
+    if (count == FLASH_COLUMN_BLOCK_SAMPLES) {
+        g_next_sample = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        return FLASH_OK;
+    }
+
+    /* 之后一个缓存批次的位置必须仍为空白 */
+    uint32_t check = FLASH_COLUMN_BLOCK_SAMPLES - count;
+    if (check > FLASH_COLUMN_CHUNK_SAMPLES) {
+        check = FLASH_COLUMN_CHUNK_SAMPLES;
+    }
+
+    for (uint32_t c = 0; c < g_column_count; c++) {
+        if (!FlashColumn_IsBlank(address, &g_columns[c], count, check)) {
+            uint16_t sealed = count;
+            Log_Warn("FlashColumn: Torn block %lu, sealed at %lu", sequence, count);
+            if (Flash_Write(address + offsetof(FlashColumnBlock_t, sealed_samples),
+                            (const uint8_t*)&sealed, sizeof(sealed)) != FLASH_OK) {
+                return FLASH_ERROR_WRITE;
+            }
+            g_next_sample = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+            return FLASH_OK;
+        }
+    }
+
+    g_next_sample = sequence * FLASH_COLUMN_BLOCK_SAMPLES + count;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 初始化列存储，查找最新块并恢复写入位置
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t FlashColumn_Init(void)
+{
+    FlashColumnBlock_t block;
+    FlashColumnBlock_t newest_block;
+    uint32_t newest = 0;
+    bool found = false;
+
+    g_column_ready = false;
+    g_first_sample = 0;
+    g_next_sample = 0;
+    g_pending_count = 0;
+    memset(&g_column_stats, 0, sizeof(g_column_stats));
+
+    if (!FlashColumn_BuildLayout()) {
+        Log_Error("FlashColumn: Too many columns");
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    for (uint32_t sector = 0; sector < FLASH_COLUMN_SECTOR_COUNT; sector++) {
+        uint32_t address = W25Q64_COLUMN_AREA_START + sector * W25Q64_SECTOR_SIZE;
+
+        if (Flash_ReadNoCache(address, (uint8_t*)&block, sizeof(block)) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+
+        if (block.magic != FLASH_COLUMN_MAGIC ||
+            block.sequence % FLASH_COLUMN_SECTOR_COUNT != sector ||
+            block.crc16 != Flash_CalculateCRC16((const uint8_t*)&block, offsetof(FlashColumnBlock_t, crc16))) {
+            continue;
+        }
+
+        if (!found || block.sequence > newest) {
+            newest = block.sequence;
+            newest_block = block;
+            found = true;
+        }
+    }
+
+    if (found) {
+        if (newest >= FLASH_COLUMN_SECTOR_COUNT) {
+            g_first_sample = (newest - FLASH_COLUMN_SECTOR_COUNT + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        }
+
+        if (newest_block.schema_version != RECORD_SCHEMA_VERSION ||
+            newest_block.column_count != g_column_count ||
+            memcmp(newest_block.columns, g_columns, g_column_count * sizeof(FlashColumnDesc_t)) != 0) {
+            /* 记录格式已变化，从下一块开始使用新布局 */
+            g_next_sample = (newest + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        } else {
+            FlashResult_t result = FlashColumn_RecoverBlock(newest, &newest_block);
+            if (result != FLASH_OK) {
+                return result;
+            }
+        }
+    }
+
+    g_column_ready = true;
+    Log_Info("FlashColumn: %lu samples/block, next %lu",
+             (uint32_t)FLASH_COLUMN_BLOCK_SAMPLES, g_next_sample);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 追加一个样本
+ * @param record RecordCodec_EncodeSensorData编码的记录
+ * @param length 记录长度
+ * @return FlashResult_t 操作结果
+ * @note 样本先缓存在RAM中，攒满FLASH_COLUMN_CHUNK_SAMPLES个或写满一块时按列写入
+ */
+FlashResult_t FlashColumn_Append(const uint8_t *record, uint32_t length)
+{
+    if (!g_column_ready) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (record == NULL || length != RECORD_ENCODED_SIZE || record[0] != RECORD_SCHEMA_VERSION) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(g_pending[g_pending_count++], record, RECORD_ENCODED_SIZE);
+    g_next_sample++;
+    g_column_stats.samples++;
+
+    if (g_pending_count == FLASH_COLUMN_CHUNK_SAMPLES || g_next_sample % FLASH_COLUMN_BLOCK_SAMPLES == 0) {
+        return FlashColumn_Flush();
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 把RAM中缓存的样本按列写入芯片
+ * @return FlashResult_t 操作结果
+ * @note 每列一次写入，flags列最后写入，写入后样本才计入块中
+ */
+FlashResult_t FlashColumn_Flush(void)
+{
+    if (!g_column_ready) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (g_pending_count == 0) {
+        return FLASH_OK;
+    }
+
+    uint32_t first = g_next_sample - g_pending_count;
+    uint32_t sequence = first / FLASH_COLUMN_BLOCK_SAMPLES;
+    uint32_t index = first % FLASH_COLUMN_BLOCK_SAMPLES;
+    uint32_t address = FlashColumn_BlockAddress(sequence);
+    uint8_t values[FLASH_COLUMN_CHUNK_SAMPLES * 4];
+
+    if (index == 0) {
+        FlashResult_t result = FlashColumn_OpenBlock(sequence);
+        if (result != FLASH_OK) {
+            return result;
+        }
+    }
+
+    for (uint32_t c = 0; c < g_column_count; c++) {
+        const FlashColumnDesc_t *column = &g_columns[c];
+        uint32_t width = column->width;
+
+        for (uint32_t i = 0; i < g_pending_count; i++) {
+            memcpy(&values[i * width], &g_pending[i][g_column_record_offset[c]], width);
+        }
+
+        if (Flash_Write(address + column->offset + index * width, values, g_pending_count * width) != FLASH_OK) {
+            Log_Error("FlashColumn: Column %lu write failed", c);
+            return FLASH_ERROR_WRITE;
+        }
+    }
+
+    g_pending_count = 0;
+    g_column_stats.flushes++;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 从列值或编码记录中取出字段值
+ */
+static double FlashColumn_FieldValue(uint32_t field, const uint8_t *raw)
+{
+    const RecordFieldDesc_t *desc = RecordCodec_GetField(field);
+
+    if (desc->kind == RECORD_FIELD_FLAG) {
+        return RecordCodec_FieldValue(field, (*raw >> g_field_bit[field]) & 1);
+    }
+    return RecordCodec_FieldValue(field, RecordCodec_GetLE(raw, desc->width));
+}
+
+/**
+ * @brief 把查询范围限制在可用样本内
+ */
+static void FlashColumn_ClampRange(uint32_t first, uint32_t count, uint32_t *start, uint32_t *end)
+{
+    *start = first > g_first_sample ? first : g_first_sample;
+    *end = (count > g_next_sample - *start) ? g_next_sample : *start + count;
+    if (*start > *end) {
+        *start = *end;
+    }
+}
+
+/**
+ * @brief 单字段查询，只读取该字段所在的列
+ * @param field 字段下标（RECORD_FIELD_xxx）
+ * @param first 起始样本序号
+ * @param count 样本数
+ * @param visitor 回调，values只有一个元素
+ * @param context 回调参数
+ * @return FlashResult_t 操作结果
+ * @note 已被覆盖或未写入的样本跳过
+ */
+FlashResult_t FlashColumn_ScanField(uint32_t field, uint32_t first, uint32_t count,
+                                    FlashColumnVisitor_t visitor, void *context)
+{
+    if (!g_column_ready) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (field >= RECORD_FIELD_COUNT || visitor == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    const FlashColumnDesc_t *column = &g_columns[g_field_column[field]];
+    uint32_t record_offset = g_column_record_offset[g_field_column[field]];
+    uint32_t flushed = g_next_sample - g_pending_count;
+    uint32_t start, end;
+    uint8_t buffer[64];
+    double value;
+
+    FlashColumn_ClampRange(first, count, &start, &end);
+
+    uint32_t sample = start;
+    while (sample < end && sample < flushed) {
+        uint32_t sequence = sample / FLASH_COLUMN_BLOCK_SAMPLES;
+        uint32_t next_block = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        FlashColumnBlock_t block;
+
+        if (!FlashColumn_ReadBlock(sequence, &block)) {
+            sample = next_block;
+            continue;
+        }
+
+        uint32_t block_end = FlashColumn_BlockEnd(sequence, &block);
+        if (block_end > end) {
+            block_end = end;
+        }
+
+        uint32_t address = FlashColumn_BlockAddress(sequence) + column->offset;
+        while (sample < block_end) {
+            uint32_t n = block_end - sample;
+            if (n > sizeof(buffer) / column->width) {
+                n = sizeof(buffer) / column->width;
+            }
+
+            uint32_t index = sample % FLASH_COLUMN_BLOCK_SAMPLES;
+            if (FlashColumn_Read(address + index * column->width, buffer, n * column->width) != FLASH_OK) {
+                return FLASH_ERROR_READ;
+            }
+
+            for (uint32_t i = 0; i < n; i++) {
+                value = FlashColumn_FieldValue(field, &buffer[i * column->width]);
+                visitor(sample + i, &value, context);
+            }
+            sample += n;
+        }
+
+        sample = next_block;
+    }
+
+    /* RAM中尚未写入的样本 */
+    for (sample = (start > flushed ? start : flushed); sample < end; sample++) {
+        value = FlashColumn_FieldValue(field, &g_pending[sample - flushed][record_offset]);
+        visitor(sample, &value, context);
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 整行查询，读取所有列后按记录解码
+ * @param first 起始样本序号
+ * @param count 样本数
+ * @param visitor 回调，values有RECORD_FIELD_COUNT个元素
+ * @param context 回调参数
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t FlashColumn_ScanRows(uint32_t first, uint32_t count,
+                                   FlashColumnVisitor_t visitor, void *context)
+{
+    if (!g_column_ready) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (visitor == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t flushed = g_next_sample - g_pending_count;
+    uint32_t start, end;
+    uint8_t rows[FLASH_COLUMN_CHUNK_SAMPLES][RECORD_ENCODED_SIZE];
+    uint8_t buffer[FLASH_COLUMN_CHUNK_SAMPLES * 4];
+    double values[RECORD_FIELD_COUNT];
+
+    FlashColumn_ClampRange(first, count, &start, &end);
+
+    uint32_t sample = start;
+    while (sample < end && sample < flushed) {
+        uint32_t sequence = sample / FLASH_COLUMN_BLOCK_SAMPLES;
+        uint32_t next_block = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        FlashColumnBlock_t block;
+
+        if (!FlashColumn_ReadBlock(sequence, &block)) {
+            sample = next_block;
+            continue;
+        }
+
+        uint32_t block_end = FlashColumn_BlockEnd(sequence, &block);
+        if (block_end > end) {
+            block_end = end;
+        }
+
+        uint32_t address = FlashColumn_BlockAddress(sequence);
+        while (sample < block_end) {
+            uint32_t n = block_end - sample;
+            if (n > FLASH_COLUMN_CHUNK_SAMPLES) {
+                n = FLASH_COLUMN_CHUNK_SAMPLES;
+            }
+
+            uint32_t index = sample % FLASH_COLUMN_BLOCK_SAMPLES;
+            for (uint32_t c = 0; c < g_column_count; c++) {
+                const FlashColumnDesc_t *column = &g_columns[c];
+
+                if (FlashColumn_Read(address + column->offset + index * column->width,
+                                     buffer, n * column->width) != FLASH_OK) {
+                    return FLASH_ERROR_READ;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    memcpy(&rows[i][g_column_record_offset[c]], &buffer[i * column->width], column->width);
+                }
+            }
+
+            for (uint32_t i = 0; i < n; i++) {
+                rows[i][0] = RECORD_SCHEMA_VERSION;
+                if (RecordCodec_DecodeValues(rows[i], RECORD_ENCODED_SIZE, values)) {
+                    visitor(sample + i, values, context);
+                }
+            }
+            sample += n;
+        }
+
+        sample = next_block;
+    }
+
+    /* RAM中尚未写入的样本 */
+    for (sample = (start > flushed ? start : flushed); sample < end; sample++) {
+        if (RecordCodec_DecodeValues(g_pending[sample - flushed], RECORD_ENCODED_SIZE, values)) {
+            visitor(sample, values, context);
+        }
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 获取列描述
+ * @param column 列号，按字段表顺序（标志字段除外），flags列在最后
+ * @return 列不存在或列存储未初始化时返回NULL
+ */
+const FlashColumnDesc_t* FlashColumn_GetColumn(uint32_t column)
+{
+    if (!g_column_ready || column >= g_column_count) {
+        return NULL;
+    }
+    return &g_columns[column];
+}
+
+/**
+ * @brief 读取一列的原始值
+ * @param column 列号
+ * @param first 起始样本序号
+ * @param count 样本数
+ * @param buffer 输出count * width字节，按样本顺序存放列中的原始值（小端）
+ * @return FLASH_ERROR_NOT_FOUND: 范围超出可用样本
+ * @note 每块中的连续部分一次直接读入buffer，不经过中间缓冲区和解码；
+ *       目录无效的块和封存后未写入的样本读为0xFF
+ */
+FlashResult_t FlashColumn_ReadColumn(uint32_t column, uint32_t first, uint32_t count, uint8_t *buffer)
+{
+    if (!g_column_ready) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (column >= g_column_count || buffer == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    if (first < g_first_sample || first > g_next_sample || count > g_next_sample - first) {
+        return FLASH_ERROR_NOT_FOUND;
+    }
+
+    const FlashColumnDesc_t *desc = &g_columns[column];
+    uint32_t width = desc->width;
+    uint32_t flushed = g_next_sample - g_pending_count;
+    uint32_t end = first + count;
+    uint32_t sample = first;
+
+    while (sample < end && sample < flushed) {
+        uint32_t sequence = sample / FLASH_COLUMN_BLOCK_SAMPLES;
+        uint32_t segment_end = (sequence + 1) * FLASH_COLUMN_BLOCK_SAMPLES;
+        uint32_t written_end = sample;
+        FlashColumnBlock_t block;
+
+        if (segment_end > end) {
+            segment_end = end;
+        }
+        if (segment_end > flushed) {
+            segment_end = flushed;
+        }
+
+        if (FlashColumn_ReadBlock(sequence, &block)) {
+            written_end = FlashColumn_BlockEnd(sequence, &block);
+            if (written_end > segment_end) {
+                written_end = segment_end;
+            }
+            if (written_end > sample) {
+                uint32_t address = FlashColumn_BlockAddress(sequence) + desc->offset +
+                                   (sample % FLASH_COLUMN_BLOCK_SAMPLES) * width;
+                if (FlashColumn_Read(address, buffer + (sample - first) * width,
+                                     (written_end - sample) * width) != FLASH_OK) {
+                    return FLASH_ERROR_READ;
+                }
+            } else {
+                written_end = sample;
+            }
+        }
+
+        if (written_end < segment_end) {
+            memset(buffer + (written_end - first) * width, 0xFF, (segment_end - written_end) * width);
+        }
+        sample = segment_end;
+    }
+
+    /* RAM中尚未写入的样本 */
+    for (; sample < end; sample++) {
+        memcpy(buffer + (sample - first) * width,
+               &g_pending[sample - flushed][g_column_record_offset[column]], width);
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 获取可用样本范围
+ * @param first 输出最旧样本序号
+ * @param count 输出样本数（含RAM中尚未写入的）
+ */
+void FlashColumn_GetRange(uint32_t *first, uint32_t *count)
+{
+    if (first != NULL) {
+        *first = g_first_sample;
+    }
+    if (count != NULL) {
+        *count = g_next_sample - g_first_sample;
+    }
+}
+
+/**
+ * @brief 获取列存储统计
+ * @return const FlashColumnStats_t* 统计指针
+ */
+const FlashColumnStats_t* FlashColumn_GetStats(void)
+{
+    return &g_column_stats;
+}
+
+#endif /* FLASH_COLUMN_STORE_ENABLE */
@@ -0,0 +1,868 @@
+#include "flash_fs.h"
+#include "log.h"
+#include <string.h>
+#include <stddef.h>
+
+/* 文件表条目中meta_sector的特殊取值 */
+#define FLASH_FS_RESERVED_SECTOR   0xFFFE                /* 新建文件已占用条目但尚未提交 */
+
+/* 每扇区页数 */
+#define FLASH_FS_PAGES_PER_SECTOR  (W25Q64_SECTOR_SIZE / W25Q64_PAGE_SIZE)
+
+/* 文件表条目结构体（仅RAM使用，文件名和扇区表按需从元数据页读取） */
+typedef struct {
+    uint16_t meta_sector;       /* 最新版本元数据扇区 */
+    uint16_t name_hash;         /* 文件名哈希，用于快速比较 */
+    uint32_t revision;          /* 最新版本号 */
+} FlashFsEntry_t;
+
+/* 全局变量 */
+static bool g_fs_mounted = false;
+static FlashFsEntry_t g_fs_files[FLASH_FS_MAX_FILES];
+static uint8_t g_fs_used[FLASH_FS_SECTOR_COUNT / 8];     /* 扇区占用位图 */
+static uint16_t g_fs_alloc_cursor = 0;                   /* 下次分配起始扇区，轮转分配均衡磨损 */
+static uint32_t g_fs_revision = 0;                       /* 已使用的最大版本号 */
+static FlashFsFile_t g_fs_handles[FLASH_FS_MAX_HANDLES];
+static FlashFsHeader_t g_fs_header;                      /* 元数据页读写缓冲 */
+
+/* 私有函数声明 */
+static uint32_t FlashFs_SectorAddress(uint16_t sector);
+static uint16_t FlashFs_NameHash(const char *name);
+static FlashResult_t FlashFs_ReadHeader(uint16_t sector, FlashFsHeader_t *header);
+static int16_t FlashFs_Find(const char *name);
+static bool FlashFs_IsOpen(const char *name);
+static void FlashFs_MarkSector(uint16_t sector, bool used);
+static FlashResult_t FlashFs_AllocSector(uint16_t *sector);
+static void FlashFs_Locate(uint32_t position, uint16_t *logical, uint32_t *offset);
+static uint32_t FlashFs_PagePosition(uint16_t logical, uint16_t page);
+static FlashResult_t FlashFs_FlushPage(FlashFsFile_t *file);
+static FlashResult_t FlashFs_FinishCow(FlashFsFile_t *file);
+static FlashResult_t FlashFs_BeginCow(FlashFsFile_t *file, uint16_t logical);
+static FlashResult_t FlashFs_Commit(FlashFsFile_t *file);
+static void FlashFs_Abort(FlashFsFile_t *file);
+
+/**
+ * @brief 文件区扇区号转换为Flash地址
+ */
+static uint32_t FlashFs_SectorAddress(uint16_t sector)
+{
+    return W25Q64_FS_AREA_START + (uint32_t)sector * W25Q64_SECTOR_SIZE;
+}
+
+/**
+ * @brief 计算文件名哈希（FNV-1a折叠为16位）
+ */
+static uint16_t FlashFs_NameHash(const char *name)
+{
+    uint32_t hash = 2166136261UL;
+
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619UL;
+    }
+
+    return (uint16_t)((hash >> 16) ^ (hash & 0xFFFF));
+}
+
+/**
+ * @brief 读取并校验元数据页
+ * @param sector 文件区扇区号
+ * @param header 输出元数据
+ * @return FlashResult_t 无效时返回FLASH_ERROR_NOT_FOUND或FLASH_ERROR_CRC
+ */
+static FlashResult_t FlashFs_ReadHeader(uint16_t sector, FlashFsHeader_t *header)
+{
+    if (Flash_Read(FlashFs_SectorAddress(sector), (uint8_t*)header, sizeof(FlashFsHeader_t)) != FLASH_OK) {
+        return FLASH_ERROR_READ;
+    }
+
+    if (header->magic != FLASH_FS_HEADER_MAGIC) {
+        return FLASH_ERROR_NOT_FOUND;
+    }
+
+    if (header->crc16 != Flash_CalculateCRC16((uint8_t*)header, offsetof(FlashFsHeader_t, crc16)) ||
+        header->sector_count > FLASH_FS_MAX_DATA_SECTORS ||
+        header->name[FLASH_FS_NAME_LEN - 1] != '\0') {
+        return FLASH_ERROR_CRC;
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 按文件名查找文件表条目
+ * @return int16_t 条目下标，未找到返回-1
+ */
+static int16_t FlashFs_Find(const char *name)
+{
+    uint16_t hash = FlashFs_NameHash(name);
+    char stored_name[FLASH_FS_NAME_LEN];
+
+    for (int16_t i = 0; i < FLASH_FS_MAX_FILES; i++) {
+        if (g_fs_files[i].meta_sector >= FLASH_FS_SECTOR_COUNT || g_fs_files[i].name_hash != hash) {
+            continue;
+        }
+
+        /* 哈希相同再读取文件名确认 */
+        uint32_t address = FlashFs_SectorAddress(g_fs_files[i].meta_sector) + offsetof(FlashFsHeader_t, name);
+        if (Flash_Read(address, (uint8_t*)stored_name, sizeof(stored_name)) == FLASH_OK &&
+            strncmp(stored_name, name, FLASH_FS_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief 检查文件是否已被打开
+ */
+static bool FlashFs_IsOpen(const char *name)
+{
+    for (uint32_t i = 0; i < FLASH_FS_MAX_HANDLES; i++) {
+        if (g_fs_handles[i].in_use && strncmp(g_fs_handles[i].name, name, FLASH_FS_NAME_LEN) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 设置扇区占用状态
+ */
+static void FlashFs_MarkSector(uint16_t sector, bool used)
+{
+    if (sector >= FLASH_FS_SECTOR_COUNT) {
+        return;
+    }
+
+    if (used) {
+        g_fs_used[sector / 8] |= (uint8_t)(1 << (sector % 8));
+    } else {
+        g_fs_used[sector / 8] &= (uint8_t)~(1 << (sector % 8));
+    }
+}
+
+/**
+ * @brief 分配并擦除一个空闲扇区
+ * @param sector 输出扇区号
+ * @return FlashResult_t 操作结果
+ * @note 空闲扇区不保证已擦除，分配时统一擦除
+ */
+static FlashResult_t FlashFs_AllocSector(uint16_t *sector)
+{
+    for (uint32_t n = 0; n < FLASH_FS_SECTOR_COUNT; n++) {
+        uint16_t candidate = (g_fs_alloc_cursor + n) % FLASH_FS_SECTOR_COUNT;
+
+        if (g_fs_used[candidate / 8] & (1 << (candidate % 8))) {
+            continue;
+        }
+
+        FlashFs_MarkSector(candidate, true);
+        g_fs_alloc_cursor = (candidate + 1) % FLASH_FS_SECTOR_COUNT;
+
+        if (Flash_EraseSector(FlashFs_SectorAddress(candidate)) != FLASH_OK) {
+            FlashFs_MarkSector(candidate, false);
+            Log_Error("FS: Erase sector %u failed", candidate);
+            return FLASH_ERROR_ERASE;
+        }
+
+        *sector = candidate;
+        return FLASH_OK;
+    }
+
+    Log_Warn("FS: No free sector");
+    return FLASH_ERROR_FULL;
+}
+
+/**
+ * @brief 文件内位置转换为逻辑扇区和扇区内偏移
+ * @note 逻辑扇区0为元数据扇区，数据从第1页开始
+ */
+static void FlashFs_Locate(uint32_t position, uint16_t *logical, uint32_t *offset)
+{
+    if (position < FLASH_FS_INLINE_SIZE) {
+        *logical = 0;
+        *offset = W25Q64_PAGE_SIZE + position;
+    } else {
+        position -= FLASH_FS_INLINE_SIZE;
+        *logical = 1 + position / W25Q64_SECTOR_SIZE;
+        *offset = position % W25Q64_SECTOR_SIZE;
+    }
+}
+
+/**
+ * @brief 逻辑扇区内某页对应的文件内位置
+ */
+static uint32_t FlashFs_PagePosition(uint16_t logical, uint16_t page)
+{
+    if (logical == 0) {
+        return (uint32_t)(page - 1) * W25Q64_PAGE_SIZE;
+    }
+    return FLASH_FS_INLINE_SIZE + (uint32_t)(logical - 1) * W25Q64_SECTOR_SIZE + (uint32_t)page * W25Q64_PAGE_SIZE;
+}
+
+/**
+ * @brief 将页缓冲写入正在复制的新扇区
+ */
+static FlashResult_t FlashFs_FlushPage(FlashFsFile_t *file)
+{
+    if (file->buffer_page < 0) {
+        return FLASH_OK;
+    }
+
+    uint32_t address = FlashFs_SectorAddress(file->sectors[file->cow_logical]) +
+                       (uint32_t)file->buffer_page * W25Q64_PAGE_SIZE;
+
+    if (Flash_Write(address, file->page_buffer, W25Q64_PAGE_SIZE) != FLASH_OK) {
+        Log_Error("FS: Page program failed");
+        return FLASH_ERROR_WRITE;
+    }
+
+    file->cow_pages |= (uint16_t)(1 << file->buffer_page);
+    file->buffer_page = -1;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 完成当前逻辑扇区的复制
+ * @note 未写过的有效页从源扇区复制，源扇区为本次写入中间结果时立即释放；
+ *       整页复制是流式访问，不经过页缓存
+ */
+static FlashResult_t FlashFs_FinishCow(FlashFsFile_t *file)
+{
+    if (file->cow_logical < 0) {
+        return FLASH_OK;
+    }
+
+    FlashResult_t result = FlashFs_FlushPage(file);
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    uint16_t logical = (uint16_t)file->cow_logical;
+    uint32_t target = FlashFs_SectorAddress(file->sectors[logical]);
+    uint32_t source = FlashFs_SectorAddress(file->cow_source);
+
+    for (uint16_t page = (logical == 0) ? 1 : 0; page < FLASH_FS_PAGES_PER_SECTOR; page++) {
+        if ((file->cow_pages & (1 << page)) ||
+            file->cow_source == FLASH_FS_NO_SECTOR ||
+            FlashFs_PagePosition(logical, page) >= file->size) {
+            continue;
+        }
+
+        uint32_t offset = (uint32_t)page * W25Q64_PAGE_SIZE;
+        if (Flash_ReadNoCache(source + offset, file->page_buffer, W25Q64_PAGE_SIZE) != FLASH_OK ||
+            Flash_Write(target + offset, file->page_buffer, W25Q64_PAGE_SIZE) != FLASH_OK) {
+            Log_Error("FS: Sector copy failed");
+            return FLASH_ERROR_WRITE;
+        }
+    }
+
+    if (file->cow_source_uncommitted) {
+        FlashFs_MarkSector(file->cow_source, false);
+    }
+
+    file->cow_logical = -1;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 开始复制一个逻辑扇区到新分配的扇区
+ */
+static FlashResult_t FlashFs_BeginCow(FlashFsFile_t *file, uint16_t logical)
+{
+    FlashResult_t result = FlashFs_FinishCow(file);
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    uint16_t new_sector;
+    result = FlashFs_AllocSector(&new_sector);
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    /* 已替换过的逻辑扇区，其当前扇区是本次写入分配的，复制完成后可释放 */
+    file->cow_source = file->sectors[logical];
+    file->cow_source_uncommitted = (file->replaced[logical / 8] & (1 << (logical % 8))) != 0;
+    file->replaced[logical / 8] |= (uint8_t)(1 << (logical % 8));
+    file->sectors[logical] = new_sector;
+    file->cow_logical = (int16_t)logical;
+    file->cow_pages = 0;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 提交写句柄：写入新元数据页后清理旧版本
+ */
+static FlashResult_t FlashFs_Commit(FlashFsFile_t *file)
+{
+    FlashResult_t result = FlashFs_FinishCow(file);
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    /* 每个新版本都需要新的元数据扇区 */
+    if (!(file->replaced[0] & 0x01)) {
+        result = FlashFs_BeginCow(file, 0);
+        if (result == FLASH_OK) {
+            result = FlashFs_FinishCow(file);
+        }
+        if (result != FLASH_OK) {
+            return result;
+        }
+    }
+
+    uint16_t sector_count = 0;
+    if (file->size > FLASH_FS_INLINE_SIZE) {
+        sector_count = (file->size - FLASH_FS_INLINE_SIZE + W25Q64_SECTOR_SIZE - 1) / W25Q64_SECTOR_SIZE;
+    }
+
+    memset(&g_fs_header, 0xFF, sizeof(g_fs_header));
+    g_fs_header.magic = FLASH_FS_HEADER_MAGIC;
+    g_fs_header.revision = g_fs_revision + 1;
+    g_fs_header.size = file->size;
+    g_fs_header.sector_count = sector_count;
+    memset(g_fs_header.name, 0, sizeof(g_fs_header.name));
+    strncpy(g_fs_header.name, file->name, FLASH_FS_NAME_LEN - 1);
+    memcpy(g_fs_header.sectors, &file->sectors[1], sector_count * sizeof(uint16_t));
+    g_fs_header.crc16 = Flash_CalculateCRC16((uint8_t*)&g_fs_header, offsetof(FlashFsHeader_t, crc16));
+
+    /* 提交点：元数据页写入并校验通过后新版本生效 */
+    uint16_t meta_sector = file->sectors[0];
+    if (Flash_Write(FlashFs_SectorAddress(meta_sector), (uint8_t*)&g_fs_header, sizeof(g_fs_header)) != FLASH_OK ||
+        FlashFs_ReadHeader(meta_sector, &g_fs_header) != FLASH_OK) {
+        Log_Error("FS: Commit of %s failed", file->name);
+        return FLASH_ERROR_WRITE;
+    }
+    g_fs_revision = g_fs_header.revision;
+
+    /* 清理旧版本：先擦除旧元数据扇区，再释放新版本不再引用的数据扇区 */
+    if (file->old_meta != FLASH_FS_NO_SECTOR) {
+        bool old_valid = (FlashFs_ReadHeader(file->old_meta, &g_fs_header) == FLASH_OK);
+
+        Flash_EraseSector(FlashFs_SectorAddress(file->old_meta));
+        FlashFs_MarkSector(file->old_meta, false);
+
+        for (uint16_t i = 0; old_valid && i < g_fs_header.sector_count; i++) {
+            bool still_used = false;
+            for (uint16_t j = 0; j < sector_count; j++) {
+                if (file->sectors[1 + j] == g_fs_header.sectors[i]) {
+                    still_used = true;
+                    break;
+                }
+            }
+            if (!still_used) {
+                FlashFs_MarkSector(g_fs_header.sectors[i], false);
+            }
+        }
+    }
+
+    FlashFsEntry_t *entry = &g_fs_files[file->file_index];
+    entry->meta_sector = meta_sector;
+    entry->name_hash = FlashFs_NameHash(file->name);
+    entry->revision = g_fs_revision;
+
+    Log_Debug("FS: %s rev %lu, %lu bytes", file->name, g_fs_revision, file->size);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 放弃写句柄，释放本次写入分配的扇区
+ */
+static void FlashFs_Abort(FlashFsFile_t *file)
+{
+    for (uint16_t i = 0; i <= FLASH_FS_MAX_DATA_SECTORS; i++) {
+        if (file->replaced[i / 8] & (1 << (i % 8))) {
+            FlashFs_MarkSector(file->sectors[i], false);
+        }
+    }
+
+    if (file->cow_logical >= 0 && file->cow_source_uncommitted) {
+        FlashFs_MarkSector(file->cow_source, false);
+    }
+
+    if (file->file_index >= 0 && g_fs_files[file->file_index].meta_sector == FLASH_FS_RESERVED_SECTOR) {
+        g_fs_files[file->file_index].meta_sector = FLASH_FS_NO_SECTOR;
+    }
+}
+
+/**
+ * @brief 挂载文件区
+ * @return FlashResult_t 操作结果
+ * @note 扫描所有扇区的元数据页重建文件表和占用位图，同名文件保留版本号最大者
+ */
+FlashResult_t FlashFs_Mount(void)
+{
+    uint32_t magic;
+    char stored_name[FLASH_FS_NAME_LEN];
+    uint32_t file_count = 0;
+
+    memset(g_fs_files, 0xFF, sizeof(g_fs_files));
+    memset(g_fs_used, 0, sizeof(g_fs_used));
+    memset(g_fs_handles, 0, sizeof(g_fs_handles));
+    g_fs_revision = 0;
+    g_fs_mounted = false;
+
+    /* 第一遍：找出每个文件的最新版本 */
+    for (uint16_t sector = 0; sector < FLASH_FS_SECTOR_COUNT; sector++) {
+        /* 探测只读4字节，不经过页缓存以免每个扇区整页读入 */
+        if (Flash_ReadNoCache(FlashFs_SectorAddress(sector), (uint8_t*)&magic, sizeof(magic)) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+        if (magic != FLASH_FS_HEADER_MAGIC || FlashFs_ReadHeader(sector, &g_fs_header) != FLASH_OK) {
+            continue;
+        }
+
+        if (g_fs_header.revision > g_fs_revision) {
+            g_fs_revision = g_fs_header.revision;
+        }
+
+        uint16_t hash = FlashFs_NameHash(g_fs_header.name);
+        int16_t free_index = -1;
+        int16_t same_index = -1;
+
+        for (int16_t i = 0; i < FLASH_FS_MAX_FILES; i++) {
+            if (g_fs_files[i].meta_sector == FLASH_FS_NO_SECTOR) {
+                if (free_index < 0) {
+                    free_index = i;
+                }
+                continue;
+            }
+            if (g_fs_files[i].name_hash != hash) {
+                continue;
+            }
+            uint32_t address = FlashFs_SectorAddress(g_fs_files[i].meta_sector) + offsetof(FlashFsHeader_t, name);
+            if (Flash_Read(address, (uint8_t*)stored_name, sizeof(stored_name)) == FLASH_OK &&
+                strncmp(stored_name, g_fs_header.name, FLASH_FS_NAME_LEN) == 0) {
+                same_index = i;
+                break;
+            }
+        }
+
+        if (same_index >= 0) {
+            /* 提交后清理前掉电留下的旧版本，擦除以免删除新版本后旧版本复活 */
+            FlashFsEntry_t *entry = &g_fs_files[same_index];
+            uint16_t stale = sector;
+            if (g_fs_header.revision > entry->revision) {
+                stale = entry->meta_sector;
+                entry->meta_sector = sector;
+                entry->revision = g_fs_header.revision;
+            }
+            Log_Warn("FS: Dropping stale sector %u", stale);
+            Flash_EraseSector(FlashFs_SectorAddress(stale));
+            continue;
+        }
+
+        if (free_index < 0) {
+            Log_Warn("FS: File table full");
+            continue;
+        }
+
+        g_fs_files[free_index].meta_sector = sector;
+        g_fs_files[free_index].name_hash = hash;
+        g_fs_files[free_index].revision = g_fs_header.revision;
+    }
+
+    /* 第二遍：标记最新版本引用的扇区 */
+    for (int16_t i = 0; i < FLASH_FS_MAX_FILES; i++) {
+        if (g_fs_files[i].meta_sector == FLASH_FS_NO_SECTOR ||
+            FlashFs_ReadHeader(g_fs_files[i].meta_sector, &g_fs_header) != FLASH_OK) {
+            continue;
+        }
+
+        FlashFs_MarkSector(g_fs_files[i].meta_sector, true);
+        for (uint16_t j = 0; j < g_fs_header.sector_count; j++) {
+            FlashFs_MarkSector(g_fs_header.sectors[j], true);
+        }
+        file_count++;
+    }
+
+    g_fs_alloc_cursor = (uint16_t)(g_fs_revision % FLASH_FS_SECTOR_COUNT);
+    g_fs_mounted = true;
+
+    Log_Info("FS: Mounted, %lu files", file_count);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 格式化文件区
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t FlashFs_Format(void)
+{
+    Log_Info("FS: Formatting...");
+
+    for (uint32_t offset = 0; offset < W25Q64_FS_AREA_SIZE; offset += W25Q64_BLOCK_SIZE) {
+        if (Flash_EraseBlock(W25Q64_FS_AREA_START + offset) != FLASH_OK) {
+            Log_Error("FS: Format erase failed");
+            return FLASH_ERROR_ERASE;
+        }
+    }
+
+    return FlashFs_Mount();
+}
+
+/**
+ * @brief 打开文件
+ * @param file 输出文件句柄
+ * @param name 文件名
+ * @param flags 打开方式，FLASH_FS_O_RDONLY或FLASH_FS_O_WRONLY组合其余标志
+ * @return FlashResult_t 操作结果
+ * @note 同一文件同时只能打开一次；写句柄的修改在关闭时才生效
+ */
+FlashResult_t FlashFs_Open(FlashFsFile_t **file, const char *name, uint8_t flags)
+{
+    if (!g_fs_mounted) {
+        return FLASH_ERROR_INIT;
+    }
+
+    bool write_mode = (flags & FLASH_FS_O_WRONLY) != 0;
+    if (file == NULL || name == NULL || name[0] == '\0' || strlen(name) >= FLASH_FS_NAME_LEN ||
+        write_mode == ((flags & FLASH_FS_O_RDONLY) != 0)) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    if (FlashFs_IsOpen(name)) {
+        Log_Warn("FS: %s already open", name);
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    FlashFsFile_t *handle = NULL;
+    for (uint32_t i = 0; i < FLASH_FS_MAX_HANDLES; i++) {
+        if (!g_fs_handles[i].in_use) {
+            handle = &g_fs_handles[i];
+            break;
+        }
+    }
+    if (handle == NULL) {
+        return FLASH_ERROR_MEMORY;
+    }
+
+    int16_t index = FlashFs_Find(name);
+
+    memset(handle, 0, sizeof(FlashFsFile_t));
+    memset(handle->sectors, 0xFF, sizeof(handle->sectors));
+    strncpy(handle->name, name, FLASH_FS_NAME_LEN - 1);
+    handle->flags = flags;
+    handle->file_index = index;
+    handle->old_meta = FLASH_FS_NO_SECTOR;
+    handle->cow_logical = -1;
+    handle->buffer_page = -1;
+
+    if (index >= 0) {
+        uint16_t meta_sector = g_fs_files[index].meta_sector;
+        if (FlashFs_ReadHeader(meta_sector, &g_fs_header) != FLASH_OK) {
+            return FLASH_ERROR_CRC;
+        }
+
+        handle->old_meta = meta_sector;
+        if (!write_mode || !(flags & FLASH_FS_O_TRUNC)) {
+            handle->size = g_fs_header.size;
+            handle->sectors[0] = meta_sector;
+            memcpy(&handle->sectors[1], g_fs_header.sectors, g_fs_header.sector_count * sizeof(uint16_t));
+        }
+    } else {
+        if (!write_mode || !(flags & FLASH_FS_O_CREAT)) {
+            return FLASH_ERROR_NOT_FOUND;
+        }
+
+        /* 新建文件预先占用文件表条目，保证提交时有位置 */
+        for (int16_t i = 0; i < FLASH_FS_MAX_FILES; i++) {
+            if (g_fs_files[i].meta_sector == FLASH_FS_NO_SECTOR) {
+                g_fs_files[i].meta_sector = FLASH_FS_RESERVED_SECTOR;
+                handle->file_index = i;
+                break;
+            }
+        }
+        if (handle->file_index < 0) {
+            Log_Warn("FS: File table full");
+            return FLASH_ERROR_FULL;
+        }
+    }
+
+    if (write_mode && (flags & FLASH_FS_O_APPEND)) {
+        handle->position = handle->size;
+    }
+
+    handle->in_use = true;
+    *file = handle;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 读取文件
+ * @param file 文件句柄（只读）
+ * @param buffer 输出缓冲区
+ * @param length 读取长度
+ * @param read_length 实际读取长度，到达文件末尾时小于length
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t FlashFs_Read(FlashFsFile_t *file, uint8_t *buffer, uint32_t length, uint32_t *read_length)
+{
+    if (file == NULL || !file->in_use || !(file->flags & FLASH_FS_O_RDONLY) ||
+        buffer == NULL || read_length == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t remaining = file->size - file->position;
+    if (length > remaining) {
+        length = remaining;
+    }
+    *read_length = 0;
+
+    while (length > 0) {
+        uint16_t logical;
+        uint32_t offset;
+        FlashFs_Locate(file->position, &logical, &offset);
+
+        uint32_t chunk = W25Q64_SECTOR_SIZE - offset;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        if (file->sectors[logical] >= FLASH_FS_SECTOR_COUNT) {
+            return FLASH_ERROR_CRC;
+        }
+
+        if (Flash_Read(FlashFs_SectorAddress(file->sectors[logical]) + offset, buffer, chunk) != FLASH_OK) {
+            return FLASH_ERROR_READ;
+        }
+
+        buffer += chunk;
+        length -= chunk;
+        file->position += chunk;
+        *read_length += chunk;
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 写入文件
+ * @param file 文件句柄（只写）
+ * @param buffer 数据
+ * @param length 数据长度
+ * @return FlashResult_t 操作结果
+ * @note 写入先进入页缓冲，跨页时编程到新扇区；关闭前其他句柄看到的仍是旧版本
+ */
+FlashResult_t FlashFs_Write(FlashFsFile_t *file, const uint8_t *buffer, uint32_t length)
+{
+    if (file == NULL || !file->in_use || !(file->flags & FLASH_FS_O_WRONLY) || buffer == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    if (file->position + length > FLASH_FS_MAX_FILE_SIZE) {
+        return FLASH_ERROR_FULL;
+    }
+
+    while (length > 0) {
+        uint16_t logical;
+        uint32_t offset;
+        FlashFs_Locate(file->position, &logical, &offset);
+
+        int16_t page = (int16_t)(offset / W25Q64_PAGE_SIZE);
+        uint32_t page_offset = offset % W25Q64_PAGE_SIZE;
+        uint32_t chunk = W25Q64_PAGE_SIZE - page_offset;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        /* 换到其他扇区，或回写已编程的页，都需要新扇区 */
+        FlashResult_t result;
+        if (file->cow_logical != (int16_t)logical || (file->cow_pages & (1 << page))) {
+            result = FlashFs_BeginCow(file, logical);
+            if (result != FLASH_OK) {
+                return result;
+            }
+        }
+
+        if (file->buffer_page != page) {
+            result = FlashFs_FlushPage(file);
+            if (result != FLASH_OK) {
+                return result;
+            }
+
+            if (file->cow_source != FLASH_FS_NO_SECTOR && FlashFs_PagePosition(logical, page) < file->size) {
+                uint32_t address = FlashFs_SectorAddress(file->cow_source) + (uint32_t)page * W25Q64_PAGE_SIZE;
+                if (Flash_ReadNoCache(address, file->page_buffer, W25Q64_PAGE_SIZE) != FLASH_OK) {
+                    return FLASH_ERROR_READ;
+                }
+            } else {
+                memset(file->page_buffer, 0xFF, W25Q64_PAGE_SIZE);
+            }
+            file->buffer_page = page;
+        }
+
+        memcpy(&file->page_buffer[page_offset], buffer, chunk);
+        buffer += chunk;
+        length -= chunk;
+        file->position += chunk;
+        if (file->position > file->size) {
+            file->size = file->position;
+        }
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 设置读写位置
+ * @param file 文件句柄
+ * @param offset 偏移
+ * @param whence FLASH_FS_SEEK_SET/CUR/END
+ * @return FlashResult_t 操作结果，不允许定位到文件末尾之后
+ */
+FlashResult_t FlashFs_Seek(FlashFsFile_t *file, int32_t offset, uint8_t whence)
+{
+    if (file == NULL || !file->in_use) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    int32_t base;
+    switch (whence) {
+        case FLASH_FS_SEEK_SET: base = 0; break;
+        case FLASH_FS_SEEK_CUR: base = (int32_t)file->position; break;
+        case FLASH_FS_SEEK_END: base = (int32_t)file->size; break;
+        default: return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    int32_t position = base + offset;
+    if (position < 0 || (uint32_t)position > file->size) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    file->position = (uint32_t)position;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 关闭文件，写句柄在此提交新版本
+ * @param file 文件句柄
+ * @return FlashResult_t 操作结果，提交失败时保留旧版本
+ */
+FlashResult_t FlashFs_Close(FlashFsFile_t *file)
+{
+    if (file == NULL || !file->in_use) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    FlashResult_t result = FLASH_OK;
+
+    if (file->flags & FLASH_FS_O_WRONLY) {
+        result = FlashFs_Commit(file);
+        if (result != FLASH_OK) {
+            FlashFs_Abort(file);
+        }
+    }
+
+    file->in_use = false;
+    return result;
+}
+
+/**
+ * @brief 删除文件
+ * @param name 文件名
+ * @return FlashResult_t 操作结果
+ * @note 擦除元数据扇区即完成删除，数据扇区在下次分配时擦除
+ */
+FlashResult_t FlashFs_Delete(const char *name)
+{
+    if (!g_fs_mounted) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (name == NULL || FlashFs_IsOpen(name)) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    int16_t index = FlashFs_Find(name);
+    if (index < 0) {
+        return FLASH_ERROR_NOT_FOUND;
+    }
+
+    uint16_t meta_sector = g_fs_files[index].meta_sector;
+    bool header_valid = (FlashFs_ReadHeader(meta_sector, &g_fs_header) == FLASH_OK);
+
+    if (Flash_EraseSector(FlashFs_SectorAddress(meta_sector)) != FLASH_OK) {
+        return FLASH_ERROR_ERASE;
+    }
+
+    FlashFs_MarkSector(meta_sector, false);
+    for (uint16_t i = 0; header_valid && i < g_fs_header.sector_count; i++) {
+        FlashFs_MarkSector(g_fs_header.sectors[i], false);
+    }
+    g_fs_files[index].meta_sector = FLASH_FS_NO_SECTOR;
+
+    Log_Debug("FS: Deleted %s", name);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 获取当前读写位置
+ */
+uint32_t FlashFs_Tell(const FlashFsFile_t *file)
+{
+    return (file != NULL) ? file->position : 0;
+}
+
+/**
+ * @brief 获取文件大小（写句柄为包含未提交内容的大小）
+ */
+uint32_t FlashFs_Size(const FlashFsFile_t *file)
+{
+    return (file != NULL) ? file->size : 0;
+}
+
+/**
+ * @brief 获取文件区使用情况
+ * @param file_count 文件数
+ * @param free_sectors 空闲扇区数
+ * @return FlashResult_t 操作结果
+ */
+FlashResult_t FlashFs_GetInfo(uint32_t *file_count, uint32_t *free_sectors)
+{
+    if (!g_fs_mounted) {
+        return FLASH_ERROR_INIT;
+    }
+
+    if (file_count == NULL || free_sectors == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    *file_count = 0;
+    for (uint32_t i = 0; i < FLASH_FS_MAX_FILES; i++) {
+        if (g_fs_files[i].meta_sector < FLASH_FS_SECTOR_COUNT) {
+            (*file_count)++;
+        }
+    }
+
+    *free_sectors = 0;
+    for (uint32_t i = 0; i < FLASH_FS_SECTOR_COUNT; i++) {
+        if (!(g_fs_used[i / 8] & (1 << (i % 8)))) {
+            (*free_sectors)++;
+        }
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 打印文件区状态
+ */
+void FlashFs_PrintStatus(void)
+{
+    uint32_t file_count, free_sectors;
+
+    if (FlashFs_GetInfo(&file_count, &free_sectors) != FLASH_OK) {
+        Log_Info("FS: Not mounted");
+        return;
+    }
+
+    Log_Info("=== FS Status ===");
+    Log_Info("Files: %lu", file_count);
+    Log_Info("Free: %lu of %u sectors", free_sectors, FLASH_FS_SECTOR_COUNT);
+    Log_Info("Revision: %lu", g_fs_revision);
+    Log_Info("=================");
+}
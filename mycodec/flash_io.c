@@ -0,0 +1,517 @@
+#include "flash_io.h"
+#include "flash_fs.h"
+#include "flash_column.h"
+#include "warm_state.h"
+#include "tuning.h"
+#include "bsp_dwt.h"
+#include "log.h"
+#include <string.h>
+
+#define FLASH_IO_CLASS_NONE          FLASH_IO_CLASS_COUNT  /* 当前没有执行请求 */
+
+/* 每个优先级一个先进先出队列 */
+static FlashIoRequest_t *g_io_head[FLASH_IO_CLASS_COUNT];
+static FlashIoRequest_t *g_io_tail[FLASH_IO_CLASS_COUNT];
+static uint32_t g_io_skipped[FLASH_IO_CLASS_COUNT];  /* 有请求等待时被越过的次数 */
+
+/* 服务状态 */
+static osThreadId_t g_io_thread = NULL;
+static volatile bool g_io_ready = false;
+static FlashIoClass_t g_io_current = FLASH_IO_CLASS_NONE;   /* 正在执行的请求优先级 */
+static FlashIoStats_t g_io_stats;
+
+static const char * const g_io_class_names[FLASH_IO_CLASS_COUNT] = {
+    "interactive", "durable", "background"
+};
+
+/**
+ * @brief DWT计数差换算为微秒
+ */
+static uint32_t FlashIo_ElapsedUs(uint32_t start_cycles)
+{
+    return (DWT_GetTick() - start_cycles) / (SystemCoreClock / 1000000);
+}
+
+/**
+ * @brief 按排队时间累计直方图
+ * @note 桶边界与Flash延迟直方图相同：128/512/2048/8192/32768/131072/524288us
+ */
+static void FlashIo_Histogram(uint32_t *hist, uint32_t us)
+{
+    uint32_t bits = 32 - __CLZ(us);
+    uint32_t bucket = (bits > 7) ? (bits - 6) / 2 : 0;
+
+    if (bucket >= FLASH_STATS_HIST_BUCKETS) {
+        bucket = FLASH_STATS_HIST_BUCKETS - 1;
+    }
+    hist[bucket]++;
+}
+
+/**
+ * @brief 从指定优先级队列取出一个请求
+ * @note 调用者持有调度锁
+ */
+static FlashIoRequest_t* FlashIo_PopLocked(FlashIoClass_t io_class)
+{
+    FlashIoRequest_t *request = g_io_head[io_class];
+
+    if (request != NULL) {
+        g_io_head[io_class] = request->next;
+        if (g_io_head[io_class] == NULL) {
+            g_io_tail[io_class] = NULL;
+        }
+        g_io_stats.classes[io_class].depth--;
+    }
+    return request;
+}
+
+/**
+ * @brief 取出下一个要执行的请求
+ * @return FlashIoRequest_t* 没有请求时返回NULL
+ * @note 优先级最高者优先；被连续越过FLASH_IO_STARVATION_LIMIT次的低优先级请求提前执行
+ */
+static FlashIoRequest_t* FlashIo_Dequeue(void)
+{
+    FlashIoRequest_t *request = NULL;
+    uint32_t selected = FLASH_IO_CLASS_NONE;
+    int32_t lock = osKernelLock();
+
+    /* 防饿死：从最低优先级开始找被越过太多次的队列 */
+    for (uint32_t c = FLASH_IO_CLASS_COUNT; c-- > 1; ) {
+        if (g_io_head[c] != NULL && g_io_skipped[c] >= FLASH_IO_STARVATION_LIMIT) {
+            selected = c;
+            g_io_stats.classes[c].promoted++;
+            break;
+        }
+    }
+
+    if (selected == FLASH_IO_CLASS_NONE) {
+        for (uint32_t c = 0; c < FLASH_IO_CLASS_COUNT; c++) {
+            if (g_io_head[c] != NULL) {
+                selected = c;
+                break;
+            }
+        }
+    }
+
+    if (selected != FLASH_IO_CLASS_NONE) {
+        request = FlashIo_PopLocked((FlashIoClass_t)selected);
+        g_io_skipped[selected] = 0;
+
+        /* 比所选优先级低且在等待的队列记一次越过 */
+        for (uint32_t c = selected + 1; c < FLASH_IO_CLASS_COUNT; c++) {
+            if (g_io_head[c] != NULL) {
+                g_io_skipped[c]++;
+            }
+        }
+    }
+
+    osKernelRestoreLock(lock);
+    return request;
+}
+
+/**
+ * @brief 执行请求对应的Flash操作
+ */
+static FlashResult_t FlashIo_Dispatch(FlashIoRequest_t *request)
+{
+    switch (request->op) {
+        case FLASH_IO_OP_READ:
+            return Flash_Read(request->address, request->buffer, request->length);
+
+        case FLASH_IO_OP_READ_NOCACHE:
+            return Flash_ReadNoCache(request->address, request->buffer, request->length);
+
+        case FLASH_IO_OP_WRITE:
+            return Flash_Write(request->address, request->buffer, request->length);
+
+        case FLASH_IO_OP_ERASE_BLOCK:
+            return Flash_EraseBlock(request->address);
+
+        case FLASH_IO_OP_READ_DATA:
+            return Flash_ReadData(request->address, (ReadResult_t*)request->output);
+
+        case FLASH_IO_OP_STORE_DATA:
+            return Flash_StoreTaggedData((uint16_t)request->address, request->buffer, request->length,
+                                         (uint32_t*)request->output);
+
+        case FLASH_IO_OP_CALL:
+            return (request->handler != NULL) ? request->handler(request->output) : FLASH_ERROR_INVALID_PARAM;
+
+        default:
+            return FLASH_ERROR_INVALID_PARAM;
+    }
+}
+
+/**
+ * @brief 执行请求并通知提交任务
+ * @param request 请求
+ * @param preempted 是否在其他请求的芯片操作之间插入执行
+ */
+static void FlashIo_Execute(FlashIoRequest_t *request, bool preempted)
+{
+    FlashIoClassStats_t *stats = &g_io_stats.classes[request->io_class];
+    FlashIoClass_t previous = g_io_current;
+    uint32_t start_cycles = DWT_GetTick();
+    uint32_t wait_us = (start_cycles - request->submit_cycles) / (SystemCoreClock / 1000000);
+
+    g_io_current = request->io_class;
+    request->result = FlashIo_Dispatch(request);
+    g_io_current = previous;
+
+    uint32_t service_us = FlashIo_ElapsedUs(start_cycles);
+    if (service_us > FLASH_IO_HANG_MS * 1000) {
+        Log_Error("Flash IO: Op %d took %lu ms", request->op, service_us / 1000);
+    }
+
+    stats->completed++;
+    if (preempted) {
+        stats->preempted++;
+    }
+    stats->wait_total_us += wait_us;
+    if (wait_us > stats->wait_max_us) {
+        stats->wait_max_us = wait_us;
+    }
+    if (service_us > stats->service_max_us) {
+        stats->service_max_us = service_us;
+    }
+    FlashIo_Histogram(stats->hist_wait, wait_us);
+
+    /* done置位后请求所在的栈可能立即失效，先取出等待任务 */
+    osThreadId_t waiter = request->waiter;
+    request->wait_us = wait_us;
+    request->done = true;
+    if (waiter != NULL) {
+        osThreadFlagsSet(waiter, FLASH_IO_FLAG_DONE);
+    }
+}
+
+/**
+ * @brief 芯片操作边界回调：插入执行等待中的交互读取
+ * @note 由flash.c在每次页编程、擦除完成后调用。只在服务任务执行非交互请求
+ *       （或后台处理）时生效，交互读取看到的是两次芯片操作之间的一致状态
+ */
+static void FlashIo_OpBoundary(void)
+{
+    FlashIoRequest_t *request;
+
+    if (!g_io_ready || osThreadGetId() != g_io_thread || g_io_current == FLASH_IO_INTERACTIVE) {
+        return;
+    }
+
+    g_io_stats.op_boundaries++;
+
+    /* 只执行此刻已排队的请求，读取方连续提交时写入/擦除仍能推进 */
+    for (uint32_t pending = g_io_stats.classes[FLASH_IO_INTERACTIVE].depth; pending > 0; pending--) {
+        int32_t lock = osKernelLock();
+        request = FlashIo_PopLocked(FLASH_IO_INTERACTIVE);
+        osKernelRestoreLock(lock);
+
+        if (request == NULL) {
+            break;
+        }
+        FlashIo_Execute(request, true);
+    }
+}
+
+/**
+ * @brief 擦除等待回调：等待期间响应新提交的交互读取
+ * @param timeout_ms 最长等待时间
+ * @return bool true: 有等待中的交互读取，由flash.c暂停擦除后经FlashIo_OpBoundary执行
+ */
+static bool FlashIo_EraseWait(uint32_t timeout_ms)
+{
+    if (!g_io_ready || osThreadGetId() != g_io_thread || g_io_current == FLASH_IO_INTERACTIVE) {
+        osDelay(timeout_ms);
+        return false;
+    }
+
+    if (g_io_head[FLASH_IO_INTERACTIVE] == NULL) {
+        osThreadFlagsWait(FLASH_IO_FLAG_REQUEST, osFlagsWaitAny, timeout_ms);
+    }
+    return g_io_head[FLASH_IO_INTERACTIVE] != NULL;
+}
+
+/**
+ * @brief 提交请求并等待完成
+ */
+static FlashResult_t FlashIo_Run(FlashIoRequest_t *request)
+{
+    /* 处理函数中再次提交的请求直接执行，不能等待自己 */
+    if (g_io_thread != NULL && osThreadGetId() == g_io_thread) {
+        return FlashIo_Dispatch(request);
+    }
+
+    request->waiter = osThreadGetId();
+    FlashIo_Submit(request);
+
+    while (!request->done) {
+        osThreadFlagsWait(FLASH_IO_FLAG_DONE, osFlagsWaitAny, osWaitForever);
+    }
+    return request->result;
+}
+
+/**
+ * @brief 构造请求并等待完成
+ */
+static FlashResult_t FlashIo_Request(FlashIoOp_t op, FlashIoClass_t io_class, uint32_t address,
+                                     uint8_t *buffer, uint32_t length, void *output)
+{
+    FlashIoRequest_t request;
+
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    request.io_class = io_class;
+    request.address = address;
+    request.buffer = buffer;
+    request.length = length;
+    request.output = output;
+
+    return FlashIo_Run(&request);
+}
+
+/**
+ * @brief 提交请求（不等待）
+ * @param request 请求，完成（done置位）前必须保持有效
+ * @note 可在任意任务中调用；waiter非NULL时完成后向其发送FLASH_IO_FLAG_DONE
+ */
+void FlashIo_Submit(FlashIoRequest_t *request)
+{
+    if (request->io_class >= FLASH_IO_CLASS_COUNT) {
+        request->io_class = FLASH_IO_BACKGROUND;
+    }
+
+    request->next = NULL;
+    request->done = false;
+    request->submit_cycles = DWT_GetTick();
+
+    int32_t lock = osKernelLock();
+    FlashIoClassStats_t *stats = &g_io_stats.classes[request->io_class];
+
+    if (g_io_tail[request->io_class] != NULL) {
+        g_io_tail[request->io_class]->next = request;
+    } else {
+        g_io_head[request->io_class] = request;
+    }
+    g_io_tail[request->io_class] = request;
+
+    stats->depth++;
+    if (stats->depth > stats->max_depth) {
+        stats->max_depth = stats->depth;
+    }
+    osKernelRestoreLock(lock);
+
+    if (g_io_thread != NULL) {
+        osThreadFlagsSet(g_io_thread, FLASH_IO_FLAG_REQUEST);
+    }
+}
+
+/**
+ * @brief 执行一个排队的请求
+ * @return true: 执行了请求, false: 队列为空
+ */
+bool FlashIo_ServiceOnce(void)
+{
+    FlashIoRequest_t *request = FlashIo_Dequeue();
+
+    if (request == NULL) {
+        return false;
+    }
+
+    FlashIo_Execute(request, false);
+    return true;
+}
+
+/**
+ * @brief 启动服务
+ * @note 在服务任务中、Flash初始化完成后调用，之后Flash只能由调用任务访问；
+ *       此前提交的请求保留在队列中
+ */
+void FlashIo_Init(void)
+{
+    g_io_thread = osThreadGetId();
+    g_io_current = FLASH_IO_CLASS_NONE;
+    Flash_SetOpHook(FlashIo_OpBoundary);
+    Flash_SetWaitHook(FlashIo_EraseWait);
+    g_io_ready = true;
+}
+
+/**
+ * @brief 服务是否已启动
+ */
+bool FlashIo_IsReady(void)
+{
+    return g_io_ready;
+}
+
+/**
+ * @brief Flash I/O服务任务
+ * @param argument 未使用
+ * @note Flash初始化中识别芯片后、加载索引表之前加载热启动状态（Modbus初始化等待它），
+ *       初始化完成后挂载文件区、加载运行参数、初始化列存储，然后循环执行请求；
+ *       空闲时或每FLASH_IO_PROCESS_MS执行一次Flash_TaskProcess、WarmState_Process和Tuning_Process
+ */
+void FlashIo_Task(void *argument)
+{
+    uint32_t last_process = 0;
+
+    (void)argument;
+
+    Log_Info("Flash IO: Starting...");
+
+    Flash_SetProbeHook(WarmState_Load);
+    Flash_TaskInit();
+    FlashFs_Mount();
+    Tuning_Load();
+#if FLASH_COLUMN_STORE_ENABLE
+    FlashColumn_Init();
+#endif
+
+    FlashIo_Init();
+    Log_Info("Flash IO: Service ready");
+
+    for (;;) {
+        bool busy = FlashIo_ServiceOnce();
+
+        if (!busy) {
+            osThreadFlagsWait(FLASH_IO_FLAG_REQUEST, osFlagsWaitAny, FLASH_IO_PROCESS_MS);
+        }
+
+        /* 写合并到期提交、统计块和状态快照保存按后台请求处理，期间同样插入交互读取 */
+        if (!busy || osKernelGetTickCount() - last_process >= FLASH_IO_PROCESS_MS) {
+            g_io_current = FLASH_IO_BACKGROUND;
+            Flash_TaskProcess();
+            WarmState_Process();
+            Tuning_Process();
+            g_io_current = FLASH_IO_CLASS_NONE;
+            last_process = osKernelGetTickCount();
+        }
+    }
+}
+
+/**
+ * @brief 读取Flash任意地址数据
+ * @param io_class 优先级，一般为FLASH_IO_INTERACTIVE
+ */
+FlashResult_t FlashIo_Read(FlashIoClass_t io_class, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    return FlashIo_Request(FLASH_IO_OP_READ, io_class, address, buffer, length, NULL);
+}
+
+/**
+ * @brief 读取Flash任意地址数据，不经过页缓存
+ */
+FlashResult_t FlashIo_ReadNoCache(FlashIoClass_t io_class, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    return FlashIo_Request(FLASH_IO_OP_READ_NOCACHE, io_class, address, buffer, length, NULL);
+}
+
+/**
+ * @brief 按记录ID读取数据
+ */
+FlashResult_t FlashIo_ReadData(FlashIoClass_t io_class, uint32_t record_id, ReadResult_t *result)
+{
+    return FlashIo_Request(FLASH_IO_OP_READ_DATA, io_class, record_id, NULL, 0, result);
+}
+
+/**
+ * @brief 写入Flash任意地址数据（持久写入优先级）
+ */
+FlashResult_t FlashIo_Write(uint32_t address, const uint8_t *buffer, uint32_t length)
+{
+    return FlashIo_Request(FLASH_IO_OP_WRITE, FLASH_IO_DURABLE, address, (uint8_t*)buffer, length, NULL);
+}
+
+/**
+ * @brief 擦除64KB块（后台优先级）
+ */
+FlashResult_t FlashIo_EraseBlock(uint32_t address)
+{
+    return FlashIo_Request(FLASH_IO_OP_ERASE_BLOCK, FLASH_IO_BACKGROUND, address, NULL, 0, NULL);
+}
+
+/**
+ * @brief 存储一条记录（持久写入优先级）
+ */
+FlashResult_t FlashIo_StoreData(const uint8_t *data, uint32_t length, uint32_t *record_id)
+{
+    return FlashIo_Request(FLASH_IO_OP_STORE_DATA, FLASH_IO_DURABLE, FLASH_RECORD_TAG_NONE, (uint8_t*)data, length, record_id);
+}
+
+/**
+ * @brief 存储一条带标签的记录（持久写入优先级）
+ */
+FlashResult_t FlashIo_StoreTaggedData(uint16_t tag, const uint8_t *data, uint32_t length, uint32_t *record_id)
+{
+    return FlashIo_Request(FLASH_IO_OP_STORE_DATA, FLASH_IO_DURABLE, tag, (uint8_t*)data, length, record_id);
+}
+
+/**
+ * @brief 在服务任务中执行自定义处理
+ * @param io_class 优先级，FLASH_IO_INTERACTIVE的处理函数只能读取
+ * @param handler 处理函数
+ * @param context 传给处理函数的参数
+ */
+FlashResult_t FlashIo_Call(FlashIoClass_t io_class, FlashIoHandler_t handler, void *context)
+{
+    FlashIoRequest_t request;
+
+    memset(&request, 0, sizeof(request));
+    request.op = FLASH_IO_OP_CALL;
+    request.io_class = io_class;
+    request.handler = handler;
+    request.output = context;
+
+    return FlashIo_Run(&request);
+}
+
+/**
+ * @brief 获取服务统计
+ */
+const FlashIoStats_t* FlashIo_GetStats(void)
+{
+    return &g_io_stats;
+}
+
+/**
+ * @brief 清零服务统计（保留当前排队数）
+ */
+void FlashIo_ResetStats(void)
+{
+    int32_t lock = osKernelLock();
+
+    for (uint32_t c = 0; c < FLASH_IO_CLASS_COUNT; c++) {
+        uint32_t depth = g_io_stats.classes[c].depth;
+
+        memset(&g_io_stats.classes[c], 0, sizeof(FlashIoClassStats_t));
+        g_io_stats.classes[c].depth = depth;
+        g_io_stats.classes[c].max_depth = depth;
+    }
+    g_io_stats.op_boundaries = 0;
+
+    osKernelRestoreLock(lock);
+}
+
+/**
+ * @brief 打印服务统计
+ */
+void FlashIo_PrintStats(void)
+{
+    Log_Info("=== Flash IO Status ===");
+
+    for (uint32_t c = 0; c < FLASH_IO_CLASS_COUNT; c++) {
+        const FlashIoClassStats_t *stats = &g_io_stats.classes[c];
+        uint32_t avg_us = stats->completed ? (uint32_t)(stats->wait_total_us / stats->completed) : 0;
+
+        Log_Info("%s: %lu done, %lu pre, %lu promoted", g_io_class_names[c],
+                 stats->completed, stats->preempted, stats->promoted);
+        Log_Info("  wait avg %lu max %lu us, depth %lu",
+                 avg_us, stats->wait_max_us, stats->max_depth);
+        Log_Info("  service max %lu us", stats->service_max_us);
+    }
+    Log_Info("Op boundaries: %lu", g_io_stats.op_boundaries);
+
+    const FlashSuspendStats_t *suspend = Flash_GetSuspendStats();
+    Log_Info("Erase suspends: %lu, %lu ms total, max %lu ms",
+             suspend->suspends, suspend->suspended_ms, suspend->max_suspend_ms);
+}
@@ -0,0 +1,832 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    flash_test.c
+  * @brief   This file provides test code for the W25Q64 flash driver.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash.h"
+#include "flash_fs.h"
+#include "record_codec.h"
+#include "flash_column.h"
+#include "flash_io.h"
+#include "warm_state.h"
+#include "bsp_dwt.h"
+#include "log.h"
+
+/* USER CODE BEGIN Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* USER CODE END Includes */
+
+/* Private typedef -----------------------------------------------------------*/
+/* USER CODE BEGIN PTD */
+
+/* USER CODE END PTD */
+
+/* Private define ------------------------------------------------------------*/
+/* USER CODE BEGIN PD */
+
+/* 测试使用数据区最后一个扇区，正常存储很晚才会写到这里 */
+#define FLASH_TEST_SECTOR_ADDR   (W25Q64_DATA_AREA_START + W25Q64_DATA_AREA_SIZE - W25Q64_SECTOR_SIZE)
+
+/* 文件系统测试参数 */
+#define FLASH_TEST_FS_FILE_SIZE  (64 * 1024)            /* 顺序读写测试文件大小 */
+#define FLASH_TEST_FS_FILE_COUNT 200                    /* 挂载测试文件数 */
+
+/* Flash I/O服务测试参数 */
+#define FLASH_TEST_IO_READ_SIZE  16                     /* 每次交互读取字节数 */
+#define FLASH_TEST_SUSPEND_ERASES 4                     /* 快照读取测试的后台擦除次数 */
+
+/* 标签查询测试使用的标签，正常记录不使用 */
+#define FLASH_TEST_TAG           0x7E57
+
+/* USER CODE END PD */
+
+/* Private macro -------------------------------------------------------------*/
+/* USER CODE BEGIN PM */
+
+/* USER CODE END PM */
+
+/* Private variables ---------------------------------------------------------*/
+/* USER CODE BEGIN PV */
+
+static uint8_t test_page[W25Q64_PAGE_SIZE];
+
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+/* USER CODE BEGIN PFP */
+
+/* USER CODE END PFP */
+
+/* Private user code ---------------------------------------------------------*/
+/* USER CODE BEGIN 0 */
+
+/**
+ * @brief DWT周期数转换为微秒
+ */
+static uint32_t FlashTest_CyclesToUs(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+/**
+ * @brief 确认测试扇区未被数据记录占用
+ */
+static bool FlashTest_ScratchSectorFree(void)
+{
+    uint32_t next_address;
+
+    if (Flash_GetNextWriteAddress(&next_address) != FLASH_OK) {
+        return false;
+    }
+
+    return next_address <= FLASH_TEST_SECTOR_ADDR;
+}
+
+/* USER CODE END 0 */
+
+/* Exported functions --------------------------------------------------------*/
+/* USER CODE BEGIN EF */
+
+/**
+ * @brief 顺序页编程吞吐量测试
+ * @note 擦除测试扇区后连续写满16页，统计擦除耗时、单页编程耗时和吞吐量
+ */
+void Flash_ProgramThroughputTest(void)
+{
+    Log_Info("=== Flash Program Throughput Test ===");
+
+    if (!FlashTest_ScratchSectorFree()) {
+        Log_Warn("Scratch sector in use, test skipped");
+        return;
+    }
+
+    DWT_Init();
+
+    for (uint32_t i = 0; i < W25Q64_PAGE_SIZE; i++) {
+        test_page[i] = (uint8_t)i;
+    }
+
+    /* 扇区擦除 */
+    uint32_t start = DWT_GetTick();
+    if (Flash_EraseSector(FLASH_TEST_SECTOR_ADDR) != FLASH_OK) {
+        Log_Error("Erase failed");
+        return;
+    }
+    uint32_t erase_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    /* 顺序页编程 */
+    uint32_t pages = W25Q64_SECTOR_SIZE / W25Q64_PAGE_SIZE;
+    uint32_t max_page_us = 0;
+    start = DWT_GetTick();
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t page_start = DWT_GetTick();
+        if (Flash_Write(FLASH_TEST_SECTOR_ADDR + i * W25Q64_PAGE_SIZE, test_page, W25Q64_PAGE_SIZE) != FLASH_OK) {
+            Log_Error("Program failed at page %lu", i);
+            return;
+        }
+        uint32_t page_us = FlashTest_CyclesToUs(DWT_GetTick() - page_start);
+        if (page_us > max_page_us) {
+            max_page_us = page_us;
+        }
+    }
+    uint32_t program_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    Log_Info("Sector erase: %lu us", erase_us);
+    Log_Info("%lu pages: %lu us, max %lu us", pages, program_us, max_page_us);
+    Log_Info("Avg page: %lu us", program_us / pages);
+    Log_Info("Throughput: %lu KB/s", (W25Q64_SECTOR_SIZE / 1024 * 1000000UL) / (program_us + 1));
+
+    Log_Info("=== Flash Program Throughput Test Completed ===");
+}
+
+/**
+ * @brief 文件系统顺序读写吞吐量和挂载时间测试
+ * @note 需先挂载文件区；测试文件以"bench"开头，结束后全部删除
+ */
+void FlashFs_BenchmarkTest(void)
+{
+    FlashFsFile_t *file;
+    char name[FLASH_FS_NAME_LEN];
+    uint32_t files_before, free_sectors;
+
+    Log_Info("=== Flash FS Benchmark ===");
+
+    if (FlashFs_GetInfo(&files_before, &free_sectors) != FLASH_OK) {
+        Log_Warn("FS not mounted, test skipped");
+        return;
+    }
+
+    if (free_sectors < FLASH_TEST_FS_FILE_COUNT + FLASH_TEST_FS_FILE_SIZE / W25Q64_SECTOR_SIZE + 2) {
+        Log_Warn("FS too full, test skipped");
+        return;
+    }
+
+    DWT_Init();
+
+    for (uint32_t i = 0; i < W25Q64_PAGE_SIZE; i++) {
+        test_page[i] = (uint8_t)(i * 7);
+    }
+
+    /* 顺序写 */
+    uint32_t start = DWT_GetTick();
+    if (FlashFs_Open(&file, "bench.bin", FLASH_FS_O_WRONLY | FLASH_FS_O_CREAT | FLASH_FS_O_TRUNC) != FLASH_OK) {
+        Log_Error("Open for write failed");
+        return;
+    }
+    for (uint32_t written = 0; written < FLASH_TEST_FS_FILE_SIZE; written += W25Q64_PAGE_SIZE) {
+        if (FlashFs_Write(file, test_page, W25Q64_PAGE_SIZE) != FLASH_OK) {
+            Log_Error("Write failed at %lu", written);
+            FlashFs_Close(file);
+            return;
+        }
+    }
+    if (FlashFs_Close(file) != FLASH_OK) {
+        Log_Error("Commit failed");
+        return;
+    }
+    uint32_t write_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    /* 顺序读并校验 */
+    uint32_t errors = 0;
+    uint32_t read_length;
+    start = DWT_GetTick();
+    if (FlashFs_Open(&file, "bench.bin", FLASH_FS_O_RDONLY) != FLASH_OK) {
+        Log_Error("Open for read failed");
+        return;
+    }
+    for (uint32_t total = 0; total < FLASH_TEST_FS_FILE_SIZE; total += read_length) {
+        if (FlashFs_Read(file, test_page, W25Q64_PAGE_SIZE, &read_length) != FLASH_OK || read_length == 0) {
+            errors++;
+            break;
+        }
+        for (uint32_t i = 0; i < read_length; i++) {
+            if (test_page[i] != (uint8_t)(i * 7)) {
+                errors++;
+                break;
+            }
+        }
+    }
+    FlashFs_Close(file);
+    uint32_t read_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+    FlashFs_Delete("bench.bin");
+
+    Log_Info("Seq write 64KB: %lu us, %lu KB/s", write_us, (64 * 1000000UL) / (write_us + 1));
+    Log_Info("Seq read 64KB: %lu us, %lu KB/s", read_us, (64 * 1000000UL) / (read_us + 1));
+    Log_Info("Read errors: %lu", errors);
+
+    /* 挂载时间（200个小文件） */
+    for (uint32_t i = 0; i < FLASH_TEST_FS_FILE_COUNT; i++) {
+        snprintf(name, sizeof(name), "bench%03lu", i);
+        if (FlashFs_Open(&file, name, FLASH_FS_O_WRONLY | FLASH_FS_O_CREAT | FLASH_FS_O_TRUNC) != FLASH_OK) {
+            Log_Error("Create %s failed", name);
+            break;
+        }
+        FlashFs_Write(file, (const uint8_t*)name, sizeof(name));
+        FlashFs_Close(file);
+    }
+
+    start = DWT_GetTick();
+    FlashFs_Mount();
+    uint32_t mount_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    uint32_t files_after;
+    FlashFs_GetInfo(&files_after, &free_sectors);
+    Log_Info("Mount %lu files: %lu us", files_after, mount_us);
+
+    for (uint32_t i = 0; i < FLASH_TEST_FS_FILE_COUNT; i++) {
+        snprintf(name, sizeof(name), "bench%03lu", i);
+        FlashFs_Delete(name);
+    }
+
+    Log_Info("=== Flash FS Benchmark Completed ===");
+}
+
+/**
+ * @brief 页缓存回放测试
+ * @note 按FLASH任务的访问模式（存储一条传感器记录后立即按ID读回）回放，
+ *       统计页缓存命中率和节省的SPI字节数；会真实写入记录
+ */
+void Flash_PageCacheReplayTest(void)
+{
+    uint8_t record[40];
+    uint32_t record_id;
+    static ReadResult_t read_result;
+
+    Log_Info("=== Flash Page Cache Replay ===");
+
+    FlashPageCacheStats_t before = *Flash_GetPageCacheStats();
+
+    for (uint32_t i = 0; i < 20; i++) {
+        for (uint32_t j = 0; j < sizeof(record); j++) {
+            record[j] = (uint8_t)(i + j);
+        }
+
+        if (Flash_StoreData(record, sizeof(record), &record_id) != FLASH_OK ||
+            Flash_ReadData(record_id, &read_result) != FLASH_OK ||
+            !read_result.valid) {
+            Log_Error("Replay failed at %lu", i);
+            return;
+        }
+    }
+
+    const FlashPageCacheStats_t *after = Flash_GetPageCacheStats();
+    uint32_t hits = after->hits - before.hits;
+    uint32_t misses = after->misses - before.misses;
+    int32_t saved = (int32_t)((after->uncached_spi_bytes - before.uncached_spi_bytes) -
+                              (after->spi_bytes - before.spi_bytes));
+
+    Log_Info("Hits %lu, misses %lu (%lu%%)", hits, misses, hits * 100 / (hits + misses + 1));
+    Log_Info("SPI bytes saved: %ld", saved);
+
+    Log_Info("=== Flash Page Cache Replay Completed ===");
+}
+
+/**
+ * @brief 写合并测试
+ * @note 连续存储32条48字节记录后调用Flash_Flush，统计每条记录的页编程次数、
+ *       单次存储耗时和包含提交在内的存储吞吐量；会真实写入记录
+ */
+void Flash_WriteCoalescingTest(void)
+{
+    uint8_t record[48];
+    uint32_t record_id;
+    uint32_t max_store_us = 0;
+    const uint32_t count = 32;
+
+    Log_Info("=== Flash Write Coalescing Test ===");
+
+    DWT_Init();
+
+    FlashStageStats_t before = *Flash_GetStageStats();
+    uint32_t programs_before = Flash_GetStats()->program_ops;
+    uint32_t start = DWT_GetTick();
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = 0; j < sizeof(record); j++) {
+            record[j] = (uint8_t)(i * 3 + j);
+        }
+
+        uint32_t store_start = DWT_GetTick();
+        if (Flash_StoreData(record, sizeof(record), &record_id) != FLASH_OK) {
+            Log_Error("Store failed at %lu", i);
+            return;
+        }
+        uint32_t store_us = FlashTest_CyclesToUs(DWT_GetTick() - store_start);
+        if (store_us > max_store_us) {
+            max_store_us = store_us;
+        }
+    }
+
+    uint32_t flush_start = DWT_GetTick();
+    if (Flash_Flush() != FLASH_OK) {
+        Log_Error("Flush failed");
+        return;
+    }
+    uint32_t flush_us = FlashTest_CyclesToUs(DWT_GetTick() - flush_start);
+    uint32_t total_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    const FlashStageStats_t *after = Flash_GetStageStats();
+    uint32_t data_programs = after->page_programs - before.page_programs;
+    uint32_t all_programs = Flash_GetStats()->program_ops - programs_before;
+
+    Log_Info("%lu records, data programs %lu, all %lu", count, data_programs, all_programs);
+    Log_Info("Data programs/rec: %lu.%02lu", data_programs / count, data_programs * 100 / count % 100);
+    Log_Info("Store max %lu us, flush %lu us", max_store_us, flush_us);
+    Log_Info("Throughput: %lu B/s", count * sizeof(record) * 1000000UL / (total_us + 1));
+
+    Log_Info("=== Flash Write Coalescing Test Completed ===");
+}
+
+/**
+ * @brief 传感器记录编解码测试
+ * @note 统计编码、解码的平均周期数和每条记录占用的Flash空间，并检查往返精度
+ */
+void Flash_RecordCodecTest(void)
+{
+    GlobalSensorData_t sample = *SensorData_GetGlobalData();
+    GlobalSensorData_t decoded;
+    uint8_t record[RECORD_ENCODED_SIZE];
+    uint32_t length = 0;
+    const uint32_t rounds = 100;
+
+    Log_Info("=== Flash Record Codec Test ===");
+
+    DWT_Init();
+
+    uint32_t start = DWT_GetTick();
+    for (uint32_t i = 0; i < rounds; i++) {
+        length = RecordCodec_EncodeSensorData(&sample, record);
+    }
+    uint32_t encode_cycles = (DWT_GetTick() - start) / rounds;
+
+    bool decoded_ok = true;
+    start = DWT_GetTick();
+    for (uint32_t i = 0; i < rounds; i++) {
+        decoded_ok &= RecordCodec_DecodeSensorData(record, length, &decoded);
+    }
+    uint32_t decode_cycles = (DWT_GetTick() - start) / rounds;
+
+    /* 定点数往返误差不超过半个最小单位 */
+    double pressure_error = decoded.pressure_value - sample.pressure_value;
+    float temperature_error = decoded.temperature - sample.temperature;
+    bool round_trip = decoded_ok &&
+                      (!sample.pressure_valid || (pressure_error < 0.0000005 && pressure_error > -0.0000005)) &&
+                      (!sample.temperature_valid || (temperature_error < 0.0051f && temperature_error > -0.0051f)) &&
+                      decoded.system_status == sample.system_status &&
+                      decoded.system_timestamp == sample.system_timestamp;
+
+    /* 旧版本记录：按基线固件的GlobalSensorData_t布局逐字节构造 */
+    uint8_t legacy[RECORD_LEGACY_SIZE];
+    double legacy_pressure = 0.101325;
+    float legacy_temperature = -12.5f;
+    float legacy_humidity = 55.25f;
+    uint32_t legacy_pressure_time = 123456;
+    uint32_t legacy_time = 123789;
+    uint16_t legacy_status = 0x0102;
+    uint16_t legacy_errors = 7;
+
+    memset(legacy, 0, sizeof(legacy));
+    memcpy(&legacy[0], &legacy_pressure, 8);
+    memcpy(&legacy[8], &legacy_pressure_time, 4);
+    legacy[12] = 1;
+    memcpy(&legacy[16], &legacy_temperature, 4);
+    legacy[20] = 1;
+    memcpy(&legacy[24], &legacy_humidity, 4);
+    legacy[28] = 0;
+    memcpy(&legacy[30], &legacy_status, 2);
+    memcpy(&legacy[32], &legacy_errors, 2);
+    memcpy(&legacy[36], &legacy_time, 4);
+
+    memset(&decoded, 0xA5, sizeof(decoded));
+    bool legacy_ok = RecordCodec_DecodeSensorData(legacy, sizeof(legacy), &decoded) &&
+                     decoded.pressure_value == legacy_pressure && decoded.pressure_timestamp == legacy_pressure_time &&
+                     decoded.pressure_valid == 1 && decoded.temperature == legacy_temperature &&
+                     decoded.temperature_valid == 1 && decoded.humidity == legacy_humidity &&
+                     decoded.humidity_valid == 0 && decoded.system_status == legacy_status &&
+                     decoded.error_count == legacy_errors && decoded.system_timestamp == legacy_time &&
+                     decoded.restored == 0;
+
+    uint32_t old_size = RECORD_LEGACY_SIZE + W25Q64_DATA_HEADER_SIZE;
+    uint32_t new_size = length + W25Q64_DATA_HEADER_SIZE;
+    Log_Info("Encode %lu cyc, decode %lu cyc", encode_cycles, decode_cycles);
+    Log_Info("Payload %lu -> %lu B", (uint32_t)RECORD_LEGACY_SIZE, length);
+    Log_Info("On flash %lu -> %lu B (x%lu.%02lu)", old_size, new_size,
+             old_size / new_size, old_size * 100 / new_size % 100);
+    Log_Info("Round trip: %s", round_trip ? "PASS" : "FAIL");
+    Log_Info("Legacy %u B record: %s", RECORD_LEGACY_SIZE, legacy_ok ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Record Codec Test Completed ===");
+}
+
+/**
+ * @brief 芯片参数检测与挂载时间
+ * @note 输出从SFDP读到的容量、地址模式和典型时间，重新初始化一次统计挂载耗时，
+ *       并列出索引相关的RAM占用（与芯片容量无关）
+ */
+void Flash_GeometryTest(void)
+{
+    const FlashGeometry_t *geometry = Flash_GetGeometry();
+    uint32_t used_space, free_space, record_count;
+
+    Log_Info("=== Flash Geometry Test ===");
+
+    DWT_Init();
+
+    Log_Info("JEDEC 0x%06lX, SFDP %u.%u", geometry->jedec_id,
+             geometry->sfdp_revision >> 4, geometry->sfdp_revision & 0x0F);
+    Log_Info("Size %lu KB, %u-byte address%s", geometry->total_size / 1024,
+             geometry->address_bytes, geometry->enter_4byte_mode ? " (B7)" : "");
+    Log_Info("Cmds %02X/%02X/%02X/%02X", geometry->read_cmd, geometry->program_cmd,
+             geometry->sector_erase_cmd, geometry->block_erase_cmd);
+    Log_Info("tPP %lu us, tSE %lu us", geometry->page_program_us, geometry->sector_erase_us);
+    Log_Info("tBE %lu us, tCE %lu ms", geometry->block_erase_us, geometry->chip_erase_ms);
+
+    /* 重新挂载：保存索引后重新初始化 */
+    Flash_DeInit();
+    uint32_t start = DWT_GetTick();
+    FlashResult_t result = Flash_Init();
+    uint32_t mount_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    Flash_GetStorageInfo(&used_space, &free_space, &record_count);
+    Log_Info("Mount %lu us, %lu records", mount_us, record_count);
+    Log_Info("Data area %lu KB", (used_space + free_space) / 1024);
+    Log_Info("Index RAM %lu B, stats %lu B",
+             (uint32_t)(W25Q64_MAX_CACHE_ENTRIES * sizeof(CacheEntry_t)), (uint32_t)sizeof(FlashStats_t));
+    Log_Info("Result: %s", result == FLASH_OK ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Geometry Test Completed ===");
+}
+
+/**
+ * @brief 数据区扫描吞吐量测试
+ * @note 重新扫描数据区，统计扫描速度和顺序预读的突发读取次数；
+ *       记录数应与扫描前一致
+ */
+void Flash_ScanThroughputTest(void)
+{
+    uint32_t used_space, free_space, records_before, records_after;
+
+    Log_Info("=== Flash Scan Throughput Test ===");
+
+    DWT_Init();
+    Flash_GetStorageInfo(&used_space, &free_space, &records_before);
+    FlashPageCacheStats_t before = *Flash_GetPageCacheStats();
+
+    uint32_t start = DWT_GetTick();
+    FlashResult_t result = Flash_ScanDataArea();
+    uint32_t scan_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    const FlashPageCacheStats_t *after = Flash_GetPageCacheStats();
+    Flash_GetStorageInfo(&used_space, &free_space, &records_after);
+    uint32_t kb_per_s = scan_us ? (uint32_t)((uint64_t)used_space * 1000000 / 1024 / scan_us) : 0;
+
+    Log_Info("Scanned %lu KB in %lu us (%lu KB/s)", used_space / 1024, scan_us, kb_per_s);
+    Log_Info("Read-ahead: %lu bursts, %lu B served",
+             after->readahead_bursts - before.readahead_bursts,
+             after->readahead_bytes - before.readahead_bytes);
+    Log_Info("Result: %s", (result == FLASH_OK && records_after == records_before) ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Scan Throughput Test Completed ===");
+}
+
+#if FLASH_COLUMN_STORE_ENABLE
+/* 查询回调：累加第一个值 */
+static void FlashTest_SumVisitor(uint32_t sample, const double *values, void *context)
+{
+    (void)sample;
+    *(double*)context += values[0];
+}
+
+/* 整行查询回调：累加压力值 */
+static void FlashTest_RowSumVisitor(uint32_t sample, const double *values, void *context)
+{
+    (void)sample;
+    *(double*)context += values[RECORD_FIELD_pressure];
+}
+
+/**
+ * @brief 列存储单字段查询与整行查询对比
+ * @note 对全部可用样本分别按单字段（压力）和整行查询，比较读取字节数、
+ *       耗时和结果是否一致
+ */
+void Flash_ColumnScanTest(void)
+{
+    const FlashColumnStats_t *stats = FlashColumn_GetStats();
+    uint32_t first;
+    uint32_t count;
+    double field_sum = 0;
+    double row_sum = 0;
+
+    Log_Info("=== Flash Column Scan Test ===");
+
+    DWT_Init();
+
+    FlashColumn_GetRange(&first, &count);
+    Log_Info("Samples %lu..%lu", first, first + count);
+
+    uint32_t bytes = stats->bytes_read;
+    uint32_t start = DWT_GetTick();
+    FlashResult_t field_result = FlashColumn_ScanField(RECORD_FIELD_pressure, first, count,
+                                                       FlashTest_SumVisitor, &field_sum);
+    uint32_t field_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+    uint32_t field_bytes = stats->bytes_read - bytes;
+
+    bytes = stats->bytes_read;
+    start = DWT_GetTick();
+    FlashResult_t row_result = FlashColumn_ScanRows(first, count, FlashTest_RowSumVisitor, &row_sum);
+    uint32_t row_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+    uint32_t row_bytes = stats->bytes_read - bytes;
+
+    Log_Info("Field scan: %lu B, %lu us", field_bytes, field_us);
+    Log_Info("Row scan:   %lu B, %lu us", row_bytes, row_us);
+    Log_Info("Result: %s", (field_result == FLASH_OK && row_result == FLASH_OK &&
+                            field_sum == row_sum) ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Column Scan Test Completed ===");
+}
+#endif
+
+/**
+ * @brief 后台请求：擦除测试扇区后写满16页
+ */
+static FlashResult_t FlashTest_IoBackgroundJob(void *context)
+{
+    (void)context;
+
+    FlashResult_t result = Flash_EraseSector(FLASH_TEST_SECTOR_ADDR);
+    for (uint32_t i = 0; result == FLASH_OK && i < W25Q64_SECTOR_SIZE / W25Q64_PAGE_SIZE; i++) {
+        result = Flash_Write(FLASH_TEST_SECTOR_ADDR + i * W25Q64_PAGE_SIZE, test_page, W25Q64_PAGE_SIZE);
+    }
+    return result;
+}
+
+/**
+ * @brief Flash I/O服务交互读取延迟测试
+ * @note 在其他任务中调用（不能在FlashIO任务中）。提交一个擦除+16页编程的后台请求，
+ *       执行期间连续发起交互读取，交互读取应在芯片操作之间插入执行，
+ *       最大延迟约为一次扇区擦除，而不是整个后台请求
+ */
+void Flash_IoLatencyTest(void)
+{
+    FlashIoRequest_t job;
+    uint8_t buffer[FLASH_TEST_IO_READ_SIZE];
+    uint32_t reads = 0;
+    uint32_t max_read_us = 0;
+
+    Log_Info("=== Flash IO Latency Test ===");
+
+    if (!FlashIo_IsReady() || !FlashTest_ScratchSectorFree()) {
+        Log_Warn("Service not ready or scratch in use, skipped");
+        return;
+    }
+
+    DWT_Init();
+    FlashIo_ResetStats();
+
+    for (uint32_t i = 0; i < W25Q64_PAGE_SIZE; i++) {
+        test_page[i] = (uint8_t)(i ^ 0x5A);
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.op = FLASH_IO_OP_CALL;
+    job.io_class = FLASH_IO_BACKGROUND;
+    job.handler = FlashTest_IoBackgroundJob;
+    job.waiter = osThreadGetId();
+
+    uint32_t start = DWT_GetTick();
+    FlashIo_Submit(&job);
+
+    /* 后台请求完成前一直发起交互读取 */
+    while (!job.done) {
+        uint32_t read_start = DWT_GetTick();
+        if (FlashIo_Read(FLASH_IO_INTERACTIVE, W25Q64_DATA_AREA_START, buffer, sizeof(buffer)) != FLASH_OK) {
+            Log_Error("Interactive read failed");
+            break;
+        }
+        uint32_t read_us = FlashTest_CyclesToUs(DWT_GetTick() - read_start);
+        if (read_us > max_read_us) {
+            max_read_us = read_us;
+        }
+        reads++;
+    }
+
+    /* 读取失败提前退出时，job在栈上，必须等服务任务执行完 */
+    while (!job.done) {
+        osThreadFlagsWait(FLASH_IO_FLAG_DONE, osFlagsWaitAny, osWaitForever);
+    }
+    uint32_t job_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    const FlashIoClassStats_t *interactive = &FlashIo_GetStats()->classes[FLASH_IO_INTERACTIVE];
+    Log_Info("Background job: %lu us", job_us);
+    Log_Info("%lu reads, max %lu us", reads, max_read_us);
+    Log_Info("Preempted %lu, queue wait max %lu us", interactive->preempted, interactive->wait_max_us);
+    FlashIo_PrintStats();
+    Log_Info("Result: %s", (job.result == FLASH_OK && interactive->preempted > 0 &&
+                            max_read_us < job_us) ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash IO Latency Test Completed ===");
+}
+
+/**
+ * @brief 后台请求：连续擦除测试扇区FLASH_TEST_SUSPEND_ERASES次
+ */
+static FlashResult_t FlashTest_EraseJob(void *context)
+{
+    FlashResult_t result = FLASH_OK;
+
+    (void)context;
+
+    for (uint32_t i = 0; result == FLASH_OK && i < FLASH_TEST_SUSPEND_ERASES; i++) {
+        result = Flash_EraseSector(FLASH_TEST_SECTOR_ADDR);
+    }
+    return result;
+}
+
+/**
+ * @brief 快照读取与擦除暂停测试
+ * @note 在其他任务中调用。后台连续擦除期间按快照中的最新记录ID读取，读取应在
+ *       擦除暂停期间完成，最大延迟远小于一次扇区擦除；快照的最新ID不应回退
+ */
+void Flash_SnapshotReadTest(void)
+{
+    static ReadResult_t result;
+    FlashIoRequest_t job;
+    FlashSnapshot_t snapshot;
+    uint32_t last_head = 0;
+    uint32_t reads = 0;
+    uint32_t failures = 0;
+    uint32_t max_read_us = 0;
+
+    Log_Info("=== Flash Snapshot Read Test ===");
+
+    Flash_GetSnapshot(&snapshot);
+    if (!FlashIo_IsReady() || !FlashTest_ScratchSectorFree() || snapshot.head_id == 0) {
+        Log_Warn("Service not ready or no records, skipped");
+        return;
+    }
+
+    DWT_Init();
+    uint32_t suspends = Flash_GetSuspendStats()->suspends;
+
+    memset(&job, 0, sizeof(job));
+    job.op = FLASH_IO_OP_CALL;
+    job.io_class = FLASH_IO_BACKGROUND;
+    job.handler = FlashTest_EraseJob;
+    job.waiter = osThreadGetId();
+    FlashIo_Submit(&job);
+
+    while (!job.done) {
+        Flash_GetSnapshot(&snapshot);
+        if (snapshot.head_id < last_head) {
+            failures++;
+        }
+        last_head = snapshot.head_id;
+
+        uint32_t read_start = DWT_GetTick();
+        if (FlashIo_ReadData(FLASH_IO_INTERACTIVE, snapshot.head_id, &result) != FLASH_OK ||
+            !result.valid) {
+            failures++;
+        }
+        uint32_t read_us = FlashTest_CyclesToUs(DWT_GetTick() - read_start);
+        if (read_us > max_read_us) {
+            max_read_us = read_us;
+        }
+        reads++;
+
+        /* 模拟轮询间隔，给擦除留出执行时间 */
+        osDelay(2);
+    }
+
+    suspends = Flash_GetSuspendStats()->suspends - suspends;
+    Log_Info("%lu reads, %lu failed, max %lu us", reads, failures, max_read_us);
+    Log_Info("Erase suspends: %lu (cmd 0x%02X)", suspends, Flash_GetGeometry()->suspend_cmd);
+    Log_Info("Result: %s", (job.result == FLASH_OK && failures == 0 &&
+                            (Flash_GetGeometry()->suspend_cmd == 0 ||
+                             (suspends > 0 && max_read_us < Flash_GetGeometry()->sector_erase_us / 2))) ?
+             "PASS" : "FAIL");
+
+    Log_Info("=== Flash Snapshot Read Test Completed ===");
+}
+
+/**
+ * @brief 服务任务中执行：保存状态快照后重新加载
+ */
+static FlashResult_t FlashTest_WarmStateJob(void *context)
+{
+    (void)context;
+
+    FlashResult_t result = WarmState_Save();
+    if (result == FLASH_OK) {
+        WarmState_Load();
+    }
+    return result;
+}
+
+/**
+ * @brief 热启动状态快照测试
+ * @note 在其他任务中、Modbus初始化之后调用。保存一次快照后按上电流程重新加载，
+ *       应找到刚保存的快照，加载只读取几个页，耗时为毫秒级
+ */
+void Flash_WarmStateTest(void)
+{
+    Log_Info("=== Flash Warm State Test ===");
+
+    if (!FlashIo_IsReady()) {
+        Log_Warn("Service not ready, skipped");
+        return;
+    }
+
+    FlashResult_t result = FlashIo_Call(FLASH_IO_DURABLE, FlashTest_WarmStateJob, NULL);
+    const WarmStateStats_t *stats = WarmState_GetStats();
+
+    Log_Info("Saves %lu, skipped %lu", stats->saves, stats->skipped);
+    Log_Info("Load %lu us, fallbacks %lu", stats->load_us, stats->fallbacks);
+    Log_Info("Result: %s", (result == FLASH_OK && stats->restored && stats->fallbacks == 0 &&
+                            stats->load_us < 10000) ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Warm State Test Completed ===");
+}
+
+/* 标签查询测试上下文 */
+typedef struct {
+    FlashTagCursor_t cursor;
+    uint32_t record_id;         /* 存储的测试记录 */
+    uint32_t found;             /* 查到的带测试标签的记录数 */
+    uint32_t query_us;          /* 查询耗时 */
+} FlashTestTagQuery_t;
+
+/**
+ * @brief 服务任务中执行：存储一条带测试标签的记录，再按标签查询全部记录
+ */
+static FlashResult_t FlashTest_TagQueryJob(void *context)
+{
+    static ReadResult_t result;
+    FlashTestTagQuery_t *query = (FlashTestTagQuery_t*)context;
+    uint8_t record[16];
+    uint32_t last_id = 0;
+    FlashResult_t status;
+
+    memset(record, 0x5A, sizeof(record));
+    status = Flash_StoreTaggedData(FLASH_TEST_TAG, record, sizeof(record), &query->record_id);
+    if (status != FLASH_OK) {
+        return status;
+    }
+
+    uint32_t start = DWT_GetTick();
+    Flash_TagCursorInit(&query->cursor);
+    while ((status = Flash_ReadNextTagged(FLASH_TEST_TAG, &query->cursor, &result)) != FLASH_ERROR_NOT_FOUND) {
+        if (status == FLASH_OK) {
+            query->found++;
+            last_id = result.record_id;
+        }
+    }
+    query->query_us = FlashTest_CyclesToUs(DWT_GetTick() - start);
+
+    return (last_id == query->record_id) ? FLASH_OK : FLASH_ERROR_NOT_FOUND;
+}
+
+/**
+ * @brief 按标签查询测试
+ * @note 在其他任务中调用。测试标签的记录很少，查询应跳过绝大多数扇区，
+ *       并找到刚存储的记录
+ */
+void Flash_TagQueryTest(void)
+{
+    static FlashTestTagQuery_t query;
+
+    Log_Info("=== Flash Tag Query Test ===");
+
+    if (!FlashIo_IsReady()) {
+        Log_Warn("Service not ready, skipped");
+        return;
+    }
+
+    DWT_Init();
+    memset(&query, 0, sizeof(query));
+    FlashResult_t result = FlashIo_Call(FLASH_IO_DURABLE, FlashTest_TagQueryJob, &query);
+
+    Log_Info("Found %lu records in %lu us", query.found, query.query_us);
+    Log_Info("Sectors read %lu, skipped %lu", query.cursor.sectors_read, query.cursor.sectors_skipped);
+    Log_Info("Result: %s", (result == FLASH_OK && query.found > 0) ? "PASS" : "FAIL");
+
+    Log_Info("=== Flash Tag Query Test Completed ===");
+}
+
+/* USER CODE END EF */
@@ -0,0 +1,510 @@
+#include "fw_update.h"
+#include "flash_io.h"
+#include "ble_data.h"
+#include "modbus.h"
+#include "log.h"
+#include "crc.h"
+#include <string.h>
+#include <stddef.h>
+
+/* 帧解析状态 */
+typedef enum {
+    FW_PARSE_SYNC = 0,          /* 寻找0xA5 */
+    FW_PARSE_HEADER,            /* 接收帧头 */
+    FW_PARSE_BODY               /* 接收payload和CRC */
+} FwParseState_t;
+
+/* 会话状态 */
+typedef struct {
+    bool active;                /* 会话进行中 */
+    uint32_t image_size;        /* 镜像大小 */
+    uint32_t image_crc32;       /* 上位机给出的镜像CRC32 */
+    uint32_t running_crc32;     /* 接收过程中累计的CRC32 */
+    uint32_t next_offset;       /* 下一个期望的偏移 */
+    uint16_t chunk_size;        /* 数据帧大小 */
+    uint8_t window;             /* 窗口大小 */
+    uint8_t unacked;            /* 上次确认后接收的帧数 */
+    bool nack_sent;             /* 已为当前偏移发送过重传请求 */
+    uint32_t start_tick;        /* 会话开始时间 */
+    uint32_t last_rx_tick;      /* 最近一次收到数据的时间 */
+    uint32_t retransmits;       /* 丢弃的乱序/重复帧数 */
+    uint32_t crc_errors;        /* 帧CRC错误数 */
+    uint32_t programmed;        /* 已编程的字节数 */
+    uint32_t sequence;          /* 本次暂存序号 */
+    uint16_t page_fill;         /* 页缓冲中的字节数 */
+    uint8_t page_buffer[W25Q64_PAGE_SIZE];  /* 待编程的页 */
+} FwSession_t;
+
+/* 全局变量 */
+static FwSession_t g_fw_session;
+static FwParseState_t g_fw_parse_state = FW_PARSE_SYNC;
+static uint16_t g_fw_frame_pos = 0;
+static uint16_t g_fw_frame_length = 0;
+static uint8_t g_fw_frame[FW_FRAME_HEADER_SIZE + FW_FRAME_MAX_PAYLOAD + 2];
+static uint16_t g_fw_tx_seq = 0;
+
+/* 私有函数声明 */
+static void FwUpdate_SendFrame(uint8_t type, const uint8_t *payload, uint16_t length);
+static void FwUpdate_SendAck(void);
+static void FwUpdate_SendResult(FwStatus_t status, uint32_t crc32);
+static void FwUpdate_HandleFrame(uint8_t type, const uint8_t *payload, uint16_t length);
+static void FwUpdate_HandleStart(const uint8_t *payload, uint16_t length);
+static void FwUpdate_HandleData(const uint8_t *payload, uint16_t length);
+static void FwUpdate_HandleEnd(void);
+static FlashResult_t FwUpdate_FlushPage(void);
+static FlashResult_t FwUpdate_VerifyImage(uint32_t *crc32);
+static void FwUpdate_EndSession(FwStatus_t status, uint32_t crc32);
+
+/**
+ * @brief 读取小端32位数
+ */
+static uint32_t FwUpdate_GetU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief 写入小端32位数
+ */
+static void FwUpdate_PutU32(uint8_t *p, uint32_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+/**
+ * @brief 初始化固件暂存模块
+ */
+void FwUpdate_Init(void)
+{
+    memset(&g_fw_session, 0, sizeof(g_fw_session));
+    g_fw_parse_state = FW_PARSE_SYNC;
+    g_fw_frame_pos = 0;
+}
+
+/**
+ * @brief 是否处于暂存会话中（此时USART2数据全部交给本模块）
+ */
+bool FwUpdate_IsActive(void)
+{
+    return g_fw_session.active;
+}
+
+/**
+ * @brief 判断消息是否以START帧开头
+ */
+bool FwUpdate_IsStartFrame(const uint8_t *data, uint16_t length)
+{
+    return length >= FW_FRAME_HEADER_SIZE && data[0] == FW_FRAME_SYNC && data[1] == FW_FRAME_START;
+}
+
+/**
+ * @brief 输入USART2收到的数据
+ * @param data 数据
+ * @param length 长度
+ * @note 帧可能被DMA接收拆分到多条消息，也可能多帧合并在一条消息中，按字节流解析
+ */
+void FwUpdate_Feed(const uint8_t *data, uint16_t length)
+{
+    g_fw_session.last_rx_tick = osKernelGetTickCount();
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        switch (g_fw_parse_state) {
+            case FW_PARSE_SYNC:
+                if (byte == FW_FRAME_SYNC) {
+                    g_fw_frame[0] = byte;
+                    g_fw_frame_pos = 1;
+                    g_fw_parse_state = FW_PARSE_HEADER;
+                }
+                break;
+
+            case FW_PARSE_HEADER:
+                g_fw_frame[g_fw_frame_pos++] = byte;
+                if (g_fw_frame_pos == FW_FRAME_HEADER_SIZE) {
+                    uint16_t payload_length = g_fw_frame[4] | ((uint16_t)g_fw_frame[5] << 8);
+                    if (payload_length > FW_FRAME_MAX_PAYLOAD) {
+                        g_fw_session.crc_errors++;
+                        g_fw_parse_state = FW_PARSE_SYNC;
+                    } else {
+                        g_fw_frame_length = FW_FRAME_HEADER_SIZE + payload_length + 2;
+                        g_fw_parse_state = FW_PARSE_BODY;
+                    }
+                }
+                break;
+
+            case FW_PARSE_BODY:
+                g_fw_frame[g_fw_frame_pos++] = byte;
+                if (g_fw_frame_pos == g_fw_frame_length) {
+                    uint16_t crc_pos = g_fw_frame_length - 2;
+                    uint16_t crc = g_fw_frame[crc_pos] | ((uint16_t)g_fw_frame[crc_pos + 1] << 8);
+
+                    if (crc == Modbus_CalculateCRC16(g_fw_frame, crc_pos)) {
+                        FwUpdate_HandleFrame(g_fw_frame[1], &g_fw_frame[FW_FRAME_HEADER_SIZE],
+                                             crc_pos - FW_FRAME_HEADER_SIZE);
+                    } else {
+                        /* 损坏的数据帧按乱序处理，请求从next_offset重传 */
+                        g_fw_session.crc_errors++;
+                        if (g_fw_session.active && !g_fw_session.nack_sent) {
+                            FwUpdate_SendAck();
+                            g_fw_session.nack_sent = true;
+                        }
+                    }
+                    g_fw_parse_state = FW_PARSE_SYNC;
+                }
+                break;
+
+            default:
+                g_fw_parse_state = FW_PARSE_SYNC;
+                break;
+        }
+    }
+}
+
+/**
+ * @brief 周期检查会话超时，由USART2任务在队列等待超时时调用
+ */
+void FwUpdate_Poll(void)
+{
+    if (g_fw_session.active &&
+        osKernelGetTickCount() - g_fw_session.last_rx_tick >= FW_SESSION_TIMEOUT_MS) {
+        Log_Warn("FW: Session timeout at %lu", g_fw_session.next_offset);
+        FwUpdate_EndSession(FW_STATUS_TIMEOUT, 0);
+    }
+}
+
+/**
+ * @brief 读取暂存区镜像头
+ * @param header 输出镜像头
+ * @return FlashResult_t 无有效镜像时返回FLASH_ERROR_NOT_FOUND
+ */
+FlashResult_t FwUpdate_GetStagedImage(FwImageHeader_t *header)
+{
+    if (header == NULL) {
+        return FLASH_ERROR_INVALID_PARAM;
+    }
+
+    FlashResult_t result = FlashIo_Read(FLASH_IO_INTERACTIVE, FW_HEADER_ADDR,
+                                        (uint8_t*)header, sizeof(FwImageHeader_t));
+    if (result != FLASH_OK) {
+        return result;
+    }
+
+    if (header->magic != FW_HEADER_MAGIC ||
+        header->crc16 != Flash_CalculateCRC16((uint8_t*)header, offsetof(FwImageHeader_t, crc16))) {
+        return FLASH_ERROR_NOT_FOUND;
+    }
+
+    return FLASH_OK;
+}
+
+/**
+ * @brief 发送一帧到USART2
+ */
+static void FwUpdate_SendFrame(uint8_t type, const uint8_t *payload, uint16_t length)
+{
+    uint8_t frame[FW_FRAME_HEADER_SIZE + 16 + 2];
+
+    if (length > 16) {
+        return;
+    }
+
+    frame[0] = FW_FRAME_SYNC;
+    frame[1] = type;
+    frame[2] = g_fw_tx_seq & 0xFF;
+    frame[3] = (g_fw_tx_seq >> 8) & 0xFF;
+    frame[4] = length & 0xFF;
+    frame[5] = (length >> 8) & 0xFF;
+    memcpy(&frame[FW_FRAME_HEADER_SIZE], payload, length);
+
+    uint16_t crc = Modbus_CalculateCRC16(frame, FW_FRAME_HEADER_SIZE + length);
+    frame[FW_FRAME_HEADER_SIZE + length] = crc & 0xFF;
+    frame[FW_FRAME_HEADER_SIZE + length + 1] = (crc >> 8) & 0xFF;
+
+    g_fw_tx_seq++;
+    UART2_SendData(frame, FW_FRAME_HEADER_SIZE + length + 2);
+}
+
+/**
+ * @brief 发送累计确认
+ */
+static void FwUpdate_SendAck(void)
+{
+    uint8_t payload[4];
+
+    FwUpdate_PutU32(payload, g_fw_session.next_offset);
+    FwUpdate_SendFrame(FW_FRAME_ACK, payload, sizeof(payload));
+    g_fw_session.unacked = 0;
+}
+
+/**
+ * @brief 发送会话结果
+ */
+static void FwUpdate_SendResult(FwStatus_t status, uint32_t crc32)
+{
+    uint8_t payload[13];
+    uint32_t elapsed_ms = osKernelGetTickCount() - g_fw_session.start_tick;
+    uint32_t rate = (elapsed_ms > 0) ? (uint32_t)((uint64_t)g_fw_session.next_offset * 1000 / elapsed_ms) : 0;
+
+    payload[0] = (uint8_t)status;
+    FwUpdate_PutU32(&payload[1], crc32);
+    FwUpdate_PutU32(&payload[5], elapsed_ms);
+    FwUpdate_PutU32(&payload[9], rate);
+    FwUpdate_SendFrame(FW_FRAME_RESULT, payload, sizeof(payload));
+
+    Log_Info("FW: %lu B in %lu ms, %lu B/s", g_fw_session.next_offset, elapsed_ms, rate);
+    Log_Info("FW: %lu%% of line rate, %lu resent", rate * 100 / FW_LINE_BYTES_PER_SEC, g_fw_session.retransmits);
+}
+
+/**
+ * @brief 分发一个校验通过的帧
+ */
+static void FwUpdate_HandleFrame(uint8_t type, const uint8_t *payload, uint16_t length)
+{
+    switch (type) {
+        case FW_FRAME_START:
+            FwUpdate_HandleStart(payload, length);
+            break;
+
+        case FW_FRAME_DATA:
+            if (g_fw_session.active) {
+                FwUpdate_HandleData(payload, length);
+            }
+            break;
+
+        case FW_FRAME_END:
+            if (g_fw_session.active) {
+                FwUpdate_HandleEnd();
+            }
+            break;
+
+        case FW_FRAME_ABORT:
+            if (g_fw_session.active) {
+                Log_Warn("FW: Aborted by host");
+                FwUpdate_EndSession(FW_STATUS_ABORTED, 0);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief 处理START帧：擦除暂存区并开始会话
+ */
+static void FwUpdate_HandleStart(const uint8_t *payload, uint16_t length)
+{
+    if (length < 11) {
+        return;
+    }
+
+    uint32_t image_size = FwUpdate_GetU32(&payload[0]);
+    uint16_t chunk_size = payload[8] | ((uint16_t)payload[9] << 8);
+    uint8_t window = payload[10];
+
+    if (image_size == 0 || image_size > FW_IMAGE_MAX_SIZE ||
+        chunk_size == 0 || chunk_size > FW_CHUNK_MAX_SIZE ||
+        window == 0 || window > FW_WINDOW_MAX) {
+        Log_Error("FW: Bad START parameters");
+        FwUpdate_SendResult(FW_STATUS_SIZE_MISMATCH, 0);
+        return;
+    }
+
+    /* 擦除前取出上一次的暂存序号 */
+    FwImageHeader_t previous;
+    uint32_t sequence = (FwUpdate_GetStagedImage(&previous) == FLASH_OK) ? previous.sequence + 1 : 1;
+
+    memset(&g_fw_session, 0, sizeof(g_fw_session));
+    g_fw_session.sequence = sequence;
+    g_fw_session.image_size = image_size;
+    g_fw_session.image_crc32 = FwUpdate_GetU32(&payload[4]);
+    g_fw_session.running_crc32 = CRC32_INIT;
+    g_fw_session.chunk_size = chunk_size;
+    g_fw_session.window = window;
+    g_fw_session.start_tick = osKernelGetTickCount();
+    g_fw_session.last_rx_tick = g_fw_session.start_tick;
+
+    Log_Info("FW: Start, %lu bytes, window %u", image_size, window);
+
+    /* 一次性擦除镜像头和镜像所需的块，数据阶段只剩页编程 */
+    uint32_t erase_end = FW_IMAGE_ADDR + image_size;
+    for (uint32_t address = W25Q64_FW_AREA_START; address < erase_end; address += W25Q64_BLOCK_SIZE) {
+        if (FlashIo_EraseBlock(address) != FLASH_OK) {
+            Log_Error("FW: Erase failed at 0x%08lX", address);
+            FwUpdate_SendResult(FW_STATUS_FLASH_ERROR, 0);
+            return;
+        }
+    }
+
+    g_fw_session.active = true;
+    g_fw_session.last_rx_tick = osKernelGetTickCount();
+    FwUpdate_SendAck();
+}
+
+/**
+ * @brief 处理DATA帧：按序写入页缓冲，满页即编程
+ */
+static void FwUpdate_HandleData(const uint8_t *payload, uint16_t length)
+{
+    if (length <= 4) {
+        return;
+    }
+
+    uint32_t offset = FwUpdate_GetU32(payload);
+    const uint8_t *data = &payload[4];
+    uint16_t data_length = length - 4;
+
+    /* 乱序或重复帧丢弃，回到next_offset（go-back-N），每个偏移只请求一次重传 */
+    if (offset != g_fw_session.next_offset ||
+        data_length > g_fw_session.chunk_size ||
+        offset + data_length > g_fw_session.image_size) {
+        g_fw_session.retransmits++;
+        if (!g_fw_session.nack_sent) {
+            FwUpdate_SendAck();
+            g_fw_session.nack_sent = true;
+        }
+        return;
+    }
+
+    g_fw_session.running_crc32 = Crc32_Update(g_fw_session.running_crc32, data, data_length);
+
+    while (data_length > 0) {
+        uint16_t copy = W25Q64_PAGE_SIZE - g_fw_session.page_fill;
+        if (copy > data_length) {
+            copy = data_length;
+        }
+
+        memcpy(&g_fw_session.page_buffer[g_fw_session.page_fill], data, copy);
+        g_fw_session.page_fill += copy;
+        data += copy;
+        data_length -= copy;
+
+        if (g_fw_session.page_fill == W25Q64_PAGE_SIZE && FwUpdate_FlushPage() != FLASH_OK) {
+            FwUpdate_EndSession(FW_STATUS_FLASH_ERROR, 0);
+            return;
+        }
+    }
+
+    g_fw_session.next_offset = offset + (length - 4);
+    g_fw_session.nack_sent = false;
+    g_fw_session.unacked++;
+
+    /* 收到半个窗口或整个镜像后确认，上位机在确认返回途中继续发送后半个窗口 */
+    if (g_fw_session.unacked >= (g_fw_session.window + 1) / 2 ||
+        g_fw_session.next_offset == g_fw_session.image_size) {
+        FwUpdate_SendAck();
+    }
+}
+
+/**
+ * @brief 处理END帧：编程剩余数据，回读校验并写入镜像头
+ */
+static void FwUpdate_HandleEnd(void)
+{
+    if (g_fw_session.next_offset != g_fw_session.image_size) {
+        Log_Error("FW: Short image %lu/%lu", g_fw_session.next_offset, g_fw_session.image_size);
+        FwUpdate_EndSession(FW_STATUS_SIZE_MISMATCH, 0);
+        return;
+    }
+
+    if (FwUpdate_FlushPage() != FLASH_OK) {
+        FwUpdate_EndSession(FW_STATUS_FLASH_ERROR, 0);
+        return;
+    }
+
+    uint32_t received_crc = g_fw_session.running_crc32;
+    if (received_crc != g_fw_session.image_crc32) {
+        Log_Error("FW: CRC 0x%08lX != 0x%08lX", received_crc, g_fw_session.image_crc32);
+        FwUpdate_EndSession(FW_STATUS_CRC_MISMATCH, received_crc);
+        return;
+    }
+
+    /* 接收CRC只说明串口数据正确，再从Flash回读确认编程结果 */
+    uint32_t flash_crc;
+    if (FwUpdate_VerifyImage(&flash_crc) != FLASH_OK || flash_crc != g_fw_session.image_crc32) {
+        Log_Error("FW: Readback CRC mismatch");
+        FwUpdate_EndSession(FW_STATUS_FLASH_ERROR, flash_crc);
+        return;
+    }
+
+    FwImageHeader_t header;
+    header.magic = FW_HEADER_MAGIC;
+    header.image_size = g_fw_session.image_size;
+    header.image_crc32 = flash_crc;
+    header.sequence = g_fw_session.sequence;
+    header.crc16 = Flash_CalculateCRC16((uint8_t*)&header, offsetof(FwImageHeader_t, crc16));
+
+    if (FlashIo_Write(FW_HEADER_ADDR, (uint8_t*)&header, sizeof(header)) != FLASH_OK) {
+        FwUpdate_EndSession(FW_STATUS_FLASH_ERROR, flash_crc);
+        return;
+    }
+
+    FwUpdate_EndSession(FW_STATUS_OK, flash_crc);
+}
+
+/**
+ * @brief 编程页缓冲中的数据
+ */
+static FlashResult_t FwUpdate_FlushPage(void)
+{
+    if (g_fw_session.page_fill == 0) {
+        return FLASH_OK;
+    }
+
+    /* 页缓冲总是从页边界开始，一次编程不会跨页 */
+    uint32_t address = FW_IMAGE_ADDR + g_fw_session.programmed;
+
+    FlashResult_t result = FlashIo_Write(address, g_fw_session.page_buffer, g_fw_session.page_fill);
+    if (result != FLASH_OK) {
+        Log_Error("FW: Program failed at 0x%08lX", address);
+        return result;
+    }
+
+    g_fw_session.programmed += g_fw_session.page_fill;
+    g_fw_session.page_fill = 0;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 从Flash回读镜像计算CRC32
+ */
+static FlashResult_t FwUpdate_VerifyImage(uint32_t *crc32)
+{
+    uint32_t crc = CRC32_INIT;
+
+    *crc32 = 0;
+    for (uint32_t offset = 0; offset < g_fw_session.image_size; offset += W25Q64_PAGE_SIZE) {
+        uint32_t length = g_fw_session.image_size - offset;
+        if (length > W25Q64_PAGE_SIZE) {
+            length = W25Q64_PAGE_SIZE;
+        }
+
+        FlashResult_t result = FlashIo_ReadNoCache(FLASH_IO_DURABLE, FW_IMAGE_ADDR + offset,
+                                                   g_fw_session.page_buffer, length);
+        if (result != FLASH_OK) {
+            return result;
+        }
+        crc = Crc32_Update(crc, g_fw_session.page_buffer, length);
+    }
+
+    *crc32 = crc;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 结束会话并回复结果
+ */
+static void FwUpdate_EndSession(FwStatus_t status, uint32_t crc32)
+{
+    FwUpdate_SendResult(status, crc32);
+    g_fw_session.active = false;
+    g_fw_parse_state = FW_PARSE_SYNC;
+
+    if (status == FW_STATUS_OK) {
+        Log_Info("FW: Image staged, CRC 0x%08lX", crc32);
+    }
+}
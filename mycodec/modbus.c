@@ -1,56 +1,18 @@
 #include "modbus.h"
+#include "modbus_regs.h"
+#include "modbus_file.h"
 #include "log.h"
-#include "pressure.h"
+#include "crc.h"
 #include <string.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "cmsis_os.h"
-#include "bsp_dht11.h"
-/* External task handles for task notification */
-extern osThreadId_t g_PressureTaskHandle;
-extern osThreadId_t g_LCDTaskHandle;
-extern osThreadId_t g_DHT11TaskHandle;
+#include "warm_state.h"
 
 // 全局传感器数据
 GlobalSensorData_t g_sensor_data = {0};        // 全局传感器数据
 ModbusRegisters_t g_modbus_registers = {0};    // Modbus寄存器数据
 
-// CRC16查找表
-static const uint16_t crc16_table[256] = {
-    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
-    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
-    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
-    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
-    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
-    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
-    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
-    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
-    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
-    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
-    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
-    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
-    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
-    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
-    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
-    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
-    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
-    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
-    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
-    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
-    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
-    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
-    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
-    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
-    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
-    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
-    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
-    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
-    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
-    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
-    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
-    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
-};
-
 /**
  * @brief 初始化Modbus模块
  */
@@ -65,6 +27,12 @@ void Modbus_Init(void)
     g_modbus_registers.status = 0;
     g_modbus_registers.error_count = 0;
     
+    // 建立寄存器表地址索引
+    ModbusRegs_Init();
+    
+    // 恢复复位前的最近值，传感器任务重新采集前即可应答
+    WarmState_Restore(WARM_STATE_WAIT_MS);
+    
     Log_Info("Modbus and global sensor data initialized");
 }
 
@@ -106,15 +74,7 @@ void Modbus_UpdateStatus(uint16_t status_value)
  */
 uint16_t Modbus_CalculateCRC16(uint8_t* data, uint16_t length)
 {
-    uint16_t crc = 0xFFFF;
-    
-    for (uint16_t i = 0; i < length; i++)
-    {
-        uint8_t index = (crc ^ data[i]) & 0xFF;
-        crc = (crc >> 8) ^ crc16_table[index];
-    }
-    
-    return crc;
+    return Crc16Modbus_Update(CRC16_MODBUS_INIT, data, length);
 }
 
 /**
@@ -122,21 +82,21 @@ uint16_t Modbus_CalculateCRC16(uint8_t* data, uint16_t length)
  * @param frame 帧数据
  * @param length 帧长度
  * @return true: 校验正确, false: 校验错误
+ * @note RTU帧CRC低字节在前；MODBUS_CRC_COMPAT_SWAPPED时也接受高字节在前
  */
 bool Modbus_ValidateCRC(uint8_t* frame, uint16_t length)
 {
     if (length < 3) return false;
     
-    // 尝试两种CRC字节序：高字节在前和低字节在前
-    uint16_t received_crc_high_first = (frame[length - 2] << 8) | frame[length - 1];  // 高字节在前
-    uint16_t received_crc_low_first = frame[length - 2] | (frame[length - 1] << 8);  // 低字节在前
+    uint16_t received_crc = frame[length - 2] | (frame[length - 1] << 8);
     uint16_t calculated_crc = Modbus_CalculateCRC16(frame, length - 2);
     
-    Log_Debug("Modbus: CRC validation - High first: 0x%04X, Low first: 0x%04X, Calculated: 0x%04X", 
-              received_crc_high_first, received_crc_low_first, calculated_crc);
-    
-    // 检查两种字节序
-    return (received_crc_high_first == calculated_crc) || (received_crc_low_first == calculated_crc);
+#if MODBUS_CRC_COMPAT_SWAPPED
+    if (received_crc == (uint16_t)((calculated_crc >> 8) | (calculated_crc << 8))) {
+        return true;
+    }
+#endif
+    return received_crc == calculated_crc;
 }
 
 /**
@@ -205,10 +165,11 @@ void Modbus_BuildExceptionResponse(uint8_t slave_addr, uint8_t function_code, ui
 }
 
 /**
- * @brief 检测是否为Modbus命令
+ * @brief 检测是否为发给本机的Modbus命令
  * @param rx_buffer 接收缓冲区
  * @param rx_length 接收长度
  * @return true: 是Modbus命令, false: 不是Modbus命令
+ * @note 不支持的功能码也返回true，由Modbus_ProcessRequest回复异常
  */
 bool Modbus_IsModbusCommand(uint8_t* rx_buffer, uint16_t rx_length)
 {
@@ -223,14 +184,7 @@ bool Modbus_IsModbusCommand(uint8_t* rx_buffer, uint16_t rx_length)
         return false;
     }
     
-    // 检查功能码是否在有效范围内
-    uint8_t function_code = rx_buffer[1];
-    if (function_code != MODBUS_READ_HOLDING_REGISTERS && 
-        function_code != MODBUS_READ_INPUT_REGISTERS) {
-        return false;
-    }
-    
-    // 检查CRC（简单验证）
+    // 检查CRC
     if (!Modbus_ValidateCRC(rx_buffer, rx_length)) {
         return false;
     }
@@ -245,11 +199,10 @@ bool Modbus_IsModbusCommand(uint8_t* rx_buffer, uint16_t rx_length)
  * @param tx_buffer 发送缓冲区
  * @param tx_length 发送长度指针
  * @return true: 处理成功, false: 处理失败
+ * @note 校验CRC后由Modbus_ProcessFrame处理；帧定界已校验CRC的RTU帧直接调用Modbus_ProcessFrame
  */
 bool Modbus_ProcessRequest(uint8_t* rx_buffer, uint16_t rx_length, uint8_t* tx_buffer, uint16_t* tx_length)
 {
-//    Log_Debug("Modbus_ProcessRequest: RX length=%d", rx_length);
-    
     // 检查最小帧长度
     if (rx_length < 4) {
         Log_Error("Modbus: Frame too short, length=%d", rx_length);
@@ -262,227 +215,125 @@ bool Modbus_ProcessRequest(uint8_t* rx_buffer, uint16_t rx_length, uint8_t* tx_b
         return false;
     }
     
+    return Modbus_ProcessFrame(rx_buffer, rx_length, tx_buffer, tx_length);
+}
+
+/**
+ * @brief 处理CRC已校验的Modbus RTU帧
+ * @param rx_buffer 接收的帧（含CRC）
+ * @param rx_length 帧长度
+ * @param tx_buffer 发送缓冲区
+ * @param tx_length 发送长度指针
+ * @return true: 已生成应答, false: 不应答（帧太短或发给其他从机）
+ * @note 每帧只解析一次，不再计算请求的CRC；正常请求不输出日志，只记录错误
+ */
+bool Modbus_ProcessFrame(const uint8_t* rx_buffer, uint16_t rx_length, uint8_t* tx_buffer, uint16_t* tx_length)
+{
+    // 检查最小帧长度
+    if (rx_length < 4) {
+        return false;
+    }
+    
     uint8_t slave_addr = rx_buffer[0];
     uint8_t function_code = rx_buffer[1];
     
-    Log_Debug("Modbus: Slave addr=0x%02X, Function=0x%02X", slave_addr, function_code);
-    
-    // 检查从机地址（假设本设备地址为1）
+    // 检查从机地址（假设本设备地址为1），总线上发给其他从机的帧不应答
     if (slave_addr != 0x01) {
-        Log_Error("Modbus: Invalid slave address 0x%02X, expected 0x01", slave_addr);
         return false;
     }
     
     switch (function_code)
     {
         case MODBUS_READ_HOLDING_REGISTERS:
+        case MODBUS_READ_INPUT_REGISTERS:
         {
-            // 读取保持寄存器 (功能码 0x03)
+            // 读取保持寄存器 (功能码 0x03) / 输入寄存器 (功能码 0x04)
             uint16_t start_addr = (rx_buffer[2] << 8) | rx_buffer[3];
             uint16_t register_count = (rx_buffer[4] << 8) | rx_buffer[5];
+            uint8_t access = (function_code == MODBUS_READ_HOLDING_REGISTERS) ?
+                             MODBUS_REG_ACCESS_HOLDING : MODBUS_REG_ACCESS_INPUT;
             
-            Log_Debug("Modbus: Read Holding Registers - Start=0x%04X, Count=%d", start_addr, register_count);
-            
-            // 检查地址和数量范围
-            if (start_addr + register_count > MODBUS_REGISTER_COUNT)
+            if (rx_length != 8)
             {
-                Log_Error("Modbus: Illegal data address - Start=0x%04X, Count=%d, Max=%d", 
-                         start_addr, register_count, MODBUS_REGISTER_COUNT);
-                Modbus_BuildExceptionResponse(slave_addr, function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR, tx_buffer, tx_length);
+                Log_Error("Modbus: Read length mismatch, length=%d", rx_length);
+                Modbus_BuildExceptionResponse(slave_addr, function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, tx_buffer, tx_length);
                 return true;
             }
             
-            // 构建响应数据
-            uint8_t response_data[64];
-            uint16_t data_pos = 0;
-            
-            for (uint16_t i = 0; i < register_count; i++)
+            // 按寄存器表直接读取到应答中，同时计算CRC（检查地址和数量范围）
+            tx_buffer[0] = slave_addr;
+            tx_buffer[1] = function_code;
+            tx_buffer[2] = register_count * 2;
+            uint16_t crc = Modbus_CalculateCRC16(tx_buffer, 3);
+            uint8_t exception = ModbusRegs_Read(start_addr, register_count, access, &tx_buffer[3], &crc);
+            if (exception != 0)
             {
-                uint16_t reg_addr = start_addr + i;
-                uint16_t reg_value = 0;
-                
-                // 根据寄存器地址获取数据
-                switch (reg_addr)
-                {
-                    case REG_PRESSURE_ADDR:
-                        // 发送任务通知触发压力读取和LCD刷新，然后读取全局变量
-                        {
-                            if (g_PressureTaskHandle != NULL) {
-                                osThreadFlagsSet(g_PressureTaskHandle, 0x01);  /* 发送压力任务通知 */
-//                                Log_Debug("Modbus: Sent pressure task notification");
-                            }
-                            
-                            if (g_LCDTaskHandle != NULL) {
-                                osThreadFlagsSet(g_LCDTaskHandle, 0x01);  /* 发送LCD任务通知 */
-                                Log_Info("Modbus: Sent LCD task notification");
-                            } else {
-                                Log_Warn("Modbus: g_LCDTaskHandle is NULL");
-                            }
-                            
-                            /* 等待一小段时间让压力任务完成读取 */
-                            osDelay(100);  /* 等待100ms */
-                            
-                            /* 读取最新的全局压力值 */
-                            double pressure_value = PressureSensor_GetLatestValue();
-                            if (pressure_value != PRESSURE_READ_ERROR)
-                            {
-                                // 将压力值*10000后存储到寄存器
-                                uint16_t pressure_scaled = (uint16_t)(pressure_value * 10000);
-                                g_modbus_registers.pressure = pressure_scaled;
-//                                Log_Info("Modbus: Pressure read via task notification: %.4f MPa, scaled: %d", pressure_value, pressure_scaled);
-                            }
-                            else
-                            {
-                                Log_Warn("Modbus: Failed to get pressure value after task notification");
-                            }
-                        }
-                        reg_value = g_modbus_registers.pressure;
-                        break;
-                    case REG_TEMPERATURE_ADDR:
-                        // 发送任务通知触发DHT11采集和LCD刷新，然后读取全局变量
-                        {
-                            if (g_DHT11TaskHandle != NULL) {
-                                osThreadFlagsSet(g_DHT11TaskHandle, 0x01);  /* 发送DHT11任务通知 */
-                                Log_Info("Modbus: Sent DHT11 task notification");
-                            } else {
-                                Log_Warn("Modbus: g_DHT11TaskHandle is NULL");
-                            }
-                            
-                            if (g_LCDTaskHandle != NULL) {
-                                osThreadFlagsSet(g_LCDTaskHandle, 0x01);  /* 发送LCD任务通知 */
-                                Log_Info("Modbus: Sent LCD task notification");
-                            } else {
-                                Log_Warn("Modbus: g_LCDTaskHandle is NULL");
-                            }
-                            
-                            /* 等待一小段时间让DHT11任务完成读取 */
-                            osDelay(100);  /* 等待100ms */
-                        }
-                        reg_value = g_modbus_registers.temperature;
-                        break;
-                    case REG_ERROR_COUNT_ADDR:
-                        reg_value = g_modbus_registers.error_count;
-                        break;
-                    default:
-                        reg_value = 0;
-                        break;
-                }
-                
-                // 高字节在前
-                response_data[data_pos++] = (reg_value >> 8) & 0xFF;
-                response_data[data_pos++] = reg_value & 0xFF;
+                Log_Error("Modbus: Illegal read - Start=0x%04X, Count=%d", start_addr, register_count);
+                Modbus_BuildExceptionResponse(slave_addr, function_code, exception, tx_buffer, tx_length);
+                return true;
             }
             
-            // 构建响应帧
-            Log_Debug("Modbus: Building response with %d bytes", data_pos);
-            Modbus_BuildResponse(slave_addr, function_code, response_data, data_pos, tx_buffer, tx_length);
+            uint16_t pos = 3 + register_count * 2;
+            tx_buffer[pos++] = crc & 0xFF;           // CRC低字节在前
+            tx_buffer[pos++] = (crc >> 8) & 0xFF;   // CRC高字节在后
+            *tx_length = pos;
             return true;
         }
         
-        case MODBUS_READ_INPUT_REGISTERS:
+        case MODBUS_WRITE_SINGLE_REGISTER:
+        case MODBUS_WRITE_MULTIPLE_REGISTERS:
         {
-            // 读取输入寄存器 (功能码 0x04)
+            // 写单个寄存器 (功能码 0x06) / 写多个寄存器 (功能码 0x10)
             uint16_t start_addr = (rx_buffer[2] << 8) | rx_buffer[3];
-            uint16_t register_count = (rx_buffer[4] << 8) | rx_buffer[5];
+            uint16_t register_count = 1;
+            const uint8_t* values = &rx_buffer[4];
             
-            Log_Debug("Modbus: Read Input Registers - Start=0x%04X, Count=%d", start_addr, register_count);
-            
-            // 检查地址和数量范围
-            if (start_addr + register_count > MODBUS_REGISTER_COUNT)
+            if (function_code == MODBUS_WRITE_MULTIPLE_REGISTERS)
+            {
+                register_count = (rx_buffer[4] << 8) | rx_buffer[5];
+                values = &rx_buffer[7];
+                
+                // 字节数必须与寄存器数和帧长度一致
+                if (rx_length < 9 || rx_buffer[6] != register_count * 2 || rx_length != 9 + rx_buffer[6])
+                {
+                    Log_Error("Modbus: Write length mismatch, length=%d", rx_length);
+                    Modbus_BuildExceptionResponse(slave_addr, function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, tx_buffer, tx_length);
+                    return true;
+                }
+            }
+            else if (rx_length != 8)
             {
-                Log_Error("Modbus: Illegal data address - Start=0x%04X, Count=%d, Max=%d", 
-                         start_addr, register_count, MODBUS_REGISTER_COUNT);
-                Modbus_BuildExceptionResponse(slave_addr, function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR, tx_buffer, tx_length);
+                Log_Error("Modbus: Write length mismatch, length=%d", rx_length);
+                Modbus_BuildExceptionResponse(slave_addr, function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, tx_buffer, tx_length);
                 return true;
             }
             
-            // 构建响应数据（与保持寄存器相同）
-            uint8_t response_data[64];
-            uint16_t data_pos = 0;
- 
-            for (uint16_t i = 0; i < register_count; i++)
+            uint8_t exception = ModbusRegs_Write(start_addr, register_count, values);
+            if (exception != 0)
             {
-                uint16_t reg_addr = start_addr + i;
-                uint16_t reg_value = 0;
-                
-                switch (reg_addr)
-                {
-                    case REG_PRESSURE_ADDR:
-                        // 发送任务通知触发压力读取和LCD刷新，然后读取全局变量
-                        {
-                            if (g_PressureTaskHandle != NULL) {
-                                osThreadFlagsSet(g_PressureTaskHandle, 0x01);  /* 发送压力任务通知 */
-                                Log_Debug("Modbus: Sent pressure task notification");
-                            }
-                            
-                            if (g_LCDTaskHandle != NULL) {
-                                osThreadFlagsSet(g_LCDTaskHandle, 0x01);  /* 发送LCD任务通知 */
-                                Log_Debug("Modbus: Sent LCD task notification");
-                            }
-                            
-                            /* 等待一小段时间让压力任务完成读取 */
-                            osDelay(100);  /* 等待100ms */
-                            
-                            /* 读取最新的全局压力值 */
-                            double pressure_value = PressureSensor_GetLatestValue();
-                            if (pressure_value != PRESSURE_READ_ERROR)
-                            {
-                                // 将压力值*10000后存储到寄存器
-                                uint16_t pressure_scaled = (uint16_t)(pressure_value * 10000);
-                                g_modbus_registers.pressure = pressure_scaled;
-                                Log_Info("Modbus: Pressure read via task notification: %.4f MPa, scaled: %d", pressure_value, pressure_scaled);
-                            }
-                            else
-                            {
-                                Log_Warn("Modbus: Failed to get pressure value after task notification");
-                            }
-                        }
-                        reg_value = g_modbus_registers.pressure;
-                        break;
-                    case REG_TEMPERATURE_ADDR:
-                        // 发送任务通知触发DHT11采集和LCD刷新，然后读取全局变量
-                        {
-                            if (g_DHT11TaskHandle != NULL) {
-                                osThreadFlagsSet(g_DHT11TaskHandle, 0x01);  /* 发送DHT11任务通知 */
-                                Log_Info("Modbus: Sent DHT11 task notification");
-                            } else {
-                                Log_Warn("Modbus: g_DHT11TaskHandle is NULL");
-                            }
-                            
-                            if (g_LCDTaskHandle != NULL) {
-                                osThreadFlagsSet(g_LCDTaskHandle, 0x01);  /* 发送LCD任务通知 */
-                                Log_Info("Modbus: Sent LCD task notification");
-                            } else {
-                                Log_Warn("Modbus: g_LCDTaskHandle is NULL");
-                            }
-                            
-                            /* 等待一小段时间让dht11任务完成读取 */
-                            osDelay(100);  /* 等待100ms */
-                            
-                            /* 读取最新的全局温度值 */
-                            float temp_value = TemperatureSensor_GetLatestValue();
-                            
-                                // 将压力值*10000后存储到寄存器
-                                uint16_t temp_scaled = (uint16_t)(temp_value * 10000);
-                                g_modbus_registers.temperature = temp_scaled;
-                                Log_Info("Modbus: Temperature read via task notification: %.2f C, scaled: %d", temp_value, temp_scaled);
-                        }
-                        reg_value = g_modbus_registers.temperature;
-                        break;
-                    case REG_HUMIDITY_ADDR:
-                        reg_value = g_modbus_registers.humidity;
-                        break;
-                    default:
-                        reg_value = 0;
-                        break;
-                }
-                
-                response_data[data_pos++] = (reg_value >> 8) & 0xFF;
-                response_data[data_pos++] = reg_value & 0xFF;
+                Log_Error("Modbus: Illegal write - Start=0x%04X, Count=%d", start_addr, register_count);
+                Modbus_BuildExceptionResponse(slave_addr, function_code, exception, tx_buffer, tx_length);
+                return true;
             }
             
-            Log_Debug("Modbus: Building response with %d bytes", data_pos);
-            Modbus_BuildResponse(slave_addr, function_code, response_data, data_pos, tx_buffer, tx_length);
+            // 应答为请求的前6字节（地址、功能码、起始地址、值或数量）加CRC
+            memcpy(tx_buffer, rx_buffer, 6);
+            uint16_t crc = Modbus_CalculateCRC16(tx_buffer, 6);
+            tx_buffer[6] = crc & 0xFF;           // CRC低字节在前
+            tx_buffer[7] = (crc >> 8) & 0xFF;   // CRC高字节在后
+            *tx_length = 8;
+            return true;
+        }
+        
+        case MODBUS_READ_FILE_RECORD:
+        {
+            // 读文件记录 (功能码 0x14)：列存储中的历史样本，应答直接生成在发送缓冲区中
+            uint8_t exception = ModbusFile_Read(rx_buffer, rx_length, tx_buffer, tx_length);
+            if (exception != 0)
+            {
+                Log_Error("Modbus: Illegal file record read, exception %d", exception);
+                Modbus_BuildExceptionResponse(slave_addr, function_code, exception, tx_buffer, tx_length);
+            }
             return true;
         }
         
@@ -522,6 +373,7 @@ void SensorData_UpdatePressure(double pressure_value)
     g_sensor_data.pressure_value = pressure_value;
     g_sensor_data.pressure_timestamp = HAL_GetTick();
     g_sensor_data.pressure_valid = 1;
+    g_sensor_data.restored &= ~WARM_STATE_VALID_PRESSURE;
     
     // 同时更新Modbus寄存器
     uint16_t pressure_scaled = (uint16_t)(pressure_value * 10000);
@@ -537,7 +389,9 @@ void SensorData_UpdatePressure(double pressure_value)
 void SensorData_UpdateTemperature(float temperature_value)
 {
     g_sensor_data.temperature = temperature_value;
+    g_sensor_data.temperature_timestamp = HAL_GetTick();
     g_sensor_data.temperature_valid = 1;
+    g_sensor_data.restored &= ~WARM_STATE_VALID_TEMPERATURE;
     
     // 同时更新Modbus寄存器
     int16_t temp_int = (int16_t)(temperature_value * 10);
@@ -554,7 +408,9 @@ void SensorData_UpdateTemperature(float temperature_value)
 void SensorData_UpdateHumidity(float humidity_value)
 {
     g_sensor_data.humidity = humidity_value;
+    g_sensor_data.humidity_timestamp = HAL_GetTick();
     g_sensor_data.humidity_valid = 1;
+    g_sensor_data.restored &= ~WARM_STATE_VALID_HUMIDITY;
     
     // 同时更新Modbus寄存器
     int16_t humidity_int = (int16_t)(humidity_value * 10);
@@ -577,6 +433,9 @@ void SensorData_UpdateSystemStatus(uint16_t status)
     // 同时更新Modbus寄存器
     g_modbus_registers.status = status;
     
+    // 状态变化时保存热启动快照
+    WarmState_RequestSave();
+    
     Log_Info("Sensor data: System status updated to 0x%04X", status);
 }
 
@@ -593,6 +452,9 @@ void SensorData_UpdateErrorCount(uint16_t error_count)
     // 同时更新Modbus寄存器
     g_modbus_registers.error_count = error_count;
     
+    // 错误计数变化时保存热启动快照
+    WarmState_RequestSave();
+    
     Log_Info("Sensor data: Error count updated to %d", error_count);
 }
 
@@ -605,3 +467,42 @@ GlobalSensorData_t* SensorData_GetGlobalData(void)
 {
     return &g_sensor_data;
 }
+
+
+/**
+ * @brief 获取传感器数据年龄
+ * @param sensor SENSOR_DATA_xxx
+ * @return 距最近一次采集的时间（ms，最大SENSOR_DATA_AGE_MAX），本次启动后尚未采集
+ *         返回SENSOR_DATA_AGE_UNKNOWN
+ */
+uint16_t SensorData_GetAge(uint8_t sensor)
+{
+    uint32_t timestamp;
+    uint8_t valid;
+    
+    switch (sensor)
+    {
+        case SENSOR_DATA_PRESSURE:
+            timestamp = g_sensor_data.pressure_timestamp;
+            valid = g_sensor_data.pressure_valid;
+            break;
+        case SENSOR_DATA_TEMPERATURE:
+            timestamp = g_sensor_data.temperature_timestamp;
+            valid = g_sensor_data.temperature_valid;
+            break;
+        case SENSOR_DATA_HUMIDITY:
+            timestamp = g_sensor_data.humidity_timestamp;
+            valid = g_sensor_data.humidity_valid;
+            break;
+        default:
+            return SENSOR_DATA_AGE_UNKNOWN;
+    }
+    
+    // 热启动恢复的值没有本次启动的时间戳
+    if (!valid || (g_sensor_data.restored & sensor)) {
+        return SENSOR_DATA_AGE_UNKNOWN;
+    }
+    
+    uint32_t age = HAL_GetTick() - timestamp;
+    return (age > SENSOR_DATA_AGE_MAX) ? SENSOR_DATA_AGE_MAX : (uint16_t)age;
+}
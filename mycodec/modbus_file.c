@@ -0,0 +1,188 @@
+#include "modbus_file.h"
+#include "modbus.h"
+#include "flash_column.h"
+#include "flash_io.h"
+#include "record_codec.h"
+#include <string.h>
+
+#if FLASH_COLUMN_STORE_ENABLE
+
+/* 一个子请求 */
+typedef struct {
+    uint8_t column;             /* 列号 */
+    uint8_t width;              /* 列宽（字节） */
+    uint8_t size;               /* 每个样本在应答中的字节数（寄存器数x2） */
+    uint16_t samples;           /* 样本数 */
+    uint32_t first;             /* 起始样本序号 */
+} ModbusFileRead_t;
+
+/* 在Flash I/O服务任务中执行的读取：按已检查的请求把各列读入应答 */
+typedef struct {
+    const uint8_t *request;
+    uint8_t *response;
+    uint8_t count;              /* 子请求数 */
+} ModbusFileJob_t;
+
+/**
+ * @brief 解析一个子请求
+ * @param sub 子请求（参考类型、文件号、记录号、记录长度）
+ * @return 异常码，0为正常
+ */
+static uint8_t ModbusFile_Parse(const uint8_t *sub, ModbusFileRead_t *read)
+{
+    uint16_t file = (sub[1] << 8) | sub[2];
+    uint16_t record = (sub[3] << 8) | sub[4];
+    uint16_t length = (sub[5] << 8) | sub[6];
+    uint16_t stream = file >> MODBUS_FILE_STREAM_SHIFT;
+
+    if (sub[0] != MODBUS_FILE_REFERENCE_TYPE || stream == 0 || record >= MODBUS_FILE_WINDOW_RECORDS) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+
+    const FlashColumnDesc_t *column = FlashColumn_GetColumn(stream - 1);
+    if (column == NULL) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+
+    uint8_t registers = (column->width + 1) / 2;
+    if (length == 0 || length % registers != 0) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+
+    read->column = stream - 1;
+    read->width = column->width;
+    read->size = registers * 2;
+    read->samples = length / registers;
+    read->first = (uint32_t)(file & MODBUS_FILE_WINDOW_MASK) * MODBUS_FILE_WINDOW_RECORDS + record;
+
+    /* 一个子应答（长度、参考类型和寄存器）不能超过应答数据长度上限 */
+    if (2 + (uint32_t)read->samples * read->size > MODBUS_FILE_MAX_DATA) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if (record + read->samples > MODBUS_FILE_WINDOW_RECORDS) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+    return 0;
+}
+
+/**
+ * @brief 读取各子请求的列值到应答中对应的位置
+ * @note 在Flash I/O服务任务中执行，每个子请求的值读到寄存器区的开头
+ */
+static FlashResult_t ModbusFile_ReadJob(void *context)
+{
+    const ModbusFileJob_t *job = (const ModbusFileJob_t*)context;
+    uint8_t *data = &job->response[3];
+    ModbusFileRead_t read;
+
+    for (uint8_t i = 0; i < job->count; i++) {
+        ModbusFile_Parse(&job->request[3 + i * MODBUS_FILE_SUBREQUEST_SIZE], &read);
+
+        FlashResult_t result = FlashColumn_ReadColumn(read.column, read.first, read.samples, data + 2);
+        if (result != FLASH_OK) {
+            return result;
+        }
+        data += 2 + read.samples * read.size;
+    }
+    return FLASH_OK;
+}
+
+/**
+ * @brief 把列的原始值（小端）原地转换为大端寄存器
+ * @note 从最后一个样本向前转换，写入的位置不会覆盖尚未转换的值
+ */
+static void ModbusFile_ToRegisters(const ModbusFileRead_t *read, uint8_t *data)
+{
+    for (uint16_t i = read->samples; i-- > 0; ) {
+        uint32_t value = RecordCodec_GetLE(&data[i * read->width], read->width);
+        uint8_t *out = &data[i * read->size];
+
+        for (uint8_t b = read->size; b-- > 0; ) {
+            out[b] = value & 0xFF;
+            value >>= 8;
+        }
+    }
+}
+
+/**
+ * @brief 处理FC 0x14读文件记录请求
+ * @param request 请求帧（含CRC）
+ * @param request_length 帧长度
+ * @param response 发送缓冲区，至少MODBUS_RTU_MAX_FRAME字节
+ * @param response_length 应答长度
+ * @return 异常码，0为已生成应答
+ * @note 先检查全部子请求和应答长度，再一次提交到Flash I/O服务任务读取；
+ *       调用的任务在读取期间阻塞
+ */
+uint8_t ModbusFile_Read(const uint8_t *request, uint16_t request_length, uint8_t *response, uint16_t *response_length)
+{
+    ModbusFileJob_t job;
+    ModbusFileRead_t read;
+    uint8_t byte_count = request[2];
+    uint32_t data_length = 0;
+
+    if (request_length < 5 || byte_count < MODBUS_FILE_MIN_BYTE_COUNT || byte_count > MODBUS_FILE_MAX_BYTE_COUNT ||
+        byte_count % MODBUS_FILE_SUBREQUEST_SIZE != 0 || request_length != 5 + byte_count) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+
+    job.request = request;
+    job.response = response;
+    job.count = byte_count / MODBUS_FILE_SUBREQUEST_SIZE;
+
+    for (uint8_t i = 0; i < job.count; i++) {
+        uint8_t exception = ModbusFile_Parse(&request[3 + i * MODBUS_FILE_SUBREQUEST_SIZE], &read);
+        if (exception != 0) {
+            return exception;
+        }
+        if (data_length + 2 + read.samples * read.size > MODBUS_FILE_MAX_DATA) {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        data_length += 2 + read.samples * read.size;
+    }
+
+    if (!FlashIo_IsReady()) {
+        return MODBUS_EXCEPTION_SLAVE_DEVICE_BUSY;
+    }
+
+    FlashResult_t result = FlashIo_Call(FLASH_IO_INTERACTIVE, ModbusFile_ReadJob, &job);
+    if (result == FLASH_ERROR_NOT_FOUND) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+    if (result != FLASH_OK) {
+        return MODBUS_EXCEPTION_SLAVE_DEVICE_FAILURE;
+    }
+
+    /* 子应答：长度（参考类型+数据）、参考类型、寄存器 */
+    uint8_t *data = &response[3];
+    for (uint8_t i = 0; i < job.count; i++) {
+        ModbusFile_Parse(&request[3 + i * MODBUS_FILE_SUBREQUEST_SIZE], &read);
+        data[0] = 1 + read.samples * read.size;
+        data[1] = MODBUS_FILE_REFERENCE_TYPE;
+        ModbusFile_ToRegisters(&read, data + 2);
+        data += 2 + read.samples * read.size;
+    }
+
+    uint16_t pos = 3 + data_length;
+    response[0] = request[0];
+    response[1] = MODBUS_READ_FILE_RECORD;
+    response[2] = data_length;
+    uint16_t crc = Modbus_CalculateCRC16(response, pos);
+    response[pos++] = crc & 0xFF;           // CRC低字节在前
+    response[pos++] = (crc >> 8) & 0xFF;   // CRC高字节在后
+    *response_length = pos;
+    return 0;
+}
+
+#else
+
+uint8_t ModbusFile_Read(const uint8_t *request, uint16_t request_length, uint8_t *response, uint16_t *response_length)
+{
+    (void)request;
+    (void)request_length;
+    (void)response;
+    (void)response_length;
+    return MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+}
+
+#endif /* FLASH_COLUMN_STORE_ENABLE */
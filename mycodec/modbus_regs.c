@@ -0,0 +1,323 @@
+#include "modbus_regs.h"
+#include "modbus.h"
+#include "tuning.h"
+#include "flash.h"
+#include "log.h"
+#include "warm_state.h"
+#include "crc.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/* External task handles for task notification */
+extern osThreadId_t g_PressureTaskHandle;
+extern osThreadId_t g_DHT11TaskHandle;
+
+#define MODBUS_REG_NONE              0xFF                  /* 地址没有描述符 */
+
+static uint16_t ModbusRegs_ReadAge(uint16_t offset);
+static bool ModbusRegs_CheckTuning(uint16_t offset, uint16_t value);
+static void ModbusRegs_WriteTuning(uint16_t offset, uint16_t value);
+static uint16_t ModbusRegs_ReadLogLevel(uint16_t offset);
+static bool ModbusRegs_CheckLogLevel(uint16_t offset, uint16_t value);
+static void ModbusRegs_WriteLogLevel(uint16_t offset, uint16_t value);
+static uint16_t ModbusRegs_ReadSave(uint16_t offset);
+static bool ModbusRegs_CheckSave(uint16_t offset, uint16_t value);
+static void ModbusRegs_WriteSave(uint16_t offset, uint16_t value);
+
+/* 刷新通知 */
+static uint32_t g_refresh_tick_dht11;
+static uint32_t g_refresh_tick_pressure;
+static uint32_t g_refresh_requests;
+
+#define MODBUS_REG_RW                (MODBUS_REG_ACCESS_READ | MODBUS_REG_ACCESS_WRITE)
+
+/* 寄存器表，按地址排列 */
+static const ModbusRegister_t g_modbus_register_map[] = {
+    /* 地址                         数量                   访问                       镜像                              读取函数                 写入函数                  检查函数                  参数                     刷新 */
+    { MODBUS_REG_ERROR_COUNT_ADDR,  1,                     MODBUS_REG_ACCESS_READ,    &g_modbus_registers.error_count,  NULL,                    NULL,                     NULL,                     0,                       0 },
+    { MODBUS_REG_TEMPERATURE_ADDR,  1,                     MODBUS_REG_ACCESS_READ,    &g_modbus_registers.temperature,  NULL,                    NULL,                     NULL,                     0,                       SENSOR_DATA_TEMPERATURE },
+    { MODBUS_REG_PRESSURE_ADDR,     1,                     MODBUS_REG_ACCESS_READ,    &g_modbus_registers.pressure,     NULL,                    NULL,                     NULL,                     0,                       SENSOR_DATA_PRESSURE },
+    { MODBUS_REG_HUMIDITY_ADDR,     1,                     MODBUS_REG_ACCESS_READ,    &g_modbus_registers.humidity,     NULL,                    NULL,                     NULL,                     0,                       SENSOR_DATA_HUMIDITY },
+    { MODBUS_REG_STATUS_ADDR,       1,                     MODBUS_REG_ACCESS_READ,    &g_modbus_registers.status,       NULL,                    NULL,                     NULL,                     0,                       0 },
+    { MODBUS_REG_MAX_AGE_ADDR,      1,                     MODBUS_REG_RW,             &g_tuning.max_age_ms,             NULL,                    ModbusRegs_WriteTuning,   ModbusRegs_CheckTuning,   TUNING_MAX_AGE,          0 },
+    { MODBUS_REG_AGE_ADDR,          3,                     MODBUS_REG_ACCESS_READ,    NULL,                             ModbusRegs_ReadAge,      NULL,                     NULL,                     0,                       0 },
+    { MODBUS_REG_TUNING_ADDR,       TUNING_COUNT - 1,      MODBUS_REG_RW,             &g_tuning.pressure_period_ms,     NULL,                    ModbusRegs_WriteTuning,   ModbusRegs_CheckTuning,   TUNING_PRESSURE_PERIOD,  0 },
+    { MODBUS_REG_LOG_LEVEL_ADDR,    1,                     MODBUS_REG_RW,             NULL,                             ModbusRegs_ReadLogLevel, ModbusRegs_WriteLogLevel, ModbusRegs_CheckLogLevel, 0,                       0 },
+    { MODBUS_REG_TUNING_SAVE_ADDR,  1,                     MODBUS_REG_RW,             NULL,                             ModbusRegs_ReadSave,     ModbusRegs_WriteSave,     ModbusRegs_CheckSave,     0,                       0 },
+    { MODBUS_REG_FLASH_STATS_ADDR,  FLASH_STATS_REG_COUNT, MODBUS_REG_ACCESS_INPUT,   NULL,                             Flash_GetStatsRegister,  NULL,                     NULL,                     0,                       0 },
+};
+
+#define MODBUS_REG_MAP_SIZE          (sizeof(g_modbus_register_map) / sizeof(g_modbus_register_map[0]))
+
+/* 地址到描述符的索引 */
+static uint8_t g_modbus_reg_index[MODBUS_REGISTER_COUNT];
+
+/**
+ * @brief 建立地址索引
+ * @note 在Modbus_Init中调用
+ */
+void ModbusRegs_Init(void)
+{
+    memset(g_modbus_reg_index, MODBUS_REG_NONE, sizeof(g_modbus_reg_index));
+
+    for (uint8_t i = 0; i < MODBUS_REG_MAP_SIZE; i++) {
+        const ModbusRegister_t *reg = &g_modbus_register_map[i];
+
+        for (uint16_t n = 0; n < reg->count && reg->address + n < MODBUS_REGISTER_COUNT; n++) {
+            if (g_modbus_reg_index[reg->address + n] != MODBUS_REG_NONE) {
+                Log_Error("Modbus: register 0x%04X mapped twice", reg->address + n);
+            }
+            g_modbus_reg_index[reg->address + n] = i;
+        }
+    }
+}
+
+/**
+ * @brief 查找可按access读取的描述符
+ * @return 没有描述符或不允许访问时返回NULL
+ */
+static const ModbusRegister_t* ModbusRegs_FindReadable(uint16_t address, uint8_t access)
+{
+    uint8_t index = g_modbus_reg_index[address];
+
+    if (index == MODBUS_REG_NONE || (g_modbus_register_map[index].access & access) == 0) {
+        return NULL;
+    }
+    return &g_modbus_register_map[index];
+}
+
+/**
+ * @brief 读取连续寄存器（高字节在前）
+ * @param start 起始地址
+ * @param count 寄存器数
+ * @param access MODBUS_REG_ACCESS_HOLDING或MODBUS_REG_ACCESS_INPUT
+ * @param data 输出缓冲区，至少count*2字节
+ * @param crc 非NULL时输入之前字节的CRC-16/MODBUS，按输出的数据继续计算后返回；
+ *            每段写入后立即计算，应答不需要再遍历一次
+ * @return uint8_t 0: 成功，其他: Modbus异常码
+ */
+uint8_t ModbusRegs_Read(uint16_t start, uint16_t count, uint8_t access, uint8_t *data, uint16_t *crc)
+{
+    if (count == 0 || count > MODBUS_MAX_READ_REGISTERS) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if ((uint32_t)start + count > MODBUS_REGISTER_COUNT) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+
+    uint16_t address = start;
+    uint16_t end = start + count;
+    uint8_t refresh = 0;
+
+    while (address < end) {
+        const ModbusRegister_t *reg = ModbusRegs_FindReadable(address, access);
+        uint8_t *segment = data;
+
+        if (reg == NULL) {
+            /* 连续的不可读地址读为0 */
+            do {
+                *data++ = 0;
+                *data++ = 0;
+                address++;
+            } while (address < end && ModbusRegs_FindReadable(address, access) == NULL);
+        } else {
+            /* 一段连续寄存器 */
+            refresh |= reg->refresh;
+            uint16_t offset = address - reg->address;
+            uint16_t n = reg->count - offset;
+            if (n > end - address) {
+                n = end - address;
+            }
+
+            if (reg->image != NULL) {
+                const volatile uint16_t *value = reg->image + offset;
+                for (uint16_t i = 0; i < n; i++) {
+                    uint16_t v = value[i];
+                    *data++ = v >> 8;
+                    *data++ = v & 0xFF;
+                }
+            } else {
+                /* 读取函数不阻塞；一段内锁调度器，32位计数的高低字取自同一时刻 */
+                int32_t lock = osKernelLock();
+                for (uint16_t i = 0; i < n; i++) {
+                    uint16_t v = reg->get(reg->arg + offset + i);
+                    *data++ = v >> 8;
+                    *data++ = v & 0xFF;
+                }
+                osKernelRestoreLock(lock);
+            }
+
+            address += n;
+        }
+
+        if (crc != NULL) {
+            *crc = Crc16Modbus_Update(*crc, segment, data - segment);
+        }
+    }
+
+    if (refresh != 0) {
+        ModbusRegs_RequestRefresh(refresh);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 写入连续寄存器（高字节在前）
+ * @param start 起始地址
+ * @param count 寄存器数
+ * @param data 寄存器值，count*2字节
+ * @return uint8_t 0: 成功，其他: Modbus异常码
+ * @note 全部地址可写且全部值合格才写入，写入期间锁定调度器
+ */
+uint8_t ModbusRegs_Write(uint16_t start, uint16_t count, const uint8_t *data)
+{
+    uint8_t exception = 0;
+
+    if (count == 0 || count > MODBUS_MAX_WRITE_REGISTERS) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if ((uint32_t)start + count > MODBUS_REGISTER_COUNT) {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+    }
+
+    /* 地址错误优先于值错误 */
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t address = start + i;
+        uint8_t index = g_modbus_reg_index[address];
+        const ModbusRegister_t *reg = (index != MODBUS_REG_NONE) ? &g_modbus_register_map[index] : NULL;
+
+        if (reg == NULL || (reg->access & MODBUS_REG_ACCESS_WRITE) == 0) {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR;
+        }
+
+        uint16_t value = (data[i * 2] << 8) | data[i * 2 + 1];
+        if (!reg->check(reg->arg + address - reg->address, value)) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+    }
+    if (exception != 0) {
+        return exception;
+    }
+
+    int32_t lock = osKernelLock();
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t address = start + i;
+        const ModbusRegister_t *reg = &g_modbus_register_map[g_modbus_reg_index[address]];
+        reg->set(reg->arg + address - reg->address, (data[i * 2] << 8) | data[i * 2 + 1]);
+    }
+    osKernelRestoreLock(lock);
+
+    return 0;
+}
+
+/**
+ * @brief 请求刷新超过最大数据年龄的传感器值，不等待采集
+ * @param sensors SENSOR_DATA_xxx
+ * @note 最大数据年龄为0时不按读取刷新，只靠采集任务周期采样
+ */
+void ModbusRegs_RequestRefresh(uint8_t sensors)
+{
+    uint16_t max_age = g_tuning.max_age_ms;
+    uint32_t now = HAL_GetTick();
+
+    if (max_age == 0) {
+        return;
+    }
+
+    /* 多个端口的任务可能同时请求，检查和更新通知时间期间锁定调度器 */
+    int32_t lock = osKernelLock();
+
+    /* DHT11同时采集温度和湿度 */
+    if ((sensors & (SENSOR_DATA_TEMPERATURE | SENSOR_DATA_HUMIDITY)) &&
+        (SensorData_GetAge(SENSOR_DATA_TEMPERATURE) > max_age || SensorData_GetAge(SENSOR_DATA_HUMIDITY) > max_age) &&
+        now - g_refresh_tick_dht11 >= MODBUS_REFRESH_INTERVAL_MS && g_DHT11TaskHandle != NULL) {
+        g_refresh_tick_dht11 = now;
+        g_refresh_requests++;
+        osThreadFlagsSet(g_DHT11TaskHandle, 0x01);  /* 发送DHT11任务通知 */
+    }
+
+    if ((sensors & SENSOR_DATA_PRESSURE) && SensorData_GetAge(SENSOR_DATA_PRESSURE) > max_age &&
+        now - g_refresh_tick_pressure >= MODBUS_REFRESH_INTERVAL_MS && g_PressureTaskHandle != NULL) {
+        g_refresh_tick_pressure = now;
+        g_refresh_requests++;
+        osThreadFlagsSet(g_PressureTaskHandle, 0x01);  /* 发送压力任务通知 */
+    }
+
+    osKernelRestoreLock(lock);
+}
+
+/**
+ * @brief 获取刷新通知次数
+ */
+uint32_t ModbusRegs_GetRefreshRequests(void)
+{
+    return g_refresh_requests;
+}
+
+/**
+ * @brief 数据年龄寄存器：温度、压力、湿度（与数值寄存器顺序相同）
+ */
+static uint16_t ModbusRegs_ReadAge(uint16_t offset)
+{
+    static const uint8_t sensors[3] = {SENSOR_DATA_TEMPERATURE, SENSOR_DATA_PRESSURE, SENSOR_DATA_HUMIDITY};
+
+    return (offset < 3) ? SensorData_GetAge(sensors[offset]) : 0;
+}
+
+/**
+ * @brief 运行参数寄存器，offset为TUNING_xxx
+ */
+static bool ModbusRegs_CheckTuning(uint16_t offset, uint16_t value)
+{
+    return Tuning_Check(offset, value);
+}
+
+static void ModbusRegs_WriteTuning(uint16_t offset, uint16_t value)
+{
+    Tuning_Set(offset, value);
+}
+
+/**
+ * @brief 日志级别寄存器（LogLevel_t，由热启动快照保存）
+ */
+static uint16_t ModbusRegs_ReadLogLevel(uint16_t offset)
+{
+    (void)offset;
+    return (uint16_t)Log_GetLevel();
+}
+
+static bool ModbusRegs_CheckLogLevel(uint16_t offset, uint16_t value)
+{
+    (void)offset;
+    return value < LOG_LEVEL_MAX;
+}
+
+static void ModbusRegs_WriteLogLevel(uint16_t offset, uint16_t value)
+{
+    (void)offset;
+    Log_SetLevel((LogLevel_t)value);
+    WarmState_RequestSave();
+}
+
+/**
+ * @brief 保存寄存器：写MODBUS_TUNING_SAVE_VALUE请求保存运行参数，读出1表示保存尚未完成
+ */
+static uint16_t ModbusRegs_ReadSave(uint16_t offset)
+{
+    (void)offset;
+    return Tuning_IsSavePending() ? 1 : 0;
+}
+
+static bool ModbusRegs_CheckSave(uint16_t offset, uint16_t value)
+{
+    (void)offset;
+    return value == MODBUS_TUNING_SAVE_VALUE;
+}
+
+static void ModbusRegs_WriteSave(uint16_t offset, uint16_t value)
+{
+    (void)offset;
+    (void)value;
+    Tuning_RequestSave();
+}
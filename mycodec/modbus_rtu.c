@@ -0,0 +1,567 @@
+#include "modbus_rtu.h"
+#include "modbus.h"
+#include "ble_data.h"
+#include "usart.h"
+#include "tim.h"
+#include "crc.h"
+#include "bsp_dwt.h"
+#include "log.h"
+#include <string.h>
+
+/* RTU端口 */
+ModbusRtuPort_t g_modbus_rtu_usart2 = { .huart = &huart2, .htim = &htim4, .queue = &BLEQueueHandle, .tap = true };
+ModbusRtuPort_t g_modbus_rtu_usart3 = { .huart = &huart3, .htim = &htim5, .queue = &Usart3QueueHandle };
+
+/**
+ * @brief 环形缓冲区中从当前帧起点到position的字节数
+ */
+static uint16_t ModbusRtu_Pending(const ModbusRtuFramer_t *framer, uint16_t position)
+{
+    return (uint16_t)((position + framer->ring_size - framer->frame_start) % framer->ring_size);
+}
+
+/**
+ * @brief 计算环形缓冲区中一段数据的CRC（可能跨越缓冲区末尾）
+ * @param crc 前面数据的CRC，从头计算时为CRC16_MODBUS_INIT
+ */
+static uint16_t ModbusRtu_RingCrc(const ModbusRtuFramer_t *framer, uint16_t crc, uint16_t start, uint16_t length)
+{
+    uint16_t first = framer->ring_size - start;
+
+    if (first >= length) {
+        return Crc16Modbus_Update(crc, framer->ring + start, length);
+    }
+    return Crc16Modbus_Update(Crc16Modbus_Update(crc, framer->ring + start, first),
+                              framer->ring, length - first);
+}
+
+/**
+ * @brief 把已收到的字节计入当前帧的CRC
+ * @note 在IDLE和DMA半满/全满中断中调用，帧结束时只需计算最后一段
+ */
+static void ModbusRtu_UpdateCrc(ModbusRtuFramer_t *framer, uint16_t position)
+{
+    uint16_t length = (uint16_t)((position + framer->ring_size - framer->crc_position) % framer->ring_size);
+
+    if (length != 0) {
+        framer->crc = ModbusRtu_RingCrc(framer, framer->crc, framer->crc_position, length);
+        framer->crc_position = position;
+    }
+}
+
+/**
+ * @brief 输出当前帧起点开始的length个字节
+ */
+static void ModbusRtu_Emit(ModbusRtuFramer_t *framer, uint16_t length, uint16_t flags)
+{
+    if (flags & MODBUS_RTU_FRAME_OK) framer->stats.frames++;
+    if (flags & MODBUS_RTU_FRAME_CRC_ERROR) framer->stats.crc_errors++;
+    if (flags & MODBUS_RTU_FRAME_GAP_ERROR) framer->stats.gap_errors++;
+    if (flags & MODBUS_RTU_FRAME_LINE_ERROR) framer->stats.line_errors++;
+    if (flags & MODBUS_RTU_FRAME_PARTIAL) framer->stats.partial++;
+
+    framer->sink(framer, framer->frame_start, length, flags);
+    framer->frame_start = (uint16_t)((framer->frame_start + length) % framer->ring_size);
+    framer->crc = CRC16_MODBUS_INIT;
+    framer->crc_position = framer->frame_start;
+}
+
+/**
+ * @brief 超过最大帧长的连续数据分段输出，避免被DMA覆盖
+ */
+static void ModbusRtu_SplitLong(ModbusRtuFramer_t *framer, uint16_t position)
+{
+    while (ModbusRtu_Pending(framer, position) > MODBUS_RTU_MAX_FRAME) {
+        framer->flags |= MODBUS_RTU_FRAME_PARTIAL;
+        ModbusRtu_Emit(framer, MODBUS_RTU_MAX_FRAME, framer->flags);
+    }
+}
+
+#if MODBUS_CRC_COMPAT_SWAPPED
+/**
+ * @brief 当前帧的CRC是否为高字节在前（兼容旧主站）
+ * @note 只对CRC错误的帧调用，重新计算整帧CRC
+ */
+static bool ModbusRtu_IsSwappedCrc(const ModbusRtuFramer_t *framer, uint16_t length)
+{
+    uint16_t crc_high = (framer->frame_start + length - 2) % framer->ring_size;
+    uint16_t crc_low = (framer->frame_start + length - 1) % framer->ring_size;
+
+    return ModbusRtu_RingCrc(framer, CRC16_MODBUS_INIT, framer->frame_start, length - 2) ==
+           (framer->ring[crc_low] | ((uint16_t)framer->ring[crc_high] << 8));
+}
+#endif
+
+/**
+ * @brief 初始化帧定界
+ * @param ring DMA环形缓冲区
+ * @param ring_size 缓冲区大小，至少2倍MODBUS_RTU_MAX_FRAME
+ * @param position DMA当前写入位置
+ * @param sink 帧输出函数
+ * @param context 输出函数使用的参数
+ */
+void ModbusRtu_FramerInit(ModbusRtuFramer_t *framer, const uint8_t *ring, uint16_t ring_size,
+                          uint16_t position, ModbusRtuSink_t sink, void *context)
+{
+    memset(framer, 0, sizeof(ModbusRtuFramer_t));
+    framer->ring = ring;
+    framer->ring_size = ring_size;
+    framer->frame_start = position;
+    framer->idle_position = position;
+    framer->crc = CRC16_MODBUS_INIT;
+    framer->crc_position = position;
+    framer->sink = sink;
+    framer->context = context;
+}
+
+/**
+ * @brief 计算帧间隔时间
+ * @param baud_rate 波特率
+ * @param char_bits 每个字符的位数（起始位+数据位+校验位+停止位）
+ */
+void ModbusRtu_GetTiming(uint32_t baud_rate, uint32_t char_bits, ModbusRtuTiming_t *timing)
+{
+    timing->char_us = (char_bits * 1000000 + baud_rate - 1) / baud_rate;
+
+    if (baud_rate > MODBUS_RTU_FIXED_BAUD) {
+        timing->t15_us = MODBUS_RTU_FIXED_T15_US;
+        timing->t35_us = MODBUS_RTU_FIXED_T35_US;
+    } else {
+        timing->t15_us = timing->char_us * 3 / 2;
+        timing->t35_us = timing->char_us * 7 / 2;
+    }
+}
+
+/**
+ * @brief 线路空闲一个字符时间（IDLE中断）
+ * @param position DMA写入位置
+ * @param line_error 本段数据有校验、帧格式、噪声或溢出错误
+ * @note 调用者随后重新启动t1.5/t3.5定时器
+ */
+void ModbusRtu_OnIdle(ModbusRtuFramer_t *framer, uint16_t position, bool line_error)
+{
+    framer->stats.idle_events++;
+
+    if (line_error) {
+        framer->flags |= MODBUS_RTU_FRAME_LINE_ERROR;
+    }
+
+    /* 超过t1.5后又收到字节，整帧作废 */
+    if (framer->t15_expired) {
+        framer->flags |= MODBUS_RTU_FRAME_GAP_ERROR;
+    }
+
+    framer->t15_expired = false;
+    framer->idle_position = position;
+    ModbusRtu_SplitLong(framer, position);
+    ModbusRtu_UpdateCrc(framer, position);
+}
+
+/**
+ * @brief IDLE后t1.5（定时器比较中断）
+ */
+void ModbusRtu_OnT15(ModbusRtuFramer_t *framer, uint16_t position)
+{
+    framer->stats.timer_events++;
+
+    if (position == framer->idle_position) {
+        framer->t15_expired = true;
+    }
+}
+
+/**
+ * @brief 最后一个字符后t3.5（定时器更新中断）
+ * @note 期间没有新字节则当前帧结束：校验CRC后输出。CRC已在接收过程中计算到最近一次
+ *       IDLE，含CRC字节在内的整帧CRC为0即正确，不再遍历整帧
+ */
+void ModbusRtu_OnT35(ModbusRtuFramer_t *framer, uint16_t position)
+{
+    framer->stats.timer_events++;
+
+    /* 期间又收到字节，由下一次IDLE继续处理 */
+    if (position != framer->idle_position) {
+        return;
+    }
+
+    uint16_t length = ModbusRtu_Pending(framer, position);
+    uint16_t flags = framer->flags;
+
+    framer->flags = 0;
+    framer->t15_expired = false;
+
+    if (length == 0) {
+        return;
+    }
+
+    uint32_t start_cycles = DWT_GetTick();
+
+    if ((flags & (MODBUS_RTU_FRAME_PARTIAL | MODBUS_RTU_FRAME_GAP_ERROR | MODBUS_RTU_FRAME_LINE_ERROR)) == 0) {
+        /* CRC低字节在前 */
+        ModbusRtu_UpdateCrc(framer, position);
+
+        if (length >= MODBUS_RTU_MIN_FRAME && framer->crc == 0) {
+            flags |= MODBUS_RTU_FRAME_OK;
+#if MODBUS_CRC_COMPAT_SWAPPED
+        } else if (length >= MODBUS_RTU_MIN_FRAME && ModbusRtu_IsSwappedCrc(framer, length)) {
+            flags |= MODBUS_RTU_FRAME_OK;
+#endif
+        } else {
+            flags |= MODBUS_RTU_FRAME_CRC_ERROR;
+        }
+    }
+
+    ModbusRtu_Emit(framer, length, flags);
+
+    uint32_t cycles = DWT_GetTick() - start_cycles;
+    if (cycles > framer->stats.max_frame_cycles) {
+        framer->stats.max_frame_cycles = cycles;
+    }
+}
+
+/**
+ * @brief DMA半满/全满中断，检查超长数据
+ */
+void ModbusRtu_OnDmaEvent(ModbusRtuFramer_t *framer, uint16_t position)
+{
+    ModbusRtu_SplitLong(framer, position);
+    ModbusRtu_UpdateCrc(framer, position);
+}
+
+/**
+ * @brief 从环形缓冲区复制一帧
+ */
+void ModbusRtu_CopyFrame(const ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint8_t *buffer)
+{
+    uint16_t first = framer->ring_size - start;
+
+    if (first >= length) {
+        memcpy(buffer, framer->ring + start, length);
+    } else {
+        memcpy(buffer, framer->ring + start, first);
+        memcpy(buffer + first, framer->ring, length - first);
+    }
+}
+
+// ============================================================================
+// 端口：USART2（DMA接收）、USART3（RXNE中断接收）
+// ============================================================================
+
+/**
+ * @brief 端口是否用DMA接收（USART3没有链接DMA）
+ */
+static bool ModbusRtu_IsDma(const ModbusRtuPort_t *port)
+{
+    return port->huart->hdmarx != NULL;
+}
+
+/**
+ * @brief 接收环形缓冲区的当前写入位置
+ */
+static uint16_t ModbusRtu_RxPosition(const ModbusRtuPort_t *port)
+{
+    if (ModbusRtu_IsDma(port)) {
+        return (uint16_t)(MODBUS_RTU_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(port->huart->hdmarx));
+    }
+    return port->rx_position;
+}
+
+/**
+ * @brief 帧输出：复制到端口的消息队列
+ */
+static void ModbusRtu_QueueFrame(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags)
+{
+    ModbusRtuPort_t *port = (ModbusRtuPort_t*)framer->context;
+
+    port->message.length = length;
+    port->message.flags = flags;
+    port->message.timestamp = HAL_GetTick();
+    port->message.cycles = DWT_GetTick();
+    ModbusRtu_CopyFrame(framer, start, length, port->message.data);
+
+    if (osMessageQueuePut(*port->queue, &port->message, 0, 0) != osOK) {
+        framer->stats.dropped++;
+    }
+}
+
+/**
+ * @brief 查找UART对应的端口
+ */
+static ModbusRtuPort_t* ModbusRtu_FindPort(const UART_HandleTypeDef *huart)
+{
+    if (huart == g_modbus_rtu_usart2.huart) {
+        return &g_modbus_rtu_usart2;
+    }
+    if (huart == g_modbus_rtu_usart3.huart) {
+        return &g_modbus_rtu_usart3;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 接收DMA半满/全满回调
+ */
+static void ModbusRtu_DmaCallback(DMA_HandleTypeDef *hdma)
+{
+    ModbusRtuPort_t *port = ModbusRtu_FindPort((UART_HandleTypeDef*)hdma->Parent);
+
+    if (port != NULL) {
+        ModbusRtu_OnDmaEvent(&port->framer, ModbusRtu_RxPosition(port));
+    }
+}
+
+/**
+ * @brief 启动端口的RTU接收
+ * @note USART2在BLE_Init中调用，USART3在Usart3_Task中调用；UART出错后重新调用
+ */
+void ModbusRtu_Start(ModbusRtuPort_t *port)
+{
+    UART_HandleTypeDef *huart = port->huart;
+    TIM_HandleTypeDef *htim = port->htim;
+    ModbusRtuTiming_t timing;
+    uint32_t char_bits = 1 + ((huart->Init.WordLength == UART_WORDLENGTH_9B) ? 9 : 8) +
+                         ((huart->Init.StopBits == UART_STOPBITS_2) ? 2 : 1);
+
+    /* 停止之前的接收 */
+    __HAL_UART_DISABLE_IT(huart, UART_IT_IDLE);
+    __HAL_UART_DISABLE_IT(huart, UART_IT_RXNE);
+    if (ModbusRtu_IsDma(port)) {
+        CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+        HAL_DMA_Abort(huart->hdmarx);
+    }
+    __HAL_TIM_DISABLE(htim);
+
+    ModbusRtu_GetTiming(huart->Init.BaudRate, char_bits, &timing);
+
+    /* 单脉冲计时，1us计数；IDLE在最后一个字符结束后一个字符时间产生 */
+    SET_BIT(htim->Instance->CR1, TIM_CR1_OPM);
+    __HAL_TIM_SET_COUNTER(htim, 0);
+    __HAL_TIM_SET_COMPARE(htim, TIM_CHANNEL_1, timing.t15_us);
+    __HAL_TIM_SET_AUTORELOAD(htim, timing.t35_us - timing.char_us - 1);
+    __HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC1 | TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_IT(htim, TIM_IT_CC1 | TIM_IT_UPDATE);
+
+    port->rx_position = 0;
+    port->rx_line_error = false;
+    ModbusRtu_FramerInit(&port->framer, port->ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusRtu_QueueFrame, port);
+
+    if (ModbusRtu_IsDma(port)) {
+        /* 循环DMA，半满和全满中断只用于分段超长数据 */
+        huart->hdmarx->XferHalfCpltCallback = ModbusRtu_DmaCallback;
+        huart->hdmarx->XferCpltCallback = ModbusRtu_DmaCallback;
+        if (HAL_DMA_Start_IT(huart->hdmarx, (uint32_t)&huart->Instance->DR, (uint32_t)port->ring,
+                             MODBUS_RTU_RX_RING_SIZE) != HAL_OK) {
+            Log_Error("Modbus RTU: DMA start failed");
+            return;
+        }
+    }
+
+    /* 清除IDLE和错误标志（读SR后读DR） */
+    __HAL_UART_CLEAR_PEFLAG(huart);
+    if (ModbusRtu_IsDma(port)) {
+        SET_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+    } else {
+        __HAL_UART_ENABLE_IT(huart, UART_IT_RXNE);
+    }
+    __HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+
+    Log_Info("Modbus RTU: t1.5 %lu us, t3.5 %lu us", timing.t15_us, timing.t35_us);
+}
+
+/**
+ * @brief UART中断中调用，处理IDLE；中断接收的端口同时保存收到的字节
+ * @note DMA接收的端口不使能RXNE和错误中断，UART中断只由IDLE产生
+ */
+void ModbusRtu_UartIrq(ModbusRtuPort_t *port)
+{
+    UART_HandleTypeDef *huart = port->huart;
+    TIM_HandleTypeDef *htim = port->htim;
+    uint32_t sr = huart->Instance->SR;
+    bool line_error = (sr & (USART_SR_ORE | USART_SR_NE | USART_SR_FE | USART_SR_PE)) != 0U;
+
+    if (!ModbusRtu_IsDma(port) && (sr & USART_SR_RXNE)) {
+        /* 读DR同时清除RXNE、IDLE和错误标志 */
+        uint16_t position = port->rx_position;
+
+        port->ring[position] = (uint8_t)huart->Instance->DR;
+        position = (uint16_t)((position + 1) % MODBUS_RTU_RX_RING_SIZE);
+        port->rx_position = position;
+        port->rx_line_error |= line_error;
+
+        /* 相当于DMA半满/全满 */
+        if (position % (MODBUS_RTU_RX_RING_SIZE / 2) == 0) {
+            ModbusRtu_OnDmaEvent(&port->framer, position);
+        }
+    }
+
+    if ((sr & USART_SR_IDLE) == 0U) {
+        return;
+    }
+
+    /* 读SR后读DR清除IDLE和错误标志；DMA接收时新字节还没被取走则留给DMA，下次进入再清除 */
+    if ((sr & USART_SR_RXNE) == 0U) {
+        (void)huart->Instance->DR;
+    }
+
+    if (!ModbusRtu_IsDma(port)) {
+        line_error = port->rx_line_error;
+        port->rx_line_error = false;
+    }
+
+    /* 重新开始t1.5/t3.5计时 */
+    __HAL_TIM_DISABLE(htim);
+    __HAL_TIM_SET_COUNTER(htim, 0);
+    __HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC1 | TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE(htim);
+
+    ModbusRtu_OnIdle(&port->framer, ModbusRtu_RxPosition(port), line_error);
+}
+
+/**
+ * @brief 端口定时器中断中调用
+ */
+void ModbusRtu_TimerIrq(ModbusRtuPort_t *port)
+{
+    TIM_HandleTypeDef *htim = port->htim;
+    uint32_t sr = htim->Instance->SR;
+
+    if (sr & TIM_SR_CC1IF) {
+        __HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC1);
+        ModbusRtu_OnT15(&port->framer, ModbusRtu_RxPosition(port));
+    }
+
+    if (sr & TIM_SR_UIF) {
+        __HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_UPDATE);
+        ModbusRtu_OnT35(&port->framer, ModbusRtu_RxPosition(port));
+    }
+}
+
+/**
+ * @brief 获取端口帧定界统计
+ */
+const ModbusRtuStats_t* ModbusRtu_GetStats(const ModbusRtuPort_t *port)
+{
+    return &port->framer.stats;
+}
+
+/**
+ * @brief 开始从端口发送，不等待
+ * @note 有发送DMA的端口（USART2）用DMA，否则用中断；完成后向调用任务发送MODBUS_RTU_FLAG_TX_DONE
+ */
+static bool ModbusRtu_StartTransmit(ModbusRtuPort_t *port, const uint8_t *data, uint16_t length)
+{
+    port->tx_thread = osThreadGetId();
+    osThreadFlagsClear(MODBUS_RTU_FLAG_TX_DONE);
+
+    if (port->huart->hdmatx != NULL) {
+        return HAL_UART_Transmit_DMA(port->huart, (uint8_t*)data, length) == HAL_OK;
+    }
+    return HAL_UART_Transmit_IT(port->huart, (uint8_t*)data, length) == HAL_OK;
+}
+
+/**
+ * @brief 等待发送完成，超时则中止发送
+ */
+static bool ModbusRtu_WaitTransmit(ModbusRtuPort_t *port, uint32_t timeout)
+{
+    if (osThreadFlagsWait(MODBUS_RTU_FLAG_TX_DONE, osFlagsWaitAny, timeout) & osFlagsError) {
+        HAL_UART_AbortTransmit(port->huart);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 应答旁路：长度和前几个字节以DEBUG级别写入日志
+ * @note 只放入日志队列，由日志任务输出到串口1，不等待串口1；队列满时丢弃
+ */
+static void ModbusRtu_Tap(const uint8_t *data, uint16_t length)
+{
+#if MODBUS_RTU_TAP_ENABLE
+    static const char hex[] = "0123456789ABCDEF";
+    char line[MODBUS_RTU_TAP_BYTES * 2 + 1];
+    uint16_t n = (length < MODBUS_RTU_TAP_BYTES) ? length : MODBUS_RTU_TAP_BYTES;
+
+    if (Log_GetLevel() < LOG_LEVEL_DEBUG) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        line[i * 2] = hex[data[i] >> 4];
+        line[i * 2 + 1] = hex[data[i] & 0x0F];
+    }
+    line[n * 2] = '\0';
+    Log_Debug("TX %u B: %s%s", length, line, (length > n) ? ".." : "");
+#else
+    (void)data;
+    (void)length;
+#endif
+}
+
+/**
+ * @brief 处理端口收到的一个RTU帧并应答
+ * @param msg CRC正确的RTU帧
+ * @return 应答字节数，0为不应答（发给其他从机等）或发送失败
+ * @note 由处理该端口的任务调用，多个端口的任务可同时调用（共用寄存器表）。
+ *       应答生成在端口的发送缓冲区中，用DMA或中断发送，任务等待完成通知期间不占用CPU
+ */
+uint16_t ModbusRtu_Serve(ModbusRtuPort_t *port, BLEMessage_t *msg)
+{
+    ModbusRtuTxStats_t *stats = &port->tx_stats;
+    uint32_t start_cycles = DWT_GetTick();
+    uint16_t response_length = 0;
+
+    /* 帧定界已校验CRC，协议层只解析一次 */
+    if (msg->flags & MODBUS_RTU_FRAME_OK) {
+        Modbus_ProcessFrame(msg->data, msg->length, port->tx_buffer, &response_length);
+    }
+    if (response_length == 0) {
+        return 0;
+    }
+
+    bool started = ModbusRtu_StartTransmit(port, port->tx_buffer, response_length);
+    uint32_t tx_cycles = DWT_GetTick();
+
+    /* 发送期间输出旁路，不计入应答时间 */
+    if (port->tap) {
+        ModbusRtu_Tap(port->tx_buffer, response_length);
+    }
+    uint32_t cycles = DWT_GetTick() - start_cycles;
+
+    if (!started || !ModbusRtu_WaitTransmit(port, MODBUS_RTU_TX_TIMEOUT_MS)) {
+        stats->tx_errors++;
+        return 0;
+    }
+
+    /* 从本帧结束算起：任务处理前一帧期间，后一帧可能已经入队 */
+    uint32_t turnaround_us = (tx_cycles - msg->cycles) / (SystemCoreClock / 1000000);
+    stats->responses++;
+    stats->turnaround_total_us += turnaround_us;
+    if (turnaround_us > stats->turnaround_max_us) {
+        stats->turnaround_max_us = turnaround_us;
+    }
+    stats->cpu_total_cycles += cycles;
+    if (cycles > stats->cpu_max_cycles) {
+        stats->cpu_max_cycles = cycles;
+    }
+    return response_length;
+}
+
+/**
+ * @brief 获取端口应答统计
+ */
+const ModbusRtuTxStats_t* ModbusRtu_GetTxStats(const ModbusRtuPort_t *port)
+{
+    return &port->tx_stats;
+}
+
+/**
+ * @brief UART发送完成回调中调用，通知等待的任务
+ */
+void ModbusRtu_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    ModbusRtuPort_t *port = ModbusRtu_FindPort(huart);
+
+    if (port != NULL && port->tx_thread != NULL) {
+        osThreadFlagsSet(port->tx_thread, MODBUS_RTU_FLAG_TX_DONE);
+    }
+}
@@ -0,0 +1,2158 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    modbus_test.c
+  * @brief   This file provides test code for the Modbus RTU framer,
+  *          register map and request path.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "modbus_rtu.h"
+#include "modbus.h"
+#include "modbus_regs.h"
+#include "modbus_file.h"
+#include "flash_column.h"
+#include "flash_io.h"
+#include "tuning.h"
+#include "flash.h"
+#include "bsp_dwt.h"
+#include "log.h"
+
+/* USER CODE BEGIN Includes */
+#include <string.h>
+/* USER CODE END Includes */
+
+/* Private typedef -----------------------------------------------------------*/
+/* USER CODE BEGIN PTD */
+
+/* 回放的一段字节 */
+typedef struct {
+    const uint8_t *data;
+    uint16_t length;
+    uint32_t gap_us;            /* 段前静默时间（从上一个字符结束算起） */
+    uint16_t split_at;          /* 在段内第split_at个字节前插入split_gap_us静默，0为不插入 */
+    uint32_t split_gap_us;
+    bool noise;                 /* 段内字节带噪声错误 */
+} ModbusTestSegment_t;
+
+/* 双端口基准的一个端口：独立的环形缓冲区和帧定界，共用寄存器表 */
+typedef struct {
+    const char *name;
+    ModbusRtuFramer_t framer;
+    uint8_t ring[MODBUS_RTU_RX_RING_SIZE];
+    uint16_t position;          /* 写入位置 */
+    uint8_t request[8];         /* FC 0x03请求 */
+    uint16_t count;             /* 请求的寄存器数 */
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+    uint8_t response[MODBUS_RTU_MAX_FRAME];
+    uint32_t served;            /* 应答正确的请求 */
+    uint32_t errors;
+    uint32_t cycles;            /* 帧结束到应答生成的总周期数 */
+} ModbusTestPort_t;
+
+/* 文件记录测试的对照查询：在Flash I/O服务任务中按字段查询 */
+typedef struct {
+    uint32_t field;
+    uint32_t first;
+    uint32_t count;
+    uint32_t found;             /* 查询到的样本数 */
+    double *values;
+} ModbusTestScan_t;
+
+/* 一致性用例：按ModbusTest_BuildFrame构建请求，再按frame修改 */
+typedef struct {
+    const char *name;
+    uint8_t slave_addr;
+    uint8_t function_code;
+    uint16_t start;
+    uint16_t count;             /* FC 0x06为写入的值 */
+    uint8_t frame;              /* MODBUS_TEST_FRAME_xxx */
+    uint8_t expect;             /* 0为正常应答，异常码，或MODBUS_TEST_NO_REPLY */
+} ModbusTestConformance_t;
+
+/* USER CODE END PTD */
+
+/* Private define ------------------------------------------------------------*/
+/* USER CODE BEGIN PD */
+
+#define MODBUS_TEST_MAX_OUTPUTS  8                      /* 每个用例记录的输出数 */
+#define MODBUS_TEST_RATE_FRAMES  200                    /* 速率测试的连续帧数 */
+#define MODBUS_TEST_TIME_NEVER   0xFFFFFFFF
+#define MODBUS_TEST_READ_LOOPS   100                    /* 寄存器读取基准的重复次数 */
+#define MODBUS_TEST_REQUESTS     1000                   /* 请求速率基准的请求数 */
+#define MODBUS_TEST_MAX_LATENCY_US 2000                 /* 请求处理时间上限 */
+#define MODBUS_TEST_PORT_BAUD    115200                 /* 双端口基准的波特率 */
+#define MODBUS_TEST_FILE_SAMPLES 40                     /* 文件记录测试每个子请求的样本数 */
+
+/* 请求检查结果（其余为0或异常码） */
+#define MODBUS_TEST_NO_REPLY     0xFF                   /* 不应答 */
+#define MODBUS_TEST_INVALID      0xFE                   /* 应答不符合标准 */
+
+/* 一致性用例的帧修改 */
+#define MODBUS_TEST_FRAME_AS_BUILT    0
+#define MODBUS_TEST_FRAME_EXTRA       1                 /* CRC前多一个字节 */
+#define MODBUS_TEST_FRAME_SHORT       2                 /* CRC前少一个字节 */
+#define MODBUS_TEST_FRAME_BYTE_COUNT  3                 /* 字节数加1 */
+#define MODBUS_TEST_FRAME_BAD_CRC     4
+#define MODBUS_TEST_FRAME_TRUNCATED   5                 /* 只有地址、功能码和1个字节 */
+
+#define MODBUS_TEST_GUARD_SIZE   16                     /* 发送缓冲区之后的保护字节 */
+#define MODBUS_TEST_GUARD_BYTE   0xA5
+#define MODBUS_TEST_LOG_DRAIN_MS 100                    /* 等待日志队列发送完 */
+#define MODBUS_TEST_FUZZ_SEED    0x2545F491             /* 固定种子，失败可以复现 */
+#define MODBUS_TEST_FUZZ_FRAMES  20000                  /* 请求模糊测试的帧数 */
+#define MODBUS_TEST_FUZZ_STREAMS 500                    /* 帧定界模糊测试的字节流数 */
+#define MODBUS_TEST_FUZZ_SEGMENTS 4                     /* 每个字节流的段数 */
+#define MODBUS_TEST_FUZZ_CORPUS  16                     /* 语料帧数 */
+#define MODBUS_TEST_FUZZ_MAP_SHIFT 10                   /* 特征位图1024位 */
+#define MODBUS_TEST_FUZZ_REPORTS 4                      /* 输出的失败帧数 */
+
+/* USER CODE END PD */
+
+/* Private macro -------------------------------------------------------------*/
+/* USER CODE BEGIN PM */
+
+/* USER CODE END PM */
+
+/* Private variables ---------------------------------------------------------*/
+/* USER CODE BEGIN PV */
+
+/*
+ * 回放模型：字节在结束时由"DMA"写入环形缓冲区；最后一个字符结束后静默一个字符时间
+ * 产生IDLE，并按ModbusRtu_Start的设置启动单脉冲定时器（IDLE后t1.5比较，
+ * t3.5减一个字符时间更新），事件按时间顺序调用帧定界函数。
+ */
+static ModbusRtuFramer_t test_framer;
+static ModbusRtuTiming_t test_timing;
+static uint8_t test_ring[MODBUS_RTU_RX_RING_SIZE];
+static uint16_t test_position;                          /* DMA写入位置 */
+static uint32_t test_last_end;                          /* 最后一个字符结束时间 */
+static bool test_idle_pending;                          /* 最后一个字符后还没有IDLE */
+static bool test_line_error;
+static bool test_timer_running;
+static bool test_t15_done;
+static uint32_t test_t15_time;
+static uint32_t test_t35_time;
+
+/* 输出记录 */
+static uint16_t test_output_count;
+static uint16_t test_output_length[MODBUS_TEST_MAX_OUTPUTS];
+static uint16_t test_output_flags[MODBUS_TEST_MAX_OUTPUTS];
+static uint8_t test_output_first[MODBUS_TEST_MAX_OUTPUTS][MODBUS_RTU_MIN_FRAME];
+
+static uint8_t test_frames[2][MODBUS_RTU_MAX_FRAME];
+static uint8_t test_long[700];
+static uint8_t test_registers[MODBUS_MAX_READ_REGISTERS * 2];
+static uint8_t test_response[MODBUS_RTU_MAX_FRAME];
+static uint8_t test_request[MODBUS_RTU_MAX_FRAME];
+static ModbusTestPort_t test_ports[2];
+static double test_scan_values[MODBUS_TEST_FILE_SAMPLES];
+
+/* 发送缓冲区，之后是保护字节，检查应答写越界 */
+static uint8_t test_guarded_response[MODBUS_RTU_MAX_FRAME + MODBUS_TEST_GUARD_SIZE];
+
+/* 模糊测试 */
+static uint32_t test_fuzz_state;                        /* xorshift32 */
+static uint8_t test_fuzz_corpus[MODBUS_TEST_FUZZ_CORPUS][MODBUS_RTU_MAX_FRAME];
+static uint16_t test_fuzz_length[MODBUS_TEST_FUZZ_CORPUS];
+static uint16_t test_fuzz_count;
+static uint16_t test_fuzz_seeds;                        /* 前test_fuzz_seeds个为种子，不替换 */
+static uint8_t test_fuzz_map[(1 << MODBUS_TEST_FUZZ_MAP_SHIFT) / 8];
+static uint8_t test_fuzz_frame[MODBUS_RTU_MAX_FRAME];
+static uint32_t test_fuzz_failures;
+static uint32_t test_fuzz_ok_frames;                    /* 帧定界输出的正确帧 */
+static uint32_t test_fuzz_bytes;                        /* 帧定界输出的字节 */
+
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+/* USER CODE BEGIN PFP */
+
+/* USER CODE END PFP */
+
+/* Private user code ---------------------------------------------------------*/
+/* USER CODE BEGIN 0 */
+
+/**
+ * @brief 帧输出：记录长度、标志和前几个字节
+ */
+static void ModbusTest_Sink(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags)
+{
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+
+    if (test_output_count < MODBUS_TEST_MAX_OUTPUTS) {
+        ModbusRtu_CopyFrame(framer, start, length, frame);
+        test_output_length[test_output_count] = length;
+        test_output_flags[test_output_count] = flags;
+        memcpy(test_output_first[test_output_count], frame, MODBUS_RTU_MIN_FRAME);
+    }
+    test_output_count++;
+}
+
+/**
+ * @brief 按新的波特率重新开始回放
+ */
+static void ModbusTest_Reset(uint32_t baud_rate)
+{
+    ModbusRtu_GetTiming(baud_rate, 10, &test_timing);
+    ModbusRtu_FramerInit(&test_framer, test_ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusTest_Sink, NULL);
+    test_position = 0;
+    test_last_end = 0;
+    test_idle_pending = false;
+    test_line_error = false;
+    test_timer_running = false;
+}
+
+/**
+ * @brief 处理next_start开始、next_end结束的字节之前发生的IDLE和定时器事件
+ */
+static void ModbusTest_Advance(uint32_t next_start, uint32_t next_end)
+{
+    for (;;) {
+        /* 字节开始前产生IDLE，字节写入前到期的定时器事件看不到该字节；同时发生时先处理定时器 */
+        uint32_t idle_time = test_last_end + test_timing.char_us;
+        uint32_t idle = (test_idle_pending && idle_time <= next_start) ? idle_time : MODBUS_TEST_TIME_NEVER;
+        uint32_t t15 = (test_timer_running && !test_t15_done && test_t15_time < next_end) ? test_t15_time : MODBUS_TEST_TIME_NEVER;
+        uint32_t t35 = (test_timer_running && test_t35_time < next_end) ? test_t35_time : MODBUS_TEST_TIME_NEVER;
+
+        if (t15 != MODBUS_TEST_TIME_NEVER && t15 <= t35 && t15 <= idle) {
+            test_t15_done = true;
+            ModbusRtu_OnT15(&test_framer, test_position);
+        } else if (t35 != MODBUS_TEST_TIME_NEVER && t35 <= idle) {
+            test_timer_running = false;
+            ModbusRtu_OnT35(&test_framer, test_position);
+        } else if (idle != MODBUS_TEST_TIME_NEVER) {
+            test_idle_pending = false;
+            test_timer_running = true;
+            test_t15_done = false;
+            test_t15_time = idle_time + test_timing.t15_us;
+            test_t35_time = idle_time + test_timing.t35_us - test_timing.char_us;
+            ModbusRtu_OnIdle(&test_framer, test_position, test_line_error);
+            test_line_error = false;
+        } else {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 回放一段字节
+ */
+static void ModbusTest_Play(const ModbusTestSegment_t *segment)
+{
+    uint32_t start = test_last_end + segment->gap_us;
+
+    for (uint16_t i = 0; i < segment->length; i++) {
+        if (i > 0 && i == segment->split_at) {
+            start += segment->split_gap_us;
+        }
+
+        uint32_t end = start + test_timing.char_us;
+        ModbusTest_Advance(start, end);
+
+        test_ring[test_position] = segment->data[i];
+        test_position = (test_position + 1) % MODBUS_RTU_RX_RING_SIZE;
+        if (test_position % (MODBUS_RTU_RX_RING_SIZE / 2) == 0) {
+            ModbusRtu_OnDmaEvent(&test_framer, test_position);
+        }
+
+        test_last_end = end;
+        test_idle_pending = true;
+        test_line_error |= segment->noise;
+        start = end;
+    }
+}
+
+/**
+ * @brief 回放若干段后静默到所有帧结束
+ */
+static void ModbusTest_Replay(const ModbusTestSegment_t *segments, uint16_t count)
+{
+    test_output_count = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        ModbusTest_Play(&segments[i]);
+    }
+    ModbusTest_Advance(MODBUS_TEST_TIME_NEVER, MODBUS_TEST_TIME_NEVER);
+}
+
+/**
+ * @brief 构建读保持寄存器请求（8字节，CRC低字节在前）
+ */
+static uint16_t ModbusTest_BuildRequest(uint8_t *frame, uint16_t start)
+{
+    frame[0] = 0x01;
+    frame[1] = MODBUS_READ_HOLDING_REGISTERS;
+    frame[2] = start >> 8;
+    frame[3] = start & 0xFF;
+    frame[4] = 0x00;
+    frame[5] = 0x04;
+    uint16_t crc = Modbus_CalculateCRC16(frame, 6);
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+    return 8;
+}
+
+/**
+ * @brief 检查回放结果：输出数，以及每个输出的长度和标志
+ */
+static bool ModbusTest_Expect(const char *name, uint16_t count, const uint16_t *lengths, const uint16_t *flags)
+{
+    bool passed = (test_output_count == count);
+
+    for (uint16_t i = 0; passed && i < count; i++) {
+        passed = test_output_length[i] == lengths[i] && test_output_flags[i] == flags[i];
+    }
+
+    if (!passed) {
+        Log_Error("%s: %u out, 1st len %u flags 0x%02X", name, test_output_count,
+                  test_output_length[0], test_output_flags[0]);
+    }
+    return passed;
+}
+
+/**
+ * @brief 单帧用例：回放后应输出一帧
+ */
+static bool ModbusTest_Single(const char *name, const ModbusTestSegment_t *segments, uint16_t count,
+                              uint16_t length, uint16_t flags)
+{
+    ModbusTest_Replay(segments, count);
+    return ModbusTest_Expect(name, 1, &length, &flags);
+}
+
+/**
+ * @brief 连续帧速率：间隔正好t3.5的帧全部正确，统计每帧中断数
+ */
+static bool ModbusTest_Rate(uint32_t baud_rate, uint16_t frame_length)
+{
+    ModbusTestSegment_t segment = {test_frames[0], frame_length, 0, 0, 0, false};
+    uint32_t start_cycles;
+    uint32_t cycles;
+
+    ModbusTest_Reset(baud_rate);
+    memset(test_frames[0], 0x5A, frame_length - 2);
+    uint16_t crc = Modbus_CalculateCRC16(test_frames[0], frame_length - 2);
+    test_frames[0][frame_length - 2] = crc & 0xFF;
+    test_frames[0][frame_length - 1] = crc >> 8;
+
+    test_output_count = 0;
+    start_cycles = DWT_GetTick();
+    for (uint16_t i = 0; i < MODBUS_TEST_RATE_FRAMES; i++) {
+        ModbusTest_Play(&segment);
+        segment.gap_us = test_timing.t35_us;
+    }
+    ModbusTest_Advance(MODBUS_TEST_TIME_NEVER, MODBUS_TEST_TIME_NEVER);
+    cycles = DWT_GetTick() - start_cycles;
+
+    const ModbusRtuStats_t *stats = &test_framer.stats;
+    uint32_t events = stats->idle_events + stats->timer_events;
+    uint32_t line_us = test_last_end + test_timing.t35_us;
+
+    Log_Info("%6lu baud %3u B: %lu/%u ok, %lu.%02lu irq/frame",
+             baud_rate, frame_length, stats->frames, MODBUS_TEST_RATE_FRAMES,
+             events / MODBUS_TEST_RATE_FRAMES, events * 100 / MODBUS_TEST_RATE_FRAMES % 100);
+    Log_Info("  %lu frames/s, max %lu cyc/frame, total %lu cyc",
+             (uint32_t)((uint64_t)MODBUS_TEST_RATE_FRAMES * 1000000 / line_us),
+             stats->max_frame_cycles, cycles);
+
+    return stats->frames == MODBUS_TEST_RATE_FRAMES && test_output_count == MODBUS_TEST_RATE_FRAMES;
+}
+
+/**
+ * @brief 寄存器读取基准：重复读取，返回每个寄存器的平均周期数（x100）
+ */
+static uint32_t ModbusTest_ReadCost(const char *name, uint16_t start, uint16_t count, uint8_t access)
+{
+    uint32_t start_cycles = DWT_GetTick();
+    for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+        ModbusRegs_Read(start, count, access, test_registers, NULL);
+    }
+    uint32_t cycles = DWT_GetTick() - start_cycles;
+    uint32_t per_register_x100 = (uint32_t)((uint64_t)cycles * 100 / MODBUS_TEST_READ_LOOPS / count);
+
+    Log_Info("%-12s %3u regs: %lu cyc/read, %lu.%02lu cyc/reg", name, count,
+             cycles / MODBUS_TEST_READ_LOOPS, per_register_x100 / 100, per_register_x100 % 100);
+    return per_register_x100;
+}
+
+/**
+ * @brief 写寄存器请求：加CRC后处理，返回异常码（0为正常应答）
+ * @note FC 0x10时values为count个寄存器值，FC 0x06时为1个
+ */
+static uint8_t ModbusTest_Write(uint8_t function_code, uint16_t start, uint16_t count, const uint16_t *values)
+{
+    uint16_t length = 0;
+    uint16_t response_length = 0;
+
+    test_request[length++] = 0x01;
+    test_request[length++] = function_code;
+    test_request[length++] = start >> 8;
+    test_request[length++] = start & 0xFF;
+    if (function_code == MODBUS_WRITE_MULTIPLE_REGISTERS) {
+        test_request[length++] = count >> 8;
+        test_request[length++] = count & 0xFF;
+        test_request[length++] = count * 2;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        test_request[length++] = values[i] >> 8;
+        test_request[length++] = values[i] & 0xFF;
+    }
+    uint16_t crc = Modbus_CalculateCRC16(test_request, length);
+    test_request[length++] = crc & 0xFF;
+    test_request[length++] = crc >> 8;
+
+    Modbus_ProcessRequest(test_request, length, test_response, &response_length);
+
+    if (response_length == 5 && test_response[1] == (function_code | 0x80)) {
+        return test_response[2];
+    }
+    /* 正常应答是请求的前6字节加CRC */
+    if (response_length != 8 || memcmp(test_response, test_request, 6) != 0) {
+        return 0xFF;
+    }
+    return 0;
+}
+
+/**
+ * @brief 用FC 0x10/0x06写回运行参数和日志级别（不保存）
+ * @return 写回后与saved一致
+ */
+static bool ModbusTest_RestoreTuning(const Tuning_t *saved, LogLevel_t level)
+{
+    uint16_t values[TUNING_COUNT];
+
+    memcpy(values, &saved->pressure_period_ms, (TUNING_COUNT - 1) * sizeof(uint16_t));
+    values[TUNING_COUNT - 1] = level;
+    ModbusTest_Write(MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT, values);
+    values[0] = saved->max_age_ms;
+    ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 1, values);
+    return memcmp(saved, &g_tuning, sizeof(Tuning_t)) == 0 && Log_GetLevel() == level;
+}
+
+/**
+ * @brief 双端口基准的帧输出：处理请求并检查应答
+ */
+static void ModbusTest_PortSink(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags)
+{
+    ModbusTestPort_t *port = (ModbusTestPort_t*)framer->context;
+    uint16_t response_length = 0;
+
+    ModbusRtu_CopyFrame(framer, start, length, port->frame);
+    if ((flags & MODBUS_RTU_FRAME_OK) &&
+        Modbus_ProcessRequest(port->frame, length, port->response, &response_length) &&
+        response_length == 5 + port->count * 2 && port->response[2] == port->count * 2) {
+        port->served++;
+    } else {
+        port->errors++;
+    }
+}
+
+/**
+ * @brief 初始化双端口基准的一个端口
+ */
+static void ModbusTest_PortInit(ModbusTestPort_t *port, const char *name, uint16_t start, uint16_t count)
+{
+    memset(port, 0, sizeof(ModbusTestPort_t));
+    port->name = name;
+    port->count = count;
+    port->request[0] = 0x01;
+    port->request[1] = MODBUS_READ_HOLDING_REGISTERS;
+    port->request[2] = start >> 8;
+    port->request[3] = start & 0xFF;
+    port->request[4] = count >> 8;
+    port->request[5] = count & 0xFF;
+    uint16_t crc = Modbus_CalculateCRC16(port->request, 6);
+    port->request[6] = crc & 0xFF;
+    port->request[7] = crc >> 8;
+    ModbusRtu_FramerInit(&port->framer, port->ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusTest_PortSink, port);
+}
+
+/**
+ * @brief 端口收到一个字节
+ */
+static void ModbusTest_PortByte(ModbusTestPort_t *port, uint8_t data)
+{
+    port->ring[port->position] = data;
+    port->position = (port->position + 1) % MODBUS_RTU_RX_RING_SIZE;
+    if (port->position % (MODBUS_RTU_RX_RING_SIZE / 2) == 0) {
+        ModbusRtu_OnDmaEvent(&port->framer, port->position);
+    }
+}
+
+/**
+ * @brief 端口帧结束：IDLE、t1.5、t3.5，统计到应答生成的周期数
+ */
+static void ModbusTest_PortEnd(ModbusTestPort_t *port)
+{
+    uint32_t start_cycles = DWT_GetTick();
+
+    ModbusRtu_OnIdle(&port->framer, port->position, false);
+    ModbusRtu_OnT15(&port->framer, port->position);
+    ModbusRtu_OnT35(&port->framer, port->position);
+    port->cycles += DWT_GetTick() - start_cycles;
+}
+
+/**
+ * @brief 端口每个请求的处理时间（ns）
+ */
+static uint32_t ModbusTest_PortNs(const ModbusTestPort_t *port)
+{
+    if (port->served == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)port->cycles * 1000000000 / SystemCoreClock / port->served);
+}
+
+/**
+ * @brief 主站在应答结束后t3.5发出下一个请求时端口的请求速率（每秒x10）
+ * @param other_ns 另一个端口每个请求的处理时间，最坏情况下本端口每个请求都要等它处理完
+ */
+static uint32_t ModbusTest_PortRate(const ModbusTestPort_t *port, uint32_t other_ns, const ModbusRtuTiming_t *timing)
+{
+    uint32_t wire_ns = ((sizeof(port->request) + 5 + port->count * 2) * timing->char_us + 2 * timing->t35_us) * 1000;
+
+    return (uint32_t)(10000000000ULL / (wire_ns + ModbusTest_PortNs(port) + other_ns));
+}
+
+/**
+ * @brief 解析基准的帧输出：只复制帧并记录结果
+ */
+static void ModbusTest_CopySink(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags)
+{
+    ModbusTestPort_t *port = (ModbusTestPort_t*)framer->context;
+
+    ModbusRtu_CopyFrame(framer, start, length, port->frame);
+    if (flags & MODBUS_RTU_FRAME_OK) {
+        port->served++;
+    } else {
+        port->errors++;
+    }
+}
+
+/**
+ * @brief 构建请求：FC 0x03为8字节读请求，FC 0x10写入count个当前值（不改变参数）
+ * @return 帧长度
+ */
+static uint16_t ModbusTest_BuildFrame(uint8_t *frame, uint8_t slave_addr, uint8_t function_code,
+                                      uint16_t start, uint16_t count)
+{
+    uint16_t length = 0;
+
+    frame[length++] = slave_addr;
+    frame[length++] = function_code;
+    frame[length++] = start >> 8;
+    frame[length++] = start & 0xFF;
+    frame[length++] = count >> 8;
+    frame[length++] = count & 0xFF;
+    if (function_code == MODBUS_WRITE_MULTIPLE_REGISTERS) {
+        frame[length++] = count * 2;
+        ModbusRegs_Read(start, count, MODBUS_REG_ACCESS_HOLDING, &frame[length], NULL);
+        length += count * 2;
+    }
+    uint16_t crc = Modbus_CalculateCRC16(frame, length);
+    frame[length++] = crc & 0xFF;
+    frame[length++] = crc >> 8;
+    return length;
+}
+
+#if FLASH_COLUMN_STORE_ENABLE
+/**
+ * @brief 文件记录请求：增加一个子请求
+ * @param length 当前帧长度，首次调用前为3（地址、功能码、字节数）
+ */
+static void ModbusTest_AddFileRead(uint8_t *frame, uint16_t *length, uint8_t column, uint32_t sample, uint16_t registers)
+{
+    uint16_t file = ((column + 1) << MODBUS_FILE_STREAM_SHIFT) | (sample / MODBUS_FILE_WINDOW_RECORDS);
+    uint16_t record = sample % MODBUS_FILE_WINDOW_RECORDS;
+    uint8_t *sub = &frame[*length];
+
+    sub[0] = MODBUS_FILE_REFERENCE_TYPE;
+    sub[1] = file >> 8;
+    sub[2] = file & 0xFF;
+    sub[3] = record >> 8;
+    sub[4] = record & 0xFF;
+    sub[5] = registers >> 8;
+    sub[6] = registers & 0xFF;
+    *length += MODBUS_FILE_SUBREQUEST_SIZE;
+}
+
+/**
+ * @brief 文件记录请求：填写地址、功能码、字节数和CRC
+ * @return 帧长度
+ */
+static uint16_t ModbusTest_FinishFileRequest(uint8_t *frame, uint16_t length)
+{
+    frame[0] = 0x01;
+    frame[1] = MODBUS_READ_FILE_RECORD;
+    frame[2] = length - 3;
+    uint16_t crc = Modbus_CalculateCRC16(frame, length);
+    frame[length++] = crc & 0xFF;
+    frame[length++] = crc >> 8;
+    return length;
+}
+
+/**
+ * @brief 文件记录请求，返回异常码（0为正常应答）
+ */
+static uint8_t ModbusTest_FileRequest(uint8_t *frame, uint16_t length, uint16_t *response_length)
+{
+    *response_length = 0;
+    Modbus_ProcessFrame(frame, length, test_response, response_length);
+
+    if (*response_length == 5 && test_response[1] == (MODBUS_READ_FILE_RECORD | 0x80)) {
+        return test_response[2];
+    }
+    return (*response_length > 5) ? 0 : 0xFF;
+}
+
+/**
+ * @brief 最新的samples个样本的起始序号，不跨越文件窗口
+ */
+static uint32_t ModbusTest_FileStart(uint32_t first, uint32_t count, uint32_t samples)
+{
+    uint32_t sample = first + count - samples;
+    uint32_t record = sample % MODBUS_FILE_WINDOW_RECORDS;
+
+    if (record + samples > MODBUS_FILE_WINDOW_RECORDS) {
+        sample -= record + samples - MODBUS_FILE_WINDOW_RECORDS;
+    }
+    return sample;
+}
+
+/**
+ * @brief 对照查询回调：按样本序号保存字段值
+ */
+static void ModbusTest_ScanVisitor(uint32_t sample, const double *values, void *context)
+{
+    ModbusTestScan_t *scan = (ModbusTestScan_t*)context;
+
+    if (sample >= scan->first && sample - scan->first < scan->count) {
+        scan->values[sample - scan->first] = values[0];
+        scan->found++;
+    }
+}
+
+/**
+ * @brief 对照查询，在Flash I/O服务任务中执行
+ */
+static FlashResult_t ModbusTest_ScanJob(void *context)
+{
+    ModbusTestScan_t *scan = (ModbusTestScan_t*)context;
+
+    return FlashColumn_ScanField(scan->field, scan->first, scan->count, ModbusTest_ScanVisitor, scan);
+}
+
+/**
+ * @brief 检查子应答中的寄存器与按字段查询的值一致
+ * @param data 子应答的寄存器
+ * @param registers 每个样本的寄存器数
+ */
+static bool ModbusTest_CheckFileData(const uint8_t *data, uint32_t field, uint32_t first, uint16_t registers)
+{
+    ModbusTestScan_t scan = {field, first, MODBUS_TEST_FILE_SAMPLES, 0, test_scan_values};
+
+    if (FlashIo_Call(FLASH_IO_INTERACTIVE, ModbusTest_ScanJob, &scan) != FLASH_OK ||
+        scan.found != MODBUS_TEST_FILE_SAMPLES) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < MODBUS_TEST_FILE_SAMPLES; i++) {
+        uint32_t raw = 0;
+        for (uint16_t b = 0; b < registers * 2; b++) {
+            raw = (raw << 8) | data[i * registers * 2 + b];
+        }
+        if (RecordCodec_FieldValue(field, raw) != scan.values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+/**
+ * @brief 按MODBUS_TEST_FRAME_xxx修改ModbusTest_BuildFrame构建的请求
+ * @return 帧长度
+ */
+static uint16_t ModbusTest_Reframe(uint8_t *frame, uint16_t length, uint8_t change)
+{
+    uint16_t data_length = length - 2;
+
+    switch (change) {
+    case MODBUS_TEST_FRAME_EXTRA:
+        frame[data_length++] = 0x00;
+        break;
+    case MODBUS_TEST_FRAME_SHORT:
+        data_length--;
+        break;
+    case MODBUS_TEST_FRAME_BYTE_COUNT:
+        frame[6]++;
+        break;
+    case MODBUS_TEST_FRAME_BAD_CRC:
+        frame[length - 1] ^= 0x01;
+        return length;
+    case MODBUS_TEST_FRAME_TRUNCATED:
+        return 3;
+    default:
+        return length;
+    }
+
+    uint16_t crc = Modbus_CalculateCRC16(frame, data_length);
+    frame[data_length++] = crc & 0xFF;
+    frame[data_length++] = crc >> 8;
+    return data_length;
+}
+
+/**
+ * @brief 发送缓冲区之后的保护字节是否未改变（检查后重新填充）
+ */
+static bool ModbusTest_GuardIntact(void)
+{
+    bool intact = true;
+
+    for (uint16_t i = 0; i < MODBUS_TEST_GUARD_SIZE; i++) {
+        intact &= (test_guarded_response[MODBUS_RTU_MAX_FRAME + i] == MODBUS_TEST_GUARD_BYTE);
+    }
+    memset(&test_guarded_response[MODBUS_RTU_MAX_FRAME], MODBUS_TEST_GUARD_BYTE, MODBUS_TEST_GUARD_SIZE);
+    return intact;
+}
+
+/**
+ * @brief 按标准检查一个请求的应答
+ * @param replied Modbus_ProcessRequest/Modbus_ProcessFrame的返回值
+ * @return 0为正常应答，异常码，MODBUS_TEST_NO_REPLY为不应答，MODBUS_TEST_INVALID为不符合标准
+ * @note 发给本机（地址1）且CRC正确的请求必须应答，其他请求（含广播）不应答；应答的地址
+ *       和功能码与请求相同，CRC正确。异常应答5字节，异常码为标准定义的值；正常应答的长度
+ *       与功能码和请求一致，不支持的功能码只能应答异常
+ */
+static uint8_t ModbusTest_CheckResponse(uint8_t *request, uint16_t request_length, bool replied,
+                                        uint8_t *response, uint16_t response_length)
+{
+    bool addressed = Modbus_IsModbusCommand(request, request_length);
+    bool valid;
+
+    if (!replied) {
+        return addressed ? MODBUS_TEST_INVALID : MODBUS_TEST_NO_REPLY;
+    }
+    if (!addressed || response_length < 5 || response_length > MODBUS_RTU_MAX_FRAME ||
+        response[0] != request[0] || Modbus_CalculateCRC16(response, response_length) != 0) {
+        return MODBUS_TEST_INVALID;
+    }
+
+    if (response[1] == (request[1] | 0x80)) {
+        uint8_t exception = response[2];
+        valid = response_length == 5 && exception >= MODBUS_EXCEPTION_ILLEGAL_FUNCTION &&
+                exception <= MODBUS_EXCEPTION_SLAVE_DEVICE_BUSY && exception != 0x05;
+        return valid ? exception : MODBUS_TEST_INVALID;
+    }
+    if (response[1] != request[1]) {
+        return MODBUS_TEST_INVALID;
+    }
+
+    switch (request[1]) {
+    case MODBUS_READ_HOLDING_REGISTERS:
+    case MODBUS_READ_INPUT_REGISTERS:
+        valid = response_length == 5 + response[2] && response[2] == 2 * ((request[4] << 8) | request[5]);
+        break;
+    case MODBUS_WRITE_SINGLE_REGISTER:
+    case MODBUS_WRITE_MULTIPLE_REGISTERS:
+        valid = response_length == 8 && memcmp(response, request, 6) == 0;
+        break;
+    case MODBUS_READ_FILE_RECORD:
+        valid = response_length == 5 + response[2] && response[2] <= MODBUS_FILE_MAX_DATA;
+        break;
+    default:
+        valid = false;
+        break;
+    }
+    return valid ? 0 : MODBUS_TEST_INVALID;
+}
+
+/**
+ * @brief 模糊测试的伪随机数（xorshift32）
+ */
+static uint32_t ModbusTest_Random(void)
+{
+    test_fuzz_state ^= test_fuzz_state << 13;
+    test_fuzz_state ^= test_fuzz_state >> 17;
+    test_fuzz_state ^= test_fuzz_state << 5;
+    return test_fuzz_state;
+}
+
+/**
+ * @brief 是否为写保存寄存器的请求（会写Flash），模糊测试不发送
+ */
+static bool ModbusTest_WritesSave(const uint8_t *frame, uint16_t length)
+{
+    if (length < 6) {
+        return false;
+    }
+
+    uint16_t start = (frame[2] << 8) | frame[3];
+    uint16_t count = (frame[4] << 8) | frame[5];
+
+    if (frame[1] == MODBUS_WRITE_SINGLE_REGISTER) {
+        return start == MODBUS_REG_TUNING_SAVE_ADDR;
+    }
+    return frame[1] == MODBUS_WRITE_MULTIPLE_REGISTERS && start <= MODBUS_REG_TUNING_SAVE_ADDR &&
+           (uint32_t)start + count > MODBUS_REG_TUNING_SAVE_ADDR;
+}
+
+/**
+ * @brief 变异一帧：1~4次位翻转、替换、特殊值、插入、删除、改变长度或拼接其他语料
+ * @return 新的帧长度
+ * @note 多数结果重新加地址1和CRC，使请求到达功能码处理
+ */
+static uint16_t ModbusTest_Mutate(uint8_t *frame, uint16_t length)
+{
+    static const uint8_t interesting[] = {0x00, 0x01, 0x07, 0x7B, 0x7D, 0x7E, 0x7F, 0x80, 0xF5, 0xFF};
+    uint16_t operations = 1 + ModbusTest_Random() % 4;
+
+    for (uint16_t i = 0; i < operations; i++) {
+        uint16_t at = (length > 0) ? ModbusTest_Random() % length : 0;
+
+        switch (ModbusTest_Random() % 7) {
+        case 0:
+            if (length > 0) {
+                frame[at] ^= 1 << (ModbusTest_Random() % 8);
+            }
+            break;
+        case 1:
+            if (length > 0) {
+                frame[at] = ModbusTest_Random();
+            }
+            break;
+        case 2:
+            if (length > 0) {
+                frame[at] = interesting[ModbusTest_Random() % sizeof(interesting)];
+            }
+            break;
+        case 3:
+            if (length < MODBUS_RTU_MAX_FRAME) {
+                memmove(&frame[at + 1], &frame[at], length - at);
+                frame[at] = ModbusTest_Random();
+                length++;
+            }
+            break;
+        case 4:
+            if (length > 0) {
+                memmove(&frame[at], &frame[at + 1], length - at - 1);
+                length--;
+            }
+            break;
+        case 5:
+        {
+            uint16_t new_length = ModbusTest_Random() % (MODBUS_RTU_MAX_FRAME + 1);
+            while (length < new_length) {
+                frame[length++] = ModbusTest_Random();
+            }
+            length = new_length;
+            break;
+        }
+        default:
+        {
+            uint16_t other = ModbusTest_Random() % test_fuzz_count;
+            uint16_t from = ModbusTest_Random() % (test_fuzz_length[other] + 1);
+            uint16_t copy = test_fuzz_length[other] - from;
+            if (copy > MODBUS_RTU_MAX_FRAME - at) {
+                copy = MODBUS_RTU_MAX_FRAME - at;
+            }
+            memcpy(&frame[at], &test_fuzz_corpus[other][from], copy);
+            if (at + copy > length) {
+                length = at + copy;
+            }
+            break;
+        }
+        }
+    }
+
+    if (length >= MODBUS_RTU_MIN_FRAME && ModbusTest_Random() % 8 != 0) {
+        if (ModbusTest_Random() % 16 != 0) {
+            frame[0] = 0x01;
+        }
+        uint16_t crc = Modbus_CalculateCRC16(frame, length - 2);
+        frame[length - 2] = crc & 0xFF;
+        frame[length - 1] = crc >> 8;
+    }
+    return length;
+}
+
+/**
+ * @brief 长度的二进制位数，作为特征的长度分级
+ */
+static uint32_t ModbusTest_Bucket(uint16_t length)
+{
+    uint32_t bucket = 0;
+
+    while (length > 0) {
+        bucket++;
+        length >>= 1;
+    }
+    return bucket;
+}
+
+/**
+ * @brief 记录一次处理的特征，是否为新特征
+ * @note 目标板上没有编译器覆盖率插桩，以功能码、结果、请求和应答长度分级的组合近似
+ *       覆盖的处理路径：产生新特征的帧加入语料，继续变异
+ */
+static bool ModbusTest_FuzzSignal(const uint8_t *frame, uint16_t length, uint8_t result, uint16_t response_length)
+{
+    uint8_t function_code = (length > 1) ? frame[1] : 0;
+
+    /* 不应答和不支持的功能码各是同一条路径 */
+    if (result == MODBUS_TEST_NO_REPLY || result == MODBUS_EXCEPTION_ILLEGAL_FUNCTION) {
+        function_code = 0;
+    }
+    uint32_t key = ((uint32_t)function_code << 16) | ((uint32_t)result << 8) |
+                   (ModbusTest_Bucket(length) << 4) | ModbusTest_Bucket(response_length);
+    uint16_t bit = (uint16_t)((key * 2654435761u) >> (32 - MODBUS_TEST_FUZZ_MAP_SHIFT));
+    uint8_t mask = 1 << (bit % 8);
+
+    if (test_fuzz_map[bit / 8] & mask) {
+        return false;
+    }
+    test_fuzz_map[bit / 8] |= mask;
+    return true;
+}
+
+/**
+ * @brief 加入语料，满后替换一个非种子的帧
+ */
+static void ModbusTest_FuzzKeep(const uint8_t *frame, uint16_t length)
+{
+    uint16_t index = test_fuzz_count;
+
+    if (test_fuzz_count < MODBUS_TEST_FUZZ_CORPUS) {
+        test_fuzz_count++;
+    } else {
+        index = test_fuzz_seeds + ModbusTest_Random() % (MODBUS_TEST_FUZZ_CORPUS - test_fuzz_seeds);
+    }
+    memcpy(test_fuzz_corpus[index], frame, length);
+    test_fuzz_length[index] = length;
+}
+
+/**
+ * @brief 种子：每个功能码一个正确的请求（写请求写入当前值）
+ */
+static void ModbusTest_FuzzSeed(void)
+{
+    static const struct {
+        uint8_t function_code;
+        uint16_t start;
+        uint16_t count;
+    } seeds[] = {
+        {MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 8},
+        {MODBUS_READ_HOLDING_REGISTERS, 0x0000, MODBUS_MAX_READ_REGISTERS},
+        {MODBUS_READ_INPUT_REGISTERS, MODBUS_REG_FLASH_STATS_ADDR, FLASH_STATS_REG_COUNT},
+        {MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 0},
+        {MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT - 1},
+        {0x2B, 0x0E01, 0x0000},
+    };
+
+    test_fuzz_count = 0;
+    for (uint16_t i = 0; i < sizeof(seeds) / sizeof(seeds[0]); i++) {
+        uint16_t count = (seeds[i].function_code == MODBUS_WRITE_SINGLE_REGISTER) ? g_tuning.max_age_ms : seeds[i].count;
+        test_fuzz_length[test_fuzz_count] = ModbusTest_BuildFrame(test_fuzz_corpus[test_fuzz_count], 0x01,
+                                                                  seeds[i].function_code, seeds[i].start, count);
+        test_fuzz_count++;
+    }
+#if FLASH_COLUMN_STORE_ENABLE
+    {
+        uint32_t first;
+        uint32_t stored;
+        uint16_t length = 3;
+
+        FlashColumn_GetRange(&first, &stored);
+        ModbusTest_AddFileRead(test_fuzz_corpus[test_fuzz_count], &length, RECORD_FIELD_temperature, first, 10);
+        test_fuzz_length[test_fuzz_count] = ModbusTest_FinishFileRequest(test_fuzz_corpus[test_fuzz_count], length);
+        test_fuzz_count++;
+    }
+#endif
+    test_fuzz_seeds = test_fuzz_count;
+}
+
+/**
+ * @brief 输出失败的帧（前8个字节）
+ */
+static void ModbusTest_FuzzReport(const char *what, const uint8_t *frame, uint16_t length)
+{
+    uint8_t head[8] = {0};
+
+    test_fuzz_failures++;
+    if (test_fuzz_failures > MODBUS_TEST_FUZZ_REPORTS) {
+        return;
+    }
+    memcpy(head, frame, (length < sizeof(head)) ? length : sizeof(head));
+    Log_Error("Fuzz %s: len %u", what, length);
+    Log_Error("  %02X %02X %02X %02X %02X %02X %02X %02X",
+              head[0], head[1], head[2], head[3], head[4], head[5], head[6], head[7]);
+}
+
+/**
+ * @brief 处理一个变异的请求并检查，返回ModbusTest_CheckResponse的结果
+ * @note 请求之后的字节分别填充0x00和0xFF各处理一次，结果不同说明处理读取了帧以外的字节
+ */
+static uint8_t ModbusTest_FuzzOne(uint16_t length, uint16_t *response_length)
+{
+    uint16_t other_length = 0;
+
+    memset(&test_fuzz_frame[length], 0xFF, MODBUS_RTU_MAX_FRAME - length);
+    bool other_replied = Modbus_ProcessRequest(test_fuzz_frame, length, test_guarded_response, &other_length);
+    uint8_t other_function = test_guarded_response[1];
+
+    *response_length = 0;
+    memset(&test_fuzz_frame[length], 0x00, MODBUS_RTU_MAX_FRAME - length);
+    bool replied = Modbus_ProcessRequest(test_fuzz_frame, length, test_guarded_response, response_length);
+    uint8_t result = ModbusTest_CheckResponse(test_fuzz_frame, length, replied, test_guarded_response, *response_length);
+
+    if (!ModbusTest_GuardIntact()) {
+        ModbusTest_FuzzReport("overrun", test_fuzz_frame, length);
+    } else if (result == MODBUS_TEST_INVALID) {
+        ModbusTest_FuzzReport("response", test_fuzz_frame, length);
+    } else if (replied != other_replied ||
+               (replied && (*response_length != other_length || test_guarded_response[1] != other_function))) {
+        ModbusTest_FuzzReport("read past end", test_fuzz_frame, length);
+    }
+    return result;
+}
+
+/**
+ * @brief 帧定界模糊测试的帧输出：检查长度和CRC，正确的帧再处理并检查应答
+ */
+static void ModbusTest_FuzzSink(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags)
+{
+    uint16_t response_length = 0;
+
+    test_fuzz_bytes += length;
+    if (length == 0 || length > MODBUS_RTU_MAX_FRAME) {
+        ModbusTest_FuzzReport("framer length", test_fuzz_frame, length);
+        return;
+    }
+    if ((flags & MODBUS_RTU_FRAME_OK) == 0) {
+        return;
+    }
+
+    ModbusRtu_CopyFrame(framer, start, length, test_fuzz_frame);
+    test_fuzz_ok_frames++;
+#if !MODBUS_CRC_COMPAT_SWAPPED
+    if (length < MODBUS_RTU_MIN_FRAME || Modbus_CalculateCRC16(test_fuzz_frame, length) != 0) {
+        ModbusTest_FuzzReport("framer crc", test_fuzz_frame, length);
+        return;
+    }
+#endif
+    if (ModbusTest_WritesSave(test_fuzz_frame, length)) {
+        return;
+    }
+
+    bool replied = Modbus_ProcessFrame(test_fuzz_frame, length, test_guarded_response, &response_length);
+    if (ModbusTest_CheckResponse(test_fuzz_frame, length, replied, test_guarded_response, response_length) ==
+        MODBUS_TEST_INVALID || !ModbusTest_GuardIntact()) {
+        ModbusTest_FuzzReport("framed response", test_fuzz_frame, length);
+    }
+}
+
+/**
+ * @brief 帧定界模糊测试的静默时间：无间隔、小于t1.5、t1.5~t3.5之间或超过t3.5
+ */
+static uint32_t ModbusTest_FuzzGap(void)
+{
+    switch (ModbusTest_Random() % 4) {
+    case 0:
+        return 0;
+    case 1:
+        return ModbusTest_Random() % test_timing.t15_us;
+    case 2:
+        return (test_timing.t15_us + test_timing.t35_us) / 2;
+    default:
+        return test_timing.t35_us + ModbusTest_Random() % (2 * test_timing.t35_us);
+    }
+}
+
+/**
+ * @brief 回放一个随机字节流：语料帧或随机字节，随机静默、帧内间隔和噪声
+ * @note 输出的字节数必须等于回放的字节数；前后静默都不小于t3.5、没有帧内间隔和噪声的
+ *       正确帧必须作为正确的帧输出
+ */
+static void ModbusTest_FuzzStream(void)
+{
+    ModbusTestSegment_t segments[MODBUS_TEST_FUZZ_SEGMENTS];
+    uint32_t gaps[MODBUS_TEST_FUZZ_SEGMENTS + 1];
+    uint32_t played = 0;
+    uint32_t expected = 0;
+
+    ModbusTest_Reset(MODBUS_TEST_PORT_BAUD);
+    ModbusRtu_FramerInit(&test_framer, test_ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusTest_FuzzSink, NULL);
+
+    for (uint16_t i = 0; i < MODBUS_TEST_FUZZ_SEGMENTS; i++) {
+        gaps[i] = ModbusTest_FuzzGap();
+    }
+    gaps[MODBUS_TEST_FUZZ_SEGMENTS] = test_timing.t35_us;
+
+    for (uint16_t i = 0; i < MODBUS_TEST_FUZZ_SEGMENTS; i++) {
+        ModbusTestSegment_t *segment = &segments[i];
+        bool crc_ok = false;
+
+        if (ModbusTest_Random() % 8 == 0) {
+            segment->data = test_long;
+            segment->length = 1 + ModbusTest_Random() % sizeof(test_long);
+        } else {
+            uint16_t k = ModbusTest_Random() % test_fuzz_count;
+            segment->data = test_fuzz_corpus[k];
+            segment->length = test_fuzz_length[k];
+            crc_ok = segment->length >= MODBUS_RTU_MIN_FRAME &&
+                     Modbus_CalculateCRC16(test_fuzz_corpus[k], segment->length) == 0;
+        }
+        segment->gap_us = gaps[i];
+        segment->split_at = (segment->length > 1 && ModbusTest_Random() % 8 == 0) ?
+                            1 + ModbusTest_Random() % (segment->length - 1) : 0;
+        segment->split_gap_us = ModbusTest_FuzzGap();
+        segment->noise = (ModbusTest_Random() % 16 == 0);
+
+        played += segment->length;
+        if (crc_ok && segment->split_at == 0 && !segment->noise &&
+            gaps[i] >= test_timing.t35_us && gaps[i + 1] >= test_timing.t35_us) {
+            expected++;
+        }
+    }
+
+    uint32_t bytes = test_fuzz_bytes;
+    uint32_t ok_frames = test_fuzz_ok_frames;
+    ModbusTest_Replay(segments, MODBUS_TEST_FUZZ_SEGMENTS);
+
+    if (test_fuzz_bytes - bytes != played) {
+        ModbusTest_FuzzReport("framer bytes", segments[0].data, segments[0].length);
+    }
+    if (test_fuzz_ok_frames - ok_frames < expected) {
+        ModbusTest_FuzzReport("framer lost", segments[0].data, segments[0].length);
+    }
+}
+
+/**
+ * @brief 功能码基准：重复处理test_request，报告平均和最长处理周期及请求速率
+ * @return 结果与expect相同且最长处理时间不超过MODBUS_TEST_MAX_LATENCY_US
+ */
+static bool ModbusTest_FunctionCost(const char *name, uint16_t length, uint8_t expect)
+{
+    uint16_t response_length = 0;
+    uint32_t total_cycles = 0;
+    uint32_t max_cycles = 0;
+    bool replied = false;
+
+    for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+        uint32_t start_cycles = DWT_GetTick();
+        replied = Modbus_ProcessFrame(test_request, length, test_guarded_response, &response_length);
+        uint32_t cycles = DWT_GetTick() - start_cycles;
+        total_cycles += cycles;
+        if (cycles > max_cycles) {
+            max_cycles = cycles;
+        }
+    }
+
+    uint8_t result = ModbusTest_CheckResponse(test_request, length, replied, test_guarded_response, response_length);
+    uint32_t average = total_cycles / MODBUS_TEST_READ_LOOPS;
+    bool passed = result == expect && ModbusTest_GuardIntact() &&
+                  max_cycles / (SystemCoreClock / 1000000) < MODBUS_TEST_MAX_LATENCY_US;
+
+    /* 异常应答的日志可能已占满日志队列 */
+    osDelay(MODBUS_TEST_LOG_DRAIN_MS);
+    Log_Info("%-16s %6lu cyc, max %6lu", name, average, max_cycles);
+    Log_Info("  %lu req/s, result 0x%02X %s", (uint32_t)((uint64_t)SystemCoreClock / (average + 1)),
+             result, passed ? "ok" : "FAIL");
+    return passed;
+}
+
+/* USER CODE END 0 */
+
+/* Exported functions --------------------------------------------------------*/
+/* USER CODE BEGIN EF */
+
+/**
+ * @brief Modbus RTU帧定界回放测试
+ * @note 不使用USART2和TIM4：按受控的字符间隔回放字节流，模拟DMA写入、IDLE和
+ *       t1.5/t3.5定时器事件，检查帧边界、错误标志和超长分段，再统计连续帧的
+ *       每帧中断数和处理周期
+ */
+void Modbus_RtuFramerTest(void)
+{
+    bool passed = true;
+    uint16_t length = ModbusTest_BuildRequest(test_frames[0], MODBUS_REG_TEMPERATURE_ADDR);
+    static const uint8_t text[] = "AT+NAME?\r\n";
+
+    Log_Info("=== Modbus RTU Framer Test ===");
+
+    DWT_Init();
+    ModbusTest_BuildRequest(test_frames[1], MODBUS_REG_PRESSURE_ADDR);
+    for (uint16_t i = 0; i < sizeof(test_long); i++) {
+        test_long[i] = (uint8_t)(i * 13 + 1);
+    }
+
+    ModbusTest_Reset(115200);
+    Log_Info("115200: char %lu us, t1.5 %lu us, t3.5 %lu us",
+             test_timing.char_us, test_timing.t15_us, test_timing.t35_us);
+
+    /* 间隔正好t3.5的两帧分开输出 */
+    {
+        ModbusTestSegment_t segments[2] = {
+            {test_frames[0], length, 0, 0, 0, false},
+            {test_frames[1], length, test_timing.t35_us, 0, 0, false},
+        };
+        static const uint16_t lengths[2] = {8, 8};
+        static const uint16_t flags[2] = {MODBUS_RTU_FRAME_OK, MODBUS_RTU_FRAME_OK};
+        ModbusTest_Replay(segments, 2);
+        passed &= ModbusTest_Expect("back-to-back", 2, lengths, flags);
+        passed &= (test_output_first[1][3] == (MODBUS_REG_PRESSURE_ADDR & 0xFF));
+    }
+
+    /* 帧内间隔超过一个字符、不到t1.5：仍是一帧（按IDLE定界会拆成两段） */
+    {
+        ModbusTestSegment_t segment = {test_frames[0], length, test_timing.t35_us, 3, 600, false};
+        passed &= ModbusTest_Single("gap < t1.5", &segment, 1, 8, MODBUS_RTU_FRAME_OK);
+    }
+
+    /* 帧内间隔在t1.5和t3.5之间：整帧作废 */
+    {
+        ModbusTestSegment_t segment = {test_frames[0], length, test_timing.t35_us, 3, 1200, false};
+        passed &= ModbusTest_Single("t1.5 < gap < t3.5", &segment, 1, 8, MODBUS_RTU_FRAME_GAP_ERROR);
+    }
+
+    /* 两帧间隔不足t3.5：合并为一帧并作废 */
+    {
+        ModbusTestSegment_t segments[2] = {
+            {test_frames[0], length, test_timing.t35_us, 0, 0, false},
+            {test_frames[1], length, 1200, 0, 0, false},
+        };
+        passed &= ModbusTest_Single("merged", segments, 2, 16, MODBUS_RTU_FRAME_GAP_ERROR);
+    }
+
+    /* 噪声、CRC错误、太短、字符串 */
+    {
+        ModbusTestSegment_t segment = {test_frames[0], length, test_timing.t35_us, 0, 0, true};
+        passed &= ModbusTest_Single("noise", &segment, 1, 8, MODBUS_RTU_FRAME_LINE_ERROR);
+    }
+    {
+        test_frames[1][4] ^= 0x01;
+        ModbusTestSegment_t segment = {test_frames[1], length, test_timing.t35_us, 0, 0, false};
+        passed &= ModbusTest_Single("bad crc", &segment, 1, 8, MODBUS_RTU_FRAME_CRC_ERROR);
+        test_frames[1][4] ^= 0x01;
+    }
+    {
+        ModbusTestSegment_t segment = {test_frames[0], 2, test_timing.t35_us, 0, 0, false};
+        passed &= ModbusTest_Single("short", &segment, 1, 2, MODBUS_RTU_FRAME_CRC_ERROR);
+    }
+    {
+        /* CRC高字节在前：只在兼容时接受 */
+        uint8_t swapped = test_frames[1][6];
+        test_frames[1][6] = test_frames[1][7];
+        test_frames[1][7] = swapped;
+        ModbusTestSegment_t segment = {test_frames[1], length, test_timing.t35_us, 0, 0, false};
+        passed &= ModbusTest_Single("swapped crc", &segment, 1, 8,
+                                    MODBUS_CRC_COMPAT_SWAPPED ? MODBUS_RTU_FRAME_OK : MODBUS_RTU_FRAME_CRC_ERROR);
+        ModbusTest_BuildRequest(test_frames[1], MODBUS_REG_PRESSURE_ADDR);
+    }
+    {
+        ModbusTestSegment_t segment = {text, sizeof(text) - 1, test_timing.t35_us, 0, 0, false};
+        passed &= ModbusTest_Single("text", &segment, 1, sizeof(text) - 1, MODBUS_RTU_FRAME_CRC_ERROR);
+        passed &= (memcmp(test_output_first[0], text, MODBUS_RTU_MIN_FRAME) == 0);
+    }
+
+    /* 超长数据分段输出 */
+    {
+        ModbusTestSegment_t segment = {test_long, sizeof(test_long), test_timing.t35_us, 0, 0, false};
+        static const uint16_t lengths[3] = {256, 256, 188};
+        static const uint16_t flags[3] = {MODBUS_RTU_FRAME_PARTIAL, MODBUS_RTU_FRAME_PARTIAL, MODBUS_RTU_FRAME_PARTIAL};
+        ModbusTest_Replay(&segment, 1);
+        passed &= ModbusTest_Expect("long", 3, lengths, flags);
+    }
+
+    /* 最大帧不分段；此时已跨越环形缓冲区末尾 */
+    {
+        uint8_t *frame = test_frames[1];
+        memcpy(frame, test_long, MODBUS_RTU_MAX_FRAME - 2);
+        uint16_t crc = Modbus_CalculateCRC16(frame, MODBUS_RTU_MAX_FRAME - 2);
+        frame[MODBUS_RTU_MAX_FRAME - 2] = crc & 0xFF;
+        frame[MODBUS_RTU_MAX_FRAME - 1] = crc >> 8;
+        ModbusTestSegment_t segment = {frame, MODBUS_RTU_MAX_FRAME, test_timing.t35_us, 0, 0, false};
+        passed &= ModbusTest_Single("max frame", &segment, 1, MODBUS_RTU_MAX_FRAME, MODBUS_RTU_FRAME_OK);
+        ModbusTest_BuildRequest(test_frames[1], MODBUS_REG_PRESSURE_ADDR);
+    }
+
+    /* 9600波特率按字符时间计算间隔 */
+    ModbusTest_Reset(9600);
+    Log_Info("  9600: char %lu us, t1.5 %lu us, t3.5 %lu us",
+             test_timing.char_us, test_timing.t15_us, test_timing.t35_us);
+    {
+        ModbusTestSegment_t segments[2] = {
+            {test_frames[0], length, 0, 3, test_timing.t15_us - 100, false},
+            {test_frames[1], length, test_timing.t35_us, 0, 0, false},
+        };
+        static const uint16_t lengths[2] = {8, 8};
+        static const uint16_t flags[2] = {MODBUS_RTU_FRAME_OK, MODBUS_RTU_FRAME_OK};
+        ModbusTest_Replay(segments, 2);
+        passed &= ModbusTest_Expect("9600", 2, lengths, flags);
+    }
+    {
+        ModbusTestSegment_t segment = {test_frames[0], length, test_timing.t35_us, 5, test_timing.t15_us + 500, false};
+        passed &= ModbusTest_Single("9600 gap", &segment, 1, 8, MODBUS_RTU_FRAME_GAP_ERROR);
+    }
+
+    /* 连续帧 */
+    passed &= ModbusTest_Rate(115200, 8);
+    passed &= ModbusTest_Rate(115200, MODBUS_RTU_MAX_FRAME);
+    passed &= ModbusTest_Rate(921600, 8);
+    passed &= ModbusTest_Rate(921600, MODBUS_RTU_MAX_FRAME);
+
+    Log_Info("Correctness: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus RTU Framer Test Completed ===");
+}
+
+/**
+ * @brief Modbus寄存器表测试
+ * @note 检查访问权限、跨段读取、数据年龄和异常码，再统计1个和125个寄存器读取的
+ *       每寄存器周期数
+ */
+void Modbus_RegisterMapTest(void)
+{
+    bool passed = true;
+    uint16_t saved_error_count = g_modbus_registers.error_count;
+    uint16_t saved_humidity = g_modbus_registers.humidity;
+    uint16_t saved_status = g_modbus_registers.status;
+    GlobalSensorData_t saved_sensor_data = g_sensor_data;
+
+    Log_Info("=== Modbus Register Map Test ===");
+
+    DWT_Init();
+    g_modbus_registers.error_count = 0x1234;
+    g_modbus_registers.humidity = 0x0256;
+    g_modbus_registers.status = 0x8001;
+
+    /* 镜像寄存器，高字节在前 */
+    passed &= (ModbusRegs_Read(MODBUS_REG_ERROR_COUNT_ADDR, 1, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) == 0);
+    passed &= (test_registers[0] == 0x12 && test_registers[1] == 0x34);
+
+    /* 跨越湿度和状态两段，读到未映射的地址为0 */
+    passed &= (ModbusRegs_Read(MODBUS_REG_HUMIDITY_ADDR, 2, MODBUS_REG_ACCESS_INPUT, test_registers, NULL) == 0);
+    passed &= (test_registers[0] == 0x02 && test_registers[1] == 0x56);
+    passed &= (test_registers[2] == 0x80 && test_registers[3] == 0x01);
+    memset(test_registers, 0xEE, sizeof(test_registers));
+    passed &= (ModbusRegs_Read(MODBUS_REG_ERROR_COUNT_ADDR, 2, MODBUS_REG_ACCESS_INPUT, test_registers, NULL) == 0);
+    passed &= (test_registers[2] == 0 && test_registers[3] == 0);
+
+    /* Flash统计只能用FC 0x04读取，段内偏移传给读取函数 */
+    passed &= (ModbusRegs_Read(MODBUS_REG_FLASH_STATS_ADDR + 10, 1, MODBUS_REG_ACCESS_INPUT, test_registers, NULL) == 0);
+    passed &= (((test_registers[0] << 8) | test_registers[1]) == Flash_GetStatsRegister(10));
+    passed &= (ModbusRegs_Read(MODBUS_REG_FLASH_STATS_ADDR, 2, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) == 0);
+    passed &= (test_registers[0] == 0 && test_registers[1] == 0 && test_registers[2] == 0 && test_registers[3] == 0);
+
+    /* 数据年龄：本次启动采集的值按时间戳计算，无效或热启动恢复的值为未知 */
+    g_sensor_data.temperature_valid = 1;
+    g_sensor_data.temperature_timestamp = HAL_GetTick() - 500;
+    g_sensor_data.restored &= ~SENSOR_DATA_TEMPERATURE;
+    g_sensor_data.humidity_valid = 0;
+    passed &= (ModbusRegs_Read(MODBUS_REG_AGE_ADDR, 3, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) == 0);
+    uint16_t age = (test_registers[0] << 8) | test_registers[1];
+    passed &= (age >= 500 && age < 600);
+    passed &= (test_registers[4] == 0xFF && test_registers[5] == 0xFF);
+    g_sensor_data = saved_sensor_data;
+
+    /* 数量和地址范围 */
+    passed &= (ModbusRegs_Read(0, 0, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) == MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    passed &= (ModbusRegs_Read(0, MODBUS_MAX_READ_REGISTERS + 1, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    passed &= (ModbusRegs_Read(MODBUS_REGISTER_COUNT - 1, 2, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR);
+    passed &= (ModbusRegs_Read(MODBUS_REGISTER_COUNT - 1, 1, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL) == 0);
+
+    Log_Info("Correctness: %s", passed ? "PASS" : "FAIL");
+
+    /* 每寄存器周期数 */
+    ModbusTest_ReadCost("error count", MODBUS_REG_ERROR_COUNT_ADDR, 1, MODBUS_REG_ACCESS_HOLDING);
+    ModbusTest_ReadCost("humidity", MODBUS_REG_HUMIDITY_ADDR, 2, MODBUS_REG_ACCESS_INPUT);
+    ModbusTest_ReadCost("flash stats", MODBUS_REG_FLASH_STATS_ADDR, 1, MODBUS_REG_ACCESS_INPUT);
+    ModbusTest_ReadCost("flash stats", MODBUS_REG_FLASH_STATS_ADDR, FLASH_STATS_REG_COUNT, MODBUS_REG_ACCESS_INPUT);
+    ModbusTest_ReadCost("0x0000", 0, MODBUS_MAX_READ_REGISTERS, MODBUS_REG_ACCESS_HOLDING);
+    ModbusTest_ReadCost("0x00CA", MODBUS_REG_HUMIDITY_ADDR, MODBUS_REGISTER_COUNT - MODBUS_REG_HUMIDITY_ADDR,
+                        MODBUS_REG_ACCESS_INPUT);
+
+    g_modbus_registers.error_count = saved_error_count;
+    g_modbus_registers.humidity = saved_humidity;
+    g_modbus_registers.status = saved_status;
+
+    Log_Info("=== Modbus Register Map Test Completed ===");
+}
+
+/**
+ * @brief Modbus写寄存器测试
+ * @note 检查FC 0x06/0x10的范围检查、只读地址和长度错误；FC 0x10中任何一个值或
+ *       地址不合格时一个都不写入。结束时恢复原参数，不保存
+ */
+void Modbus_RegisterWriteTest(void)
+{
+    bool passed = true;
+    Tuning_t saved = g_tuning;
+    LogLevel_t saved_level = Log_GetLevel();
+    uint16_t values[TUNING_COUNT];
+
+    Log_Info("=== Modbus Register Write Test ===");
+
+    /* FC 0x06：范围内写入，范围外和只读地址不写入 */
+    values[0] = 2500;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TUNING_ADDR, 1, values) == 0);
+    passed &= (g_tuning.pressure_period_ms == 2500);
+    values[0] = 50;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TUNING_ADDR, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    values[0] = 999;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TUNING_ADDR + TUNING_DHT11_PERIOD - 1, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    passed &= (g_tuning.pressure_period_ms == 2500 && g_tuning.dht11_period_ms == saved.dht11_period_ms);
+    values[0] = 100;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TEMPERATURE_ADDR, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR);
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REGISTER_COUNT, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR);
+    values[0] = 0;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 1, values) == 0);
+    passed &= (g_tuning.max_age_ms == 0);
+    values[0] = LOG_LEVEL_MAX;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_LOG_LEVEL_ADDR, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    values[0] = 0;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TUNING_SAVE_ADDR, 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    Log_Info("FC06: %s", passed ? "PASS" : "FAIL");
+
+    /* FC 0x10：中间一个值超出范围，全部不写入 */
+    uint16_t new_values[TUNING_COUNT - 1] = {1000, 2000, 500, 10, 30};
+    memcpy(values, new_values, sizeof(new_values));
+    values[2] = 60001;
+    Tuning_t before = g_tuning;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT - 1, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    passed &= (memcmp(&before, &g_tuning, sizeof(Tuning_t)) == 0);
+
+    /* 延伸到只读地址，全部不写入（地址错误优先） */
+    memcpy(values, new_values, sizeof(new_values));
+    values[TUNING_COUNT - 1] = LOG_LEVEL_INFO;
+    passed &= (ModbusTest_Write(MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR - 1, TUNING_COUNT, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR);
+    passed &= (memcmp(&before, &g_tuning, sizeof(Tuning_t)) == 0);
+
+    /* 全部合格时全部写入，包括后面的日志级别 */
+    passed &= (ModbusTest_Write(MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT, values) == 0);
+    passed &= (memcmp(&g_tuning.pressure_period_ms, new_values, sizeof(new_values)) == 0);
+    passed &= (Log_GetLevel() == LOG_LEVEL_INFO);
+
+    /* 字节数与数量不一致 */
+    uint16_t response_length = 0;
+    test_request[6] ^= 0x02;
+    uint16_t crc = Modbus_CalculateCRC16(test_request, 7 + TUNING_COUNT * 2);
+    test_request[7 + TUNING_COUNT * 2] = crc & 0xFF;
+    test_request[8 + TUNING_COUNT * 2] = crc >> 8;
+    Modbus_ProcessRequest(test_request, 9 + TUNING_COUNT * 2, test_response, &response_length);
+    passed &= (response_length == 5 && test_response[2] == MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    passed &= (ModbusTest_Write(MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, 0, values) ==
+               MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+    Log_Info("FC10: %s", passed ? "PASS" : "FAIL");
+
+    /* 恢复 */
+    passed &= ModbusTest_RestoreTuning(&saved, saved_level);
+
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Register Write Test Completed ===");
+}
+
+/**
+ * @brief Modbus请求速率基准
+ * @note 连续处理读取全部传感器寄存器（0x00C8起8个）的FC 0x03请求，统计请求速率和
+ *       最长处理时间；读取不等待采集，超过最大数据年龄时只发出有间隔限制的刷新通知
+ */
+void Modbus_RequestRateBenchmark(void)
+{
+    uint8_t request[8] = {0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR >> 8,
+                          MODBUS_REG_TEMPERATURE_ADDR & 0xFF, 0x00, 0x08};
+    uint16_t response_length = 0;
+    uint32_t max_cycles = 0;
+    uint32_t refresh_requests = ModbusRegs_GetRefreshRequests();
+    uint32_t start_tick = HAL_GetTick();
+
+    Log_Info("=== Modbus Request Rate Benchmark ===");
+
+    DWT_Init();
+    uint16_t crc = Modbus_CalculateCRC16(request, 6);
+    request[6] = crc & 0xFF;
+    request[7] = crc >> 8;
+
+    uint32_t start_cycles = DWT_GetTick();
+    for (uint16_t i = 0; i < MODBUS_TEST_REQUESTS; i++) {
+        uint32_t request_start = DWT_GetTick();
+        Modbus_ProcessRequest(request, sizeof(request), test_response, &response_length);
+        uint32_t cycles = DWT_GetTick() - request_start;
+        if (cycles > max_cycles) {
+            max_cycles = cycles;
+        }
+    }
+    uint32_t total_cycles = DWT_GetTick() - start_cycles;
+    uint32_t elapsed_ms = HAL_GetTick() - start_tick;
+    refresh_requests = ModbusRegs_GetRefreshRequests() - refresh_requests;
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t max_us = max_cycles / cycles_per_us;
+    Log_Info("%u requests: %lu cyc/req, max %lu us", MODBUS_TEST_REQUESTS,
+             total_cycles / MODBUS_TEST_REQUESTS, max_us);
+    Log_Info("Rate: %lu req/s, %lu refresh requests in %lu ms",
+             (uint32_t)((uint64_t)MODBUS_TEST_REQUESTS * SystemCoreClock / (total_cycles + 1)),
+             refresh_requests, elapsed_ms);
+
+    bool passed = (response_length == 5 + 8 * 2) && (test_response[2] == 8 * 2) &&
+                  (max_us < MODBUS_TEST_MAX_LATENCY_US) &&
+                  (refresh_requests <= 2 * (elapsed_ms / MODBUS_REFRESH_INTERVAL_MS + 1));
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Request Rate Benchmark Completed ===");
+}
+
+/**
+ * @brief 双端口请求速率基准
+ * @note 两个端口各有环形缓冲区和帧定界，字节交替到达，共用寄存器表处理请求：
+ *       USART2读125个寄存器（最长应答）使端口饱和，USART3读8个传感器寄存器。
+ *       报告各端口单独运行和另一端口饱和时的请求速率，以及两个端口同时饱和时
+ *       请求处理占用的CPU；应答由中断发送，不占用任务时间
+ */
+void Modbus_DualPortBenchmark(void)
+{
+    ModbusTestPort_t *usart2 = &test_ports[0];
+    ModbusTestPort_t *usart3 = &test_ports[1];
+    ModbusRtuTiming_t timing;
+
+    Log_Info("=== Modbus Dual Port Benchmark ===");
+
+    DWT_Init();
+    ModbusRtu_GetTiming(MODBUS_TEST_PORT_BAUD, 10, &timing);
+    ModbusTest_PortInit(usart2, "USART2", 0x0000, MODBUS_MAX_READ_REGISTERS);
+    ModbusTest_PortInit(usart3, "USART3", MODBUS_REG_TEMPERATURE_ADDR, 8);
+
+    for (uint16_t i = 0; i < MODBUS_TEST_REQUESTS; i++) {
+        for (uint16_t j = 0; j < sizeof(usart2->request); j++) {
+            ModbusTest_PortByte(usart2, usart2->request[j]);
+            ModbusTest_PortByte(usart3, usart3->request[j]);
+        }
+        ModbusTest_PortEnd(usart2);
+        ModbusTest_PortEnd(usart3);
+    }
+
+    bool passed = true;
+    uint32_t load = 0;                  /* 两个端口同时饱和时的CPU占用（x10000） */
+    for (uint16_t i = 0; i < 2; i++) {
+        ModbusTestPort_t *port = &test_ports[i];
+        uint32_t other_ns = ModbusTest_PortNs(&test_ports[1 - i]);
+        uint32_t alone = ModbusTest_PortRate(port, 0, &timing);
+        uint32_t shared = ModbusTest_PortRate(port, other_ns, &timing);
+
+        Log_Info("%s %3u reg: %lu ok, %lu err, %lu ns/req", port->name, port->count,
+                 port->served, port->errors, ModbusTest_PortNs(port));
+        Log_Info("  alone %lu.%lu req/s, other saturated %lu.%lu req/s",
+                 alone / 10, alone % 10, shared / 10, shared % 10);
+
+        load += (uint32_t)((uint64_t)shared * ModbusTest_PortNs(port) / 1000000);
+        passed = passed && port->served == MODBUS_TEST_REQUESTS && port->errors == 0 &&
+                 port->framer.stats.frames == MODBUS_TEST_REQUESTS &&
+                 shared * 100 >= alone * 95;
+    }
+    Log_Info("%u baud, both saturated: CPU %lu.%02lu%%", MODBUS_TEST_PORT_BAUD, load / 100, load % 100);
+
+    passed = passed && load < 10000;
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Dual Port Benchmark Completed ===");
+}
+
+/**
+ * @brief 读应答生成基准：1、32、125个寄存器
+ * @note 比较直接生成（寄存器值写入发送缓冲区一次，同时计算CRC）和经过中间缓冲区
+ *       的两遍生成（先读到数组，Modbus_BuildResponse复制后再计算CRC），两者应答
+ *       必须相同；报告每个应答写入的字节数和处理周期数
+ */
+void Modbus_ReadResponseBenchmark(void)
+{
+    static const uint16_t counts[] = {1, 32, MODBUS_MAX_READ_REGISTERS};
+    uint8_t request[8];
+    uint16_t response_length = 0;
+    uint16_t reference_length = 0;
+    bool passed = true;
+
+    Log_Info("=== Modbus Read Response Benchmark ===");
+
+    DWT_Init();
+    for (uint16_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint16_t count = counts[c];
+        /* 125个寄存器读到地址末尾，包含传感器、运行参数和Flash统计 */
+        uint16_t start = (count == MODBUS_MAX_READ_REGISTERS) ? MODBUS_REGISTER_COUNT - count : MODBUS_REG_TEMPERATURE_ADDR;
+
+        request[0] = 0x01;
+        request[1] = MODBUS_READ_HOLDING_REGISTERS;
+        request[2] = start >> 8;
+        request[3] = start & 0xFF;
+        request[4] = count >> 8;
+        request[5] = count & 0xFF;
+        uint16_t crc = Modbus_CalculateCRC16(request, 6);
+        request[6] = crc & 0xFF;
+        request[7] = crc >> 8;
+
+        uint32_t start_cycles = DWT_GetTick();
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            Modbus_ProcessRequest(request, sizeof(request), test_response, &response_length);
+        }
+        uint32_t handler_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_READ_LOOPS;
+
+        /* 只比较应答生成部分，与Modbus_ProcessRequest的读应答相同 */
+        start_cycles = DWT_GetTick();
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            test_response[0] = 0x01;
+            test_response[1] = MODBUS_READ_HOLDING_REGISTERS;
+            test_response[2] = count * 2;
+            uint16_t response_crc = Modbus_CalculateCRC16(test_response, 3);
+            ModbusRegs_Read(start, count, MODBUS_REG_ACCESS_HOLDING, &test_response[3], &response_crc);
+            test_response[3 + count * 2] = response_crc & 0xFF;
+            test_response[4 + count * 2] = response_crc >> 8;
+        }
+        uint32_t direct_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_READ_LOOPS;
+
+        start_cycles = DWT_GetTick();
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            ModbusRegs_Read(start, count, MODBUS_REG_ACCESS_HOLDING, test_registers, NULL);
+            Modbus_BuildResponse(0x01, MODBUS_READ_HOLDING_REGISTERS, test_registers, count * 2,
+                                 test_request, &reference_length);
+        }
+        uint32_t two_pass_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_READ_LOOPS;
+
+        uint16_t response_crc = Modbus_CalculateCRC16(test_response, response_length - 2);
+        bool ok = response_length == 5 + count * 2 && reference_length == response_length &&
+                  memcmp(test_response, test_request, response_length) == 0 &&
+                  test_response[response_length - 2] == (response_crc & 0xFF) &&
+                  test_response[response_length - 1] == (response_crc >> 8);
+        passed = passed && ok;
+
+        /* 两遍生成：寄存器写入数组，再复制到应答 */
+        Log_Info("%3u regs: %u B written, two-pass %u B, %s", count, response_length,
+                 count * 2 + reference_length, ok ? "same" : "DIFFERENT");
+        Log_Info("  handler %lu cyc, build %lu cyc, two-pass %lu cyc", handler_cycles, direct_cycles, two_pass_cycles);
+    }
+
+    /* 超过标准最大值的请求回复异常 */
+    request[4] = 0x00;
+    request[5] = MODBUS_MAX_READ_REGISTERS + 1;
+    uint16_t crc = Modbus_CalculateCRC16(request, 6);
+    request[6] = crc & 0xFF;
+    request[7] = crc >> 8;
+    Modbus_ProcessRequest(request, sizeof(request), test_response, &response_length);
+    passed = passed && response_length == 5 && test_response[1] == (MODBUS_READ_HOLDING_REGISTERS | 0x80) &&
+             test_response[2] == MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Read Response Benchmark Completed ===");
+}
+
+/**
+ * @brief 应答发送基准：经ModbusRtu_Serve处理请求并从USART2发送
+ * @note 在USART2上实际发送（DMA）。帧结束时间取调用前，周转时间不含中断到任务的切换。
+ *       阻塞发送时任务在发送期间一直占用CPU，USART2和串口1副本各一次，按字符时间估算
+ */
+void Modbus_ServeBenchmark(void)
+{
+    static const uint16_t counts[] = {8, MODBUS_MAX_READ_REGISTERS};
+    static BLEMessage_t message;
+    ModbusRtuPort_t *port = &g_modbus_rtu_usart2;
+    ModbusRtuTiming_t timing;
+    bool passed = true;
+
+    Log_Info("=== Modbus Serve Benchmark ===");
+
+    DWT_Init();
+    ModbusRtu_GetTiming(port->huart->Init.BaudRate, 10, &timing);
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    for (uint16_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint16_t count = counts[c];
+        uint16_t start = (count == MODBUS_MAX_READ_REGISTERS) ? MODBUS_REGISTER_COUNT - count : MODBUS_REG_TEMPERATURE_ADDR;
+        uint16_t response_length = 0;
+
+        message.data[0] = 0x01;
+        message.data[1] = MODBUS_READ_HOLDING_REGISTERS;
+        message.data[2] = start >> 8;
+        message.data[3] = start & 0xFF;
+        message.data[4] = count >> 8;
+        message.data[5] = count & 0xFF;
+        uint16_t crc = Modbus_CalculateCRC16(message.data, 6);
+        message.data[6] = crc & 0xFF;
+        message.data[7] = crc >> 8;
+        message.length = 8;
+        message.flags = MODBUS_RTU_FRAME_OK;
+
+        memset(&port->tx_stats, 0, sizeof(port->tx_stats));
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            message.cycles = DWT_GetTick();
+            response_length = ModbusRtu_Serve(port, &message);
+        }
+
+        const ModbusRtuTxStats_t *stats = ModbusRtu_GetTxStats(port);
+        uint32_t responses = stats->responses ? stats->responses : 1;
+        uint32_t blocking_us = 2 * response_length * timing.char_us;
+
+        Log_Info("%3u regs: %lu/%u sent, %lu err", count, stats->responses,
+                 MODBUS_TEST_READ_LOOPS, stats->tx_errors);
+        Log_Info("  turnaround avg %lu us, max %lu us",
+                 stats->turnaround_total_us / responses, stats->turnaround_max_us);
+        Log_Info("  task %lu cyc/req (%lu us), blocking %lu us",
+                 stats->cpu_total_cycles / responses,
+                 stats->cpu_total_cycles / responses / cycles_per_us, blocking_us);
+
+        passed = passed && response_length == 5 + count * 2 && stats->responses == MODBUS_TEST_READ_LOOPS &&
+                 stats->turnaround_max_us < MODBUS_TEST_MAX_LATENCY_US;
+    }
+
+    memset(&port->tx_stats, 0, sizeof(port->tx_stats));
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Serve Benchmark Completed ===");
+}
+
+/**
+ * @brief 帧解析基准：读8个、125个寄存器，写运行参数，以及发给其他从机的255字节写请求
+ * @note 逐字节写入端口环形缓冲区后依次调用IDLE、t1.5、t3.5。CRC在IDLE（以及DMA半满/
+ *       全满）时计算，处于t3.5等待期间；帧结束（t3.5）到帧输出只检查结果。再比较
+ *       Modbus_ProcessFrame（只解析一次）和先校验CRC再处理的Modbus_IsModbusCommand加
+ *       Modbus_ProcessRequest，两者应答必须相同；报告每个请求的周期数
+ */
+void Modbus_FrameParseBenchmark(void)
+{
+    static const struct {
+        uint8_t slave_addr;
+        uint8_t function_code;
+        uint16_t start;
+        uint16_t count;
+    } cases[] = {
+        {0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 8},
+        {0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REGISTER_COUNT - MODBUS_MAX_READ_REGISTERS, MODBUS_MAX_READ_REGISTERS},
+        {0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT - 1},
+        {0x02, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, MODBUS_MAX_WRITE_REGISTERS},
+    };
+    ModbusTestPort_t *port = &test_ports[0];
+    uint16_t response_length = 0;
+    uint16_t reference_length = 0;
+    bool passed = true;
+
+    Log_Info("=== Modbus Frame Parse Benchmark ===");
+
+    DWT_Init();
+    for (uint16_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint16_t length = ModbusTest_BuildFrame(test_request, cases[c].slave_addr, cases[c].function_code,
+                                                cases[c].start, cases[c].count);
+        uint32_t idle_cycles = 0;
+        uint32_t t35_cycles = 0;
+        uint32_t checked_cycles = 0;
+        uint32_t parse_cycles = 0;
+        bool same = true;
+
+        memset(port, 0, sizeof(ModbusTestPort_t));
+        ModbusRtu_FramerInit(&port->framer, port->ring, MODBUS_RTU_RX_RING_SIZE, 0, ModbusTest_CopySink, port);
+
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            for (uint16_t j = 0; j < length; j++) {
+                ModbusTest_PortByte(port, test_request[j]);
+            }
+            uint32_t start_cycles = DWT_GetTick();
+            ModbusRtu_OnIdle(&port->framer, port->position, false);
+            idle_cycles += DWT_GetTick() - start_cycles;
+            ModbusRtu_OnT15(&port->framer, port->position);
+            start_cycles = DWT_GetTick();
+            ModbusRtu_OnT35(&port->framer, port->position);
+            t35_cycles += DWT_GetTick() - start_cycles;
+
+            reference_length = 0;
+            response_length = 0;
+            start_cycles = DWT_GetTick();
+            if (Modbus_IsModbusCommand(port->frame, length)) {
+                Modbus_ProcessRequest(port->frame, length, test_response, &reference_length);
+            }
+            checked_cycles += DWT_GetTick() - start_cycles;
+
+            start_cycles = DWT_GetTick();
+            Modbus_ProcessFrame(port->frame, length, port->response, &response_length);
+            parse_cycles += DWT_GetTick() - start_cycles;
+
+            same = same && response_length == reference_length &&
+                   memcmp(port->response, test_response, response_length) == 0;
+        }
+
+        passed = passed && same && port->served == MODBUS_TEST_READ_LOOPS && port->errors == 0;
+        Log_Info("FC%02X %3u B: %lu/%u ok, %s", cases[c].function_code, length,
+                 port->served, MODBUS_TEST_READ_LOOPS, same ? "same" : "DIFFERENT");
+        Log_Info("  idle %lu cyc, t3.5 %lu cyc", idle_cycles / MODBUS_TEST_READ_LOOPS,
+                 t35_cycles / MODBUS_TEST_READ_LOOPS);
+        Log_Info("  check+parse %lu cyc, parse once %lu cyc", checked_cycles / MODBUS_TEST_READ_LOOPS,
+                 parse_cycles / MODBUS_TEST_READ_LOOPS);
+    }
+
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Frame Parse Benchmark Completed ===");
+}
+
+#if FLASH_COLUMN_STORE_ENABLE
+/**
+ * @brief Modbus文件记录测试与历史数据传输速率
+ * @note 在其他任务中调用（不能在FlashIO任务中），需要列存储中至少有121个样本。
+ *       一个请求读取最新样本的时间戳和温度两个数据流，与按字段查询的结果比较；检查标准规定的异常。再按115200波特率的字符时间和实测
+ *       处理时间，比较一个FC 0x14请求读取121个温度样本与逐个寄存器轮询（FC 0x03读1个
+ *       寄存器，每次1个样本）每秒传输的样本数
+ */
+void Modbus_FileRecordTest(void)
+{
+    uint8_t *request = test_request;
+    uint16_t response_length = 0;
+    uint16_t length;
+    uint32_t first;
+    uint32_t count;
+    bool passed = true;
+
+    Log_Info("=== Modbus File Record Test ===");
+
+    DWT_Init();
+    FlashColumn_GetRange(&first, &count);
+    uint16_t samples = (MODBUS_FILE_MAX_DATA - 2) / 2;     /* 一个子请求最多的温度样本 */
+    if (count < samples) {
+        Log_Info("Only %lu samples stored, skipped", count);
+        Log_Info("=== Modbus File Record Test Completed ===");
+        return;
+    }
+
+    /* 列号按字段表顺序（标志字段在最后），与字段序号相同 */
+    uint32_t sample = ModbusTest_FileStart(first, count, MODBUS_TEST_FILE_SAMPLES);
+    Log_Info("Samples %lu..%lu, reading %lu", first, first + count, sample);
+
+    /* 时间戳（2个寄存器/样本）和温度（1个寄存器/样本） */
+    length = 3;
+    ModbusTest_AddFileRead(request, &length, RECORD_FIELD_timestamp, sample, MODBUS_TEST_FILE_SAMPLES * 2);
+    ModbusTest_AddFileRead(request, &length, RECORD_FIELD_temperature, sample, MODBUS_TEST_FILE_SAMPLES);
+    length = ModbusTest_FinishFileRequest(request, length);
+    {
+        uint8_t exception = ModbusTest_FileRequest(request, length, &response_length);
+        const uint8_t *sub1 = &test_response[3];
+        const uint8_t *sub2 = sub1 + 2 + MODBUS_TEST_FILE_SAMPLES * 4;
+        uint16_t crc = Modbus_CalculateCRC16(test_response, response_length - 2);
+        bool ok = exception == 0 &&
+                  response_length == 5 + 4 + MODBUS_TEST_FILE_SAMPLES * 6 &&
+                  test_response[2] == response_length - 5 &&
+                  sub1[0] == 1 + MODBUS_TEST_FILE_SAMPLES * 4 && sub1[1] == MODBUS_FILE_REFERENCE_TYPE &&
+                  sub2[0] == 1 + MODBUS_TEST_FILE_SAMPLES * 2 && sub2[1] == MODBUS_FILE_REFERENCE_TYPE &&
+                  test_response[response_length - 2] == (crc & 0xFF) &&
+                  test_response[response_length - 1] == (crc >> 8) &&
+                  ModbusTest_CheckFileData(sub1 + 2, RECORD_FIELD_timestamp, sample, 2) &&
+                  ModbusTest_CheckFileData(sub2 + 2, RECORD_FIELD_temperature, sample, 1);
+        Log_Info("2 streams x %u samples: %s", MODBUS_TEST_FILE_SAMPLES, ok ? "PASS" : "FAIL");
+        passed &= ok;
+    }
+
+    /* 异常：参考类型、数据流、记录长度、样本范围、应答长度 */
+    {
+        static const struct {
+            const char *name;
+            uint8_t column;
+            uint8_t reference_type;
+            int32_t offset;             /* 相对最新样本之后 */
+            uint16_t registers;
+            uint8_t exception;
+        } cases[] = {
+            {"reference type", 0, 5, -1, 2, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+            {"stream",         FLASH_COLUMN_MAX_COLUMNS, 6, -1, 1, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+            {"odd length",     0, 6, -1, 3, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+            {"future sample",  0, 6, 0, 2, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+            {"too long",       0, 6, -100, 122, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        };
+
+        for (uint16_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+            length = 3;
+            ModbusTest_AddFileRead(request, &length, cases[c].column,
+                                   (uint32_t)((int32_t)(first + count) + cases[c].offset), cases[c].registers);
+            request[3] = cases[c].reference_type;
+            length = ModbusTest_FinishFileRequest(request, length);
+            uint8_t exception = ModbusTest_FileRequest(request, length, &response_length);
+            if (exception != cases[c].exception) {
+                Log_Info("%s: exception %u, expected %u", cases[c].name, exception, cases[c].exception);
+                passed = false;
+            }
+        }
+
+        /* 两个子应答长度之和超过16位：8192和8191个时间戳样本，2+32768+2+32764=65536 */
+        uint32_t window = (first + count - 1) / MODBUS_FILE_WINDOW_RECORDS * MODBUS_FILE_WINDOW_RECORDS;
+        length = 3;
+        ModbusTest_AddFileRead(request, &length, RECORD_FIELD_timestamp, window, 8192 * 2);
+        ModbusTest_AddFileRead(request, &length, RECORD_FIELD_timestamp, window, 8191 * 2);
+        length = ModbusTest_FinishFileRequest(request, length);
+        uint8_t exception = ModbusTest_FileRequest(request, length, &response_length);
+        if (exception != MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE) {
+            Log_Info("length wrap: exception %u, expected %u", exception, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE);
+            passed = false;
+        }
+    }
+
+    /* 传输速率：一个子请求121个温度样本，与逐个寄存器轮询 */
+    {
+        ModbusRtuTiming_t timing;
+        uint32_t start_cycles;
+        uint32_t file_cycles;
+        uint32_t poll_cycles;
+        uint16_t poll_length = 0;
+
+        ModbusRtu_GetTiming(MODBUS_TEST_PORT_BAUD, 10, &timing);
+        length = 3;
+        ModbusTest_AddFileRead(request, &length, RECORD_FIELD_temperature, ModbusTest_FileStart(first, count, samples), samples);
+        length = ModbusTest_FinishFileRequest(request, length);
+
+        start_cycles = DWT_GetTick();
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            Modbus_ProcessFrame(request, length, test_response, &response_length);
+        }
+        file_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_READ_LOOPS;
+
+        uint16_t poll_request_length = ModbusTest_BuildFrame(test_frames[0], 0x01, MODBUS_READ_HOLDING_REGISTERS,
+                                                             MODBUS_REG_TEMPERATURE_ADDR, 1);
+        start_cycles = DWT_GetTick();
+        for (uint16_t i = 0; i < MODBUS_TEST_READ_LOOPS; i++) {
+            Modbus_ProcessFrame(test_frames[0], poll_request_length, test_frames[1], &poll_length);
+        }
+        poll_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_READ_LOOPS;
+
+        uint32_t cycles_per_us = SystemCoreClock / 1000000;
+        uint32_t file_us = (length + response_length) * timing.char_us + 2 * timing.t35_us + file_cycles / cycles_per_us;
+        uint32_t poll_us = (poll_request_length + poll_length) * timing.char_us + 2 * timing.t35_us + poll_cycles / cycles_per_us;
+        uint32_t file_rate = (uint32_t)((uint64_t)samples * 1000000 / file_us);
+        uint32_t poll_rate = 1000000 / poll_us;
+
+        Log_Info("FC14 %u samples: %u+%u B, handler %lu us", samples, length, response_length,
+                 file_cycles / cycles_per_us);
+        Log_Info("FC03 1 reg: %u+%u B, handler %lu us", poll_request_length, poll_length,
+                 poll_cycles / cycles_per_us);
+        Log_Info("%u baud: file %lu samples/s, polling %lu samples/s", MODBUS_TEST_PORT_BAUD, file_rate, poll_rate);
+
+        passed = passed && response_length == 5 + 2 + samples * 2 && file_rate > poll_rate * 10;
+    }
+
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus File Record Test Completed ===");
+}
+#endif
+
+/**
+ * @brief Modbus一致性测试
+ * @note 按Modbus协议规范（应用协议v1.1b3和串行链路规范）检查各功能码的正常应答、
+ *       异常码和不应答的情况，每个应答再用ModbusTest_CheckResponse检查格式和CRC，
+ *       并检查发送缓冲区没有写越界。只写入在范围内的值，结束时恢复原参数
+ */
+void Modbus_ConformanceTest(void)
+{
+    static const ModbusTestConformance_t cases[] = {
+        {"FC03 1 reg",       0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_AS_BUILT, 0},
+        {"FC03 125 regs",    0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, MODBUS_MAX_READ_REGISTERS, MODBUS_TEST_FRAME_AS_BUILT, 0},
+        {"FC03 0 regs",      0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, 0, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC03 126 regs",    0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, MODBUS_MAX_READ_REGISTERS + 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC03 past end",    0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REGISTER_COUNT - 1, 2, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+        {"FC03 0xFFFF",      0x01, MODBUS_READ_HOLDING_REGISTERS, 0xFFFF, 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+        {"FC03 9 bytes",     0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_EXTRA, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC03 7 bytes",     0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_SHORT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC04 flash stats", 0x01, MODBUS_READ_INPUT_REGISTERS, MODBUS_REG_FLASH_STATS_ADDR, FLASH_STATS_REG_COUNT, MODBUS_TEST_FRAME_AS_BUILT, 0},
+        {"FC04 126 regs",    0x01, MODBUS_READ_INPUT_REGISTERS, 0x0000, MODBUS_MAX_READ_REGISTERS + 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC06 write",       0x01, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 1000, MODBUS_TEST_FRAME_AS_BUILT, 0},
+        {"FC06 read-only",   0x01, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TEMPERATURE_ADDR, 100, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+        {"FC06 out of range",0x01, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_TUNING_ADDR, 50, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC06 9 bytes",     0x01, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 1000, MODBUS_TEST_FRAME_EXTRA, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC10 write",       0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT - 1, MODBUS_TEST_FRAME_AS_BUILT, 0},
+        {"FC10 0 regs",      0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, 0, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC10 byte count",  0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, 2, MODBUS_TEST_FRAME_BYTE_COUNT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC10 past end",    0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REGISTER_COUNT - 1, 2, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+#if FLASH_COLUMN_STORE_ENABLE
+        {"FC14 no request",  0x01, MODBUS_READ_FILE_RECORD, 0x0000, 0, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+        {"FC14 short",       0x01, MODBUS_READ_FILE_RECORD, 0x0700, 0, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE},
+#endif
+        {"FC01 unsupported", 0x01, 0x01, 0x0000, 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_FUNCTION},
+        {"FC05 unsupported", 0x01, 0x05, 0x0000, 0xFF00, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_FUNCTION},
+        {"FC2B unsupported", 0x01, 0x2B, 0x0E01, 0x0000, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_EXCEPTION_ILLEGAL_FUNCTION},
+        {"bad CRC",          0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_BAD_CRC, MODBUS_TEST_NO_REPLY},
+        {"3 bytes",          0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_TRUNCATED, MODBUS_TEST_NO_REPLY},
+        {"other slave",      0x02, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_TEST_NO_REPLY},
+        {"broadcast",        0x00, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 2000, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_TEST_NO_REPLY},
+        {"address 248",      0xF8, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 1, MODBUS_TEST_FRAME_AS_BUILT, MODBUS_TEST_NO_REPLY},
+    };
+    Tuning_t saved = g_tuning;
+    LogLevel_t saved_level = Log_GetLevel();
+    uint16_t failed = 0;
+
+    Log_Info("=== Modbus Conformance Test ===");
+
+    ModbusTest_GuardIntact();
+    for (uint16_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint16_t response_length = 0;
+        uint16_t length = ModbusTest_BuildFrame(test_request, cases[c].slave_addr, cases[c].function_code,
+                                                cases[c].start, cases[c].count);
+        length = ModbusTest_Reframe(test_request, length, cases[c].frame);
+
+        bool replied = Modbus_ProcessRequest(test_request, length, test_guarded_response, &response_length);
+        uint8_t result = ModbusTest_CheckResponse(test_request, length, replied, test_guarded_response, response_length);
+        if (result != cases[c].expect || !ModbusTest_GuardIntact()) {
+            osDelay(MODBUS_TEST_LOG_DRAIN_MS);
+            Log_Error("%s: 0x%02X, expected 0x%02X", cases[c].name, result, cases[c].expect);
+            failed++;
+        }
+    }
+    bool restored = ModbusTest_RestoreTuning(&saved, saved_level);
+
+    /* 异常用例的日志可能已占满日志队列 */
+    osDelay(MODBUS_TEST_LOG_DRAIN_MS);
+    Log_Info("%u cases, %u failed", (uint16_t)(sizeof(cases) / sizeof(cases[0])), failed);
+    Log_Info("Result: %s", (failed == 0 && restored) ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Conformance Test Completed ===");
+}
+
+/**
+ * @brief Modbus模糊测试
+ * @note 固定种子，结果可以复现。请求：从每个功能码一个正确请求的种子开始变异，产生新特征
+ *       （ModbusTest_FuzzSignal）的帧加入语料；每帧检查应答符合标准、发送缓冲区没有写越界、
+ *       处理不读取帧以外的字节。帧定界：随机拼接语料帧和随机字节，加随机静默、帧内间隔和
+ *       噪声回放，检查字节数、CRC和不丢帧，正确的帧再处理。不发送写保存寄存器的请求，
+ *       结束时恢复原参数，并报告本任务栈的剩余空间
+ */
+void Modbus_FuzzTest(void)
+{
+    Tuning_t saved = g_tuning;
+    LogLevel_t saved_level = Log_GetLevel();
+    uint32_t replies = 0;
+    uint32_t skipped = 0;
+    uint32_t signals = 0;
+
+    Log_Info("=== Modbus Fuzz Test ===");
+    Log_Info("Seed 0x%08lX, %u frames, %u streams", (uint32_t)MODBUS_TEST_FUZZ_SEED,
+             MODBUS_TEST_FUZZ_FRAMES, MODBUS_TEST_FUZZ_STREAMS);
+
+    DWT_Init();
+    test_fuzz_state = MODBUS_TEST_FUZZ_SEED;
+    test_fuzz_failures = 0;
+    memset(test_fuzz_map, 0, sizeof(test_fuzz_map));
+    ModbusTest_GuardIntact();
+    ModbusTest_FuzzSeed();
+
+    uint32_t start_cycles = DWT_GetTick();
+    for (uint32_t i = 0; i < MODBUS_TEST_FUZZ_FRAMES; i++) {
+        uint16_t parent = ModbusTest_Random() % test_fuzz_count;
+        uint16_t length = test_fuzz_length[parent];
+
+        memcpy(test_fuzz_frame, test_fuzz_corpus[parent], length);
+        length = ModbusTest_Mutate(test_fuzz_frame, length);
+        if (ModbusTest_WritesSave(test_fuzz_frame, length)) {
+            skipped++;
+            continue;
+        }
+
+        uint16_t response_length;
+        uint8_t result = ModbusTest_FuzzOne(length, &response_length);
+        if (result != MODBUS_TEST_NO_REPLY) {
+            replies++;
+        }
+        if (ModbusTest_FuzzSignal(test_fuzz_frame, length, result, response_length)) {
+            signals++;
+            ModbusTest_FuzzKeep(test_fuzz_frame, length);
+        }
+    }
+    uint32_t frame_cycles = (DWT_GetTick() - start_cycles) / MODBUS_TEST_FUZZ_FRAMES;
+
+    test_fuzz_ok_frames = 0;
+    test_fuzz_bytes = 0;
+    for (uint16_t i = 0; i < sizeof(test_long); i++) {
+        test_long[i] = ModbusTest_Random();
+    }
+    for (uint32_t i = 0; i < MODBUS_TEST_FUZZ_STREAMS; i++) {
+        ModbusTest_FuzzStream();
+    }
+
+    bool restored = ModbusTest_RestoreTuning(&saved, saved_level);
+
+    /* 异常应答的日志可能已占满日志队列 */
+    osDelay(MODBUS_TEST_LOG_DRAIN_MS);
+    Log_Info("Requests: %lu replied, %lu skipped", replies, skipped);
+    Log_Info("  %lu signals, corpus %u, %lu cyc/frame", signals, test_fuzz_count, frame_cycles);
+    Log_Info("Framer: %lu bytes, %lu ok frames", test_fuzz_bytes, test_fuzz_ok_frames);
+    Log_Info("Failures: %lu, stack free %lu B", test_fuzz_failures,
+             osThreadGetStackSpace(osThreadGetId()));
+    Log_Info("Result: %s", (test_fuzz_failures == 0 && restored) ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Fuzz Test Completed ===");
+}
+
+/**
+ * @brief 各功能码的处理周期和请求速率基准
+ * @note 处理帧定界已校验CRC的请求（Modbus_ProcessFrame），不含字符时间：每个功能码
+ *       报告平均和最长周期、按平均周期计算的请求速率，检查结果和最长处理时间，
+ *       用于发现协议处理的性能退化。写请求写入当前值，不改变参数
+ */
+void Modbus_FunctionCodeBenchmark(void)
+{
+    static const struct {
+        const char *name;
+        uint8_t slave_addr;
+        uint8_t function_code;
+        uint16_t start;
+        uint16_t count;
+        uint8_t expect;
+    } cases[] = {
+        {"FC03 8 regs",     0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 8, 0},
+        {"FC03 125 regs",   0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, MODBUS_MAX_READ_REGISTERS, 0},
+        {"FC04 42 regs",    0x01, MODBUS_READ_INPUT_REGISTERS, MODBUS_REG_FLASH_STATS_ADDR, FLASH_STATS_REG_COUNT, 0},
+        {"FC06 1 reg",      0x01, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_REG_MAX_AGE_ADDR, 0, 0},
+        {"FC10 5 regs",     0x01, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_REG_TUNING_ADDR, TUNING_COUNT - 1, 0},
+        {"FC03 exception",  0x01, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REGISTER_COUNT - 1, 2, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR},
+        {"FC2B unsupported",0x01, 0x2B, 0x0E01, 0x0000, MODBUS_EXCEPTION_ILLEGAL_FUNCTION},
+        {"other slave",     0x02, MODBUS_READ_HOLDING_REGISTERS, MODBUS_REG_TEMPERATURE_ADDR, 8, MODBUS_TEST_NO_REPLY},
+    };
+    Tuning_t saved = g_tuning;
+    bool passed = true;
+
+    Log_Info("=== Modbus Function Code Benchmark ===");
+
+    DWT_Init();
+    ModbusTest_GuardIntact();
+    for (uint16_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint16_t count = (cases[c].function_code == MODBUS_WRITE_SINGLE_REGISTER) ? g_tuning.max_age_ms : cases[c].count;
+        uint16_t length = ModbusTest_BuildFrame(test_request, cases[c].slave_addr, cases[c].function_code,
+                                                cases[c].start, count);
+        passed &= ModbusTest_FunctionCost(cases[c].name, length, cases[c].expect);
+    }
+
+#if FLASH_COLUMN_STORE_ENABLE
+    {
+        uint16_t samples = (MODBUS_FILE_MAX_DATA - 2) / 2;
+        uint32_t first;
+        uint32_t count;
+        uint16_t length = 3;
+
+        FlashColumn_GetRange(&first, &count);
+        if (count >= samples) {
+            ModbusTest_AddFileRead(test_request, &length, RECORD_FIELD_temperature,
+                                   ModbusTest_FileStart(first, count, samples), samples);
+            length = ModbusTest_FinishFileRequest(test_request, length);
+            passed &= ModbusTest_FunctionCost("FC14 121 samples", length, 0);
+        }
+    }
+#endif
+
+    passed &= (memcmp(&saved, &g_tuning, sizeof(Tuning_t)) == 0);
+    Log_Info("Result: %s", passed ? "PASS" : "FAIL");
+    Log_Info("=== Modbus Function Code Benchmark Completed ===");
+}
+
+/* USER CODE END EF */
@@ -0,0 +1,277 @@
+#include "record_codec.h"
+#include <string.h>
+#include <stddef.h>
+
+/* 旧版本记录按长度识别 */
+#if RECORD_ENCODED_SIZE == RECORD_LEGACY_SIZE
+#error "RECORD_ENCODED_SIZE must differ from RECORD_LEGACY_SIZE"
+#endif
+
+/* 按字段类型选择编码函数 */
+#define RECORD_PUT_FIXED             RecordCodec_PutFixed
+#define RECORD_PUT_UINT              RecordCodec_PutUint
+#define RECORD_PUT_FLAG              RecordCodec_PutFlag
+
+/* 字段描述表 */
+#define RECORD_FIELD_DESC(name, kind, width, scale, unit, member) \
+    { #name, unit, RECORD_FIELD_##kind, width, scale },
+static const RecordFieldDesc_t g_record_fields[RECORD_FIELD_COUNT] = {
+    SENSOR_RECORD_FIELDS(RECORD_FIELD_DESC)
+};
+#undef RECORD_FIELD_DESC
+
+/**
+ * @brief 读取小端无符号数
+ * @param p 数据
+ * @param width 字节数（不超过4）
+ * @return uint32_t 原始值
+ */
+uint32_t RecordCodec_GetLE(const uint8_t *p, uint8_t width)
+{
+    uint32_t value = 0;
+
+    for (uint8_t i = 0; i < width; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief 获取字段描述
+ * @param index 字段下标，0 ~ RECORD_FIELD_COUNT-1
+ * @return const RecordFieldDesc_t* 下标越界返回NULL
+ */
+const RecordFieldDesc_t* RecordCodec_GetField(uint32_t index)
+{
+    if (index >= RECORD_FIELD_COUNT) {
+        return NULL;
+    }
+    return &g_record_fields[index];
+}
+
+/**
+ * @brief 把字段的原始值换算为实际值
+ * @param index 字段下标
+ * @param raw 小端读出的原始值（FLAG为0或1）
+ * @return double 实际值，定点数已按比例换算
+ */
+double RecordCodec_FieldValue(uint32_t index, uint32_t raw)
+{
+    const RecordFieldDesc_t *field = &g_record_fields[index];
+
+    switch (field->kind) {
+        case RECORD_FIELD_FIXED:
+            if (field->width < 4 && (raw & (1UL << (field->width * 8 - 1)))) {
+                raw |= ~0UL << (field->width * 8);  /* 符号扩展 */
+            }
+            return (double)(int32_t)raw / field->scale;
+
+        case RECORD_FIELD_UINT:
+            return (double)raw / field->scale;
+
+        case RECORD_FIELD_FLAG:
+        default:
+            return raw;
+    }
+}
+
+/**
+ * @brief 解码旧版本记录（RECORD_LEGACY_SIZE字节）
+ * @param record 记录数据
+ * @param values 输出各字段的值，旧版本没有的字段为0
+ */
+static void RecordCodec_DecodeLegacy(const uint8_t *record, double *values)
+{
+    double pressure;
+    float temperature;
+    float humidity;
+
+    memcpy(&pressure, record + RECORD_LEGACY_PRESSURE, sizeof(pressure));
+    memcpy(&temperature, record + RECORD_LEGACY_TEMPERATURE, sizeof(temperature));
+    memcpy(&humidity, record + RECORD_LEGACY_HUMIDITY, sizeof(humidity));
+
+    for (uint32_t i = 0; i < RECORD_FIELD_COUNT; i++) {
+        values[i] = 0;
+    }
+    values[RECORD_FIELD_timestamp] = RecordCodec_GetLE(record + RECORD_LEGACY_TIMESTAMP, 4);
+    values[RECORD_FIELD_pressure] = pressure;
+    values[RECORD_FIELD_temperature] = temperature;
+    values[RECORD_FIELD_humidity] = humidity;
+    values[RECORD_FIELD_system_status] = RecordCodec_GetLE(record + RECORD_LEGACY_STATUS, 2);
+    values[RECORD_FIELD_error_count] = RecordCodec_GetLE(record + RECORD_LEGACY_ERROR_COUNT, 2);
+    values[RECORD_FIELD_pressure_valid] = record[RECORD_LEGACY_PRESSURE_VALID] != 0;
+    values[RECORD_FIELD_temperature_valid] = record[RECORD_LEGACY_TEMPERATURE_VALID] != 0;
+    values[RECORD_FIELD_humidity_valid] = record[RECORD_LEGACY_HUMIDITY_VALID] != 0;
+}
+
+/**
+ * @brief 按字段描述表解码记录
+ * @param record 记录数据
+ * @param length 记录长度
+ * @param values 输出各字段的值，长度RECORD_FIELD_COUNT，定点数已换算为实际值
+ * @return true: 解码成功, false: 长度或版本不符
+ * @note 长度为RECORD_LEGACY_SIZE时按旧版本布局解码
+ */
+bool RecordCodec_DecodeValues(const uint8_t *record, uint32_t length, double *values)
+{
+    if (record == NULL || values == NULL) {
+        return false;
+    }
+
+    if (length == RECORD_LEGACY_SIZE) {
+        RecordCodec_DecodeLegacy(record, values);
+        return true;
+    }
+
+    if (length != RECORD_ENCODED_SIZE || record[0] != RECORD_SCHEMA_VERSION) {
+        return false;
+    }
+
+    const uint8_t *p = record + 1;
+    const uint8_t *flags = record + 1 + RECORD_VALUE_SIZE;
+    uint32_t bit = 0;
+
+    for (uint32_t i = 0; i < RECORD_FIELD_COUNT; i++) {
+        const RecordFieldDesc_t *field = &g_record_fields[i];
+
+        if (field->kind == RECORD_FIELD_FLAG) {
+            values[i] = RecordCodec_FieldValue(i, (flags[bit / 8] >> (bit % 8)) & 1);
+            bit++;
+        } else {
+            values[i] = RecordCodec_FieldValue(i, RecordCodec_GetLE(p, field->width));
+            p += field->width;
+        }
+    }
+
+    return true;
+}
+
+#ifdef USE_HAL_DRIVER
+
+/**
+ * @brief 写入小端无符号数
+ */
+static void RecordCodec_PutLE(uint8_t **p, uint32_t value, uint8_t width)
+{
+    for (uint8_t i = 0; i < width; i++) {
+        *(*p)++ = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief 编码定点数字段，超出范围时饱和
+ */
+static void RecordCodec_PutFixed(uint8_t **p, uint8_t *flags, uint32_t *bit,
+                                 double value, uint8_t width, uint32_t scale)
+{
+    double scaled = value * scale;
+    int32_t max = (width >= 4) ? INT32_MAX : (int32_t)((1UL << (width * 8 - 1)) - 1);
+    int32_t min = -max - 1;
+    int32_t raw;
+
+    (void)flags;
+    (void)bit;
+
+    if (scaled != scaled) {
+        raw = 0;  /* NaN */
+    } else if (scaled >= max) {
+        raw = max;
+    } else if (scaled <= min) {
+        raw = min;
+    } else {
+        raw = (int32_t)(scaled + (scaled >= 0 ? 0.5 : -0.5));
+    }
+
+    RecordCodec_PutLE(p, (uint32_t)raw, width);
+}
+
+/**
+ * @brief 编码无符号整数字段，超出范围时饱和
+ */
+static void RecordCodec_PutUint(uint8_t **p, uint8_t *flags, uint32_t *bit,
+                                uint32_t value, uint8_t width, uint32_t scale)
+{
+    uint32_t max = (width >= 4) ? UINT32_MAX : (1UL << (width * 8)) - 1;
+
+    (void)flags;
+    (void)bit;
+    (void)scale;
+
+    RecordCodec_PutLE(p, value > max ? max : value, width);
+}
+
+/**
+ * @brief 编码标志字段
+ */
+static void RecordCodec_PutFlag(uint8_t **p, uint8_t *flags, uint32_t *bit,
+                                uint32_t value, uint8_t width, uint32_t scale)
+{
+    (void)p;
+    (void)width;
+    (void)scale;
+
+    if (value) {
+        flags[*bit / 8] |= 1 << (*bit % 8);
+    }
+    (*bit)++;
+}
+
+/**
+ * @brief 编码传感器数据
+ * @param data 传感器数据
+ * @param record 输出缓冲，至少RECORD_ENCODED_SIZE字节
+ * @return uint32_t 记录长度
+ */
+uint32_t RecordCodec_EncodeSensorData(const GlobalSensorData_t *data, uint8_t *record)
+{
+    uint8_t *p = record;
+    uint8_t *flags = record + 1 + RECORD_VALUE_SIZE;
+    uint32_t bit = 0;
+
+    *p++ = RECORD_SCHEMA_VERSION;
+    memset(flags, 0, (RECORD_FLAG_COUNT + 7) / 8);
+
+#define RECORD_ENCODE_FIELD(name, kind, width, scale, unit, member) \
+    RECORD_PUT_##kind(&p, flags, &bit, data->member, width, scale);
+    SENSOR_RECORD_FIELDS(RECORD_ENCODE_FIELD)
+#undef RECORD_ENCODE_FIELD
+
+    return RECORD_ENCODED_SIZE;
+}
+
+/**
+ * @brief 解码传感器数据
+ * @param record 记录数据
+ * @param length 记录长度
+ * @param data 输出传感器数据
+ * @return true: 解码成功, false: 格式不符
+ * @note 兼容旧版本直接保存的GlobalSensorData_t（见RECORD_LEGACY_SIZE）；新格式只有
+ *       一个时间戳，压力时间戳与系统时间戳相同
+ */
+bool RecordCodec_DecodeSensorData(const uint8_t *record, uint32_t length, GlobalSensorData_t *data)
+{
+    double values[RECORD_FIELD_COUNT];
+
+    if (record == NULL || data == NULL) {
+        return false;
+    }
+
+    if (!RecordCodec_DecodeValues(record, length, values)) {
+        return false;
+    }
+
+    memset(data, 0, sizeof(GlobalSensorData_t));
+
+#define RECORD_DECODE_FIELD(name, kind, width, scale, unit, member) \
+    data->member = values[RECORD_FIELD_##name];
+    SENSOR_RECORD_FIELDS(RECORD_DECODE_FIELD)
+#undef RECORD_DECODE_FIELD
+
+    data->pressure_timestamp = data->system_timestamp;
+    if (length == RECORD_LEGACY_SIZE) {
+        data->pressure_timestamp = RecordCodec_GetLE(record + RECORD_LEGACY_PRESSURE_TIME, 4);
+    }
+    return true;
+}
+
+#endif /* USE_HAL_DRIVER */
@@ -0,0 +1,153 @@
+#include "tuning.h"
+#include "flash.h"
+#include "flash_fs.h"
+#include "log.h"
+#include "crc.h"
+#include <string.h>
+#include <stddef.h>
+
+/* 取值范围，下标为TUNING_xxx */
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint16_t defaults;
+} TuningLimit_t;
+
+static const TuningLimit_t g_tuning_limits[TUNING_COUNT] = {
+    [TUNING_MAX_AGE]         = { 0,    60000, TUNING_DEFAULT_MAX_AGE_MS },
+    [TUNING_PRESSURE_PERIOD] = { 100,  60000, TUNING_DEFAULT_PRESSURE_MS },
+    [TUNING_DHT11_PERIOD]    = { 1000, 60000, TUNING_DEFAULT_DHT11_MS },  /* DHT11两次采样至少间隔1s */
+    [TUNING_LCD_PERIOD]      = { 100,  60000, TUNING_DEFAULT_LCD_MS },
+    [TUNING_STORE_PERIOD]    = { 1,    3600,  TUNING_DEFAULT_STORE_S },
+    [TUNING_STORE_BATCH]     = { 0,    600,   TUNING_DEFAULT_BATCH_S },  /* 掉电丢失窗口，见flash.h */
+};
+
+Tuning_t g_tuning = {
+    .max_age_ms = TUNING_DEFAULT_MAX_AGE_MS,
+    .pressure_period_ms = TUNING_DEFAULT_PRESSURE_MS,
+    .dht11_period_ms = TUNING_DEFAULT_DHT11_MS,
+    .lcd_period_ms = TUNING_DEFAULT_LCD_MS,
+    .store_period_s = TUNING_DEFAULT_STORE_S,
+    .store_batch_s = TUNING_DEFAULT_BATCH_S,
+};
+
+static volatile bool g_tuning_save_requested = false;
+
+/**
+ * @brief 检查参数值是否在范围内
+ * @param index TUNING_xxx
+ * @param value 参数值
+ * @return true: 可以写入
+ */
+bool Tuning_Check(uint16_t index, uint16_t value)
+{
+    return index < TUNING_COUNT && value >= g_tuning_limits[index].min && value <= g_tuning_limits[index].max;
+}
+
+/**
+ * @brief 设置参数并使其生效
+ * @param index TUNING_xxx
+ * @param value 参数值，调用前用Tuning_Check检查
+ * @note 不阻塞，可在调度器锁定时调用
+ */
+void Tuning_Set(uint16_t index, uint16_t value)
+{
+    if (index >= TUNING_COUNT) {
+        return;
+    }
+
+    ((volatile uint16_t*)&g_tuning)[index] = value;
+
+    if (index == TUNING_STORE_BATCH) {
+        Flash_SetStageFlushTime((uint32_t)value * 1000);
+    }
+}
+
+/**
+ * @brief 从文件区加载参数
+ * @note 在Flash I/O服务任务中挂载文件区后调用；没有文件时使用默认值
+ */
+void Tuning_Load(void)
+{
+    static TuningFile_t file;
+    FlashFsFile_t *handle;
+    uint32_t read_length = 0;
+    uint16_t rejected = 0;
+
+    if (FlashFs_Open(&handle, TUNING_FILE_NAME, FLASH_FS_O_RDONLY) != FLASH_OK) {
+        Log_Info("Tuning: no saved settings, using defaults");
+        return;
+    }
+    FlashResult_t result = FlashFs_Read(handle, (uint8_t*)&file, sizeof(file), &read_length);
+    FlashFs_Close(handle);
+
+    if (result != FLASH_OK || read_length != sizeof(file) || file.magic != TUNING_FILE_MAGIC ||
+        file.count != TUNING_COUNT ||
+        Crc16Ccitt_Update(CRC16_CCITT_INIT, (const uint8_t*)&file, offsetof(TuningFile_t, crc16)) != file.crc16) {
+        Log_Warn("Tuning: settings file invalid, using defaults");
+        return;
+    }
+
+    for (uint16_t i = 0; i < TUNING_COUNT; i++) {
+        if (Tuning_Check(i, file.values[i])) {
+            Tuning_Set(i, file.values[i]);
+        } else {
+            rejected++;
+        }
+    }
+
+    Log_Info("Tuning: settings loaded, %u out of range", rejected);
+}
+
+/**
+ * @brief 请求保存参数
+ * @note 任意任务可调用，由Flash I/O服务任务保存
+ */
+void Tuning_RequestSave(void)
+{
+    g_tuning_save_requested = true;
+}
+
+/**
+ * @brief 是否有尚未完成的保存请求
+ */
+bool Tuning_IsSavePending(void)
+{
+    return g_tuning_save_requested;
+}
+
+/**
+ * @brief 周期处理：保存请求的参数
+ * @note 由Flash I/O服务任务调用
+ */
+void Tuning_Process(void)
+{
+    static TuningFile_t file;
+    FlashFsFile_t *handle;
+
+    if (!g_tuning_save_requested) {
+        return;
+    }
+    g_tuning_save_requested = false;
+
+    file.magic = TUNING_FILE_MAGIC;
+    file.count = TUNING_COUNT;
+    memcpy(file.values, &g_tuning, sizeof(file.values));
+    file.crc16 = Crc16Ccitt_Update(CRC16_CCITT_INIT, (const uint8_t*)&file, offsetof(TuningFile_t, crc16));
+
+    FlashResult_t result = FlashFs_Open(&handle, TUNING_FILE_NAME,
+                                        FLASH_FS_O_WRONLY | FLASH_FS_O_CREAT | FLASH_FS_O_TRUNC);
+    if (result == FLASH_OK) {
+        result = FlashFs_Write(handle, (const uint8_t*)&file, sizeof(file));
+        FlashResult_t close_result = FlashFs_Close(handle);
+        if (result == FLASH_OK) {
+            result = close_result;
+        }
+    }
+
+    if (result != FLASH_OK) {
+        Log_Error("Tuning: save failed, error %d", result);
+        return;
+    }
+    Log_Info("Tuning: settings saved");
+}
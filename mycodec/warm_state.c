@@ -0,0 +1,368 @@
+#include "warm_state.h"
+#include "modbus.h"
+#include "bsp_dwt.h"
+#include "log.h"
+#include "crc.h"
+#include <string.h>
+#include <stddef.h>
+
+/* 加载结果（Flash I/O服务任务写入，g_warm_loaded置位后其他任务只读） */
+static WarmState_t g_warm_restored;             /* 加载到的最新快照 */
+static volatile bool g_warm_loaded = false;     /* 加载已完成（无论是否找到快照） */
+static volatile bool g_warm_applied = false;    /* 已恢复到全局数据，之后才允许保存 */
+static volatile bool g_warm_late = false;       /* 恢复时加载尚未完成，加载后由Flash I/O服务任务恢复 */
+static bool g_warm_head_checked = false;        /* 已核对快照之后的记录 */
+
+/* 写入位置与保存状态（仅Flash I/O服务任务访问） */
+static WarmState_t g_warm_last;                 /* 最近保存的快照，用于判断内容是否变化 */
+static uint32_t g_warm_sector = 1;              /* 当前扇区 */
+static uint32_t g_warm_next_slot = WARM_STATE_SLOTS_PER_SECTOR;  /* 下一个空槽，写满时轮换扇区 */
+static uint32_t g_warm_sequence = 0;
+static uint32_t g_warm_boot_count = 0;
+static uint32_t g_warm_saved_tick = 0;
+static volatile bool g_warm_save_requested = false;
+static WarmStateStats_t g_warm_stats;
+
+/**
+ * @brief 槽地址
+ */
+static uint32_t WarmState_SlotAddress(uint32_t sector, uint32_t slot)
+{
+    return W25Q64_STATE_AREA_START + sector * W25Q64_SECTOR_SIZE + slot * WARM_STATE_SLOT_SIZE;
+}
+
+/**
+ * @brief 计算快照CRC
+ */
+static uint16_t WarmState_Crc(const WarmState_t *state)
+{
+    return Crc16Ccitt_Update(CRC16_CCITT_INIT, (const uint8_t*)state, offsetof(WarmState_t, crc16));
+}
+
+/**
+ * @brief 读取一个槽并校验
+ * @return true: 标志位和CRC正确
+ */
+static bool WarmState_ReadSlot(uint32_t sector, uint32_t slot, WarmState_t *state)
+{
+    if (Flash_Read(WarmState_SlotAddress(sector, slot), (uint8_t*)state, sizeof(WarmState_t)) != FLASH_OK) {
+        return false;
+    }
+    return state->magic == WARM_STATE_MAGIC && state->crc16 == WarmState_Crc(state);
+}
+
+/**
+ * @brief 槽是否已写入（标志位不是擦除状态）
+ * @note 写入中掉电的槽也算已写入，不能再次编程
+ */
+static bool WarmState_SlotUsed(uint32_t sector, uint32_t slot)
+{
+    uint32_t magic;
+
+    if (Flash_Read(WarmState_SlotAddress(sector, slot), (uint8_t*)&magic, sizeof(magic)) != FLASH_OK) {
+        return true;
+    }
+    return magic != 0xFFFFFFFF;
+}
+
+/**
+ * @brief 加载最新的状态快照
+ * @note 由Flash I/O服务任务在Flash初始化识别芯片之后、加载索引表之前调用
+ *       （Flash_SetProbeHook）；槽按顺序写入，二分查找第一个空槽，只读取几个页
+ */
+void WarmState_Load(void)
+{
+    static WarmState_t candidate;
+    uint32_t start_cycles = DWT_GetTick();
+    int32_t sector = -1;
+
+    g_warm_stats.restored = false;
+    g_warm_stats.fallbacks = 0;
+
+    /* 第一个槽序号较大的扇区为当前扇区 */
+    for (uint32_t s = 0; s < 2; s++) {
+        if (WarmState_ReadSlot(s, 0, &candidate) &&
+            (sector < 0 || candidate.sequence > g_warm_restored.sequence)) {
+            g_warm_restored = candidate;
+            sector = s;
+        }
+    }
+
+    if (sector >= 0) {
+        uint32_t low = 1;
+        uint32_t high = WARM_STATE_SLOTS_PER_SECTOR;
+
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (WarmState_SlotUsed(sector, middle)) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        g_warm_sector = sector;
+        g_warm_next_slot = low;
+
+        /* 最后写入的槽损坏时向前回退，第一个槽已确认有效 */
+        for (uint32_t slot = low - 1; slot > 0; slot--) {
+            if (WarmState_ReadSlot(sector, slot, &candidate)) {
+                g_warm_restored = candidate;
+                break;
+            }
+            g_warm_stats.fallbacks++;
+        }
+
+        g_warm_sequence = g_warm_restored.sequence;
+        g_warm_last = g_warm_restored;
+        g_warm_stats.restored = true;
+    }
+
+    /* 本次启动是第几次，快照中保存的是上次启动时的值 */
+    g_warm_boot_count = (sector >= 0) ? g_warm_restored.boot_count + 1 : 1;
+
+    g_warm_stats.load_us = (DWT_GetTick() - start_cycles) / (SystemCoreClock / 1000000);
+    g_warm_loaded = true;
+
+    if (sector >= 0) {
+        Log_Info("Warm state: seq %lu loaded in %lu us", g_warm_restored.sequence, g_warm_stats.load_us);
+    } else {
+        Log_Info("Warm state: none, cold start");
+    }
+}
+
+/**
+ * @brief 把加载的快照恢复到全局传感器数据和Modbus寄存器
+ * @return bool true: 已恢复, false: 没有快照
+ * @note 只恢复仍为初始值的字段，加载晚于传感器首次采集时不覆盖新值；
+ *       传感器任务可能同时更新，写入期间锁定调度器
+ */
+static bool WarmState_Apply(void)
+{
+    const WarmState_t *state = &g_warm_restored;
+
+    if (!g_warm_stats.restored) {
+        g_warm_applied = true;
+        return false;
+    }
+
+    int32_t lock = osKernelLock();
+    if (!g_sensor_data.pressure_valid) {
+        g_sensor_data.pressure_value = state->pressure_value;
+        g_sensor_data.pressure_valid = (state->valid & WARM_STATE_VALID_PRESSURE) ? 1 : 0;
+        g_sensor_data.restored |= state->valid & WARM_STATE_VALID_PRESSURE;
+        g_modbus_registers.pressure = state->registers[0];
+    }
+    if (!g_sensor_data.temperature_valid) {
+        g_sensor_data.temperature = state->temperature;
+        g_sensor_data.temperature_valid = (state->valid & WARM_STATE_VALID_TEMPERATURE) ? 1 : 0;
+        g_sensor_data.restored |= state->valid & WARM_STATE_VALID_TEMPERATURE;
+        g_modbus_registers.temperature = state->registers[1];
+    }
+    if (!g_sensor_data.humidity_valid) {
+        g_sensor_data.humidity = state->humidity;
+        g_sensor_data.humidity_valid = (state->valid & WARM_STATE_VALID_HUMIDITY) ? 1 : 0;
+        g_sensor_data.restored |= state->valid & WARM_STATE_VALID_HUMIDITY;
+        g_modbus_registers.humidity = state->registers[2];
+    }
+    if (g_modbus_registers.status == 0) {
+        g_sensor_data.system_status = state->system_status;
+        g_modbus_registers.status = state->registers[3];
+    }
+    if (g_sensor_data.error_count == 0) {
+        g_sensor_data.error_count = state->error_count;
+        g_modbus_registers.error_count = state->registers[4];
+    }
+    osKernelRestoreLock(lock);
+
+    if (state->log_level < LOG_LEVEL_MAX) {
+        Log_SetLevel((LogLevel_t)state->log_level);
+    }
+
+    g_warm_applied = true;
+
+    /* 保存新的启动次数 */
+    WarmState_RequestSave();
+
+    Log_Info("Warm state: restored, boot %lu, up %lu s", g_warm_boot_count, state->uptime_ms / 1000);
+    return true;
+}
+
+/**
+ * @brief 恢复复位前的状态
+ * @param timeout_ms 等待Flash I/O服务任务加载的最长时间
+ * @return bool true: 已恢复, false: 没有快照或等待超时
+ * @note 在SensorData_Init之后调用。恢复的值保留有效标志，并在restored中标记，
+ *       传感器重新采集后清除。等待超时时由Flash I/O服务任务在加载后恢复；
+ *       恢复之后才开始保存快照，避免用清零的数据覆盖
+ */
+bool WarmState_Restore(uint32_t timeout_ms)
+{
+    uint32_t start_tick = osKernelGetTickCount();
+
+    while (!g_warm_loaded) {
+        if (osKernelGetTickCount() - start_tick >= timeout_ms) {
+            Log_Warn("Warm state: load timeout, restore later");
+            g_warm_late = true;
+            return false;
+        }
+        osDelay(1);
+    }
+
+    return WarmState_Apply();
+}
+
+/**
+ * @brief 请求保存快照（系统状态、错误计数、配置变化等事件）
+ * @note 任意任务可调用，由Flash I/O服务任务合并保存
+ */
+void WarmState_RequestSave(void)
+{
+    g_warm_save_requested = true;
+}
+
+/**
+ * @brief 采集当前状态
+ */
+static void WarmState_Capture(WarmState_t *state)
+{
+    FlashSnapshot_t snapshot;
+
+    memset(state, 0xFF, sizeof(WarmState_t));
+    Flash_GetSnapshot(&snapshot);
+
+    /* 传感器任务可能同时更新，锁调度器取得一致的一组值 */
+    int32_t lock = osKernelLock();
+    state->pressure_value = g_sensor_data.pressure_value;
+    state->temperature = g_sensor_data.temperature;
+    state->humidity = g_sensor_data.humidity;
+    state->system_status = g_sensor_data.system_status;
+    state->error_count = g_sensor_data.error_count;
+    state->valid = (g_sensor_data.pressure_valid ? WARM_STATE_VALID_PRESSURE : 0) |
+                   (g_sensor_data.temperature_valid ? WARM_STATE_VALID_TEMPERATURE : 0) |
+                   (g_sensor_data.humidity_valid ? WARM_STATE_VALID_HUMIDITY : 0);
+    state->registers[0] = g_modbus_registers.pressure;
+    state->registers[1] = g_modbus_registers.temperature;
+    state->registers[2] = g_modbus_registers.humidity;
+    state->registers[3] = g_modbus_registers.status;
+    state->registers[4] = g_modbus_registers.error_count;
+    osKernelRestoreLock(lock);
+
+    state->magic = WARM_STATE_MAGIC;
+    state->boot_count = g_warm_boot_count;
+    state->head_id = snapshot.head_id;
+    state->record_count = snapshot.record_count;
+    state->log_level = (uint8_t)Log_GetLevel();
+}
+
+/**
+ * @brief 写入下一个槽
+ * @note 当前扇区写满时擦除另一个扇区；写入失败的槽不再使用
+ */
+static FlashResult_t WarmState_Write(WarmState_t *state)
+{
+    if (g_warm_next_slot >= WARM_STATE_SLOTS_PER_SECTOR) {
+        uint32_t sector = g_warm_sector ^ 1;
+        if (Flash_EraseSector(WarmState_SlotAddress(sector, 0)) != FLASH_OK) {
+            Log_Error("Warm state: erase failed");
+            return FLASH_ERROR_ERASE;
+        }
+        g_warm_sector = sector;
+        g_warm_next_slot = 0;
+    }
+
+    uint32_t address = WarmState_SlotAddress(g_warm_sector, g_warm_next_slot);
+    g_warm_next_slot++;
+
+    state->sequence = ++g_warm_sequence;
+    state->uptime_ms = osKernelGetTickCount();
+    state->crc16 = WarmState_Crc(state);
+
+    if (Flash_Write(address, (const uint8_t*)state, sizeof(WarmState_t)) != FLASH_OK) {
+        Log_Error("Warm state: write failed");
+        return FLASH_ERROR_WRITE;
+    }
+
+    g_warm_last = *state;
+    g_warm_saved_tick = osKernelGetTickCount();
+    g_warm_stats.saves++;
+    return FLASH_OK;
+}
+
+/**
+ * @brief 立即保存快照
+ * @return FlashResult_t 操作结果
+ * @note 在Flash I/O服务任务中调用（受控复位前用FlashIo_Call）
+ */
+FlashResult_t WarmState_Save(void)
+{
+    static WarmState_t state;
+
+    if (!g_warm_loaded || !g_warm_applied) {
+        return FLASH_ERROR_INIT;
+    }
+
+    WarmState_Capture(&state);
+    g_warm_save_requested = false;
+    return WarmState_Write(&state);
+}
+
+/**
+ * @brief 周期处理
+ * @note 由Flash I/O服务任务空闲时调用（Flash初始化已完成）；内容无变化时不写入
+ */
+void WarmState_Process(void)
+{
+    static WarmState_t state;
+
+    if (!g_warm_loaded) {
+        return;
+    }
+
+    /* Modbus初始化等待超时，加载完成后在这里恢复 */
+    if (!g_warm_applied) {
+        if (!g_warm_late) {
+            return;
+        }
+        WarmState_Apply();
+    }
+
+    /* 快照之后存储的记录应当都在，最新ID回退说明记录丢失 */
+    if (!g_warm_head_checked) {
+        g_warm_head_checked = true;
+        if (g_warm_stats.restored) {
+            FlashSnapshot_t snapshot;
+            Flash_GetSnapshot(&snapshot);
+            if (snapshot.head_id < g_warm_restored.head_id) {
+                Log_Warn("Warm state: head %lu < saved %lu", snapshot.head_id, g_warm_restored.head_id);
+            }
+        }
+    }
+
+    uint32_t elapsed = osKernelGetTickCount() - g_warm_saved_tick;
+    if (elapsed < (g_warm_save_requested ? WARM_STATE_MIN_INTERVAL_MS : WARM_STATE_SAVE_INTERVAL_MS)) {
+        return;
+    }
+
+    g_warm_save_requested = false;
+    WarmState_Capture(&state);
+
+    /* 比较启动次数到日志级别，不比较序号和运行时间 */
+    if (memcmp((const uint8_t*)&state + offsetof(WarmState_t, boot_count),
+               (const uint8_t*)&g_warm_last + offsetof(WarmState_t, boot_count),
+               offsetof(WarmState_t, uptime_ms) - offsetof(WarmState_t, boot_count)) == 0) {
+        g_warm_stats.skipped++;
+        g_warm_saved_tick = osKernelGetTickCount();
+        return;
+    }
+
+    WarmState_Write(&state);
+}
+
+/**
+ * @brief 获取统计
+ */
+const WarmStateStats_t* WarmState_GetStats(void)
+{
+    return &g_warm_stats;
+}
@@ -40,7 +40,9 @@ extern "C" {
 typedef struct {
     uint8_t data[256];      /* 数据缓冲区 */
     uint16_t length;        /* 数据长度 */
+    uint16_t flags;         /* RTU帧标志（MODBUS_RTU_FRAME_xxx），其他来源为0 */
     uint32_t timestamp;     /* 时间戳 */
+    uint32_t cycles;        /* RTU帧结束时的DWT周期数，其他来源为0 */
 } BLEMessage_t;
 
 /* BLE接收状态 */
@@ -0,0 +1,49 @@
+#ifndef __CRC_H
+#define __CRC_H
+
+#include "main.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * CRC计算模块（Flash、Modbus、固件暂存共用）
+ *
+ *   CRC-16/CCITT-FALSE  多项式0x1021，初值0xFFFF，不反转   Flash记录、索引、文件头
+ *   CRC-16/MODBUS       多项式0x8005反转(0xA001)，初值0xFFFF  Modbus帧、固件暂存帧
+ *   CRC-32/MPEG-2       多项式0x04C11DB7，初值0xFFFFFFFF，不反转  固件镜像
+ *
+ * 所有Update函数都可分段连续调用：第一段传入对应的INIT值，后续传入上一段的返回值，
+ * 适合按DMA块流式计算。CRC16使用slice-by-4查表（每次处理4字节），
+ * CRC32在数据较长时使用STM32F1硬件CRC单元（同为MPEG-2算法），其余情况软件查表。
+ */
+
+/* 初值 */
+#define CRC16_CCITT_INIT             0xFFFF
+#define CRC16_MODBUS_INIT            0xFFFF
+#define CRC32_INIT                   0xFFFFFFFF
+
+/* 数据不少于该长度时CRC32使用硬件单元（主机构建没有CRC单元，由host_port.h改为不使用） */
+#ifndef CRC32_HW_MIN_LENGTH
+#define CRC32_HW_MIN_LENGTH          32
+#endif
+
+/* 查表占用的Flash空间（字节） */
+#define CRC16_SLICE4_TABLE_BYTES     (4 * 256 * sizeof(uint16_t))
+#define CRC32_TABLE_BYTES            (256 * sizeof(uint32_t))
+
+/* 函数声明 */
+
+/* CRC-16/CCITT-FALSE */
+uint16_t Crc16Ccitt_Update(uint16_t crc, const uint8_t *data, uint32_t length);
+uint16_t Crc16Ccitt_UpdateBytewise(uint16_t crc, const uint8_t *data, uint32_t length);
+
+/* CRC-16/MODBUS */
+uint16_t Crc16Modbus_Update(uint16_t crc, const uint8_t *data, uint32_t length);
+uint16_t Crc16Modbus_UpdateBytewise(uint16_t crc, const uint8_t *data, uint32_t length);
+
+/* CRC-32/MPEG-2 */
+uint32_t Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t length);
+uint32_t Crc32_UpdateSoftware(uint32_t crc, const uint8_t *data, uint32_t length);
+bool Crc32_UpdateHardware(uint32_t *crc, const uint8_t *data, uint32_t length);
+
+#endif /* __CRC_H */
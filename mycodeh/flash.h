@@ -6,8 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-/* W25Q64存储配置 */
-#define W25Q64_TOTAL_SIZE          (8 * 1024 * 1024)    /* W25Q64: 8MB */
+/* W25Q64存储配置（基本布局，各区域地址按8MB确定，实际芯片参数见FlashGeometry_t） */
+#define W25Q64_TOTAL_SIZE          (8 * 1024 * 1024)    /* 基本布局容量 8MB，也是支持的最小容量 */
 #define W25Q64_PAGE_SIZE           256                   /* 页大小 */
 #define W25Q64_SECTOR_SIZE         (4 * 1024)            /* 扇区大小 4KB */
 #define W25Q64_BLOCK_SIZE          (64 * 1024)           /* 块大小 64KB */
@@ -16,12 +16,68 @@
 #define W25Q64_INDEX_AREA_START    0x000000              /* 索引区起始地址 */
 #define W25Q64_INDEX_AREA_SIZE     (256 * 1024)         /* 索引区大小 256KB */
 #define W25Q64_DATA_AREA_START     (256 * 1024)         /* 数据区起始地址 */
-#define W25Q64_DATA_AREA_SIZE      (W25Q64_TOTAL_SIZE - W25Q64_INDEX_AREA_SIZE)  /* 数据区大小 */
+#define W25Q64_DATA_AREA_SIZE      (W25Q64_COLUMN_AREA_START - W25Q64_DATA_AREA_START)  /* 数据区大小 */
+#define W25Q64_COLUMN_AREA_START   (W25Q64_FS_AREA_START - W25Q64_COLUMN_AREA_SIZE)   /* 列存储区起始地址 */
+#define W25Q64_FS_AREA_START       (W25Q64_FW_AREA_START - W25Q64_FS_AREA_SIZE)       /* 文件区起始地址 */
+#define W25Q64_FS_AREA_SIZE        (2 * 1024 * 1024)    /* 文件区大小 2MB，见flash_fs.h */
+#define W25Q64_FW_AREA_START       (W25Q64_TOTAL_SIZE - W25Q64_FW_AREA_SIZE)          /* 固件暂存区起始地址 */
+#define W25Q64_FW_AREA_SIZE        (512 * 1024)         /* 固件暂存区大小 512KB，见fw_update.h */
+
+/* 扩展数据区：容量大于基本布局的芯片（W25Q128/256等），8MB以上的空间全部追加到数据区，
+ * 记录不跨越两段数据区之间的列存储区、文件区和固件暂存区 */
+#define FLASH_EXT_DATA_AREA_START  W25Q64_TOTAL_SIZE
+#define FLASH_MAX_TOTAL_SIZE       (256 * 1024 * 1024)  /* 支持的最大容量（扇区号不超过16位） */
+#define FLASH_3BYTE_ADDRESS_LIMIT  (16 * 1024 * 1024)   /* 超过此容量使用4字节地址 */
+
+/* 列存储区（按字段分列存放传感器样本，见flash_column.h），置0时空间归还数据区 */
+#define FLASH_COLUMN_STORE_ENABLE  1
+#if FLASH_COLUMN_STORE_ENABLE
+#define W25Q64_COLUMN_AREA_SIZE    (2 * 1024 * 1024)    /* 列存储区大小 2MB */
+#else
+#define W25Q64_COLUMN_AREA_SIZE    0
+#endif
+
+/* 系统区划分（位于索引区内，索引表只占用第一个64KB块） */
+#define W25Q64_STATS_AREA_START    (W25Q64_INDEX_AREA_START + W25Q64_BLOCK_SIZE)  /* 统计块区起始地址 */
+#define W25Q64_STATS_AREA_SIZE     (W25Q64_BLOCK_SIZE - W25Q64_STATE_AREA_SIZE)  /* 统计块按页对齐顺序追加，循环使用14个扇区 */
+#define W25Q64_STATE_AREA_START    (W25Q64_STATS_AREA_START + W25Q64_STATS_AREA_SIZE)  /* 热启动状态区，见warm_state.h */
+#define W25Q64_STATE_AREA_SIZE     (2 * W25Q64_SECTOR_SIZE)                      /* 两个扇区轮换追加 */
+#define W25Q64_TAG_AREA_START      (W25Q64_INDEX_AREA_START + 2 * W25Q64_BLOCK_SIZE)  /* 扇区标签摘要区 */
+#define W25Q64_TAG_AREA_SIZE       (2 * W25Q64_BLOCK_SIZE)                       /* 每个数据扇区一条摘要，覆盖32MB数据区 */
 
 /* 索引缓存配置 */
 #define W25Q64_MAX_CACHE_ENTRIES         200                   /* RAM缓存最大条目数 */
 #define W25Q64_INDEX_ENTRY_SIZE          16                    /* 每个索引条目大小 */
 
+/* 页缓存配置 */
+#define FLASH_PAGE_CACHE_ENTRIES         4                     /* 缓存页数（LRU） */
+#define FLASH_PAGE_CACHE_MAX_READ        (2 * W25Q64_PAGE_SIZE) /* 超过此长度的读取直接访问芯片 */
+#define FLASH_SPI_READ_OVERHEAD          6                     /* 每次读取的额外SPI字节（读状态2+命令地址4） */
+
+/* 顺序预读配置 */
+#define FLASH_READAHEAD_SIZE             1024                  /* 每个预读缓冲大小，共两个缓冲 */
+#define FLASH_READAHEAD_TRIGGER          3                     /* 连续几次顺序读取后开始预读 */
+#define FLASH_READAHEAD_DMA              1                     /* 下一段用SPI1 DMA读取，置0时在需要时轮询读取 */
+
+/* 写合并配置
+ * 暂存的记录在编程和保存索引之前只在RAM中：掉电（未经Flash_DeInit/Flash_Flush）时
+ * 丢失最近最多一个暂存时间内存储的记录，另加一个Flash_TaskProcess处理周期。默认5秒，
+ * 按FLASHTask 5秒的存储周期约为一条记录；运行参数寄存器0x00D4可在0~600秒间调整，
+ * 调大时丢失窗口随之增大（600秒约120条记录） */
+#define FLASH_STAGE_FLUSH_MS             (5 * 1000)            /* 记录暂存的最长时间默认值，到期后编程并保存索引 */
+#define FLASH_RECORD_MAX_LENGTH          1024                  /* 单条记录最大长度，与ReadResult_t一致 */
+
+/* 记录标签配置：标签保存在数据头data_length的高16位，旧版本记录读出为FLASH_RECORD_TAG_NONE */
+#define FLASH_RECORD_TAG_NONE            0                     /* 未标记的记录 */
+#define FLASH_RECORD_TAG_SHIFT           16                    /* 标签在data_length中的位置 */
+#define FLASH_RECORD_LENGTH(word)        ((word) & 0xFFFF)     /* 从data_length取数据长度 */
+#define FLASH_RECORD_TAG(word)           ((uint16_t)((word) >> FLASH_RECORD_TAG_SHIFT))  /* 从data_length取标签 */
+#define FLASH_TAG_BLOOM_HASHES           3                     /* 每个标签在Bloom过滤器中置位数 */
+#define FLASH_TAG_REBUILD_SECTORS        4                     /* 上电时向前查找已保存摘要的扇区数 */
+
+/* 擦除暂停配置 */
+#define FLASH_SUSPEND_MIN_RUN_MS         1                     /* 擦除恢复后至少继续执行的时间，连续读取时擦除仍有进展 */
+
 /* 数据头结构 */
 #define W25Q64_DATA_HEADER_MAGIC         0x55AA                /* 固定标志位 */
 #define W25Q64_DATA_HEADER_SIZE          12                    /* 数据头大小 */
@@ -30,11 +86,18 @@
 #define W25Q64_INDEX_ENTRY_MAGIC         0xAA55                /* 索引条目标志位 */
 #define W25Q64_INDEX_ENTRY_SIZE          16                    /* 索引条目大小 */
 
+/* 磨损统计配置 */
+#define W25Q64_SECTOR_COUNT              (W25Q64_TOTAL_SIZE / W25Q64_SECTOR_SIZE)  /* 擦除计数单元数，大容量芯片每单元含多个扇区 */
+#define FLASH_STATS_MAGIC                0x54415453            /* "STAT" */
+#define FLASH_STATS_HIST_BUCKETS         8                     /* 延迟直方图桶数，<128us起每桶x4 */
+#define FLASH_STATS_SAVE_INTERVAL_MS     (10 * 60 * 1000)      /* 统计块保存周期 */
+#define FLASH_STATS_REG_COUNT            42                    /* Modbus输入寄存器窗口大小 */
+
 /* 数据头结构体 */
 typedef struct {
     uint16_t magic;             /* 固定标志位 0x55AA */
     uint32_t record_id;         /* 数据编号，自增 */
-    uint32_t data_length;       /* 数据长度 */
+    uint32_t data_length;       /* 数据长度（低16位）和标签（高16位） */
     uint16_t crc16;            /* CRC16校验 */
 } __attribute__((packed)) DataHeader_t;
 
@@ -69,6 +132,120 @@ typedef enum {
     FLASH_ERROR_MEMORY
 } FlashResult_t;
 
+/* Flash操作类型（决定等待就绪时的轮询策略和超时） */
+typedef enum {
+    FLASH_OP_NONE = 0,          /* 无耗时操作，仅确认芯片空闲 */
+    FLASH_OP_PAGE_PROGRAM,      /* 页编程 */
+    FLASH_OP_SECTOR_ERASE,      /* 4KB扇区擦除 */
+    FLASH_OP_BLOCK_ERASE,       /* 64KB块擦除 */
+    FLASH_OP_CHIP_ERASE,        /* 整片擦除 */
+    FLASH_OP_COUNT
+} FlashOp_t;
+
+/* 磨损与写放大统计块（RAM常驻，定期保存到统计块区） */
+typedef struct {
+    uint32_t magic;                                     /* 标志位 FLASH_STATS_MAGIC */
+    uint32_t sequence;                                  /* 保存序号，较大者为最新 */
+    uint32_t sector_erases;                             /* 擦除扇区数（块擦除按16个扇区计） */
+    uint32_t erase_ops;                                 /* 擦除命令次数 */
+    uint32_t program_ops;                               /* 页编程次数 */
+    uint32_t bytes_programmed;                          /* 编程字节数 */
+    uint32_t bytes_read;                                /* 读取字节数 */
+    uint32_t user_bytes;                                /* 用户存储的有效数据字节数 */
+    uint32_t verify_reads;                              /* 写后校验读取次数 */
+    uint32_t index_rewrites;                            /* 索引表重写次数 */
+    uint16_t max_sector_erases;                         /* 单扇区最大擦除次数 */
+    uint16_t max_sector_index;                          /* 擦除次数最多的扇区号 */
+    uint32_t hist_program[FLASH_STATS_HIST_BUCKETS];    /* 页编程延迟直方图 */
+    uint32_t hist_erase[FLASH_STATS_HIST_BUCKETS];      /* 擦除延迟直方图 */
+    uint32_t hist_read[FLASH_STATS_HIST_BUCKETS];       /* 读取延迟直方图 */
+    uint16_t sector_erase_count[W25Q64_SECTOR_COUNT];   /* 每扇区擦除次数，大容量芯片按单元计（单元内任一扇区擦除即计1次，为上限） */
+    uint16_t crc16;                                     /* 以上内容的CRC16 */
+} FlashStats_t;
+
+/* 芯片参数（上电时从SFDP读取，仅RAM） */
+typedef struct {
+    uint32_t jedec_id;          /* JEDEC ID */
+    uint32_t total_size;        /* 容量 */
+    uint16_t page_size;         /* 页大小 */
+    uint8_t sfdp_revision;      /* SFDP基本参数表版本（主版本<<4 | 次版本），0为不支持SFDP */
+    uint8_t address_bytes;      /* 地址字节数，3或4 */
+    bool enter_4byte_mode;      /* 通过0xB7进入4字节地址模式（芯片没有4字节地址专用命令时） */
+    uint8_t read_cmd;           /* 读取命令 */
+    uint8_t program_cmd;        /* 页编程命令 */
+    uint8_t sector_erase_cmd;   /* 4KB擦除命令 */
+    uint8_t block_erase_cmd;    /* 64KB擦除命令 */
+    uint8_t wear_shift;         /* 每个擦除计数单元的扇区数的log2 */
+    uint32_t page_program_us;   /* 典型页编程时间 */
+    uint32_t sector_erase_us;   /* 典型4KB擦除时间 */
+    uint32_t block_erase_us;    /* 典型64KB擦除时间 */
+    uint32_t chip_erase_ms;     /* 典型整片擦除时间 */
+    uint8_t suspend_cmd;        /* 擦除暂停命令，0为不支持 */
+    uint8_t resume_cmd;         /* 擦除恢复命令 */
+    uint16_t suspend_interval_us;   /* 恢复后到允许再次暂停的最短间隔 */
+} FlashGeometry_t;
+
+/* 芯片操作完成回调 */
+typedef void (*FlashOpHook_t)(void);
+
+/* 擦除等待回调：代替osDelay睡眠最多timeout_ms，有读取需要在擦除暂停期间执行时提前返回true */
+typedef bool (*FlashWaitHook_t)(uint32_t timeout_ms);
+
+/* 擦除暂停统计（仅RAM） */
+typedef struct {
+    uint32_t suspends;          /* 暂停次数 */
+    uint32_t suspended_ms;      /* 累计暂停时间 */
+    uint32_t max_suspend_ms;    /* 单次最长暂停时间 */
+} FlashSuspendStats_t;
+
+/* 记录存储快照：任意任务可无锁读取，各字段来自同一次提交 */
+typedef struct {
+    uint32_t first_id;          /* 可按ID读取的最旧记录（RAM索引起点），0为无记录 */
+    uint32_t head_id;           /* 最新记录ID，0为无记录 */
+    uint32_t record_count;      /* 记录总数 */
+    uint32_t write_address;     /* 下一条记录的写入地址 */
+} FlashSnapshot_t;
+
+/* 页缓存统计（仅RAM） */
+typedef struct {
+    uint32_t hits;              /* 命中的页访问次数 */
+    uint32_t misses;            /* 未命中的页访问次数（整页读入缓存） */
+    uint32_t bypasses;          /* 大块读取直接访问芯片的次数 */
+    uint32_t requested_bytes;   /* 调用者请求的字节数 */
+    uint32_t uncached_spi_bytes;/* 无缓存时需要的SPI字节数 */
+    uint32_t spi_bytes;         /* 实际SPI字节数 */
+    uint32_t readahead_bursts;  /* 顺序预读的突发读取次数 */
+    uint32_t readahead_bytes;   /* 由预读缓冲提供的字节数 */
+} FlashPageCacheStats_t;
+
+/* 写合并统计（仅RAM） */
+typedef struct {
+    uint32_t records;           /* 暂存的记录数 */
+    uint32_t page_programs;     /* 数据区页编程次数 */
+    uint32_t full_flushes;      /* 页写满触发的编程次数 */
+    uint32_t deadline_flushes;  /* 暂存超时触发的提交次数 */
+    uint32_t forced_flushes;    /* Flash_Flush触发的提交次数 */
+    uint32_t sector_erases;     /* 写入新扇区前的擦除次数 */
+    uint32_t tag_summaries;     /* 写入的扇区标签摘要数 */
+} FlashStageStats_t;
+
+/* 扇区标签摘要：数据头位于该扇区的记录，写入位置离开扇区后写入摘要区，每个扇区只写一次 */
+typedef struct {
+    uint32_t bloom[2];          /* 记录标签的Bloom过滤器（64位） */
+    uint32_t next_address;      /* 扇区之后第一条记录的地址 */
+    uint16_t records;           /* 记录数 */
+    uint16_t crc16;             /* 以上内容的CRC16 */
+} FlashTagSummary_t;
+
+/* 按标签查询的游标 */
+typedef struct {
+    uint32_t address;           /* 下一条记录的地址 */
+    uint32_t next_id;           /* 紧接的记录ID，0为未知（跳过扇区之后） */
+    uint32_t sector;            /* 当前扇区号 */
+    uint32_t sectors_read;      /* 读取了数据头的扇区数 */
+    uint32_t sectors_skipped;   /* 按摘要跳过的扇区数 */
+} FlashTagCursor_t;
+
 /* 数据记录结构体 */
 typedef struct {
     uint32_t record_id;         /* 记录编号 */
@@ -81,6 +258,7 @@ typedef struct {
     uint32_t record_id;         /* 记录编号 */
     uint32_t data_length;       /* 数据长度 */
     uint8_t data[1024];        /* 数据缓冲区（最大1KB） */
+    uint16_t tag;              /* 记录标签 */
     bool valid;                /* 数据是否有效 */
 } ReadResult_t;
 
@@ -89,17 +267,31 @@ typedef struct {
 /* 初始化和配置 */
 FlashResult_t Flash_Init(void);
 FlashResult_t Flash_DeInit(void);
+const FlashGeometry_t* Flash_GetGeometry(void);
 
 /* 基本Flash操作 */
 FlashResult_t Flash_Read(uint32_t address, uint8_t *buffer, uint32_t length);
 FlashResult_t Flash_Write(uint32_t address, const uint8_t *buffer, uint32_t length);
 FlashResult_t Flash_EraseSector(uint32_t address);
 FlashResult_t Flash_EraseBlock(uint32_t address);
+void Flash_SetOpHook(FlashOpHook_t hook);
+void Flash_SetWaitHook(FlashWaitHook_t hook);
+void Flash_SetProbeHook(FlashOpHook_t hook);
+const FlashSuspendStats_t* Flash_GetSuspendStats(void);
 
 /* 数据存储操作 */
 FlashResult_t Flash_StoreData(const uint8_t *data, uint32_t length, uint32_t *record_id);
+FlashResult_t Flash_StoreTaggedData(uint16_t tag, const uint8_t *data, uint32_t length, uint32_t *record_id);
 FlashResult_t Flash_ReadData(uint32_t record_id, ReadResult_t *result);
 FlashResult_t Flash_ReadLatestRecords(uint32_t count, ReadResult_t *results, uint32_t *actual_count);
+FlashResult_t Flash_Flush(void);
+const FlashStageStats_t* Flash_GetStageStats(void);
+void Flash_SetStageFlushTime(uint32_t flush_ms);
+void Flash_GetSnapshot(FlashSnapshot_t *snapshot);
+
+/* 按标签查询 */
+void Flash_TagCursorInit(FlashTagCursor_t *cursor);
+FlashResult_t Flash_ReadNextTagged(uint16_t tag, FlashTagCursor_t *cursor, ReadResult_t *result);
 
 /* 索引管理 */
 FlashResult_t Flash_LoadIndexTable(void);
@@ -112,6 +304,17 @@ FlashResult_t Flash_VerifyDataHeader(const DataHeader_t *header, const uint8_t *
 FlashResult_t Flash_GetNextWriteAddress(uint32_t *address);
 FlashResult_t Flash_GetRecordCount(uint32_t *count);
 
+/* 页缓存 */
+FlashResult_t Flash_ReadNoCache(uint32_t address, uint8_t *buffer, uint32_t length);
+const FlashPageCacheStats_t* Flash_GetPageCacheStats(void);
+void Flash_InvalidatePageCache(void);
+
+/* 磨损统计 */
+const FlashStats_t* Flash_GetStats(void);
+FlashResult_t Flash_LoadStats(void);
+FlashResult_t Flash_SaveStats(void);
+uint16_t Flash_GetStatsRegister(uint16_t offset);
+
 /* 调试和状态 */
 void Flash_PrintStatus(void);
 void Flash_PrintCacheStatus(void);
@@ -0,0 +1,85 @@
+#ifndef __FLASH_COLUMN_H
+#define __FLASH_COLUMN_H
+
+#include "flash.h"
+#include "record_codec.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 列存储区布局（W25Q64_COLUMN_AREA_START起，每个4KB扇区为一个块）
+ *
+ * 块内前FLASH_COLUMN_DIR_SIZE字节为块目录（FlashColumnBlock_t），其后每个字段
+ * 占一段连续区域（列），依次存放本块全部样本的该字段值：
+ *   目录 | timestamp x N | pressure x N | ... | flags x N
+ * 列由record_codec.h的字段表生成：每个非标志字段一列，所有标志字段共用flags列。
+ * 只查询一个字段时只需读取该列，不读取其他字段。
+ *
+ * 样本按全局序号编号，序号s位于块s / N，块序号b存放在扇区b % 扇区数，
+ * 区域写满后循环覆盖最旧的块。flags列最后写入，已写入的flags字节最高位为0，
+ * 上电时据此确定最新块中的样本数。
+ *
+ * 按列读取原始值（FlashColumn_ReadColumn）时每块只需一次连续读取，可直接读入
+ * 调用者的缓冲区（Modbus文件记录，见modbus_file.h）。
+ */
+
+/* 列存储配置 */
+#define FLASH_COLUMN_SECTOR_COUNT    (W25Q64_COLUMN_AREA_SIZE / W25Q64_SECTOR_SIZE)   /* 块数 */
+#define FLASH_COLUMN_DIR_SIZE        64                    /* 块目录大小 */
+#define FLASH_COLUMN_SAMPLE_SIZE     (RECORD_VALUE_SIZE + 1)                         /* 每个样本占用字节数 */
+#define FLASH_COLUMN_BLOCK_SAMPLES   ((W25Q64_SECTOR_SIZE - FLASH_COLUMN_DIR_SIZE) / FLASH_COLUMN_SAMPLE_SIZE)  /* 每块样本数 */
+#define FLASH_COLUMN_MAX_COLUMNS     8                     /* 最大列数 */
+#define FLASH_COLUMN_CHUNK_SAMPLES   16                    /* RAM中缓存的样本数，攒满后按列写入 */
+#define FLASH_COLUMN_MAGIC           0x4C4F4357            /* "WCOL" */
+#define FLASH_COLUMN_NOT_SEALED      0xFFFF                /* 块未提前封存 */
+#define FLASH_COLUMN_PRESENT_MASK    0x80                  /* flags字节最高位为0表示样本已写入 */
+
+#if RECORD_FLAG_COUNT > 7
+#error "flags column needs bit 7 as the sample present marker"
+#endif
+
+/* 列描述 */
+typedef struct {
+    uint16_t offset;            /* 列在块内的偏移 */
+    uint8_t width;              /* 每个值的字节数 */
+    uint8_t field;              /* 字段下标，flags列为0xFF */
+} __attribute__((packed)) FlashColumnDesc_t;
+
+/* 块目录 */
+typedef struct {
+    uint32_t magic;                                     /* 标志位 FLASH_COLUMN_MAGIC */
+    uint32_t sequence;                                  /* 块序号 */
+    uint16_t samples;                                   /* 每块样本数 */
+    uint8_t schema_version;                             /* 记录格式版本 */
+    uint8_t column_count;                               /* 列数 */
+    FlashColumnDesc_t columns[FLASH_COLUMN_MAX_COLUMNS];/* 列描述 */
+    uint16_t crc16;                                     /* 以上内容的CRC16 */
+    uint16_t sealed_samples;                            /* 提前封存时的样本数，单独编程，不在CRC内 */
+} __attribute__((packed)) FlashColumnBlock_t;
+
+/* 列存储统计（仅RAM） */
+typedef struct {
+    uint32_t samples;           /* 追加的样本数 */
+    uint32_t flushes;           /* 按列写入次数 */
+    uint32_t blocks;            /* 新开的块数 */
+    uint32_t read_ops;          /* 查询读取次数 */
+    uint32_t bytes_read;        /* 查询读取字节数（含目录） */
+} FlashColumnStats_t;
+
+/* 查询回调：values为字段值，单字段查询只有一个元素，整行查询有RECORD_FIELD_COUNT个 */
+typedef void (*FlashColumnVisitor_t)(uint32_t sample, const double *values, void *context);
+
+/* 函数声明 */
+FlashResult_t FlashColumn_Init(void);
+FlashResult_t FlashColumn_Append(const uint8_t *record, uint32_t length);
+FlashResult_t FlashColumn_Flush(void);
+FlashResult_t FlashColumn_ScanField(uint32_t field, uint32_t first, uint32_t count,
+                                    FlashColumnVisitor_t visitor, void *context);
+FlashResult_t FlashColumn_ScanRows(uint32_t first, uint32_t count,
+                                   FlashColumnVisitor_t visitor, void *context);
+const FlashColumnDesc_t* FlashColumn_GetColumn(uint32_t column);
+FlashResult_t FlashColumn_ReadColumn(uint32_t column, uint32_t first, uint32_t count, uint8_t *buffer);
+void FlashColumn_GetRange(uint32_t *first, uint32_t *count);
+const FlashColumnStats_t* FlashColumn_GetStats(void);
+
+#endif /* __FLASH_COLUMN_H */
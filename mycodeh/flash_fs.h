@@ -0,0 +1,97 @@
+#ifndef __FLASH_FS_H
+#define __FLASH_FS_H
+
+#include "flash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 文件区布局（W25Q64_FS_AREA_START起，按4KB扇区管理）
+ *
+ * 每个文件版本由一个元数据扇区和若干数据扇区组成：
+ *   元数据扇区第0页：FlashFsHeader_t（文件名、版本号、大小、数据扇区表、CRC）
+ *   元数据扇区第1~15页：文件前3840字节（内联数据，小文件只占一个扇区）
+ *   数据扇区：文件后续内容，每扇区4096字节
+ *
+ * 写文件采用写时复制：修改的扇区写入新分配的扇区，未修改的扇区新旧版本共用，
+ * 关闭时最后写入新的元数据页作为提交点，之后才擦除旧元数据扇区。
+ * 提交前掉电保留旧版本，提交后掉电由挂载时按版本号去重。
+ */
+
+/* 文件系统配置 */
+#define FLASH_FS_SECTOR_COUNT        (W25Q64_FS_AREA_SIZE / W25Q64_SECTOR_SIZE)  /* 文件区扇区数 */
+#define FLASH_FS_MAX_FILES           256                   /* 最大文件数 */
+#define FLASH_FS_MAX_HANDLES         2                     /* 同时打开的文件数 */
+#define FLASH_FS_NAME_LEN            32                    /* 文件名最大长度（含结束符） */
+#define FLASH_FS_MAX_DATA_SECTORS    96                    /* 每个文件最多数据扇区数 */
+#define FLASH_FS_HEADER_MAGIC        0x53463857            /* "W8FS" */
+#define FLASH_FS_INLINE_SIZE         (W25Q64_SECTOR_SIZE - W25Q64_PAGE_SIZE)     /* 元数据扇区内联数据大小 */
+#define FLASH_FS_MAX_FILE_SIZE       (FLASH_FS_INLINE_SIZE + FLASH_FS_MAX_DATA_SECTORS * W25Q64_SECTOR_SIZE)
+#define FLASH_FS_NO_SECTOR           0xFFFF                /* 无效扇区号 */
+
+/* 打开方式 */
+#define FLASH_FS_O_RDONLY            0x01                  /* 只读 */
+#define FLASH_FS_O_WRONLY            0x02                  /* 只写（写时复制，关闭时提交） */
+#define FLASH_FS_O_CREAT             0x04                  /* 不存在时创建 */
+#define FLASH_FS_O_TRUNC             0x08                  /* 清空原内容 */
+#define FLASH_FS_O_APPEND            0x10                  /* 从文件末尾开始写 */
+
+/* 定位方式 */
+#define FLASH_FS_SEEK_SET            0
+#define FLASH_FS_SEEK_CUR            1
+#define FLASH_FS_SEEK_END            2
+
+/* 元数据页结构体（正好一页） */
+typedef struct {
+    uint32_t magic;                                     /* 标志位 FLASH_FS_HEADER_MAGIC */
+    uint32_t revision;                                  /* 版本号，全局递增，较大者为最新 */
+    uint32_t size;                                      /* 文件大小 */
+    uint16_t sector_count;                              /* 数据扇区数 */
+    char name[FLASH_FS_NAME_LEN];                       /* 文件名 */
+    uint16_t sectors[FLASH_FS_MAX_DATA_SECTORS];        /* 数据扇区表（文件区内扇区号） */
+    uint8_t reserved[16];                               /* 保留 */
+    uint16_t crc16;                                     /* 以上内容的CRC16 */
+} __attribute__((packed)) FlashFsHeader_t;
+
+/* 打开的文件句柄 */
+typedef struct {
+    bool in_use;                                        /* 句柄是否已占用 */
+    uint8_t flags;                                      /* 打开方式 */
+    int16_t file_index;                                 /* 文件表下标，新建文件为-1 */
+    uint32_t size;                                      /* 当前文件大小 */
+    uint32_t position;                                  /* 当前读写位置 */
+    char name[FLASH_FS_NAME_LEN];                       /* 文件名 */
+    uint16_t sectors[FLASH_FS_MAX_DATA_SECTORS + 1];    /* 逻辑扇区映射，[0]为元数据扇区 */
+
+    /* 以下仅写句柄使用 */
+    uint16_t old_meta;                                  /* 旧版本元数据扇区 */
+    uint8_t replaced[(FLASH_FS_MAX_DATA_SECTORS + 8) / 8];  /* 已复制到新扇区的逻辑扇区 */
+    int16_t cow_logical;                                /* 正在复制的逻辑扇区，-1表示无 */
+    uint16_t cow_source;                                /* 正在复制扇区的源扇区 */
+    bool cow_source_uncommitted;                        /* 源扇区未提交，复制完成后释放 */
+    uint16_t cow_pages;                                 /* 新扇区已编程的页 */
+    int16_t buffer_page;                                /* 页缓冲对应的扇区内页号，-1表示无 */
+    uint8_t page_buffer[W25Q64_PAGE_SIZE];              /* 页缓冲 */
+} FlashFsFile_t;
+
+/* 函数声明 */
+
+/* 挂载 */
+FlashResult_t FlashFs_Mount(void);
+FlashResult_t FlashFs_Format(void);
+
+/* 文件操作 */
+FlashResult_t FlashFs_Open(FlashFsFile_t **file, const char *name, uint8_t flags);
+FlashResult_t FlashFs_Read(FlashFsFile_t *file, uint8_t *buffer, uint32_t length, uint32_t *read_length);
+FlashResult_t FlashFs_Write(FlashFsFile_t *file, const uint8_t *buffer, uint32_t length);
+FlashResult_t FlashFs_Seek(FlashFsFile_t *file, int32_t offset, uint8_t whence);
+FlashResult_t FlashFs_Close(FlashFsFile_t *file);
+FlashResult_t FlashFs_Delete(const char *name);
+
+/* 查询 */
+uint32_t FlashFs_Tell(const FlashFsFile_t *file);
+uint32_t FlashFs_Size(const FlashFsFile_t *file);
+FlashResult_t FlashFs_GetInfo(uint32_t *file_count, uint32_t *free_sectors);
+void FlashFs_PrintStatus(void);
+
+#endif /* __FLASH_FS_H */
@@ -0,0 +1,119 @@
+#ifndef __FLASH_IO_H
+#define __FLASH_IO_H
+
+#include "flash.h"
+#include "cmsis_os.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Flash I/O服务
+ *
+ * 外部Flash（hspi1）只由FlashIO任务访问，其他任务提交请求后阻塞等待结果。
+ * 请求分三个优先级，同一优先级内先进先出：
+ *   INTERACTIVE 交互读取（Modbus/上位机查询），只读
+ *   DURABLE     持久写入（记录存储、固件暂存数据）
+ *   BACKGROUND  后台擦除、整理
+ * 服务任务每次取优先级最高的请求执行。执行写入/擦除请求时，每次芯片操作
+ * （页编程、扇区/块擦除）完成后插入执行等待中的交互读取，交互读取的等待
+ * 时间不超过一次芯片操作，而不是整个存储+校验+索引重写过程。芯片支持擦除暂停时，
+ * 扇区/块擦除期间提交的交互读取会暂停擦除后执行，不必等待擦除完成。
+ * 读取方用Flash_GetSnapshot无锁取得最新记录ID，再按ID读取，不需要经过队列。
+ * 连续执行FLASH_IO_STARVATION_LIMIT个请求而低优先级请求一直等待时，
+ * 先执行一个低优先级请求，避免饿死。
+ *
+ * 请求结构在提交任务的栈上，完成前提交任务一直阻塞，服务任务不需要分配内存。
+ * 服务任务空闲时执行Flash_TaskProcess（写合并到期提交、统计块保存）和
+ * WarmState_Process（热启动状态快照保存）。
+ */
+
+/* 服务配置 */
+#define FLASH_IO_STARVATION_LIMIT    8                     /* 低优先级请求最多被连续越过的次数 */
+#define FLASH_IO_PROCESS_MS          100                   /* Flash_TaskProcess执行周期 */
+#define FLASH_IO_HANG_MS             5000                  /* 单个请求执行超过此时间时报警 */
+#define FLASH_IO_FLAG_REQUEST        0x0100                /* 服务任务线程标志：有新请求 */
+#define FLASH_IO_FLAG_DONE           0x0200                /* 提交任务线程标志：请求完成 */
+
+/* 请求优先级，数值小者优先 */
+typedef enum {
+    FLASH_IO_INTERACTIVE = 0,   /* 交互读取 */
+    FLASH_IO_DURABLE,           /* 持久写入 */
+    FLASH_IO_BACKGROUND,        /* 后台擦除、整理 */
+    FLASH_IO_CLASS_COUNT
+} FlashIoClass_t;
+
+/* 请求类型 */
+typedef enum {
+    FLASH_IO_OP_READ = 0,       /* Flash_Read */
+    FLASH_IO_OP_READ_NOCACHE,   /* Flash_ReadNoCache */
+    FLASH_IO_OP_WRITE,          /* Flash_Write */
+    FLASH_IO_OP_ERASE_BLOCK,    /* Flash_EraseBlock */
+    FLASH_IO_OP_READ_DATA,      /* Flash_ReadData */
+    FLASH_IO_OP_STORE_DATA,     /* Flash_StoreTaggedData，标签在address中 */
+    FLASH_IO_OP_CALL            /* 在服务任务中执行handler */
+} FlashIoOp_t;
+
+/* 自定义请求处理函数，在服务任务中执行 */
+typedef FlashResult_t (*FlashIoHandler_t)(void *context);
+
+/* 请求 */
+typedef struct FlashIoRequest {
+    struct FlashIoRequest *next;    /* 队列链表 */
+    FlashIoOp_t op;                 /* 请求类型 */
+    FlashIoClass_t io_class;        /* 优先级 */
+    uint32_t address;               /* 地址、记录ID或记录标签 */
+    uint8_t *buffer;                /* 数据缓冲 */
+    uint32_t length;                /* 数据长度 */
+    void *output;                   /* ReadResult_t*、记录ID输出或handler的context */
+    FlashIoHandler_t handler;       /* FLASH_IO_OP_CALL的处理函数 */
+    osThreadId_t waiter;            /* 等待完成的任务，NULL为不通知 */
+    uint32_t submit_cycles;         /* 入队时的DWT计数 */
+    uint32_t wait_us;               /* 排队时间，完成后有效 */
+    volatile bool done;             /* 已完成 */
+    FlashResult_t result;           /* 结果 */
+} FlashIoRequest_t;
+
+/* 每个优先级的统计 */
+typedef struct {
+    uint32_t completed;                         /* 完成的请求数 */
+    uint32_t preempted;                         /* 在芯片操作之间插入执行的请求数 */
+    uint32_t promoted;                          /* 防饿死提前执行的请求数 */
+    uint32_t depth;                             /* 当前排队数 */
+    uint32_t max_depth;                         /* 最大排队数 */
+    uint64_t wait_total_us;                     /* 累计排队时间 */
+    uint32_t wait_max_us;                       /* 最大排队时间 */
+    uint32_t service_max_us;                    /* 最大执行时间 */
+    uint32_t hist_wait[FLASH_STATS_HIST_BUCKETS];   /* 排队时间直方图，桶边界同Flash延迟直方图 */
+} FlashIoClassStats_t;
+
+/* 服务统计（仅RAM） */
+typedef struct {
+    FlashIoClassStats_t classes[FLASH_IO_CLASS_COUNT];
+    uint32_t op_boundaries;                     /* 执行写入/擦除期间经过的芯片操作边界数 */
+} FlashIoStats_t;
+
+/* 函数声明 */
+void FlashIo_Init(void);
+void FlashIo_Task(void *argument);
+bool FlashIo_IsReady(void);
+
+/* 请求提交（阻塞到完成） */
+FlashResult_t FlashIo_Read(FlashIoClass_t io_class, uint32_t address, uint8_t *buffer, uint32_t length);
+FlashResult_t FlashIo_ReadNoCache(FlashIoClass_t io_class, uint32_t address, uint8_t *buffer, uint32_t length);
+FlashResult_t FlashIo_ReadData(FlashIoClass_t io_class, uint32_t record_id, ReadResult_t *result);
+FlashResult_t FlashIo_Write(uint32_t address, const uint8_t *buffer, uint32_t length);
+FlashResult_t FlashIo_EraseBlock(uint32_t address);
+FlashResult_t FlashIo_StoreData(const uint8_t *data, uint32_t length, uint32_t *record_id);
+FlashResult_t FlashIo_StoreTaggedData(uint16_t tag, const uint8_t *data, uint32_t length, uint32_t *record_id);
+FlashResult_t FlashIo_Call(FlashIoClass_t io_class, FlashIoHandler_t handler, void *context);
+
+/* 底层接口（测试与自定义调度） */
+void FlashIo_Submit(FlashIoRequest_t *request);
+bool FlashIo_ServiceOnce(void);
+
+/* 统计 */
+const FlashIoStats_t* FlashIo_GetStats(void);
+void FlashIo_ResetStats(void);
+void FlashIo_PrintStats(void);
+
+#endif /* __FLASH_IO_H */
@@ -0,0 +1,80 @@
+#ifndef __FW_UPDATE_H
+#define __FW_UPDATE_H
+
+#include "main.h"
+#include "flash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 固件暂存协议（USART2/蓝牙透传，小端）
+ *
+ * 帧格式：0xA5 | type(1) | seq(2) | len(2) | payload(len) | crc16(2)
+ *   crc16为Modbus CRC16，覆盖0xA5到payload末尾
+ *
+ * 上位机 -> 设备
+ *   START  payload: image_size(4) image_crc32(4) chunk_size(2) window(1)
+ *          设备擦除暂存区后回复ACK(next_offset=0)，擦除约需2s
+ *   DATA   payload: offset(4) data(chunk_size，最后一帧可更短)
+ *          只接受offset等于next_offset的帧；上位机最多有window帧未确认
+ *   END    payload: 无，设备回读校验后回复RESULT
+ *   ABORT  payload: 无
+ *
+ * 设备 -> 上位机
+ *   ACK    payload: next_offset(4)  累计确认；乱序或重复时立即发送，上位机从next_offset重传
+ *   RESULT payload: status(1) crc32(4) elapsed_ms(4) bytes_per_sec(4)
+ *
+ * 镜像CRC为CRC-32/MPEG-2（多项式0x04C11DB7，初值0xFFFFFFFF，不反转，无异或输出）
+ */
+
+/* 暂存区布局：第一个扇区存放镜像头，其后为镜像 */
+#define FW_HEADER_ADDR               W25Q64_FW_AREA_START
+#define FW_IMAGE_ADDR                (W25Q64_FW_AREA_START + W25Q64_SECTOR_SIZE)
+#define FW_IMAGE_MAX_SIZE            (W25Q64_FW_AREA_SIZE - W25Q64_SECTOR_SIZE)
+#define FW_HEADER_MAGIC              0x46575550            /* "PUWF" */
+
+/* 协议参数 */
+#define FW_FRAME_SYNC                0xA5
+#define FW_FRAME_HEADER_SIZE         6
+#define FW_FRAME_MAX_PAYLOAD         244                   /* 一帧不超过一次DMA接收（256字节） */
+#define FW_CHUNK_MAX_SIZE            (FW_FRAME_MAX_PAYLOAD - 4)
+#define FW_WINDOW_MAX                16                    /* 最大窗口（帧数） */
+#define FW_SESSION_TIMEOUT_MS        5000                  /* 会话无数据超时 */
+#define FW_LINE_BYTES_PER_SEC        (115200 / 10)         /* 115200波特率8N1的线路字节速率 */
+
+/* 帧类型 */
+#define FW_FRAME_START               0x01
+#define FW_FRAME_DATA                0x02
+#define FW_FRAME_END                 0x03
+#define FW_FRAME_ABORT               0x04
+#define FW_FRAME_ACK                 0x81
+#define FW_FRAME_RESULT              0x83
+
+/* 会话结果 */
+typedef enum {
+    FW_STATUS_OK = 0,
+    FW_STATUS_CRC_MISMATCH,
+    FW_STATUS_SIZE_MISMATCH,
+    FW_STATUS_FLASH_ERROR,
+    FW_STATUS_ABORTED,
+    FW_STATUS_TIMEOUT
+} FwStatus_t;
+
+/* 暂存镜像头（写在暂存区第一个扇区） */
+typedef struct {
+    uint32_t magic;             /* 标志位 FW_HEADER_MAGIC */
+    uint32_t image_size;        /* 镜像大小 */
+    uint32_t image_crc32;       /* 镜像CRC32 */
+    uint32_t sequence;          /* 第几次暂存，供引导程序判断是否已应用 */
+    uint16_t crc16;             /* 以上内容的CRC16 */
+} __attribute__((packed)) FwImageHeader_t;
+
+/* 函数声明 */
+void FwUpdate_Init(void);
+bool FwUpdate_IsActive(void);
+bool FwUpdate_IsStartFrame(const uint8_t *data, uint16_t length);
+void FwUpdate_Feed(const uint8_t *data, uint16_t length);
+void FwUpdate_Poll(void);
+FlashResult_t FwUpdate_GetStagedImage(FwImageHeader_t *header);
+
+#endif /* __FW_UPDATE_H */
@@ -10,19 +10,32 @@
 #define MODBUS_READ_INPUT_REGISTERS      0x04
 #define MODBUS_WRITE_SINGLE_REGISTER     0x06
 #define MODBUS_WRITE_MULTIPLE_REGISTERS  0x10
+#define MODBUS_READ_FILE_RECORD          0x14      // 读文件记录（Flash中的历史样本，见modbus_file.h）
 
 // Modbus异常码定义
 #define MODBUS_EXCEPTION_ILLEGAL_FUNCTION    0x01
 #define MODBUS_EXCEPTION_ILLEGAL_DATA_ADDR   0x02
 #define MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE  0x03
 #define MODBUS_EXCEPTION_SLAVE_DEVICE_FAILURE 0x04
+#define MODBUS_EXCEPTION_SLAVE_DEVICE_BUSY   0x06
+
+// CRC字节顺序：标准为低字节在前。置1时也接受高字节在前的CRC（兼容旧主站），
+// 帧定界对CRC错误的帧再完整计算一次，不影响正常帧的处理时间
+#define MODBUS_CRC_COMPAT_SWAPPED        0
 
 // Modbus寄存器地址定义
 #define MODBUS_REG_TEMPERATURE_ADDR  0x00c8  // 温度值寄存器地址（第1个位置）
 #define MODBUS_REG_PRESSURE_ADDR     0x00C9  // 压力值寄存器地址（第2个位置）
 #define MODBUS_REG_HUMIDITY_ADDR     0x00CA  // 湿度值寄存器地址（第3个位置）
 #define MODBUS_REG_STATUS_ADDR       0x00CB  // 状态寄存器地址（第4个位置）
+#define MODBUS_REG_MAX_AGE_ADDR      0x00CC  // 最大数据年龄寄存器地址（ms，0为不按读取刷新）
+#define MODBUS_REG_AGE_ADDR          0x00CD  // 数据年龄寄存器起始地址（温度、压力、湿度，ms）
+#define MODBUS_REG_TUNING_ADDR       0x00D0  // 运行参数寄存器起始地址（压力、温湿度采样周期，LCD刷新周期，存储周期，暂存时间，见tuning.h）
+                                             // 0x00D4暂存时间（秒，0~600，默认5）：掉电时丢失此时间内存储的记录
+#define MODBUS_REG_LOG_LEVEL_ADDR    0x00D5  // 日志级别寄存器地址
+#define MODBUS_REG_TUNING_SAVE_ADDR  0x00D6  // 写1保存运行参数
 #define MODBUS_REG_ERROR_COUNT_ADDR  0x0003  // 错误计数寄存器地址
+#define MODBUS_REG_FLASH_STATS_ADDR  0x0100  // Flash磨损统计输入寄存器窗口起始地址（FLASH_STATS_REG_COUNT个）
 
 // 兼容性别名
 #define REG_PRESSURE_ADDR            MODBUS_REG_PRESSURE_ADDR
@@ -34,6 +47,13 @@
 // 寄存器数量定义
 #define MODBUS_REGISTER_COUNT        300       // 总寄存器数量
 
+// 传感器标识（与WARM_STATE_VALID_xxx相同）
+#define SENSOR_DATA_PRESSURE         0x01
+#define SENSOR_DATA_TEMPERATURE      0x02
+#define SENSOR_DATA_HUMIDITY         0x04
+#define SENSOR_DATA_AGE_MAX          0xFFFE    // 数据年龄上限（ms）
+#define SENSOR_DATA_AGE_UNKNOWN      0xFFFF    // 本次启动后尚未采集（无效或热启动恢复的值）
+
 // 全局传感器数据结构体
 typedef struct {
     // 压力传感器数据
@@ -43,25 +63,28 @@ typedef struct {
     
     // 温度传感器数据
     float temperature;          // 温度值 (°C)
+    uint32_t temperature_timestamp; // 温度值时间戳
     uint8_t temperature_valid; // 温度值有效性标志
   
     // 湿度传感器数据
     float humidity;             // 湿度值 (%)
+    uint32_t humidity_timestamp; // 湿度值时间戳
     uint8_t humidity_valid;    // 湿度值有效性标志
     
     // 系统状态数据
     uint16_t system_status;     // 系统状态字
     uint16_t error_count;       // 错误计数
     uint32_t system_timestamp;  // 系统时间戳
+    uint8_t restored;           // 热启动恢复、尚未重新采集的值（WARM_STATE_VALID_xxx）
 } GlobalSensorData_t;
 
-// Modbus寄存器结构体（用于Modbus协议）
+// Modbus寄存器结构体（用于Modbus协议），前4个按寄存器地址顺序排列，可整段复制
 typedef struct {
-    uint16_t pressure;      // 压力值 (0.1 kPa)
-    uint16_t temperature;   // 温度值 (0.1 °C)
-    uint16_t humidity;
-    uint16_t status;        // 状态字
-    uint16_t error_count;   // 错误计数
+    uint16_t temperature;   // 温度值 (0.1 °C)，MODBUS_REG_TEMPERATURE_ADDR
+    uint16_t pressure;      // 压力值 (0.1 kPa)，MODBUS_REG_PRESSURE_ADDR
+    uint16_t humidity;      // 湿度值 (0.1 %)，MODBUS_REG_HUMIDITY_ADDR
+    uint16_t status;        // 状态字，MODBUS_REG_STATUS_ADDR
+    uint16_t error_count;   // 错误计数，MODBUS_REG_ERROR_COUNT_ADDR
 } ModbusRegisters_t;
 
 // 全局变量声明
@@ -79,6 +102,7 @@ void Modbus_UpdateTemperature(float temperature_value);
 void Modbus_UpdateStatus(uint16_t status_value);
 bool Modbus_IsModbusCommand(uint8_t* rx_buffer, uint16_t rx_length);
 bool Modbus_ProcessRequest(uint8_t* request, uint16_t request_length, uint8_t* response, uint16_t* response_length);
+bool Modbus_ProcessFrame(const uint8_t* frame, uint16_t frame_length, uint8_t* response, uint16_t* response_length);
 
 
 // 全局传感器数据管理函数
@@ -90,6 +114,7 @@ void SensorData_UpdateSystemStatus(uint16_t status);
 void SensorData_UpdateErrorCount(uint16_t error_count);
 void SensorData_UpdateCommunicationStatus(uint8_t i2c_status, uint8_t uart_status, uint8_t ble_status);
 GlobalSensorData_t* SensorData_GetGlobalData(void);
+uint16_t SensorData_GetAge(uint8_t sensor);
 void Modbus_BuildResponse(uint8_t slave_addr, uint8_t function_code, uint8_t* data, uint16_t data_length, uint8_t* response, uint16_t* response_length);
 void Modbus_BuildExceptionResponse(uint8_t slave_addr, uint8_t function_code, uint8_t exception_code, uint8_t* response, uint16_t* response_length);
 uint16_t Modbus_CalculateCRC16(uint8_t* data, uint16_t length);
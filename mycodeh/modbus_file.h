@@ -0,0 +1,39 @@
+#ifndef __MODBUS_FILE_H
+#define __MODBUS_FILE_H
+
+#include "main.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Modbus文件记录（FC 0x14 Read File Record）
+ *
+ * 列存储（flash_column.h）的每一列是一个数据流，用文件号选择，记录号为样本序号：
+ *   文件号 = (列号 + 1) << MODBUS_FILE_STREAM_SHIFT | 窗口号
+ *   样本序号 = 窗口号 * MODBUS_FILE_WINDOW_RECORDS + 记录号
+ * 标准规定记录号为0~9999，每个文件只能覆盖10000个样本，更早或更晚的样本在相邻的窗口中。
+ * 列号按记录格式字段表的顺序（record_codec.h，标志字段除外），flags列在最后。
+ *
+ * 每个样本占(列宽 + 1) / 2个寄存器，记录长度（寄存器数）必须是它的整数倍，子请求
+ * 不能跨越窗口。寄存器为列中的原始值，定点数未换算（比例见字段表）：4字节的值高16位
+ * 在前，flags列的寄存器低8位为flags字节。封存后未写入或块目录无效的样本各字节读为0xFF。
+ *
+ * 一个请求可包含多个子请求，应答数据最多MODBUS_FILE_MAX_DATA字节，一个子请求最多
+ * 121个寄存器。读取在Flash I/O服务任务中以交互优先级执行（FlashIo_Call），列值从
+ * 芯片直接读入发送缓冲区中各子应答的位置，再原地转换为寄存器，不经过中间缓冲区。
+ */
+
+#define MODBUS_FILE_REFERENCE_TYPE   6                     /* 子请求的参考类型（标准） */
+#define MODBUS_FILE_SUBREQUEST_SIZE  7                     /* 参考类型、文件号、记录号、记录长度 */
+#define MODBUS_FILE_MIN_BYTE_COUNT   0x07                  /* 请求字节数范围（标准） */
+#define MODBUS_FILE_MAX_BYTE_COUNT   0xF5
+#define MODBUS_FILE_MAX_DATA         0xF5                  /* 应答数据长度上限（标准） */
+#define MODBUS_FILE_MAX_SUBREQUESTS  (MODBUS_FILE_MAX_BYTE_COUNT / MODBUS_FILE_SUBREQUEST_SIZE)
+#define MODBUS_FILE_WINDOW_RECORDS   10000                 /* 每个文件的记录数（记录号0~9999） */
+#define MODBUS_FILE_STREAM_SHIFT     12                    /* 文件号高4位为列号+1，低12位为窗口号 */
+#define MODBUS_FILE_WINDOW_MASK      ((1 << MODBUS_FILE_STREAM_SHIFT) - 1)
+
+/* 函数声明 */
+uint8_t ModbusFile_Read(const uint8_t *request, uint16_t request_length, uint8_t *response, uint16_t *response_length);
+
+#endif /* __MODBUS_FILE_H */
@@ -0,0 +1,66 @@
+#ifndef __MODBUS_REGS_H
+#define __MODBUS_REGS_H
+
+#include "main.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Modbus寄存器表
+ *
+ * 每个描述符描述一段连续地址：直接复制的寄存器镜像（uint16_t数组，已按寄存器
+ * 单位缩放），或读取函数（参数为arg加段内偏移）。可写的描述符另有检查函数和
+ * 写入函数。描述符表在modbus_regs.c中
+ * 按地址排列，初始化时建立地址到描述符的索引，读请求对每段只查一次索引，段内
+ * 连续复制；增加寄存器只需在表中增加描述符。
+ *
+ * 没有描述符或不允许该功能码访问的地址读为0。
+ *
+ * 读请求的应答（FC 0x03/0x04）直接生成在端口的发送缓冲区中：寄存器值只写入一次，
+ * 每段写入后随即计算CRC，不经过中间缓冲区，也不再为CRC遍历整个应答。
+ *
+ * 传感器寄存器直接读取最新值，不等待采集。读到的值比最大数据年龄
+ * （MODBUS_REG_MAX_AGE_ADDR）旧时通知对应的采集任务，不等待结果，新值在下一次
+ * 读取时返回；每个值的年龄可从MODBUS_REG_AGE_ADDR读取。
+ *
+ * 写请求（FC 0x06/0x10）先检查全部地址和值，任何一个不合格都不写入；然后锁定
+ * 调度器逐个写入，其他任务只会看到全部写入前或全部写入后的参数。
+ */
+
+#define MODBUS_MAX_READ_REGISTERS    125                   /* FC 0x03/0x04一次最多读取的寄存器数（标准） */
+#define MODBUS_MAX_WRITE_REGISTERS   123                   /* FC 0x10一次最多写入的寄存器数（标准） */
+#define MODBUS_TUNING_SAVE_VALUE     1                     /* 写入MODBUS_REG_TUNING_SAVE_ADDR保存运行参数 */
+#define MODBUS_REFRESH_INTERVAL_MS   1000                  /* 同一任务两次刷新通知的最小间隔（DHT11采样间隔） */
+
+/* 访问权限 */
+#define MODBUS_REG_ACCESS_HOLDING    0x01                  /* FC 0x03可读 */
+#define MODBUS_REG_ACCESS_INPUT      0x02                  /* FC 0x04可读 */
+#define MODBUS_REG_ACCESS_READ       (MODBUS_REG_ACCESS_HOLDING | MODBUS_REG_ACCESS_INPUT)
+#define MODBUS_REG_ACCESS_WRITE      0x04                  /* FC 0x06/0x10可写 */
+
+/* 读取、写入和检查函数，offset为描述符的arg加段内偏移 */
+typedef uint16_t (*ModbusRegGetter_t)(uint16_t offset);
+typedef void (*ModbusRegSetter_t)(uint16_t offset, uint16_t value);
+typedef bool (*ModbusRegChecker_t)(uint16_t offset, uint16_t value);
+
+/* 寄存器描述符 */
+typedef struct {
+    uint16_t address;           /* 起始地址 */
+    uint16_t count;             /* 连续寄存器数 */
+    uint8_t access;             /* MODBUS_REG_ACCESS_xxx */
+    const volatile uint16_t *image;  /* 寄存器镜像，为NULL时使用get */
+    ModbusRegGetter_t get;      /* 不阻塞（一段寄存器在调度器锁定时连续读取） */
+    ModbusRegSetter_t set;      /* 可写时有效，不阻塞（在调度器锁定时调用） */
+    ModbusRegChecker_t check;   /* 可写时有效 */
+    uint16_t arg;
+    uint8_t refresh;            /* 读取时检查年龄的传感器（SENSOR_DATA_xxx） */
+} ModbusRegister_t;
+
+/* 函数声明 */
+void ModbusRegs_Init(void);
+uint8_t ModbusRegs_Read(uint16_t start, uint16_t count, uint8_t access, uint8_t *data, uint16_t *crc);
+uint8_t ModbusRegs_Write(uint16_t start, uint16_t count, const uint8_t *data);
+void ModbusRegs_RequestRefresh(uint8_t sensors);
+uint32_t ModbusRegs_GetRefreshRequests(void);
+
+#endif /* __MODBUS_REGS_H */
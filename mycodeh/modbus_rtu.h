@@ -0,0 +1,146 @@
+#ifndef __MODBUS_RTU_H
+#define __MODBUS_RTU_H
+
+#include "main.h"
+#include "usart.h"
+#include "tim.h"
+#include "ble_data.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Modbus RTU帧定界
+ *
+ * USART2以循环DMA接收到环形缓冲区，不使用逐字节中断。线路空闲一个字符时间后
+ * 产生一次IDLE中断，在其中重新启动单脉冲定时器TIM4：
+ *   CC1     IDLE后t1.5，此时仍无新字节则记下"超过t1.5"
+ *   更新    IDLE后t3.5减一个字符时间（即最后一个字符后t3.5），无新字节则帧结束
+ * 超过t1.5后、t3.5之前又收到字节，按标准整帧作废（MODBUS_RTU_FRAME_GAP_ERROR）。
+ * 每帧只有一次IDLE中断和两次定时器中断，与波特率和帧长无关。
+ *
+ * 每次IDLE和DMA半满/全满中断把新收到的字节计入当前帧的CRC，帧结束时只计算最后
+ * 一段，整帧（含CRC字节）CRC为0即正确（低字节在前，MODBUS_CRC_COMPAT_SWAPPED见
+ * modbus.h），连同标志交给输出函数，端口的输出函数复制到
+ * 端口的消息队列。USART2同时传输字符串和固件暂存数据，不合格的帧也会输出，由协议
+ * 任务根据标志区分；超过MODBUS_RTU_MAX_FRAME的连续数据按MODBUS_RTU_MAX_FRAME分段
+ * 输出，标记MODBUS_RTU_FRAME_PARTIAL。
+ *
+ * 每个端口（ModbusRtuPort_t）有自己的UART、定时器、环形缓冲区、帧定界状态和队列，
+ * 端口之间不共享可写状态，各由一个任务处理，共用寄存器表：
+ *   USART2  循环DMA接收，TIM4计时，输出到BLEQueue（Usart2_Task）
+ *   USART3  RXNE中断逐字节写入环形缓冲区，TIM5计时，输出到Usart3Queue（Usart3_Task）
+ * USART3的DMA通道（DMA1通道2/3）已由SPI1 Flash使用，只能用中断接收和发送；帧定界与DMA
+ * 端口相同，写入位置由中断维护，每半个缓冲区检查一次超长数据。
+ *
+ * 时间（标准6.1节）：波特率大于19200时t1.5=750us、t3.5=1750us，否则按字符时间计算。
+ */
+
+#define MODBUS_RTU_MAX_FRAME         256                   /* 最大RTU帧（ADU）字节数 */
+#define MODBUS_RTU_MIN_FRAME         4                     /* 地址+功能码+CRC */
+#define MODBUS_RTU_RX_RING_SIZE      1024                  /* 端口接收环形缓冲区，半满/全满时检查超长帧 */
+#define MODBUS_RTU_FIXED_BAUD        19200                 /* 超过此波特率使用固定的t1.5/t3.5 */
+#define MODBUS_RTU_FIXED_T15_US      750
+#define MODBUS_RTU_FIXED_T35_US      1750
+#define MODBUS_RTU_FLAG_TX_DONE      0x0400                /* 发送任务线程标志：应答已发送 */
+#define MODBUS_RTU_TX_TIMEOUT_MS     100                   /* 等待应答发送完成的最长时间 */
+#define MODBUS_RTU_TAP_ENABLE        1                     /* 应答旁路到日志（DEBUG级别） */
+#define MODBUS_RTU_TAP_BYTES         15                    /* 每个应答旁路输出的字节数 */
+
+/* 帧标志 */
+#define MODBUS_RTU_FRAME_OK          0x0001                /* 完整的RTU帧，CRC正确 */
+#define MODBUS_RTU_FRAME_GAP_ERROR   0x0002                /* 字符间隔超过t1.5 */
+#define MODBUS_RTU_FRAME_LINE_ERROR  0x0004                /* 校验、帧格式、噪声或溢出错误 */
+#define MODBUS_RTU_FRAME_CRC_ERROR   0x0008                /* CRC错误或帧太短 */
+#define MODBUS_RTU_FRAME_PARTIAL     0x0010                /* 超长数据的一段 */
+
+typedef struct ModbusRtuFramer ModbusRtuFramer_t;
+
+/* 帧输出函数，在中断中调用；帧位于环形缓冲区，用ModbusRtu_CopyFrame取出 */
+typedef void (*ModbusRtuSink_t)(ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint16_t flags);
+
+/* 帧间隔时间（us） */
+typedef struct {
+    uint32_t char_us;           /* 一个字符（含起始、校验、停止位） */
+    uint32_t t15_us;
+    uint32_t t35_us;
+} ModbusRtuTiming_t;
+
+/* 统计 */
+typedef struct {
+    uint32_t frames;            /* 正确的帧 */
+    uint32_t crc_errors;        /* CRC错误或太短 */
+    uint32_t gap_errors;        /* t1.5间隔错误 */
+    uint32_t line_errors;       /* 线路错误 */
+    uint32_t partial;           /* 超长数据段 */
+    uint32_t dropped;           /* 输出队列满丢弃的帧 */
+    uint32_t idle_events;       /* IDLE中断次数 */
+    uint32_t timer_events;      /* 定时器中断次数 */
+    uint32_t max_frame_cycles;  /* 帧结束处理最长周期数 */
+} ModbusRtuStats_t;
+
+/* 应答统计（端口任务中更新） */
+typedef struct {
+    uint32_t responses;         /* 已发送的应答 */
+    uint32_t tx_errors;         /* 发送失败或超时 */
+    uint32_t turnaround_max_us; /* 帧结束（t3.5）到开始发送的最长时间 */
+    uint32_t turnaround_total_us;
+    uint32_t cpu_max_cycles;    /* 任务处理一个请求的最长周期数（不含等待发送） */
+    uint32_t cpu_total_cycles;
+} ModbusRtuTxStats_t;
+
+/* 帧定界状态，只在同一优先级的中断中访问 */
+struct ModbusRtuFramer {
+    const uint8_t *ring;        /* DMA环形缓冲区 */
+    uint16_t ring_size;
+    uint16_t frame_start;       /* 当前帧在环形缓冲区中的起点 */
+    uint16_t idle_position;     /* 最近一次IDLE时的写入位置 */
+    bool t15_expired;           /* IDLE后已超过t1.5且没有新字节 */
+    uint16_t flags;             /* 当前帧已发现的错误 */
+    uint16_t crc;               /* 当前帧已收到字节的CRC */
+    uint16_t crc_position;      /* CRC已计算到的位置 */
+    ModbusRtuSink_t sink;
+    void *context;              /* 输出函数使用 */
+    ModbusRtuStats_t stats;
+};
+
+/* 帧定界（与硬件无关，由中断调用，也用于回放测试） */
+void ModbusRtu_FramerInit(ModbusRtuFramer_t *framer, const uint8_t *ring, uint16_t ring_size,
+                          uint16_t position, ModbusRtuSink_t sink, void *context);
+void ModbusRtu_GetTiming(uint32_t baud_rate, uint32_t char_bits, ModbusRtuTiming_t *timing);
+void ModbusRtu_OnIdle(ModbusRtuFramer_t *framer, uint16_t position, bool line_error);
+void ModbusRtu_OnT15(ModbusRtuFramer_t *framer, uint16_t position);
+void ModbusRtu_OnT35(ModbusRtuFramer_t *framer, uint16_t position);
+void ModbusRtu_OnDmaEvent(ModbusRtuFramer_t *framer, uint16_t position);
+void ModbusRtu_CopyFrame(const ModbusRtuFramer_t *framer, uint16_t start, uint16_t length, uint8_t *buffer);
+
+/* RTU端口 */
+typedef struct {
+    UART_HandleTypeDef *huart;
+    TIM_HandleTypeDef *htim;    /* t1.5/t3.5单脉冲定时器，1us计数 */
+    osMessageQueueId_t *queue;  /* 帧输出队列的句柄 */
+    uint8_t ring[MODBUS_RTU_RX_RING_SIZE];  /* 接收环形缓冲区 */
+    volatile uint16_t rx_position;  /* 中断接收时的写入位置（DMA接收时不用） */
+    bool rx_line_error;         /* 中断接收时本段数据的线路错误 */
+    ModbusRtuFramer_t framer;
+    BLEMessage_t message;       /* 输出到队列的消息，只在中断中使用 */
+    uint8_t tx_buffer[MODBUS_RTU_MAX_FRAME];  /* 发送缓冲区，应答直接生成在这里，发送完成前不能改写 */
+    osThreadId_t tx_thread;     /* 等待发送完成的任务 */
+    bool tap;                   /* 应答旁路到日志 */
+    ModbusRtuTxStats_t tx_stats;
+} ModbusRtuPort_t;
+
+/* 全局变量声明 */
+extern ModbusRtuPort_t g_modbus_rtu_usart2;   /* USART2 + TIM4，DMA接收 */
+extern ModbusRtuPort_t g_modbus_rtu_usart3;   /* USART3 + TIM5，RXNE中断接收 */
+extern osMessageQueueId_t Usart3QueueHandle;
+
+/* 端口（由UART和定时器中断调用） */
+void ModbusRtu_Start(ModbusRtuPort_t *port);
+void ModbusRtu_UartIrq(ModbusRtuPort_t *port);
+void ModbusRtu_TimerIrq(ModbusRtuPort_t *port);
+const ModbusRtuStats_t* ModbusRtu_GetStats(const ModbusRtuPort_t *port);
+void ModbusRtu_TxCpltCallback(UART_HandleTypeDef *huart);
+uint16_t ModbusRtu_Serve(ModbusRtuPort_t *port, BLEMessage_t *msg);
+const ModbusRtuTxStats_t* ModbusRtu_GetTxStats(const ModbusRtuPort_t *port);
+
+#endif /* __MODBUS_RTU_H */
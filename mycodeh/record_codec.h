@@ -0,0 +1,103 @@
+#ifndef __RECORD_CODEC_H
+#define __RECORD_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 传感器记录紧凑编码（Flash数据区记录内容）
+ *
+ * 编码格式（小端）：version(1) | 非标志字段（按字段表顺序） | flags（标志字段按位打包）
+ *
+ * 字段表是唯一的格式定义，编码、解码、字段描述表和记录长度都由它展开生成。
+ * 修改字段表时必须递增RECORD_SCHEMA_VERSION，解码器拒绝版本不符的记录。
+ *
+ *   FIXED 有符号定点数，存储round(值 * scale)，超出宽度范围时饱和
+ *   UINT  无符号整数
+ *   FLAG  1位标志
+ *
+ * 解码部分不依赖HAL，定义USE_HAL_DRIVER以外的环境（上位机）可单独编译
+ * record_codec.c作为解码库，通过字段描述表按名称导出数据。
+ */
+
+#define RECORD_SCHEMA_VERSION        1
+
+/*  X(name,              kind,  width, scale,   unit,  member)
+ *  width为字节数（FLAG为0），member为GlobalSensorData_t中对应的成员 */
+#define SENSOR_RECORD_FIELDS(X) \
+    X(timestamp,         UINT,  4,     1,       "ms",  system_timestamp)   \
+    X(pressure,          FIXED, 4,     1000000, "MPa", pressure_value)     \
+    X(temperature,       FIXED, 2,     100,     "C",   temperature)        \
+    X(humidity,          FIXED, 2,     100,     "%",   humidity)           \
+    X(system_status,     UINT,  2,     1,       "",    system_status)      \
+    X(error_count,       UINT,  2,     1,       "",    error_count)        \
+    X(pressure_valid,    FLAG,  0,     1,       "",    pressure_valid)     \
+    X(temperature_valid, FLAG,  0,     1,       "",    temperature_valid)  \
+    X(humidity_valid,    FLAG,  0,     1,       "",    humidity_valid)
+
+/* 旧版本记录：编码之前直接保存的GlobalSensorData_t。该结构体之后增加了字段，
+ * 旧记录按冻结的Cortex-M布局（double按8字节对齐，共40字节）逐个字段解码，
+ * 编码后的记录长度不能等于RECORD_LEGACY_SIZE */
+#define RECORD_LEGACY_SIZE               40
+#define RECORD_LEGACY_PRESSURE           0     /* double，MPa */
+#define RECORD_LEGACY_PRESSURE_TIME      8     /* uint32_t，ms */
+#define RECORD_LEGACY_PRESSURE_VALID     12    /* uint8_t */
+#define RECORD_LEGACY_TEMPERATURE        16    /* float，C */
+#define RECORD_LEGACY_TEMPERATURE_VALID  20    /* uint8_t */
+#define RECORD_LEGACY_HUMIDITY           24    /* float，% */
+#define RECORD_LEGACY_HUMIDITY_VALID     28    /* uint8_t */
+#define RECORD_LEGACY_STATUS             30    /* uint16_t */
+#define RECORD_LEGACY_ERROR_COUNT        32    /* uint16_t */
+#define RECORD_LEGACY_TIMESTAMP          36    /* uint32_t，ms */
+
+/* 字段类型 */
+typedef enum {
+    RECORD_FIELD_FIXED = 0,
+    RECORD_FIELD_UINT,
+    RECORD_FIELD_FLAG
+} RecordFieldKind_t;
+
+/* 字段下标 */
+#define RECORD_FIELD_INDEX(name, kind, width, scale, unit, member) RECORD_FIELD_##name,
+typedef enum {
+    SENSOR_RECORD_FIELDS(RECORD_FIELD_INDEX)
+    RECORD_FIELD_COUNT
+} RecordFieldIndex_t;
+#undef RECORD_FIELD_INDEX
+
+/* 记录长度 */
+#define RECORD_FLAG_BITS_FIXED       0
+#define RECORD_FLAG_BITS_UINT        0
+#define RECORD_FLAG_BITS_FLAG        1
+#define RECORD_FIELD_WIDTH(name, kind, width, scale, unit, member) + (width)
+#define RECORD_FIELD_FLAG_BITS(name, kind, width, scale, unit, member) + RECORD_FLAG_BITS_##kind
+#define RECORD_VALUE_SIZE            (0 SENSOR_RECORD_FIELDS(RECORD_FIELD_WIDTH))
+#define RECORD_FLAG_COUNT            (0 SENSOR_RECORD_FIELDS(RECORD_FIELD_FLAG_BITS))
+#define RECORD_ENCODED_SIZE          (1 + RECORD_VALUE_SIZE + (RECORD_FLAG_COUNT + 7) / 8)
+
+/* 字段描述 */
+typedef struct {
+    const char *name;           /* 字段名 */
+    const char *unit;           /* 单位 */
+    RecordFieldKind_t kind;     /* 字段类型 */
+    uint8_t width;              /* 字节数，FLAG为0 */
+    uint32_t scale;             /* 定点数比例 */
+} RecordFieldDesc_t;
+
+/* 函数声明 */
+
+/* 解码库（不依赖HAL） */
+const RecordFieldDesc_t* RecordCodec_GetField(uint32_t index);
+uint32_t RecordCodec_GetLE(const uint8_t *p, uint8_t width);
+double RecordCodec_FieldValue(uint32_t index, uint32_t raw);
+bool RecordCodec_DecodeValues(const uint8_t *record, uint32_t length, double *values);
+
+#ifdef USE_HAL_DRIVER
+#include "modbus.h"
+
+/* 设备端编解码 */
+uint32_t RecordCodec_EncodeSensorData(const GlobalSensorData_t *data, uint8_t *record);
+bool RecordCodec_DecodeSensorData(const uint8_t *record, uint32_t length, GlobalSensorData_t *data);
+#endif
+
+#endif /* __RECORD_CODEC_H */
@@ -0,0 +1,69 @@
+#ifndef __TUNING_H
+#define __TUNING_H
+
+#include "main.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 运行参数
+ *
+ * 采样周期、LCD刷新周期、记录存储周期和暂存时间等可在运行时由Modbus写入
+ * （MODBUS_REG_MAX_AGE_ADDR和MODBUS_REG_TUNING_ADDR起的保持寄存器），不必重新
+ * 烧写固件。各任务每次等待前读取对应的参数，新值在当前等待结束后生效。
+ *
+ * 写入只改变RAM中的参数；写MODBUS_REG_TUNING_SAVE_ADDR后由Flash I/O服务任务
+ * 保存到文件区的TUNING_FILE_NAME，启动挂载文件区后加载。文件损坏或某个值超出
+ * 范围时该值使用默认值。日志级别已由热启动快照保存，不在此文件中。
+ */
+
+#define TUNING_FILE_NAME             "tuning.cfg"
+#define TUNING_FILE_MAGIC            0x454E5554            /* "TUNE" */
+
+/* 默认值 */
+#define TUNING_DEFAULT_MAX_AGE_MS    2000                  /* 最大数据年龄，0为不按读取刷新 */
+#define TUNING_DEFAULT_PRESSURE_MS   5000                  /* 压力采样周期 */
+#define TUNING_DEFAULT_DHT11_MS      5000                  /* 温湿度采样周期 */
+#define TUNING_DEFAULT_LCD_MS        1000                  /* LCD刷新周期 */
+#define TUNING_DEFAULT_STORE_S       5                     /* 传感器记录存储周期 */
+#define TUNING_DEFAULT_BATCH_S       5                     /* 记录暂存时间，到期后编程并保存索引；
+                                                              与FLASH_STAGE_FLUSH_MS一致，掉电时丢失此时间内的记录 */
+
+/* 运行参数，按寄存器顺序排列（uint16_t数组），下标即TUNING_xxx */
+typedef struct {
+    uint16_t max_age_ms;        /* MODBUS_REG_MAX_AGE_ADDR */
+    uint16_t pressure_period_ms;  /* MODBUS_REG_TUNING_ADDR */
+    uint16_t dht11_period_ms;
+    uint16_t lcd_period_ms;
+    uint16_t store_period_s;
+    uint16_t store_batch_s;
+} Tuning_t;
+
+#define TUNING_MAX_AGE               0
+#define TUNING_PRESSURE_PERIOD       1
+#define TUNING_DHT11_PERIOD          2
+#define TUNING_LCD_PERIOD            3
+#define TUNING_STORE_PERIOD          4
+#define TUNING_STORE_BATCH           5
+#define TUNING_COUNT                 (sizeof(Tuning_t) / sizeof(uint16_t))
+
+/* 参数文件 */
+typedef struct {
+    uint32_t magic;             /* 标志位 TUNING_FILE_MAGIC */
+    uint16_t count;             /* 参数个数 */
+    uint16_t values[TUNING_COUNT];
+    uint16_t crc16;             /* 以上内容的CRC16 */
+} __attribute__((packed)) TuningFile_t;
+
+/* 全局变量声明 */
+extern Tuning_t g_tuning;
+
+/* 函数声明 */
+bool Tuning_Check(uint16_t index, uint16_t value);
+void Tuning_Set(uint16_t index, uint16_t value);
+void Tuning_Load(void);
+void Tuning_RequestSave(void);
+bool Tuning_IsSavePending(void);
+void Tuning_Process(void);
+
+#endif /* __TUNING_H */
@@ -0,0 +1,81 @@
+#ifndef __WARM_STATE_H
+#define __WARM_STATE_H
+
+#include "main.h"
+#include "flash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 热启动状态快照
+ *
+ * 最新传感器值、Modbus寄存器、错误计数、记录存储位置和配置保存在系统区的
+ * 状态区（2个扇区），复位后Flash识别芯片、尚未加载索引表或扫描数据区时即加载，
+ * Modbus不必等传感器任务重新采集就能回答最近的值。Modbus初始化等待加载超时的，
+ * 由Flash I/O服务任务在加载后恢复仍为初始值的字段，恢复之前不保存快照。
+ *
+ * 状态区按固定大小的槽顺序追加写入，每个扇区WARM_STATE_SLOTS_PER_SECTOR个槽，
+ * 一个扇区写满后擦除另一个扇区继续写，旧扇区在下次轮换前仍可回退。恢复时
+ * 比较两个扇区第一个槽的序号确定当前扇区，二分查找最后一个已写入的槽，
+ * CRC错误（写入中掉电）时向前回退，只需读取几个页。
+ *
+ * 保存时机：
+ *   周期      内容有变化时每WARM_STATE_SAVE_INTERVAL_MS保存一次
+ *   事件      系统状态、错误计数变化等调用WarmState_RequestSave，
+ *             由Flash I/O服务任务在WARM_STATE_MIN_INTERVAL_MS间隔内合并保存
+ *   受控复位  复位前在服务任务中调用WarmState_Save
+ */
+
+/* 状态区布局（W25Q64_STATE_AREA_START起） */
+#define WARM_STATE_SLOT_SIZE         64                    /* 每个槽大小，等于sizeof(WarmState_t) */
+#define WARM_STATE_SLOTS_PER_SECTOR  (W25Q64_SECTOR_SIZE / WARM_STATE_SLOT_SIZE)
+#define WARM_STATE_MAGIC             0x4D524157            /* "WARM" */
+
+/* 保存策略 */
+#define WARM_STATE_SAVE_INTERVAL_MS  (60 * 1000)           /* 周期保存间隔 */
+#define WARM_STATE_MIN_INTERVAL_MS   (5 * 1000)            /* 事件保存的最小间隔，限制擦写 */
+#define WARM_STATE_WAIT_MS           500                   /* Modbus初始化等待状态加载的最长时间 */
+
+/* 有效标志 */
+#define WARM_STATE_VALID_PRESSURE    0x01
+#define WARM_STATE_VALID_TEMPERATURE 0x02
+#define WARM_STATE_VALID_HUMIDITY    0x04
+
+/* 状态快照（一个槽） */
+typedef struct {
+    uint32_t magic;             /* 标志位 WARM_STATE_MAGIC */
+    uint32_t sequence;          /* 保存序号，递增 */
+    uint32_t boot_count;        /* 恢复过的启动次数 */
+    uint32_t head_id;           /* 保存时的最新记录ID */
+    uint32_t record_count;      /* 保存时的记录数 */
+    double pressure_value;      /* 压力值 (MPa) */
+    float temperature;          /* 温度值 (°C) */
+    float humidity;             /* 湿度值 (%) */
+    uint16_t system_status;     /* 系统状态字 */
+    uint16_t error_count;       /* 错误计数 */
+    uint16_t registers[5];      /* Modbus寄存器（ModbusRegisters_t） */
+    uint8_t valid;              /* WARM_STATE_VALID_xxx */
+    uint8_t log_level;          /* 日志级别 */
+    uint32_t uptime_ms;         /* 保存时的运行时间 */
+    uint8_t reserved[6];        /* 保留，写0xFF */
+    uint16_t crc16;             /* 以上内容的CRC16 */
+} __attribute__((packed)) WarmState_t;
+
+/* 统计（仅RAM） */
+typedef struct {
+    bool restored;              /* 本次启动从快照恢复 */
+    uint32_t load_us;           /* 加载耗时 */
+    uint32_t saves;             /* 本次启动保存次数 */
+    uint32_t skipped;           /* 内容无变化而跳过的周期保存次数 */
+    uint32_t fallbacks;         /* 恢复时跳过的损坏槽数 */
+} WarmStateStats_t;
+
+/* 函数声明 */
+void WarmState_Load(void);
+bool WarmState_Restore(uint32_t timeout_ms);
+void WarmState_RequestSave(void);
+FlashResult_t WarmState_Save(void);
+void WarmState_Process(void);
+const WarmStateStats_t* WarmState_GetStats(void);
+
+#endif /* __WARM_STATE_H */